@@ -85,6 +85,9 @@ public:
   bool pipeline = true;
   // pull model after each sync_frequency mini-batch
   int sync_frequency = 1;
+  // push 1 bit per weight of the dense model, with one scale per output
+  // row, the rounding error is kept and pushed with the next updates
+  bool one_bit_add = false;
 
   // default with simple minus updater
   // [default] [sgd] [ftrl]
@@ -65,6 +65,7 @@ Configure::Configure(const std::string& config_file) {
   CONFIG_PARSE_BOOL(sparse);
   CONFIG_PARSE_BOOL(pipeline);
   CONFIG_PARSE_INT(sync_frequency);
+  CONFIG_PARSE_BOOL(one_bit_add);
 
   CONFIG_PARSE_STRING(train_file);
   CONFIG_PARSE_STRING(reader_type);
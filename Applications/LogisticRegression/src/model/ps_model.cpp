@@ -36,8 +36,12 @@ PSModel<EleType>::PSModel(Configure& config) :
         multiverso::MV_CreateTable(SparseTableOption<EleType>(size)));
     }
   } else {
+    multiverso::ArrayTableOption<EleType> option(size);
+    if (config.one_bit_add) {
+      option.one_bit_block = static_cast<size_t>(config.input_size);
+    }
     this->worker_table_ = static_cast<multiverso::WorkerTable*>(
-      multiverso::MV_CreateTable(multiverso::ArrayTableOption<EleType>(size)));
+      multiverso::MV_CreateTable(option));
   }
   
   std::stringstream ss;
@@ -249,7 +249,7 @@ namespace wordembedding {
   }
 
   int64 const Communicator::GetWordCount() {
-    std::unordered_map<int, int64> &kv = worker_wordcount_table_->raw();
+    auto &kv = worker_wordcount_table_->raw();
     worker_wordcount_table_->Get(kWordCountId);
     return kv[kWordCountId];
   }
@@ -4,16 +4,38 @@
 namespace multiverso {
 namespace test {
 
+void TestAllocator(int argc, char* argv[]);
+
 void TestAllreduce(int argc, char* argv[]);
 
+void TestAllreduceCompression(int argc, char* argv[]);
+
 void TestArray(int argc, char* argv[]);
 
+void TestCheckpoint(int argc, char* argv[]);
+
+void TestHotRows(int argc, char* argv[]);
+
 void TestKV(int argc, char* argv[]);
 
+void TestKVPerf(int argc, char* argv[]);
+
 void TestMatrix(int argc, char* argv[]);
 
 void TestNet(int argc, char* argv[]);
 
+void TestOneBitAdd(int argc, char* argv[]);
+
+void TestQueue(int argc, char* argv[]);
+
+void TestSendPerf(int argc, char* argv[]);
+
+void TestStorage(int argc, char* argv[]);
+
+void TestUpdater(int argc, char* argv[]);
+
+void TestVersionedGet(int argc, char* argv[]);
+
 }  // namespace test
 }  // namespace multiverso
 
@@ -0,0 +1,92 @@
+#include <iostream>
+#include <memory>
+#include <random>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <multiverso/multiverso.h>
+#include <multiverso/blob.h>
+#include <multiverso/dashboard.h>
+#include <multiverso/util/allocator.h>
+#include <multiverso/util/log.h>
+#include <multiverso/util/timer.h>
+#include <multiverso/table/matrix_table.h>
+
+namespace multiverso {
+namespace test {
+
+namespace {
+
+// Alloc and free Blobs of mixed sizes from several threads, each thread
+// keeping a window of live Blobs like a message pipeline does
+double BlobAllocPerf(int num_threads, int num_ops) {
+  Timer timer;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < num_threads; ++t) {
+    threads.emplace_back([num_ops, t]() {
+      std::mt19937 gen(t);
+      std::uniform_int_distribution<int> dis(4, 16);
+      std::vector<Blob> window(64);
+      for (int i = 0; i < num_ops; ++i) {
+        window[i % window.size()] = Blob(static_cast<size_t>(1) << dis(gen));
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  return 1000.0 * num_threads * num_ops / timer.elapse();
+}
+
+// Partition of a keyed Add, as done by the worker for every request
+template <typename T>
+double PartitionPerf(MatrixWorkerTable<T>* table, int num_row, int num_col,
+                     int num_keys, int num_ops) {
+  std::mt19937 gen(0);
+  std::uniform_int_distribution<int> dis(0, num_row - 1);
+  Blob keys(num_keys * sizeof(integer_t));
+  for (int i = 0; i < num_keys; ++i) keys.As<integer_t>(i) = dis(gen);
+  Blob values(num_keys * num_col * sizeof(T));
+  std::vector<Blob> kv = { keys, values };
+
+  Timer timer;
+  for (int i = 0; i < num_ops; ++i) {
+    std::unordered_map<int, std::vector<Blob>> out;
+    table->Partition(kv, MsgType::Request_Add, &out);
+  }
+  return 1000.0 * num_ops / timer.elapse();
+}
+
+}  // namespace
+
+// Compare the smart allocator with and without the per-thread caches
+// (flag allocator_thread_cache)
+void TestAllocator(int argc, char* argv[]) {
+  Log::ResetLogLevel(LogLevel::Info);
+  MV_Init(&argc, argv);
+
+  int num_row = 100000, num_col = 50;
+  MatrixWorkerTable<float> worker_table(num_row, num_col);
+  MatrixServerTable<float> server_table(num_row, num_col);
+  MV_Barrier();
+
+  for (auto thread_cache : { false, true }) {
+    MV_SetFlag("allocator_thread_cache", thread_cache);
+    std::string name = thread_cache ? "thread cache" : "no thread cache";
+    for (auto num_threads : { 1, 4 }) {
+      std::cout << "[" << name << "] blob alloc/free, " << num_threads
+        << " threads: " << BlobAllocPerf(num_threads, 1000000)
+        << " ops/s" << std::endl;
+    }
+    std::cout << "[" << name << "] partition of 16 rows: "
+      << PartitionPerf(&worker_table, num_row, num_col, 16, 200000)
+      << " ops/s" << std::endl;
+  }
+
+  MV_Barrier();
+  Dashboard::Display();
+  std::cout << "trim released " << MV_TrimAllocator() << " bytes" << std::endl;
+  MV_ShutDown();
+}
+
+}  // namespace test
+}  // namespace multiverso
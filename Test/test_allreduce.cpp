@@ -1,12 +1,110 @@
+#include <string>
+#include <vector>
+
 #include <multiverso/multiverso.h>
 #include <multiverso/net.h>
+#include <multiverso/net/allreduce_engine.h>
 #include <multiverso/util/configure.h>
 #include <multiverso/util/log.h>
-#include <multiverso/util/net_util.h>
+#include <multiverso/util/timer.h>
 
 namespace multiverso {
+
+MV_DECLARE_int(allreduce_chunk_bytes);
+
 namespace test {
 
+namespace {
+
+void SumFloat(const char* src, char* dst, int len) {
+  const float* from = reinterpret_cast<const float*>(src);
+  float* to = reinterpret_cast<float*>(dst);
+  for (int i = 0; i < len / static_cast<int>(sizeof(float)); ++i) {
+    to[i] += from[i];
+  }
+}
+
+// all the algorithms on the same data, each result checked against the
+// exact sum, with and without the pipelined reduce steps. Run with
+// -allreduce_ranks_per_host=n to try the hierarchical algorithm on one host
+void BenchmarkAllreduce() {
+  AllreduceEngine engine;
+  engine.Init(NetInterface::Get());
+  const HierarchicalMap& hosts = engine.hierarchical_map();
+  int rank = MV_Rank(), size = MV_Size();
+  if (rank == 0) {
+    Log::Info("%d machines on %d hosts, %d on the host of rank 0%s\n", size,
+              hosts.num_hosts, static_cast<int>(hosts.local_ranks.size()),
+              hosts.balanced ? "" : ", unbalanced");
+  }
+  const std::pair<AllreduceAlgorithm, std::string> algorithms[] = {
+    { AllreduceAlgorithm::Auto, "auto" },
+    { AllreduceAlgorithm::AllGather, "allgather" },
+    { AllreduceAlgorithm::RecursiveHalving, "halving" },
+    { AllreduceAlgorithm::Ring, "ring" },
+    { AllreduceAlgorithm::Hierarchical, "hierarchical" }
+  };
+  const int chunk_bytes = MV_CONFIG_allreduce_chunk_bytes;
+  // the reduce steps are not pipelined by default
+  const int pipelined_chunk_bytes = chunk_bytes > 0 ? chunk_bytes : 256 * 1024;
+  for (int count : { 1, 1000, 1 << 16, 1 << 20, 1 << 22 }) {
+    int bytes = count * static_cast<int>(sizeof(float));
+    int repeats = count < (1 << 16) ? 50 : 5;
+    std::vector<float> input(count), output(count);
+    for (auto& algorithm : algorithms) for (bool pipelined : { true, false }) {
+      // all gather has no reduce step
+      if (!pipelined && algorithm.first == AllreduceAlgorithm::AllGather) continue;
+      SetCMDFlag("allreduce_chunk_bytes", pipelined ? pipelined_chunk_bytes : 0);
+      // small integers, exact in float whatever the order of the sums
+      for (int i = 0; i < count; ++i) { input[i] = static_cast<float>(rank + i % 7); }
+      // no barrier without the parameter server
+      int sync = 0;
+      MV_Aggregate(&sync, 1);
+      Timer timer;
+      for (int r = 0; r < repeats; ++r) {
+        engine.Allreduce(reinterpret_cast<char*>(input.data()), bytes, sizeof(float),
+                         reinterpret_cast<char*>(output.data()), &SumFloat, algorithm.first);
+      }
+      double ms = timer.elapse() / repeats;
+      for (int i = 0; i < count; ++i) {
+        CHECK(output[i] == size * (size - 1) / 2 + size * (i % 7));
+      }
+      // in place
+      engine.Allreduce(reinterpret_cast<char*>(input.data()), bytes, sizeof(float),
+                       reinterpret_cast<char*>(input.data()), &SumFloat, algorithm.first);
+      CHECK(input == output);
+      if (rank == 0) {
+        Log::Info("%-12s %-9s %8d floats %10.3f ms %10.1f MB/s\n", algorithm.second.c_str(),
+                  pipelined ? "" : "unchunked", count, ms, bytes / ms / 1e3);
+      }
+    }
+  }
+  SetCMDFlag("allreduce_chunk_bytes", chunk_bytes);
+}
+
+// layer-wise aggregates started one after the other, with a blocking one in
+// between that runs after them
+void TestAggregateAsync() {
+  const int num_layers = 8, size = MV_Size();
+  std::vector<std::vector<float>> layers(num_layers);
+  std::vector<net::AllreduceHandle> handles;
+  for (int i = 0; i < num_layers; ++i) {
+    layers[i].assign(1000 << i, static_cast<float>(i));
+    handles.push_back(MV_AggregateAsync(layers[i].data(), static_cast<int>(layers[i].size())));
+  }
+  int a = 1;
+  MV_Aggregate(&a, 1);
+  CHECK(a == size);
+  for (auto& handle : handles) CHECK(handle.Test());
+  for (int i = 0; i < num_layers; ++i) {
+    handles[i].Wait();
+    for (auto value : layers[i]) CHECK(value == i * size);
+  }
+  CHECK(net::AllreduceHandle().Test());
+}
+
+}  // namespace
+
 void TestAllreduce(int argc, char* argv[]) {
   multiverso::SetCMDFlag("ma", true);
   MV_Init(&argc, argv);
@@ -15,8 +113,15 @@ void TestAllreduce(int argc, char* argv[]) {
 
   CHECK(a == MV_Size());
 
+  std::vector<double> b(100000, 1.0);
+  MV_Aggregate(b.data(), static_cast<int>(b.size()));
+  for (auto value : b) CHECK(value == MV_Size());
+
+  TestAggregateAsync();
+  BenchmarkAllreduce();
+
   MV_ShutDown();
 }
 
 }  // namespace test
-}  // namespace multiverso
\ No newline at end of file
+}  // namespace multiverso
@@ -0,0 +1,185 @@
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <multiverso/multiverso.h>
+#include <multiverso/net.h>
+#include <multiverso/net/allreduce_engine.h>
+#include <multiverso/util/configure.h>
+#include <multiverso/util/log.h>
+#include <multiverso/util/timer.h>
+
+namespace multiverso {
+namespace test {
+
+namespace {
+
+enum class Compression { None, Half, BFloat16, TopK };
+
+void SumFloat(const char* src, char* dst, int len) {
+  const float* from = reinterpret_cast<const float*>(src);
+  float* to = reinterpret_cast<float*>(dst);
+  for (int i = 0; i < len / static_cast<int>(sizeof(float)); ++i) {
+    to[i] += from[i];
+  }
+}
+
+// Least squares split over the machines, each holds num_rows rows of A and b
+// with unit norm rows, so a step of 0.4 is stable up to about 16 machines
+class LeastSquares {
+public:
+  LeastSquares(int dim, int num_rows, int rank) : dim_(dim), num_rows_(num_rows),
+    a_(static_cast<size_t>(dim) * num_rows), b_(num_rows), residual_(num_rows) {
+    // the same solution on all machines
+    std::mt19937 shared(0);
+    std::normal_distribution<float> normal;
+    std::vector<float> solution(dim);
+    for (auto& value : solution) value = normal(shared);
+    std::mt19937 local(rank + 1);
+    float scale = 1.0f / std::sqrt(static_cast<float>(dim));
+    for (int r = 0; r < num_rows; ++r) {
+      float* row = &a_[static_cast<size_t>(r) * dim];
+      double dot = 0.0;
+      for (int j = 0; j < dim; ++j) {
+        row[j] = normal(local) * scale;
+        dot += row[j] * solution[j];
+      }
+      b_[r] = static_cast<float>(dot) + 0.01f * normal(local);
+    }
+  }
+
+  // half the squared error of the local rows at x, the local gradient in grad
+  double Gradient(const std::vector<float>& x, std::vector<float>* grad) {
+    double loss = 0.0;
+    for (int r = 0; r < num_rows_; ++r) {
+      const float* row = &a_[static_cast<size_t>(r) * dim_];
+      double dot = 0.0;
+      for (int j = 0; j < dim_; ++j) dot += row[j] * x[j];
+      residual_[r] = static_cast<float>(dot) - b_[r];
+      loss += 0.5 * residual_[r] * residual_[r];
+    }
+    grad->assign(dim_, 0.0f);
+    for (int r = 0; r < num_rows_; ++r) {
+      const float* row = &a_[static_cast<size_t>(r) * dim_];
+      for (int j = 0; j < dim_; ++j) (*grad)[j] += residual_[r] * row[j];
+    }
+    return loss;
+  }
+
+private:
+  int dim_, num_rows_;
+  std::vector<float> a_, b_, residual_;
+};
+
+// small integers, exact in fp16 and bf16 whatever the order of the sums, and
+// the top-k of all the elements is the exact sum. Run with
+// -allreduce_ring_bytes=0 -allreduce_ranks_per_host=n for the hierarchical path
+void CheckCompressedAllreduce(AllreduceEngine* engine) {
+  HalfCodec half;
+  BFloat16Codec bfloat16;
+  int rank = MV_Rank(), size = MV_Size();
+  for (int count : { 1, 1000, 1 << 16, 1 << 20 }) {
+    int bytes = count * static_cast<int>(sizeof(float));
+    std::vector<float> input(count), output(count), residual(count, 0.0f);
+    for (int i = 0; i < count; ++i) { input[i] = static_cast<float>(rank + i % 7); }
+    for (const ReduceCodec* codec : { static_cast<const ReduceCodec*>(&half),
+                                      static_cast<const ReduceCodec*>(&bfloat16) }) {
+      engine->CompressedAllreduce(reinterpret_cast<char*>(input.data()), bytes, sizeof(float),
+                                  reinterpret_cast<char*>(output.data()), *codec);
+      for (int i = 0; i < count; ++i) {
+        CHECK(output[i] == size * (size - 1) / 2 + size * (i % 7));
+      }
+    }
+    engine->TopKAllreduce(input.data(), count, count, residual.data(), output.data());
+    for (int i = 0; i < count; ++i) {
+      CHECK(output[i] == size * (size - 1) / 2 + size * (i % 7));
+      CHECK(residual[i] == 0.0f);
+    }
+  }
+}
+
+}  // namespace
+
+// Gradient descent on a least squares problem with the gradient summed by
+// the compressed allreduces: the loss against the bytes sent by each machine.
+// The uncompressed sum runs on the ring or the hierarchical algorithm like
+// fp16 / bf16 do, so those send exactly half its bytes
+void TestAllreduceCompression(int argc, char* argv[]) {
+  SetCMDFlag("ma", true);
+  MV_Init(&argc, argv);
+  AllreduceEngine engine;
+  engine.Init(NetInterface::Get());
+  CheckCompressedAllreduce(&engine);
+
+  const int dim = 2048, num_rows = 128, iterations = 100, report = 20;
+  const float step = 0.4f;
+  int rank = MV_Rank(), size = MV_Size();
+  LeastSquares problem(dim, num_rows, rank);
+  HalfCodec half;
+  BFloat16Codec bfloat16;
+  const struct {
+    Compression compression;
+    int k;
+    std::string name;
+  } methods[] = {
+    { Compression::None, 0, "none" },
+    { Compression::Half, 0, "fp16" },
+    { Compression::BFloat16, 0, "bf16" },
+    { Compression::TopK, dim / 100, "top-1%" },
+    { Compression::TopK, dim / 10, "top-10%" }
+  };
+  AllreduceAlgorithm algorithm = engine.Select(dim * 2, 2) == AllreduceAlgorithm::Hierarchical ?
+    AllreduceAlgorithm::Hierarchical : AllreduceAlgorithm::Ring;
+  long long none_bytes = 0;
+  for (auto& method : methods) {
+    std::vector<float> x(dim, 0.0f), grad, sum(dim), residual(dim, 0.0f);
+    long long start_bytes = engine.bytes_sent();
+    double first_loss = 0.0, loss = 0.0;
+    Timer timer;
+    for (int i = 0; i <= iterations; ++i) {
+      loss = problem.Gradient(x, &grad);
+      MV_Aggregate(&loss, 1);
+      if (i == 0) first_loss = loss;
+      if (rank == 0 && i % report == 0) {
+        Log::Info("%-8s iteration %4d loss %12.6f %10.3f MB sent\n", method.name.c_str(), i,
+                  loss, (engine.bytes_sent() - start_bytes) / 1e6);
+      }
+      if (i == iterations) break;
+      char* input = reinterpret_cast<char*>(grad.data());
+      char* output = reinterpret_cast<char*>(sum.data());
+      int bytes = dim * static_cast<int>(sizeof(float));
+      switch (method.compression) {
+      case Compression::None:
+        engine.Allreduce(input, bytes, sizeof(float), output, &SumFloat, algorithm);
+        break;
+      case Compression::Half:
+        engine.CompressedAllreduce(input, bytes, sizeof(float), output, half);
+        break;
+      case Compression::BFloat16:
+        engine.CompressedAllreduce(input, bytes, sizeof(float), output, bfloat16);
+        break;
+      case Compression::TopK:
+        engine.TopKAllreduce(grad.data(), dim, method.k, residual.data(), sum.data());
+        break;
+      }
+      for (int j = 0; j < dim; ++j) x[j] -= step * sum[j];
+    }
+    long long sent = engine.bytes_sent() - start_bytes;
+    if (rank == 0) {
+      Log::Info("%-8s loss %12.6f -> %12.6f, %10.3f MB sent, %8.3f s\n", method.name.c_str(),
+                first_loss, loss, sent / 1e6, timer.elapse() / 1e3);
+    }
+    CHECK(loss < first_loss);
+    if (method.compression == Compression::None) none_bytes = sent;
+    if (method.compression == Compression::Half || method.compression == Compression::BFloat16) {
+      CHECK(2 * sent == none_bytes);
+    }
+  }
+  Log::Info("Rank %d/%d: allreduce compression test passed\n", rank, size);
+
+  MV_ShutDown();
+}
+
+}  // namespace test
+}  // namespace multiverso
@@ -0,0 +1,80 @@
+#include <cstdio>
+#include <vector>
+
+#include <multiverso/multiverso.h>
+#include <multiverso/io/snapshot.h>
+#include <multiverso/util/log.h>
+#include <multiverso/table/array_table.h>
+#include <multiverso/table/kv_table.h>
+#include <multiverso/table/matrix_table.h>
+
+namespace multiverso {
+namespace test {
+
+// Checkpoint of a matrix, an array and a KV table on every server, written
+// while the workers keep adding to the tables, then restored: the tables
+// are back to their values at the checkpoint. The replicas of a hot key
+// answer with the value of its owner at the checkpoint before any merge
+void TestCheckpoint(int argc, char* argv[]) {
+  Log::ResetLogLevel(LogLevel::Info);
+  MV_SetFlag("server_threads", 2);
+  MV_Init(&argc, argv);
+
+  const char* path = "multiverso_checkpoint_test";
+  const int num_row = 10000, num_col = 16, size = 100000;
+  auto matrix = MV_CreateTable(MatrixTableOption<float>(num_row, num_col));
+  auto array = MV_CreateTable(ArrayTableOption<int>(size));
+  auto kv = MV_CreateTable(KVTableOption<int, int>());
+  // never merged but after the restore, half the workers add on the owner
+  const int hot_key = 7;
+  KVTableOption<int, int> hot_option;
+  hot_option.hot_keys = { hot_key };
+  hot_option.hot_replicas = 2;
+  hot_option.hot_merge_ms = 1e9;
+  auto hot_kv = MV_CreateTable(hot_option);
+
+  std::vector<float> rows(num_row * num_col, 1.0f);
+  std::vector<int> elements(size, 1);
+  int worker = MV_WorkerId();
+  matrix->Add(rows.data(), rows.size());
+  array->Add(elements.data(), elements.size());
+  kv->Add(worker, 10);
+  hot_kv->Add(hot_key, 10);
+  MV_Barrier();
+
+  MV_Checkpoint(path);
+  MV_Barrier();
+  for (int i = 0; i < 10; ++i) {
+    matrix->Add(rows.data(), rows.size());
+    array->Add(elements.data(), elements.size());
+    kv->Add(worker, 1);
+    hot_kv->Add(hot_key, 1);
+  }
+  MV_WaitCheckpoint();
+  MV_Barrier();
+
+  MV_Restore(path);
+  MV_Barrier();
+  int num_workers = MV_NumWorkers();
+  matrix->Get(rows.data(), rows.size());
+  for (auto value : rows) CHECK(value == num_workers);
+  array->Get(elements.data(), elements.size());
+  for (auto value : elements) CHECK(value == num_workers);
+  kv->Get(worker);
+  CHECK(kv->raw()[worker] == 10);
+  int on_owner = MV_NumServers() > 1 ? (num_workers + 1) / 2 : num_workers;
+  hot_kv->Get(hot_key);
+  CHECK(hot_kv->raw()[hot_key] == 10 * on_owner);
+  Log::Info("Rank %d: checkpoint test passed\n", MV_Rank());
+
+  MV_Barrier();
+  if (MV_ServerId() >= 0) {
+    for (int table = 0; table < 4; ++table) {
+      std::remove(SnapshotPath(path, table, MV_ServerId()).c_str());
+    }
+  }
+  MV_ShutDown();
+}
+
+}  // namespace test
+}  // namespace multiverso
@@ -0,0 +1,90 @@
+#include <algorithm>
+#include <vector>
+
+#include <multiverso/multiverso.h>
+#include <multiverso/util/log.h>
+#include <multiverso/table/kv_table.h>
+#include <multiverso/table/matrix_table.h>
+
+namespace multiverso {
+namespace test {
+
+// Adds on rows and keys replicated on two servers. Each worker reads its
+// own Adds from its replica, and once the replicas are merged the owners
+// hold the Adds of all the workers. Then the rows the workers hammer are
+// found and replicated instead
+void TestHotRows(int argc, char* argv[]) {
+  Log::ResetLogLevel(LogLevel::Info);
+  MV_Init(&argc, argv);
+
+  const int num_row = 1000, num_col = 8, num_iter = 100;
+  const int hot_key = 7;
+  MatrixTableOption<int> matrix_option(num_row, num_col);
+  matrix_option.hot_rows = { 0, 1, 2 };
+  matrix_option.hot_replicas = 2;
+  matrix_option.hot_merge_ms = 5;
+  auto matrix = MV_CreateTable(matrix_option);
+  KVTableOption<int, int> kv_option;
+  kv_option.hot_keys = { hot_key };
+  kv_option.hot_replicas = 2;
+  kv_option.hot_merge_ms = 0;
+  auto kv = MV_CreateTable(kv_option);
+  MV_Barrier();
+
+  int num_workers = MV_NumWorkers();
+  std::vector<int> delta(4 * num_col, 1);
+  std::vector<int> rows_data(3 * num_col);
+  std::vector<integer_t> hot = { 0, 1, 2 };
+  for (int iter = 0; iter < num_iter; ++iter) {
+    std::vector<integer_t> rows = { 0, 1, 2, 500 + iter % 10 };
+    matrix->Add(delta.data(), delta.size(), rows.data(), 4);
+    matrix->Get(rows_data.data(), rows_data.size(), hot.data(), 3);
+    for (auto value : rows_data) CHECK(value >= iter + 1);
+    kv->Add(hot_key, 1);
+    kv->Add(100 + MV_WorkerId(), 1);
+  }
+
+  matrix->MergeReplicas();
+  MV_Barrier();
+  std::vector<int> data(num_row * num_col);
+  matrix->Get(data.data(), data.size());
+  for (int row = 0; row < num_row; ++row) {
+    int expected = row < 3 ? num_iter * num_workers :
+      row >= 500 && row < 510 ? num_iter / 10 * num_workers : 0;
+    for (int col = 0; col < num_col; ++col) {
+      CHECK(data[row * num_col + col] == expected);
+    }
+  }
+  // the first Get merges the replica, the second sees the merged value
+  kv->Get(hot_key);
+  kv->Get(hot_key);
+  CHECK(kv->raw()[hot_key] == num_iter * num_workers);
+  kv->Get(100 + MV_WorkerId());
+  CHECK(kv->raw()[100 + MV_WorkerId()] == num_iter);
+
+  // row 10 becomes the hottest
+  matrix->ReplicateHotRows(3);
+  CHECK(matrix->hot_rows().hot(0) && matrix->hot_rows().hot(2));
+  integer_t row = 10;
+  for (int iter = 0; iter < num_iter; ++iter) {
+    matrix->Add(row, delta.data(), num_col);
+    matrix->Get(row, rows_data.data(), num_col);
+    CHECK(rows_data[0] >= iter + 1);
+  }
+  matrix->ReplicateHotRows(1);
+  CHECK(matrix->hot_rows().hot(10) && !matrix->hot_rows().hot(0));
+  matrix->Add(row, delta.data(), num_col);
+  matrix->Add(0, delta.data(), num_col);
+  matrix->MergeReplicas();
+  MV_Barrier();
+  matrix->Get(data.data(), data.size());
+  CHECK(data[10 * num_col] == (num_iter + 1) * num_workers);
+  CHECK(data[0] == (num_iter + 1) * num_workers);
+  Log::Info("Rank %d: hot rows test passed\n", MV_Rank());
+
+  MV_Barrier();
+  MV_ShutDown();
+}
+
+}  // namespace test
+}  // namespace multiverso
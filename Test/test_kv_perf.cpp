@@ -0,0 +1,162 @@
+#include <cstddef>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <multiverso/multiverso.h>
+#include <multiverso/blob.h>
+#include <multiverso/util/flat_hash_map.h>
+#include <multiverso/util/log.h>
+#include <multiverso/util/timer.h>
+#include <multiverso/table/kv_table.h>
+
+namespace multiverso {
+namespace test {
+
+namespace {
+
+// heap bytes held by the std::unordered_map of the comparison
+size_t g_allocated = 0;
+
+template <typename T>
+struct CountingAllocator {
+  typedef T value_type;
+  CountingAllocator() {}
+  template <typename U>
+  CountingAllocator(const CountingAllocator<U>&) {}
+  T* allocate(size_t n) {
+    g_allocated += n * sizeof(T);
+    return static_cast<T*>(::operator new(n * sizeof(T)));
+  }
+  void deallocate(T* p, size_t n) {
+    g_allocated -= n * sizeof(T);
+    ::operator delete(p);
+  }
+};
+template <typename T, typename U>
+bool operator==(const CountingAllocator<T>&, const CountingAllocator<U>&) {
+  return true;
+}
+template <typename T, typename U>
+bool operator!=(const CountingAllocator<T>&, const CountingAllocator<U>&) {
+  return false;
+}
+
+typedef std::unordered_map<int, float, std::hash<int>, std::equal_to<int>,
+  CountingAllocator<std::pair<const int, float>>> NodeMap;
+
+const int kBatch = 64, kPrefetchDistance = 8;
+
+// the batched loop of KVServerTable::ProcessAdd, prefetching ahead
+template <typename Map>
+void AddBatch(Map* map, const int* keys, const float* vals, bool prefetch);
+
+template <>
+void AddBatch(FlatHashMap<int, float>* map, const int* keys,
+              const float* vals, bool prefetch) {
+  for (int i = 0; i < kBatch; ++i) {
+    if (prefetch && i + kPrefetchDistance < kBatch) {
+      map->Prefetch(keys[i + kPrefetchDistance]);
+    }
+    (*map)[keys[i]] += vals[i];
+  }
+}
+
+template <>
+void AddBatch(NodeMap* map, const int* keys, const float* vals, bool) {
+  for (int i = 0; i < kBatch; ++i) (*map)[keys[i]] += vals[i];
+}
+
+template <typename Map>
+void Report(const std::string& name, Map* map, const std::vector<int>& keys,
+            const std::vector<int>& misses, bool prefetch) {
+  std::vector<float> vals(kBatch, 1.0f);
+  Timer timer;
+  for (size_t i = 0; i + kBatch <= keys.size(); i += kBatch) {
+    AddBatch(map, keys.data() + i, vals.data(), prefetch);
+  }
+  double insert_ms = timer.elapse();
+
+  timer.Start();
+  for (size_t i = 0; i + kBatch <= keys.size(); i += kBatch) {
+    AddBatch(map, keys.data() + i, vals.data(), prefetch);
+  }
+  double update_ms = timer.elapse();
+
+  timer.Start();
+  size_t found = 0;
+  for (auto key : misses) found += map->count(key);
+  double miss_ms = timer.elapse();
+  CHECK(found == 0);
+
+  std::cout << "[" << name << "] " << map->size() << " keys, insert "
+    << keys.size() / insert_ms / 1000 << " M/s, update "
+    << keys.size() / update_ms / 1000 << " M/s, miss lookup "
+    << misses.size() / miss_ms / 1000 << " M/s" << std::endl;
+}
+
+}  // namespace
+
+// Throughput and memory per entry of the int -> float storage of the KV
+// tables, FlatHashMap against std::unordered_map, on the batched Add loop
+// of KVServerTable. Then the batched Add and Get of a KVServerTable,
+// called directly on the server table
+void TestKVPerf(int argc, char* argv[]) {
+  Log::ResetLogLevel(LogLevel::Info);
+  MV_Init(&argc, argv);
+
+  const int num_keys = 1 << 21, num_misses = 1 << 20;
+  std::mt19937 gen(0);
+  std::uniform_int_distribution<int> dis(0, 1 << 30);
+  std::vector<int> keys(num_keys), misses(num_misses);
+  for (auto& key : keys) key = dis(gen) * 2;
+  for (auto& key : misses) key = dis(gen) * 2 + 1;
+
+  {
+    NodeMap map;
+    Report("std::unordered_map", &map, keys, misses, false);
+    std::cout << "[std::unordered_map] "
+      << static_cast<double>(g_allocated) / map.size() << " bytes per entry"
+      << std::endl;
+  }
+  {
+    FlatHashMap<int, float> map;
+    Report("FlatHashMap", &map, keys, misses, false);
+    std::cout << "[FlatHashMap] "
+      << static_cast<double>(map.bytes()) / map.size() << " bytes per entry"
+      << std::endl;
+  }
+  {
+    FlatHashMap<int, float> map;
+    Report("FlatHashMap, prefetch", &map, keys, misses, true);
+  }
+
+  KVTableOption<int, float> option;
+  std::unique_ptr<KVServerTable<int, float>> table(
+    new KVServerTable<int, float>(option));
+  Blob vals(kBatch * sizeof(float));
+  for (int i = 0; i < kBatch; ++i) vals.As<float>(i) = 1.0f;
+  std::vector<Blob> batches;
+  for (int i = 0; i + kBatch <= num_keys; i += kBatch) {
+    batches.push_back(Blob(keys.data() + i, kBatch * sizeof(int)));
+  }
+  Timer timer;
+  for (auto& batch : batches) table->ProcessAdd({ batch, vals });
+  std::cout << "[KVServerTable] add of " << kBatch << " keys: "
+    << num_keys / timer.elapse() / 1000 << " M keys/s" << std::endl;
+  timer.Start();
+  for (auto& batch : batches) {
+    std::vector<Blob> result;
+    table->ProcessGet({ batch }, &result);
+  }
+  std::cout << "[KVServerTable] get of " << kBatch << " keys: "
+    << num_keys / timer.elapse() / 1000 << " M keys/s" << std::endl;
+
+  MV_ShutDown();
+}
+
+}  // namespace test
+}  // namespace multiverso
@@ -6,17 +6,28 @@
 using namespace multiverso::test;
 
 void PrintUsage() {
-  printf("Usage: multiverso.test kv|array|net|matrix|allreduce\n");
+  printf("Usage: multiverso.test kv|array|net|matrix|allreduce|send_perf|queue|allocator|storage|updater|versioned_get|hot_rows|kv_perf|checkpoint|allreduce_compression|one_bit_add\n");
 }
 
 int main(int argc, char* argv[]) {
-  if (argc != 2) PrintUsage();
+  if (argc < 2) PrintUsage();
   else {
     if (strcmp(argv[1], "kv") == 0) TestKV(argc, argv);
     else if (strcmp(argv[1], "array") == 0) TestArray(argc, argv);
     else if (strcmp(argv[1], "net") == 0) TestNet(argc, argv);
     else if (strcmp(argv[1], "matrix") == 0) TestMatrix(argc, argv);
     else if (strcmp(argv[1], "allreduce") == 0) TestAllreduce(argc, argv);
+    else if (strcmp(argv[1], "send_perf") == 0) TestSendPerf(argc, argv);
+    else if (strcmp(argv[1], "queue") == 0) TestQueue(argc, argv);
+    else if (strcmp(argv[1], "allocator") == 0) TestAllocator(argc, argv);
+    else if (strcmp(argv[1], "storage") == 0) TestStorage(argc, argv);
+    else if (strcmp(argv[1], "updater") == 0) TestUpdater(argc, argv);
+    else if (strcmp(argv[1], "versioned_get") == 0) TestVersionedGet(argc, argv);
+    else if (strcmp(argv[1], "hot_rows") == 0) TestHotRows(argc, argv);
+    else if (strcmp(argv[1], "kv_perf") == 0) TestKVPerf(argc, argv);
+    else if (strcmp(argv[1], "checkpoint") == 0) TestCheckpoint(argc, argv);
+    else if (strcmp(argv[1], "allreduce_compression") == 0) TestAllreduceCompression(argc, argv);
+    else if (strcmp(argv[1], "one_bit_add") == 0) TestOneBitAdd(argc, argv);
     else {
       PrintUsage();
     }
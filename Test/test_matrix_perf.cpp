@@ -170,5 +170,52 @@ void TestDensePerf(int argc, char* argv[]) {
   });
 }
 
+// Compare the copying MPI send path with the zero-copy one (flag
+// mpi_zero_copy_send) on whole-table Add and Get of a dense matrix.
+// Run with at least 2 processes, otherwise no message goes through MPI.
+void TestSendPerf(int argc, char* argv[]) {
+  Log::ResetLogLevel(LogLevel::Info);
+  Log::Info("Test MPI send path\n");
+  Timer timmer;
+
+  MV_Init(&argc, argv);
+  int num_row = 100000, num_col = 50, num_turn = 10;
+  size_t size = static_cast<size_t>(num_row) * num_col;
+  int worker_id = MV_Rank();
+
+  std::vector<float> data(size), delta(size, 1.0f);
+  auto worker_table = std::make_shared<MatrixWorkerTable<float>>(num_row, num_col);
+  auto server_table = std::make_shared<MatrixServerTable<float>>(num_row, num_col);
+  MV_Barrier();
+
+  float expected = 0.0f;
+  for (auto zero_copy : { false, true }) {
+    MV_SetFlag("mpi_zero_copy_send", zero_copy);
+    MV_Barrier();
+
+    timmer.Start();
+    for (auto turn = 0; turn < num_turn; ++turn) {
+      worker_table->Add(delta.data(), size);
+      worker_table->Get(data.data(), size);
+    }
+    double elapse = timmer.elapse();
+    MV_Barrier();
+
+    expected += static_cast<float>(num_turn * MV_NumWorkers());
+    worker_table->Get(data.data(), size);
+    for (size_t i = 0; i < size; ++i) CHECK(data[i] == expected);
+
+    double mbytes = 2.0 * num_turn * size * sizeof(float) / 1024 / 1024;
+    std::cout << " " << elapse / 1000 << "s:\t" << (zero_copy ? "zero-copy" : "copy")
+      << " send, " << mbytes / elapse * 1000 << " MB/s, worker id: "
+      << worker_id << std::endl;
+  }
+
+  MV_Barrier();
+  Dashboard::Display();
+  Log::ResetLogLevel(LogLevel::Error);
+  MV_ShutDown();
+}
+
 }  // namespace test
 }  // namespace multiverso
\ No newline at end of file
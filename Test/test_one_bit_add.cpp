@@ -0,0 +1,163 @@
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include <multiverso/multiverso.h>
+#include <multiverso/util/log.h>
+#include <multiverso/util/quantization_util.h>
+#include <multiverso/util/timer.h>
+#include <multiverso/table/array_table.h>
+
+namespace multiverso {
+namespace test {
+
+namespace {
+
+// FilterIn and FilterOut of an Add of the whole array, by one thread
+void BenchmarkOneBitsFilter() {
+  const size_t count = 1 << 22, num_cols = 1024;
+  const int repeats = 5;
+  std::vector<float> values(count), residual(count, 0.0f);
+  std::mt19937 gen(MV_Rank());
+  std::normal_distribution<float> normal;
+  for (auto& value : values) value = normal(gen);
+  integer_t all_key = -1;
+  std::vector<Blob> request = { Blob(&all_key, sizeof(all_key)),
+                                Blob(values.data(), count * sizeof(float)) };
+  OneBitsFilter<float, integer_t> filter(num_cols, &residual);
+  std::vector<Blob> compressed, restored;
+  Timer timer;
+  for (int r = 0; r < repeats; ++r) filter.FilterIn(request, &compressed);
+  double in_ms = timer.elapse() / repeats;
+  timer.Start();
+  for (int r = 0; r < repeats; ++r) filter.FilterOut(compressed, &restored);
+  double out_ms = timer.elapse() / repeats;
+  CHECK(restored[1].size() == count * sizeof(float));
+  if (MV_Rank() == 0) {
+    Log::Info("1-bit filter: %d floats, %d bytes -> %d bytes (%.1fx), "
+              "FilterIn %.1f MB/s, FilterOut %.1f MB/s\n", static_cast<int>(count),
+              static_cast<int>(count * sizeof(float)), static_cast<int>(compressed[2].size()),
+              static_cast<double>(count * sizeof(float)) / compressed[2].size(),
+              count * sizeof(float) / in_ms / 1e3, count * sizeof(float) / out_ms / 1e3);
+  }
+}
+
+// Adds of the whole array to the servers, with and without 1-bit Adds
+void BenchmarkArrayAdd() {
+  const size_t size = 1 << 22;
+  const int repeats = 10;
+  std::vector<float> delta(size, 0.5f), model(size);
+  for (size_t one_bit_block : { static_cast<size_t>(0), static_cast<size_t>(1024) }) {
+    ArrayTableOption<float> option(size);
+    option.one_bit_block = one_bit_block;
+    auto table = MV_CreateTable(option);
+    MV_Barrier();
+    Timer timer;
+    for (int r = 0; r < repeats; ++r) table->Add(delta.data(), size);
+    double ms = timer.elapse() / repeats;
+    MV_Barrier();
+    // a delta of one magnitude is sent exactly
+    table->Get(model.data(), size);
+    for (auto value : model) CHECK(value == 0.5f * repeats * MV_NumWorkers());
+    if (MV_Rank() == 0) {
+      size_t bytes = one_bit_block == 0 ? size * sizeof(float) :
+        OneBitsFilter<float, integer_t>::CompressedSize(size, one_bit_block);
+      Log::Info("Array Add %-6s %d floats, %10d bytes sent %8.3f ms\n",
+                one_bit_block == 0 ? "float" : "1-bit", static_cast<int>(size),
+                static_cast<int>(bytes), ms);
+    }
+    MV_Barrier();
+    delete table;
+  }
+}
+
+// Binary logistic regression by SGD on the parameter server, each worker
+// with its own samples of the same model: the log loss of the model on the
+// samples of worker 0 with float and 1-bit Adds
+double TrainLogisticRegression(size_t one_bit_block) {
+  const int dim = 1000, num_samples = 2000, batch = 50, epochs = 5;
+  const float step = 0.5f;
+  std::mt19937 shared(0), local(MV_WorkerId() + 1);
+  std::normal_distribution<float> normal;
+  std::vector<float> truth(dim);
+  for (auto& value : truth) value = normal(shared);
+  std::vector<float> samples(static_cast<size_t>(num_samples) * dim);
+  std::vector<float> labels(num_samples);
+  for (int s = 0; s < num_samples; ++s) {
+    double dot = 0.0;
+    for (int j = 0; j < dim; ++j) {
+      // sparse-ish features, a tenth of them set
+      float x = local() % 10 == 0 ? normal(local) : 0.0f;
+      samples[static_cast<size_t>(s) * dim + j] = x;
+      dot += x * truth[j];
+    }
+    labels[s] = dot > 0 ? 1.0f : 0.0f;
+  }
+  auto log_loss = [&](const std::vector<float>& w) {
+    double loss = 0.0;
+    for (int s = 0; s < num_samples; ++s) {
+      double dot = 0.0;
+      for (int j = 0; j < dim; ++j) dot += w[j] * samples[static_cast<size_t>(s) * dim + j];
+      double p = 1.0 / (1.0 + std::exp(-dot));
+      p = std::min(std::max(p, 1e-7), 1 - 1e-7);
+      loss -= labels[s] * std::log(p) + (1 - labels[s]) * std::log(1 - p);
+    }
+    return loss / num_samples;
+  };
+
+  ArrayTableOption<float> option(dim);
+  option.one_bit_block = one_bit_block;
+  auto table = MV_CreateTable(option);
+  MV_Barrier();
+  std::vector<float> w(dim), grad(dim);
+  table->Get(w.data(), dim);
+  double first_loss = log_loss(w);
+  for (int epoch = 0; epoch < epochs; ++epoch) {
+    for (int begin = 0; begin < num_samples; begin += batch) {
+      table->Get(w.data(), dim);
+      std::fill(grad.begin(), grad.end(), 0.0f);
+      for (int s = begin; s < begin + batch; ++s) {
+        const float* x = &samples[static_cast<size_t>(s) * dim];
+        double dot = 0.0;
+        for (int j = 0; j < dim; ++j) dot += w[j] * x[j];
+        float error = static_cast<float>(1.0 / (1.0 + std::exp(-dot))) - labels[s];
+        for (int j = 0; j < dim; ++j) grad[j] += step / batch * error * x[j];
+      }
+      // the default updater adds the delta
+      for (auto& value : grad) value = -value;
+      table->Add(grad.data(), dim);
+    }
+  }
+  MV_Barrier();
+  table->Get(w.data(), dim);
+  double loss = log_loss(w);
+  if (MV_Rank() == 0) {
+    Log::Info("Logistic regression %-6s log loss %.4f -> %.4f\n",
+              one_bit_block == 0 ? "float" : "1-bit", first_loss, loss);
+  }
+  MV_Barrier();
+  delete table;
+  return loss;
+}
+
+}  // namespace
+
+void TestOneBitAdd(int argc, char* argv[]) {
+  Log::ResetLogLevel(LogLevel::Info);
+  MV_Init(&argc, argv);
+
+  BenchmarkOneBitsFilter();
+  BenchmarkArrayAdd();
+
+  double float_loss = TrainLogisticRegression(0);
+  double one_bit_loss = TrainLogisticRegression(100);
+  // from log(2) at the start
+  CHECK(float_loss < 0.5);
+  CHECK(one_bit_loss < 0.5);
+  Log::Info("Rank %d: 1-bit Add test passed\n", MV_Rank());
+
+  MV_ShutDown();
+}
+
+}  // namespace test
+}  // namespace multiverso
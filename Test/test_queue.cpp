@@ -0,0 +1,128 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <multiverso/message.h>
+#include <multiverso/util/log.h>
+#include <multiverso/util/mpsc_queue.h>
+#include <multiverso/util/mt_queue.h>
+#include <multiverso/util/timer.h>
+
+namespace multiverso {
+namespace test {
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+// A chain of queues with one forwarding thread per queue, like the
+// WorkerTable -> Worker -> Communicator -> Server path of a request
+class QueueChain {
+public:
+  QueueChain(bool lockfree, int num_hops, int num_msgs)
+    : send_time_(num_msgs), latency_(num_msgs), received_(0) {
+    for (int i = 0; i < num_hops; ++i) {
+      if (lockfree) queues_.emplace_back(new MpscQueue<MessagePtr>());
+      else queues_.emplace_back(new MtQueue<MessagePtr>());
+    }
+    for (int i = 0; i < num_hops; ++i) {
+      threads_.emplace_back(&QueueChain::Forward, this, i);
+    }
+  }
+
+  ~QueueChain() {
+    for (auto& queue : queues_) queue->Exit();
+    for (auto& thread : threads_) thread.join();
+  }
+
+  void Send(int id) {
+    MessagePtr msg(new Message());
+    msg->set_msg_id(id);
+    send_time_[id] = Clock::now();
+    queues_[0]->Push(msg);
+  }
+
+  void WaitReceived(int count) {
+    while (received_.load() < count) std::this_thread::yield();
+  }
+
+  std::vector<double>& latency() { return latency_; }
+
+private:
+  void Forward(int hop) {
+    MessagePtr msg;
+    while (queues_[hop]->Pop(msg)) {
+      if (hop + 1 < static_cast<int>(queues_.size())) {
+        queues_[hop + 1]->Push(msg);
+      } else {
+        int id = msg->msg_id();
+        latency_[id] = std::chrono::duration<double, std::micro>(
+          Clock::now() - send_time_[id]).count();
+        ++received_;
+      }
+    }
+  }
+
+  std::vector<std::unique_ptr<Queue<MessagePtr>>> queues_;
+  std::vector<std::thread> threads_;
+  std::vector<Clock::time_point> send_time_;
+  std::vector<double> latency_;
+  std::atomic<int> received_;
+};
+
+double Percentile(const std::vector<double>& sorted, double p) {
+  size_t i = static_cast<size_t>(p * (sorted.size() - 1));
+  return sorted[i];
+}
+
+}  // namespace
+
+// Compare MtQueue with the lock free MpscQueue used as actor mailboxes
+// (flag mailbox_type): throughput in message hops per second with several
+// producers flooding the chain, and latency of a single message crossing it
+void TestQueue(int, char*[]) {
+  const int kHops = 4, kProducers = 2;
+  const int kFloodMsgs = 400000, kPingMsgs = 20000;
+  Timer timer;
+
+  for (auto lockfree : { false, true }) {
+    std::string name = lockfree ? "lockfree" : "default";
+    {
+      QueueChain chain(lockfree, kHops, kFloodMsgs);
+      timer.Start();
+      std::vector<std::thread> producers;
+      for (int p = 0; p < kProducers; ++p) {
+        producers.emplace_back([&chain, p]() {
+          for (int id = p; id < kFloodMsgs; id += kProducers) chain.Send(id);
+        });
+      }
+      for (auto& producer : producers) producer.join();
+      chain.WaitReceived(kFloodMsgs);
+      double elapse = timer.elapse();
+      std::cout << "[" << name << "] " << kProducers << " producers, "
+        << kHops << " hops: " << 1000.0 * kFloodMsgs * kHops / elapse
+        << " hops/s" << std::endl;
+    }
+    {
+      QueueChain chain(lockfree, kHops, kPingMsgs);
+      for (int id = 0; id < kPingMsgs; ++id) {
+        chain.Send(id);
+        chain.WaitReceived(id + 1);
+      }
+      std::vector<double> latency = chain.latency();
+      std::sort(latency.begin(), latency.end());
+      std::cout << "[" << name << "] latency of " << kHops << " hops (us):"
+        << " p50 = " << Percentile(latency, 0.5)
+        << " p99 = " << Percentile(latency, 0.99)
+        << " p99.9 = " << Percentile(latency, 0.999)
+        << " max = " << latency.back() << std::endl;
+    }
+  }
+}
+
+}  // namespace test
+}  // namespace multiverso
@@ -0,0 +1,88 @@
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <multiverso/multiverso.h>
+#include <multiverso/blob.h>
+#include <multiverso/util/log.h>
+#include <multiverso/util/timer.h>
+#include <multiverso/table/matrix_table.h>
+
+namespace multiverso {
+namespace test {
+
+namespace {
+
+// keys of num_ops batches of batch_size random rows
+std::vector<Blob> RandomKeys(int num_row, int batch_size, int num_ops) {
+  std::mt19937 gen(0);
+  std::uniform_int_distribution<int> dis(0, num_row - 1);
+  std::vector<Blob> keys;
+  for (int i = 0; i < num_ops; ++i) {
+    Blob key(batch_size * sizeof(integer_t));
+    for (int j = 0; j < batch_size; ++j) key.As<integer_t>(j) = dis(gen);
+    keys.push_back(key);
+  }
+  return keys;
+}
+
+}  // namespace
+
+// Random row Get and Add on a large MatrixServerTable, called directly on
+// the server table so that only the storage access is measured, with the
+// storage backings of flags storage_huge_page and storage_numa
+void TestStorage(int argc, char* argv[]) {
+  Log::ResetLogLevel(LogLevel::Info);
+  MV_Init(&argc, argv);
+
+  const int num_row = 1000000, num_col = 50;
+  const int batch_size = 64, num_ops = 5000;
+  std::vector<Blob> keys = RandomKeys(num_row, batch_size, num_ops);
+  Blob values(batch_size * num_col * sizeof(float));
+  for (int i = 0; i < batch_size * num_col; ++i) values.As<float>(i) = 0.001f;
+
+  std::vector<std::pair<std::string, std::string>> configs = {
+    { "none", "default" }, { "transparent", "default" },
+    { "explicit", "default" }, { "transparent", "interleave" } };
+  // tables stay registered in the server until shut down
+  std::vector<std::unique_ptr<MatrixServerTable<float>>> tables;
+  Timer timer;
+  for (auto& config : configs) {
+    MV_SetFlag("storage_huge_page", config.first);
+    MV_SetFlag("storage_numa", config.second);
+    std::string name = config.first + ", " + config.second;
+
+    timer.Start();
+    tables.emplace_back(new MatrixServerTable<float>(num_row, num_col));
+    MatrixServerTable<float>* table = tables.back().get();
+    // first touch of every page
+    Blob all_key(sizeof(integer_t));
+    all_key.As<integer_t>() = -1;
+    Blob all_values(static_cast<size_t>(num_row) * num_col * sizeof(float));
+    table->ProcessAdd({ all_key, all_values });
+    std::cout << "[" << name << "] create and fill: " << timer.elapse()
+      << " ms" << std::endl;
+
+    timer.Start();
+    for (auto& key : keys) table->ProcessAdd({ key, values });
+    std::cout << "[" << name << "] random add of " << batch_size << " rows: "
+      << 1000.0 * num_ops * batch_size / timer.elapse() << " rows/s"
+      << std::endl;
+
+    timer.Start();
+    for (auto& key : keys) {
+      std::vector<Blob> result;
+      table->ProcessGet({ key }, &result);
+    }
+    std::cout << "[" << name << "] random get of " << batch_size << " rows: "
+      << 1000.0 * num_ops * batch_size / timer.elapse() << " rows/s"
+      << std::endl;
+  }
+
+  MV_ShutDown();
+}
+
+}  // namespace test
+}  // namespace multiverso
@@ -0,0 +1,66 @@
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <multiverso/multiverso.h>
+#include <multiverso/util/log.h>
+#include <multiverso/util/timer.h>
+#include <multiverso/updater/updater.h>
+
+namespace multiverso {
+namespace test {
+
+namespace {
+
+// GB/s of whole-buffer updates, counting every element read and written
+template <typename T>
+double UpdatePerf(const std::string& type, size_t size, int num_ops) {
+  MV_SetFlag("updater_type", type);
+  std::unique_ptr<Updater<T>> updater(Updater<T>::GetUpdater(size));
+  std::vector<T> data(size, 1), delta(size, static_cast<T>(0.001));
+  AddOption option;
+  option.set_momentum(0.5f);
+  // data and delta, plus the state of momentum_sgd and adagrad
+  double bytes_per_element = sizeof(T) *
+    (type == "momentum_sgd" || type == "adagrad" ? 5 : 3);
+
+  updater->Update(size, data.data(), delta.data(), &option);
+  Timer timer;
+  for (int i = 0; i < num_ops; ++i) {
+    updater->Update(size, data.data(), delta.data(), &option);
+  }
+  return bytes_per_element * size * num_ops / timer.elapse() / 1e6;
+}
+
+}  // namespace
+
+// Throughput of the updater kernels of each instruction set (flag
+// updater_simd), on a buffer that fits in cache and on one that does not
+void TestUpdater(int argc, char* argv[]) {
+  Log::ResetLogLevel(LogLevel::Info);
+  MV_SetFlag("omp_threads", 1);
+  MV_Init(&argc, argv);
+
+  std::cout << std::fixed << std::setprecision(2);
+  for (size_t size : { 1 << 14, 1 << 24 }) {
+    int num_ops = static_cast<int>((1 << 28) / size);
+    for (std::string isa : { "scalar", "avx2", "avx512" }) {
+      MV_SetFlag("updater_simd", isa);
+      for (std::string type : { "default", "sgd", "momentum_sgd", "adagrad" }) {
+        std::cout << "[" << isa << "] " << type << ", " << size
+          << " elements: float " << UpdatePerf<float>(type, size, num_ops)
+          << " GB/s, double " << UpdatePerf<double>(type, size, num_ops)
+          << " GB/s" << std::endl;
+      }
+    }
+  }
+  MV_SetFlag("updater_type", std::string("default"));
+  MV_SetFlag("updater_simd", std::string("auto"));
+
+  MV_ShutDown();
+}
+
+}  // namespace test
+}  // namespace multiverso
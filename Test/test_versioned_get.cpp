@@ -0,0 +1,109 @@
+#include <random>
+#include <vector>
+
+#include <multiverso/multiverso.h>
+#include <multiverso/util/log.h>
+#include <multiverso/util/timer.h>
+#include <multiverso/table/array_table.h>
+#include <multiverso/table/matrix_table.h>
+
+namespace multiverso {
+namespace test {
+
+// Sparse Adds followed by Gets, on a plain table and on a versioned one
+// (only the blocks changed since the last Get of the worker are sent).
+// Both tables get the same Adds and must end up with the same values
+void TestVersionedGet(int argc, char* argv[]) {
+  Log::ResetLogLevel(LogLevel::Info);
+  MV_Init(&argc, argv);
+
+  const int num_row = 100000, num_col = 50, num_iter = 100;
+  const int rows_per_add = 16, rows_per_get = 256;
+  const size_t array_size = 1 << 22, array_block = 1024;
+
+  MatrixTableOption<int> matrix_option(num_row, num_col);
+  auto plain_matrix = MV_CreateTable(matrix_option);
+  matrix_option.version_block_rows = 64;
+  auto versioned_matrix = MV_CreateTable(matrix_option);
+  ArrayTableOption<int> array_option(array_size);
+  auto plain_array = MV_CreateTable(array_option);
+  array_option.version_block_size = array_block;
+  auto versioned_array = MV_CreateTable(array_option);
+  MV_Barrier();
+
+  std::mt19937 gen(MV_Rank());
+  std::uniform_int_distribution<integer_t> row_dis(0, num_row - 1);
+  std::uniform_int_distribution<size_t> index_dis(0, array_size - 1);
+  std::vector<int> matrix(num_row * num_col), expected(num_row * num_col);
+  std::vector<int> rows_data(rows_per_get * num_col);
+  std::vector<int> expected_rows(rows_per_get * num_col);
+  std::vector<int> delta(rows_per_add * num_col, 1);
+  std::vector<int> array(array_size), expected_array(array_size);
+  std::vector<int> array_delta(array_size, 0);
+  std::vector<integer_t> add_rows(rows_per_add), get_rows(rows_per_get);
+
+  double plain_time[3] = { 0 }, versioned_time[3] = { 0 };
+  Timer timer;
+  for (int iter = 0; iter < num_iter; ++iter) {
+    for (auto& row : add_rows) row = row_dis(gen);
+    for (auto& row : get_rows) row = row_dis(gen);
+    plain_matrix->Add(delta.data(), delta.size(),
+                      add_rows.data(), rows_per_add);
+    versioned_matrix->Add(delta.data(), delta.size(),
+                          add_rows.data(), rows_per_add);
+    std::fill(array_delta.begin(), array_delta.end(), 0);
+    for (int i = 0; i < rows_per_add; ++i) array_delta[index_dis(gen)] = 1;
+    plain_array->Add(array_delta.data(), array_size);
+    versioned_array->Add(array_delta.data(), array_size);
+
+    timer.Start();
+    plain_matrix->Get(expected.data(), expected.size());
+    plain_time[0] += timer.elapse();
+    timer.Start();
+    versioned_matrix->Get(matrix.data(), matrix.size());
+    versioned_time[0] += timer.elapse();
+
+    timer.Start();
+    plain_matrix->Get(expected_rows.data(), expected_rows.size(),
+                      get_rows.data(), rows_per_get);
+    plain_time[1] += timer.elapse();
+    timer.Start();
+    versioned_matrix->Get(rows_data.data(), rows_data.size(),
+                          get_rows.data(), rows_per_get);
+    versioned_time[1] += timer.elapse();
+
+    timer.Start();
+    plain_array->Get(expected_array.data(), array_size);
+    plain_time[2] += timer.elapse();
+    timer.Start();
+    versioned_array->Get(array.data(), array_size);
+    versioned_time[2] += timer.elapse();
+  }
+
+  // the Adds of the other workers may land between the Gets of the two
+  // tables, compare once every worker is done
+  MV_Barrier();
+  plain_matrix->Get(expected.data(), expected.size());
+  versioned_matrix->Get(matrix.data(), matrix.size());
+  CHECK(matrix == expected);
+  plain_matrix->Get(expected_rows.data(), expected_rows.size(),
+                    get_rows.data(), rows_per_get);
+  versioned_matrix->Get(rows_data.data(), rows_data.size(),
+                        get_rows.data(), rows_per_get);
+  CHECK(rows_data == expected_rows);
+  plain_array->Get(expected_array.data(), array_size);
+  versioned_array->Get(array.data(), array_size);
+  CHECK(array == expected_array);
+
+  const char* names[3] = { "matrix whole table", "matrix rows", "array" };
+  for (int i = 0; i < 3; ++i) {
+    Log::Info("Rank %d: %s Get, plain %.2f ms, versioned %.2f ms\n",
+              MV_Rank(), names[i], plain_time[i] / num_iter,
+              versioned_time[i] / num_iter);
+  }
+  MV_Barrier();
+  MV_ShutDown();
+}
+
+}  // namespace test
+}  // namespace multiverso
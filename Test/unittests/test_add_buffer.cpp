@@ -0,0 +1,97 @@
+#include <string>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+#include <multiverso/dashboard.h>
+#include <multiverso/table/matrix_table.h>
+
+#include "multiverso_env.h"
+
+namespace multiverso {
+namespace test {
+
+namespace {
+
+// rows sent by the add buffers of all the matrix tables so far
+long long RowsSent() {
+  std::string info = Dashboard::Watch("MATRIX_WORKER_ADD_BUFFER_ROWS_SENT");
+  size_t pos = info.find("value = ");
+  return pos == std::string::npos ? 0 : std::stoll(info.substr(pos + 8));
+}
+
+}  // namespace
+
+BOOST_FIXTURE_TEST_SUITE(matrix_add_buffer, MultiversoEnv)
+
+// Adds are summed per row and only reach the servers on Flush or once the
+// buffer holds add_buffer_bytes
+BOOST_AUTO_TEST_CASE(matrix_add_buffer_flush) {
+  const int num_row = 20, num_col = 4;
+  MatrixTableOption<int> option(num_row, num_col);
+  option.add_buffer_bytes = 4 * num_col * sizeof(int);
+  auto table = MV_CreateTable(option);
+
+  std::vector<integer_t> hot = { 1, 2 };
+  std::vector<int> delta(hot.size() * num_col, 1);
+  std::vector<int> data(num_row * num_col);
+  for (int i = 0; i < 10; ++i) {
+    table->Add(delta.data(), delta.size(), hot.data(),
+               static_cast<integer_t>(hot.size()));
+  }
+  table->Get(data.data(), data.size());
+  for (auto value : data) BOOST_CHECK_EQUAL(value, 0);
+
+  table->Flush();
+  table->Get(data.data(), data.size());
+  for (int row = 0; row < num_row; ++row) {
+    int expected = row == 1 || row == 2 ? 10 : 0;
+    for (int col = 0; col < num_col; ++col) {
+      BOOST_CHECK_EQUAL(data[row * num_col + col], expected);
+    }
+  }
+  BOOST_CHECK_CLOSE(table->add_merge_ratio(), 10.0, 1e-6);
+
+  // the fourth distinct row fills the buffer
+  for (integer_t row = 5; row < 9; ++row) {
+    table->Add(row, delta.data(), num_col);
+  }
+  table->Get(data.data(), data.size());
+  for (integer_t row = 5; row < 9; ++row) {
+    BOOST_CHECK_EQUAL(data[row * num_col], 1);
+  }
+
+  // a whole table Add carries the buffered rows with it
+  table->Add(3, delta.data(), num_col);
+  std::vector<int> whole(num_row * num_col, 1);
+  table->Add(whole.data(), whole.size());
+  table->Get(data.data(), data.size());
+  BOOST_CHECK_EQUAL(data[3 * num_col], 2);
+  BOOST_CHECK_EQUAL(data[0], 1);
+  delete table;
+}
+
+// MV_Barrier and deleting the table send the buffered rows
+BOOST_AUTO_TEST_CASE(matrix_add_buffer_barrier) {
+  const int num_row = 20, num_col = 4;
+  MatrixTableOption<int> option(num_row, num_col);
+  option.add_buffer_bytes = 1 << 20;
+  auto table = MV_CreateTable(option);
+
+  std::vector<int> delta(num_col, 1);
+  std::vector<int> data(num_row * num_col);
+  table->Add(7, delta.data(), num_col);
+  MV_Barrier();
+  table->Get(data.data(), data.size());
+  BOOST_CHECK_EQUAL(data[7 * num_col], 1);
+
+  long long sent = RowsSent();
+  table->Add(8, delta.data(), num_col);
+  table->Add(9, delta.data(), num_col);
+  BOOST_CHECK_EQUAL(RowsSent(), sent);
+  delete table;
+  BOOST_CHECK_EQUAL(RowsSent(), sent + 2);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}  // namespace test
+}  // namespace multiverso
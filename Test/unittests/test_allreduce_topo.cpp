@@ -0,0 +1,49 @@
+#include <string>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+#include <multiverso/net/allreduce_engine.h>
+
+namespace multiverso {
+namespace test {
+
+BOOST_AUTO_TEST_SUITE(allreduce_topo)
+
+BOOST_AUTO_TEST_CASE(hierarchical_map_balanced) {
+  // hosts numbered by their first rank, whatever the rank order
+  std::vector<std::string> hosts = { "b", "a", "b", "c", "a", "c" };
+  HierarchicalMap map = HierarchicalMap::Construct(4, hosts);
+  BOOST_CHECK(map.balanced);
+  BOOST_CHECK_EQUAL(map.num_hosts, 3);
+  BOOST_CHECK_EQUAL(map.cross_rank, 1);
+  BOOST_CHECK_EQUAL(map.local_rank, 1);
+  std::vector<int> local_ranks = { 1, 4 };
+  std::vector<int> cross_ranks = { 2, 4, 5 };
+  BOOST_CHECK(map.local_ranks == local_ranks);
+  BOOST_CHECK(map.cross_ranks == cross_ranks);
+
+  // every machine of a ring agrees on the ring
+  for (int rank = 0; rank < 6; ++rank) {
+    HierarchicalMap other = HierarchicalMap::Construct(rank, hosts);
+    BOOST_CHECK_EQUAL(other.cross_ranks[other.cross_rank], rank);
+    BOOST_CHECK_EQUAL(other.local_ranks[other.local_rank], rank);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(hierarchical_map_unbalanced) {
+  std::vector<std::string> hosts = { "a", "a", "a", "b", "b" };
+  HierarchicalMap map = HierarchicalMap::Construct(3, hosts);
+  BOOST_CHECK(!map.balanced);
+  BOOST_CHECK_EQUAL(map.num_hosts, 2);
+  BOOST_CHECK_EQUAL(map.local_rank, 0);
+  BOOST_CHECK(map.cross_ranks.empty());
+
+  HierarchicalMap single = HierarchicalMap::Construct(0, { "a" });
+  BOOST_CHECK(single.balanced);
+  BOOST_CHECK_EQUAL(single.num_hosts, 1);
+  BOOST_CHECK_EQUAL(single.cross_ranks.size(), 1u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}  // namespace test
+}  // namespace multiverso
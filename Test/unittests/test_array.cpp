@@ -43,6 +43,25 @@ BOOST_AUTO_TEST_CASE(array_access) {
   }
 }
 
+// 1-bit Adds, each block of 4 elements with its own scale: the average of
+// the Adds converges to the delta
+BOOST_AUTO_TEST_CASE(array_one_bit_add) {
+  const int size = 10, num_adds = 200;
+  ArrayTableOption<float> option(size);
+  option.one_bit_block = 4;
+  auto one_bit = MV_CreateTable(option);
+  std::vector<float> delta(size), model(size);
+  for (int i = 0; i < size; ++i) delta[i] = 0.25f * i - 1.0f;
+  for (int add = 0; add < num_adds; ++add) {
+    one_bit->Add(delta.data(), delta.size());
+  }
+  one_bit->Get(model.data(), model.size());
+  for (int i = 0; i < size; ++i) {
+    BOOST_CHECK_SMALL(model[i] / num_adds - delta[i], 0.02f);
+  }
+  delete one_bit;
+}
+
 BOOST_AUTO_TEST_CASE(array_partition) {
   std::unordered_map<int, std::vector<Blob>> result;
   std::vector<Blob> kv;
@@ -34,6 +34,24 @@ BOOST_AUTO_TEST_CASE(blob_access_test) {
   BOOST_CHECK_EQUAL(str_blob[4], 'o');
 }
 
+BOOST_AUTO_TEST_CASE(blob_view_test) {
+  multiverso::Blob view;
+  {
+    multiverso::Blob parent(4 * sizeof(int));
+    for (int i = 0; i < 4; ++i) parent.As<int>(i) = i;
+    view = multiverso::Blob(parent, 2 * sizeof(int), 2 * sizeof(int));
+    BOOST_CHECK_EQUAL(view.size<int>(), 2);
+    BOOST_CHECK_EQUAL(view.data(), parent.data() + 2 * sizeof(int));
+  }
+  // the view keeps the parent memory alive
+  BOOST_CHECK_EQUAL(view.As<int>(0), 2);
+  BOOST_CHECK_EQUAL(view.As<int>(1), 3);
+
+  multiverso::Blob copy(view);
+  BOOST_CHECK_EQUAL(copy.data(), view.data());
+  BOOST_CHECK_EQUAL(copy.size(), view.size());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 }  // namespace test
@@ -0,0 +1,70 @@
+#include <random>
+#include <unordered_map>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+#include <multiverso/util/flat_hash_map.h>
+
+namespace multiverso {
+namespace test {
+
+BOOST_AUTO_TEST_SUITE(flat_hash_map)
+
+BOOST_AUTO_TEST_CASE(flat_hash_map_access) {
+  FlatHashMap<int, int> map;
+  BOOST_CHECK(map.empty() && map.find(3) == map.end());
+  map[3] += 2;
+  map[-7] = 5;
+  BOOST_CHECK_EQUAL(map.size(), 2);
+  BOOST_CHECK_EQUAL(map[3], 2);
+  BOOST_CHECK_EQUAL(map.find(-7)->second, 5);
+  BOOST_CHECK(!map.insert(std::make_pair(3, 9)).second);
+  BOOST_CHECK_EQUAL(map[3], 2);
+  BOOST_CHECK_EQUAL(map.erase(3), 1);
+  BOOST_CHECK_EQUAL(map.erase(3), 0);
+  BOOST_CHECK_EQUAL(map.count(3), 0);
+  BOOST_CHECK_EQUAL(map.size(), 1);
+  map.clear();
+  BOOST_CHECK(map.empty() && map.begin() == map.end());
+}
+
+// random inserts and erases, with many collisions of the home groups,
+// give the same content as std::unordered_map
+BOOST_AUTO_TEST_CASE(flat_hash_map_random) {
+  FlatHashMap<long long, int> map;
+  std::unordered_map<long long, int> expected;
+  std::mt19937 gen(0);
+  std::uniform_int_distribution<int> dis(0, 5000);
+  for (int i = 0; i < 200000; ++i) {
+    long long key = dis(gen);
+    if (i % 3 == 0) {
+      BOOST_REQUIRE_EQUAL(map.erase(key), expected.erase(key));
+    } else {
+      map[key] += i;
+      expected[key] += i;
+    }
+  }
+  BOOST_CHECK_EQUAL(map.size(), expected.size());
+  BOOST_CHECK(map.capacity() * 7 / 8 >= map.size());
+  size_t num = 0;
+  for (auto& entry : map) {
+    BOOST_REQUIRE(expected.count(entry.first));
+    BOOST_CHECK_EQUAL(entry.second, expected[entry.first]);
+    ++num;
+  }
+  BOOST_CHECK_EQUAL(num, expected.size());
+}
+
+BOOST_AUTO_TEST_CASE(flat_hash_map_reserve) {
+  FlatHashMap<int, float> map;
+  map.reserve(1000);
+  size_t capacity = map.capacity();
+  BOOST_CHECK(capacity >= 1000);
+  for (int i = 0; i < 1000; ++i) map[i * 16] = 1.0f;
+  BOOST_CHECK_EQUAL(map.capacity(), capacity);
+  for (int i = 0; i < 1000; ++i) BOOST_REQUIRE_EQUAL(map.count(i * 16), 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}  // namespace test
+}  // namespace multiverso
@@ -0,0 +1,59 @@
+#include <vector>
+#include <boost/test/unit_test.hpp>
+#include <multiverso/table/matrix_table.h>
+#include <multiverso/util/hot_keys.h>
+
+#include "multiverso_env.h"
+
+namespace multiverso {
+namespace test {
+
+BOOST_AUTO_TEST_SUITE(hot_keys)
+
+// the replicas of a hot key are on the servers after its owner, each
+// worker always uses the same one
+BOOST_AUTO_TEST_CASE(hot_keys_placement) {
+  MV_SetFlag("sync", false);
+  HotKeys hot;
+  BOOST_CHECK(hot.Init(2, 4));
+  hot.Set(std::vector<int>{ 5, 9 });
+  BOOST_CHECK(hot.hot(5) && !hot.hot(6));
+  BOOST_CHECK_EQUAL(hot.Server(6, 3, 1), 3);
+  BOOST_CHECK_EQUAL(hot.Server(5, 3, 0), 3);
+  BOOST_CHECK_EQUAL(hot.Server(5, 3, 1), 0);
+  BOOST_CHECK_EQUAL(hot.Server(5, 3, 3), 0);
+  BOOST_CHECK(hot.Replicates(0, 3) && !hot.Replicates(3, 3));
+  BOOST_CHECK(!hot.Replicates(1, 3));
+
+  // at most one replica per server, none in sync mode
+  BOOST_CHECK(hot.Init(8, 3));
+  BOOST_CHECK_EQUAL(hot.num_replicas(), 3);
+  BOOST_CHECK(!hot.Init(2, 1));
+  MV_SetFlag("sync", true);
+  BOOST_CHECK(!hot.Init(2, 4));
+  MV_SetFlag("sync", false);
+}
+
+BOOST_FIXTURE_TEST_CASE(hot_keys_matrix_access_count, MultiversoEnv) {
+  const int num_row = 20, num_col = 2;
+  MatrixTableOption<int> option(num_row, num_col);
+  auto table = MV_CreateTable(option);
+
+  std::vector<int> data(num_col, 1);
+  for (int i = 0; i < 5; ++i) table->Add(7, data.data(), num_col);
+  for (int i = 0; i < 3; ++i) table->Get(3, data.data(), num_col);
+  table->Add(12, data.data(), num_col);
+  // whole table requests are not counted
+  std::vector<int> whole(num_row * num_col);
+  table->Get(whole.data(), whole.size());
+
+  std::vector<integer_t> expected = { 7, 3 };
+  BOOST_CHECK(table->HotRows(2) == expected);
+  BOOST_CHECK_EQUAL(table->HotRows(10).size(), 3);
+  delete table;
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}  // namespace test
+}  // namespace multiverso
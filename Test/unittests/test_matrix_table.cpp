@@ -0,0 +1,133 @@
+#include <vector>
+#include <boost/test/unit_test.hpp>
+#include <multiverso/table/matrix_table.h>
+
+#include "multiverso_env.h"
+
+namespace multiverso {
+namespace test {
+
+BOOST_FIXTURE_TEST_SUITE(matrix_table, MultiversoEnv)
+
+// Gets of one table may be outstanding together, each reply goes to the
+// destinations of its own request
+BOOST_AUTO_TEST_CASE(matrix_table_concurrent_get_async) {
+  const int num_row = 50, num_col = 3;
+  MatrixTableOption<int> option(num_row, num_col);
+  auto table = MV_CreateTable(option);
+
+  std::vector<int> delta(num_row * num_col);
+  for (int i = 0; i < num_row * num_col; ++i) delta[i] = i;
+  table->Add(delta.data(), delta.size());
+
+  std::vector<int> whole(num_row * num_col);
+  std::vector<int> first(num_col), second(num_col);
+  std::vector<integer_t> rows = { 40, 7, 12 };
+  std::vector<int> some(rows.size() * num_col);
+  std::vector<int> ids;
+  ids.push_back(table->GetAsync(whole.data(), whole.size()));
+  ids.push_back(table->GetAsync(7, first.data(), first.size()));
+  ids.push_back(table->GetAsync(7, second.data(), second.size()));
+  ids.push_back(table->GetAsync(some.data(), some.size(), rows.data(),
+                                static_cast<integer_t>(rows.size())));
+  for (auto id : ids) table->Wait(id);
+
+  BOOST_CHECK(whole == delta);
+  for (int col = 0; col < num_col; ++col) {
+    BOOST_CHECK_EQUAL(first[col], 7 * num_col + col);
+    BOOST_CHECK_EQUAL(second[col], 7 * num_col + col);
+    BOOST_CHECK_EQUAL(some[col], 40 * num_col + col);
+    BOOST_CHECK_EQUAL(some[num_col + col], 7 * num_col + col);
+    BOOST_CHECK_EQUAL(some[2 * num_col + col], 12 * num_col + col);
+  }
+  delete table;
+}
+
+// 1-bit Adds: rows of one magnitude are sent exactly, the error of the
+// others is sent with the next Adds of the row
+BOOST_AUTO_TEST_CASE(matrix_table_one_bit_add) {
+  const int num_row = 20, num_col = 8, num_adds = 100;
+  MatrixTableOption<float> option(num_row, num_col);
+  option.one_bit_add = true;
+  auto table = MV_CreateTable(option);
+
+  std::vector<float> delta(num_row * num_col), model(num_row * num_col);
+  for (int i = 0; i < num_row * num_col; ++i) {
+    delta[i] = (i % 3 == 0 ? -1.0f : 1.0f) * (i / num_col);
+  }
+  table->Add(delta.data(), delta.size());
+  table->Get(model.data(), model.size());
+  BOOST_CHECK(model == delta);
+
+  std::vector<integer_t> rows = { 13, 2 };
+  std::vector<float> row_delta(rows.size() * num_col);
+  for (int i = 0; i < static_cast<int>(row_delta.size()); ++i) {
+    row_delta[i] = 0.1f * (i % 5) - 0.15f;
+  }
+  for (int add = 0; add < num_adds; ++add) {
+    table->Add(row_delta.data(), row_delta.size(), rows.data(),
+               static_cast<integer_t>(rows.size()));
+  }
+  table->Get(model.data(), model.size());
+  for (size_t r = 0; r < rows.size(); ++r) {
+    for (int col = 0; col < num_col; ++col) {
+      float added = model[rows[r] * num_col + col] - delta[rows[r] * num_col + col];
+      BOOST_CHECK_SMALL(added / num_adds - row_delta[r * num_col + col], 0.01f);
+    }
+  }
+  delete table;
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+struct ShardedServerEnv {
+  ShardedServerEnv() {
+    MV_SetFlag("sync", false);
+    MV_SetFlag("server_threads", 3);
+    MV_Init();
+  }
+
+  ~ShardedServerEnv() {
+    MV_ShutDown(false);
+    MV_SetFlag("server_threads", 1);
+  }
+};
+
+// Keyed Adds and Gets on a sharded server: the keys, out of order (and
+// repeated in the Add), are split between the shards owning their rows
+BOOST_FIXTURE_TEST_CASE(matrix_table_sharded_keys, ShardedServerEnv) {
+  const int num_row = 100, num_col = 4;
+  MatrixTableOption<float> option(num_row, num_col);
+  auto table = MV_CreateTable(option);
+
+  std::vector<integer_t> rows = { 97, 3, 50, 3, 64, 0, 33 };
+  integer_t num_keys = static_cast<integer_t>(rows.size());
+  std::vector<float> delta(rows.size() * num_col);
+  for (size_t i = 0; i < delta.size(); ++i) delta[i] = static_cast<float>(i);
+  table->Add(delta.data(), delta.size(), rows.data(), num_keys);
+
+  std::vector<float> expected(num_row * num_col, 0.0f);
+  for (size_t r = 0; r < rows.size(); ++r) {
+    for (int col = 0; col < num_col; ++col) {
+      expected[rows[r] * num_col + col] += delta[r * num_col + col];
+    }
+  }
+  std::vector<float> model(num_row * num_col);
+  table->Get(model.data(), model.size());
+  BOOST_CHECK(model == expected);
+
+  std::vector<integer_t> get_rows = { 64, 3, 99, 50, 0 };
+  std::vector<float> some(get_rows.size() * num_col);
+  table->Get(some.data(), some.size(), get_rows.data(),
+             static_cast<integer_t>(get_rows.size()));
+  for (size_t r = 0; r < get_rows.size(); ++r) {
+    for (int col = 0; col < num_col; ++col) {
+      BOOST_CHECK_EQUAL(some[r * num_col + col],
+                        expected[get_rows[r] * num_col + col]);
+    }
+  }
+  delete table;
+}
+
+}  // namespace test
+}  // namespace multiverso
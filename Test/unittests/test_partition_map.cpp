@@ -0,0 +1,91 @@
+#include <vector>
+#include <boost/test/unit_test.hpp>
+#include <multiverso/util/partition_map.h>
+
+namespace multiverso {
+namespace test {
+
+BOOST_AUTO_TEST_SUITE(partition_map)
+
+// each key is owned by the server whose range holds it
+void CheckRanges(const PartitionMap& map) {
+  for (int server = 0; server < map.num_servers(); ++server) {
+    for (int64_t key = map.begin(server); key < map.end(server); ++key) {
+      BOOST_CHECK_EQUAL(map.Server(key), server);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(partition_map_uniform) {
+  PartitionMap map(10, 3);
+  std::vector<int64_t> offsets = { 0, 4, 7, 10 };
+  BOOST_CHECK(map.offsets() == offsets);
+  CheckRanges(map);
+
+  PartitionMap few(2, 4);
+  BOOST_CHECK_EQUAL(few.size(1), 1);
+  BOOST_CHECK_EQUAL(few.size(2), 0);
+  CheckRanges(few);
+}
+
+BOOST_AUTO_TEST_CASE(partition_map_weighted) {
+  PartitionOption option;
+  option.strategy = PartitionStrategy::kWeightedRange;
+  option.weights = { 1, 0, 3 };
+  PartitionMap map(option, 100, 3);
+  BOOST_CHECK_EQUAL(map.size(0), 25);
+  BOOST_CHECK_EQUAL(map.size(1), 0);
+  BOOST_CHECK_EQUAL(map.size(2), 75);
+  CheckRanges(map);
+}
+
+// a hot key gets a server of its own
+BOOST_AUTO_TEST_CASE(partition_map_load_aware) {
+  PartitionOption option;
+  option.strategy = PartitionStrategy::kLoadAwareRange;
+  option.weights = { 6, 1, 1, 1, 1, 1, 1, 1 };
+  PartitionMap map(option, 8, 2);
+  BOOST_CHECK_EQUAL(map.end(0), 1);
+  CheckRanges(map);
+
+  // one load per block of 4 keys
+  option.weights = { 1, 1, 1, 5 };
+  PartitionMap blocks(option, 16, 2);
+  BOOST_CHECK_EQUAL(blocks.end(0), 12);
+  CheckRanges(blocks);
+}
+
+BOOST_AUTO_TEST_CASE(partition_map_hashed_block) {
+  PartitionOption option;
+  option.strategy = PartitionStrategy::kHashedBlock;
+  option.block_size = 4;
+  const int num_keys = 100000;
+  PartitionMap map(option, 0, 4), more(option, 0, 5);
+  BOOST_CHECK(!map.contiguous());
+  std::vector<int> count(4, 0);
+  for (int64_t key = 0; key < num_keys; ++key) {
+    int server = map.Server(key);
+    ++count[server];
+    BOOST_CHECK_EQUAL(server, map.Server(key / 4 * 4));
+    // a new server only takes keys over
+    int moved = more.Server(key);
+    if (moved != server) BOOST_CHECK_EQUAL(moved, 4);
+  }
+  for (auto keys : count) {
+    BOOST_CHECK_GT(keys, num_keys / 4 * 0.8);
+    BOOST_CHECK_LT(keys, num_keys / 4 * 1.2);
+  }
+
+  option.weights = { 1, 1, 1, 3 };
+  PartitionMap weighted(option, 0, 4);
+  int heavy = 0;
+  for (int64_t key = 0; key < num_keys; ++key) {
+    heavy += weighted.Server(key) == 3;
+  }
+  BOOST_CHECK_GT(heavy, num_keys / 2 * 0.8);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}  // namespace test
+}  // namespace multiverso
@@ -0,0 +1,86 @@
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+#include <multiverso/util/quantization_util.h>
+
+namespace multiverso {
+namespace test {
+
+namespace {
+
+std::vector<Blob> Request(std::vector<int32_t>* keys, std::vector<float>* values) {
+  std::vector<Blob> blobs;
+  blobs.push_back(Blob(keys->data(), keys->size() * sizeof(int32_t)));
+  blobs.push_back(Blob(values->data(), values->size() * sizeof(float)));
+  return blobs;
+}
+
+}  // namespace
+
+BOOST_AUTO_TEST_SUITE(quantization)
+
+BOOST_AUTO_TEST_CASE(one_bits_filter_round_trip) {
+  // two rows of 3 and a row of 2, from element 4 of the table
+  std::vector<int32_t> keys = { -1 };
+  std::vector<float> values = { 1, -2, 3, 0.5f, 0.5f, -0.5f, -4, 2 };
+  std::vector<float> residual(12, 0.0f);
+  OneBitsFilter<float, int32_t> filter(3, &residual);
+  std::vector<Blob> compressed, restored;
+  filter.FilterIn(Request(&keys, &values), 4, &compressed);
+  BOOST_REQUIRE_EQUAL(compressed.size(), 3);
+  BOOST_CHECK_EQUAL(compressed[0].As<int32_t>(), -1);
+  BOOST_CHECK_EQUAL(compressed[1].As<int64_t>(), 8);
+  BOOST_CHECK_EQUAL(compressed[2].size(), 3 * sizeof(float) + sizeof(uint32_t));
+
+  filter.FilterOut(compressed, &restored);
+  BOOST_REQUIRE_EQUAL(restored.size(), 2);
+  std::vector<float> expected = { 2, -2, 2, 0.5f, 0.5f, -0.5f, -3, 3 };
+  BOOST_REQUIRE_EQUAL(restored[1].size<float>(), expected.size());
+  for (size_t i = 0; i < expected.size(); ++i) {
+    BOOST_CHECK_EQUAL(restored[1].As<float>(i), expected[i]);
+    // what is not sent is kept
+    BOOST_CHECK_EQUAL(residual[4 + i], values[i] - expected[i]);
+  }
+  for (int i = 0; i < 4; ++i) BOOST_CHECK_EQUAL(residual[i], 0.0f);
+}
+
+BOOST_AUTO_TEST_CASE(one_bits_filter_error_feedback) {
+  // keyed rows with the option blob, the residual of each row is its own
+  const int num_cols = 100, num_adds = 200;
+  std::vector<int32_t> keys = { 4, 1 };
+  std::vector<float> values(2 * num_cols);
+  for (int i = 0; i < 2 * num_cols; ++i) values[i] = std::sin(i * 0.7f) * (i % 5);
+  std::vector<float> residual(5 * num_cols, 0.0f), sum(2 * num_cols, 0.0f);
+  int option = 7;
+  for (int add = 0; add < num_adds; ++add) {
+    OneBitsFilter<float, int32_t> filter(num_cols, &residual, true);
+    std::vector<Blob> request = Request(&keys, &values), compressed, restored;
+    request.push_back(Blob(&option, sizeof(option)));
+    filter.FilterIn(request, &compressed);
+    BOOST_REQUIRE_EQUAL(compressed.size(), 4);
+    BOOST_CHECK_EQUAL(compressed.back().As<int>(), option);
+    filter.FilterOut(compressed, &restored);
+    BOOST_REQUIRE_EQUAL(restored.size(), 3);
+    BOOST_CHECK_EQUAL(restored.back().As<int>(), option);
+    for (int i = 0; i < 2 * num_cols; ++i) sum[i] += restored[1].As<float>(i);
+  }
+  // sent plus kept is all that was added
+  for (int i = 0; i < 2 * num_cols; ++i) {
+    float kept = residual[keys[i / num_cols] * num_cols + i % num_cols];
+    BOOST_CHECK_SMALL(sum[i] + kept - num_adds * values[i], 1e-2f);
+  }
+  for (int i = 0; i < num_cols; ++i) BOOST_CHECK_EQUAL(residual[i], 0.0f);
+}
+
+BOOST_AUTO_TEST_CASE(one_bits_filter_size) {
+  BOOST_CHECK_EQUAL((OneBitsFilter<float, int32_t>::CompressedSize(1, 8)), 8);
+  BOOST_CHECK_EQUAL((OneBitsFilter<float, int32_t>::CompressedSize(1 << 20, 1024)),
+                    1024 * 4 + (1 << 15) * 4);
+  BOOST_CHECK_EQUAL((OneBitsFilter<double, int32_t>::CompressedSize(33, 33)), 8 + 8);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}  // namespace test
+}  // namespace multiverso
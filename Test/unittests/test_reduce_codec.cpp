@@ -0,0 +1,104 @@
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+#include <multiverso/net/allreduce_engine.h>
+
+namespace multiverso {
+namespace test {
+
+namespace {
+
+uint16_t Encode(const ReduceCodec& codec, float value) {
+  uint16_t result;
+  codec.Encode(reinterpret_cast<const char*>(&value), reinterpret_cast<char*>(&result), 1);
+  return result;
+}
+
+float Decode(const ReduceCodec& codec, uint16_t value) {
+  float result;
+  codec.Decode(reinterpret_cast<const char*>(&value), reinterpret_cast<char*>(&result), 1);
+  return result;
+}
+
+}  // namespace
+
+BOOST_AUTO_TEST_SUITE(reduce_codec)
+
+BOOST_AUTO_TEST_CASE(half_rounding) {
+  HalfCodec codec;
+  BOOST_CHECK_EQUAL(codec.wire_size(), 2);
+  BOOST_CHECK_EQUAL(Encode(codec, 1.0f), 0x3C00);
+  BOOST_CHECK_EQUAL(Encode(codec, -2.0f), 0xC000);
+  BOOST_CHECK_EQUAL(Encode(codec, 65504.0f), 0x7BFF);
+  // ties to even
+  BOOST_CHECK_EQUAL(Encode(codec, 1.0f + std::ldexp(1.0f, -11)), 0x3C00);
+  BOOST_CHECK_EQUAL(Encode(codec, 1.0f + 3 * std::ldexp(1.0f, -11)), 0x3C02);
+  // overflow and subnormals
+  BOOST_CHECK_EQUAL(Encode(codec, 65520.0f), 0x7C00);
+  BOOST_CHECK_EQUAL(Encode(codec, -1e10f), 0xFC00);
+  BOOST_CHECK_EQUAL(Encode(codec, std::ldexp(1.0f, -24)), 0x0001);
+  BOOST_CHECK_EQUAL(Encode(codec, std::ldexp(1.0f, -25)), 0x0000);
+  BOOST_CHECK_EQUAL(Encode(codec, 1.5f * std::ldexp(1.0f, -25)), 0x0001);
+  BOOST_CHECK_EQUAL(Encode(codec, std::ldexp(1.0f, -30)), 0x0000);
+  BOOST_CHECK_EQUAL(Decode(codec, 0x0001), std::ldexp(1.0f, -24));
+  // special values
+  BOOST_CHECK(std::isinf(Decode(codec, Encode(codec, std::numeric_limits<float>::infinity()))));
+  BOOST_CHECK(std::isnan(Decode(codec, Encode(codec, std::numeric_limits<float>::quiet_NaN()))));
+}
+
+BOOST_AUTO_TEST_CASE(half_round_trip) {
+  HalfCodec codec;
+  for (int i = 0; i < 0x10000; ++i) {
+    uint16_t half = static_cast<uint16_t>(i);
+    // not a nan
+    if ((half & 0x7C00) == 0x7C00 && (half & 0x3FF) != 0) continue;
+    BOOST_REQUIRE_EQUAL(Encode(codec, Decode(codec, half)), half);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(bfloat16_rounding) {
+  BFloat16Codec codec;
+  BOOST_CHECK_EQUAL(codec.wire_size(), 2);
+  BOOST_CHECK_EQUAL(Encode(codec, 1.0f), 0x3F80);
+  BOOST_CHECK_EQUAL(Encode(codec, 1.0f + std::ldexp(1.0f, -8)), 0x3F80);
+  BOOST_CHECK_EQUAL(Encode(codec, 1.0f + 3 * std::ldexp(1.0f, -8)), 0x3F82);
+  BOOST_CHECK_EQUAL(Decode(codec, 0x3F82), 1.0f + std::ldexp(1.0f, -6));
+  BOOST_CHECK(std::isinf(Decode(codec, Encode(codec, std::numeric_limits<float>::max()))));
+  BOOST_CHECK(std::isnan(Decode(codec, Encode(codec, std::numeric_limits<float>::quiet_NaN()))));
+  for (int i = 0; i < 0x10000; ++i) {
+    uint16_t value = static_cast<uint16_t>(i);
+    if ((value & 0x7F80) == 0x7F80 && (value & 0x7F) != 0) continue;
+    BOOST_REQUIRE_EQUAL(Encode(codec, Decode(codec, value)), value);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(decode_reduce) {
+  // the sum is accumulated in float, only the addends are rounded
+  HalfCodec half;
+  BFloat16Codec bfloat16;
+  std::vector<float> input = { 1.0f, 0.5f, -3.0f, 1e-3f };
+  for (const ReduceCodec* codec : { static_cast<const ReduceCodec*>(&half),
+                                    static_cast<const ReduceCodec*>(&bfloat16) }) {
+    std::vector<uint16_t> wire(input.size());
+    codec->Encode(reinterpret_cast<const char*>(input.data()),
+                  reinterpret_cast<char*>(wire.data()), static_cast<int>(input.size()));
+    std::vector<float> sum(input.size(), 1024.0f);
+    for (int i = 0; i < 4; ++i) {
+      codec->DecodeReduce(reinterpret_cast<const char*>(wire.data()),
+                          reinterpret_cast<char*>(sum.data()), static_cast<int>(input.size()));
+    }
+    for (size_t i = 0; i < input.size(); ++i) {
+      float expected = 1024.0f;
+      for (int j = 0; j < 4; ++j) expected += Decode(*codec, wire[i]);
+      BOOST_CHECK_EQUAL(sum[i], expected);
+    }
+    BOOST_CHECK_EQUAL(sum[0], 1028.0f);
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}  // namespace test
+}  // namespace multiverso
@@ -0,0 +1,80 @@
+#include <vector>
+#include <boost/test/unit_test.hpp>
+#include <multiverso/table/matrix_table.h>
+#include <multiverso/util/row_cache.h>
+
+#include "multiverso_env.h"
+
+namespace multiverso {
+namespace test {
+
+BOOST_AUTO_TEST_SUITE(row_cache)
+
+BOOST_AUTO_TEST_CASE(row_cache_staleness) {
+  RowCache<int> cache(10, 2, 4, 1);
+  std::vector<int> row = { 3, 4 };
+  BOOST_CHECK(cache.Find(5, 0) == nullptr);
+  cache.Put(5, 0, row.data());
+  BOOST_REQUIRE(cache.Find(5, 1) != nullptr);
+  BOOST_CHECK_EQUAL(cache.Find(5, 1)[1], 4);
+  BOOST_CHECK(cache.Find(5, 2) == nullptr);
+  BOOST_CHECK(cache.Peek(5) != nullptr);
+  BOOST_CHECK_EQUAL(cache.hits(), 2);
+  BOOST_CHECK_EQUAL(cache.misses(), 2);
+  cache.Erase(5);
+  BOOST_CHECK(cache.Peek(5) == nullptr);
+}
+
+// rows referenced since the hand last passed survive eviction
+BOOST_AUTO_TEST_CASE(row_cache_clock_eviction) {
+  RowCache<int> cache(10, 1, 3, 0);
+  for (int row = 0; row < 3; ++row) cache.Put(row, 0, &row);
+  int row = 3;
+  // clears every reference bit, then evicts row 0
+  cache.Put(row, 0, &row);
+  BOOST_CHECK(cache.Peek(0) == nullptr);
+  BOOST_CHECK(cache.Find(1, 0) != nullptr);
+  row = 4;
+  // row 1 was referenced again, row 2 goes
+  cache.Put(row, 0, &row);
+  BOOST_CHECK(cache.Peek(1) != nullptr);
+  BOOST_CHECK(cache.Peek(2) == nullptr);
+  BOOST_CHECK_EQUAL(*cache.Peek(4), 4);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_FIXTURE_TEST_SUITE(matrix_row_cache, MultiversoEnv)
+
+// Gets of fresh rows are served by the worker, its own Adds included
+BOOST_AUTO_TEST_CASE(matrix_row_cache_get) {
+  const int num_row = 100, num_col = 8;
+  MatrixTableOption<int> option(num_row, num_col);
+  option.cache_bytes = 10 * num_col * sizeof(int);
+  option.cache_staleness = 1;
+  auto table = MV_CreateTable(option);
+  BOOST_REQUIRE(table->cache() != nullptr);
+  BOOST_CHECK(table->cache()->capacity() >= 3);
+  BOOST_CHECK(table->cache()->memory_size() <= option.cache_bytes);
+
+  std::vector<integer_t> rows = { 3, 50, 99 };
+  std::vector<int> delta(rows.size() * num_col, 1);
+  std::vector<int> data(rows.size() * num_col);
+  for (int clock = 0; clock < 4; ++clock) {
+    table->Add(delta.data(), delta.size(), rows.data(),
+               static_cast<integer_t>(rows.size()));
+    table->Get(data.data(), data.size(), rows.data(),
+               static_cast<integer_t>(rows.size()));
+    for (auto value : data) BOOST_CHECK_EQUAL(value, clock + 1);
+    table->Clock();
+  }
+  // fetched at clocks 0 and 2, served from the cache at clocks 1 and 3
+  BOOST_CHECK_EQUAL(table->cache()->misses(), 2 * rows.size());
+  BOOST_CHECK_EQUAL(table->cache()->hits(), 2 * rows.size());
+  delete table;
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}  // namespace test
+}  // namespace multiverso
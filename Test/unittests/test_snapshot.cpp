@@ -0,0 +1,323 @@
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <numeric>
+#include <string>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+#include <multiverso/io/checkpoint.h>
+#include <multiverso/io/io.h>
+#include <multiverso/io/snapshot.h>
+#include <multiverso/table/array_table.h>
+#include <multiverso/table/kv_table.h>
+#include <multiverso/table/matrix_table.h>
+#include <multiverso/util/log.h>
+
+#include "multiverso_env.h"
+
+namespace multiverso {
+namespace test {
+
+namespace {
+
+const char kPath[] = "multiverso_snapshot_test";
+
+Stream* Open(const std::string& path, FileOpenMode mode) {
+  return StreamFactory::GetStream(URI(path), mode);
+}
+
+// snapshot of rows [begin, end) of a num_row x num_col int matrix, the
+// value of (row, col) is row * 10 + col
+void WriteRows(const std::string& path, int server_id, int num_servers,
+               int num_row, int num_col, int begin, int end) {
+  SnapshotHeader header;
+  header.table_type = static_cast<uint32_t>(SnapshotTable::kMatrix);
+  header.element_type = SnapshotElementType<int>();
+  header.server_id = server_id;
+  header.num_servers = num_servers;
+  header.num_rows = num_row;
+  header.num_cols = num_col;
+  header.begin = begin;
+  header.end = end;
+  header.payload_bytes = (end - begin) * num_col * sizeof(int);
+  header.chunk_bytes = 20;
+  std::unique_ptr<Stream> stream(Open(path, FileOpenMode::BinaryWrite));
+  SnapshotWriter writer(stream.get(), header);
+  for (int row = begin; row < end; ++row) {
+    for (int col = 0; col < num_col; ++col) {
+      int value = row * 10 + col;
+      writer.Write(&value, sizeof(value));
+    }
+  }
+  writer.Finish();
+}
+
+}  // namespace
+
+BOOST_AUTO_TEST_SUITE(snapshot)
+
+// a payload written and read in pieces that do not match the chunks
+BOOST_AUTO_TEST_CASE(snapshot_round_trip) {
+  std::vector<char> payload(37);
+  std::iota(payload.begin(), payload.end(), 0);
+  SnapshotHeader header;
+  header.table_type = static_cast<uint32_t>(SnapshotTable::kArray);
+  header.element_type = SnapshotElementType<char>();
+  header.server_id = 1;
+  header.num_servers = 2;
+  header.num_rows = 74;
+  header.num_cols = 1;
+  header.begin = 37;
+  header.end = 74;
+  header.payload_bytes = payload.size();
+  header.chunk_bytes = 10;
+  {
+    std::unique_ptr<Stream> stream(Open(kPath, FileOpenMode::BinaryWrite));
+    SnapshotWriter writer(stream.get(), header);
+    for (size_t i = 0; i < payload.size(); i += 7) {
+      writer.Write(payload.data() + i, std::min<size_t>(7, payload.size() - i));
+    }
+    writer.Finish();
+  }
+  std::unique_ptr<Stream> stream(Open(kPath, FileOpenMode::BinaryRead));
+  SnapshotReader reader(stream.get());
+  BOOST_CHECK_EQUAL(reader.header().server_id, 1);
+  BOOST_CHECK_EQUAL(reader.header().begin, 37u);
+  BOOST_CHECK_EQUAL(reader.header().chunk_bytes, 10u);
+  std::vector<char> read(payload.size());
+  for (size_t i = 0; i < read.size(); i += 5) {
+    reader.Read(read.data() + i, std::min<size_t>(5, read.size() - i));
+  }
+  reader.Finish();
+  BOOST_CHECK(reader.ok());
+  BOOST_CHECK(read == payload);
+  char byte;
+  BOOST_CHECK_EQUAL(stream->Read(&byte, 1), 0u);
+  stream.reset();
+
+  // the header, then 4 chunks each followed by its CRC
+  FILE* file = fopen(kPath, "rb");
+  fseek(file, 0, SEEK_END);
+  BOOST_CHECK_EQUAL(ftell(file), SnapshotHeader::kHeaderBytes + 37 + 4 * 4);
+  fclose(file);
+  std::remove(kPath);
+}
+
+BOOST_AUTO_TEST_CASE(snapshot_corrupt_chunk) {
+  std::vector<int> payload(1000, 7);
+  SnapshotHeader header;
+  header.payload_bytes = payload.size() * sizeof(int);
+  header.chunk_bytes = 1024;
+  {
+    std::unique_ptr<Stream> stream(Open(kPath, FileOpenMode::BinaryWrite));
+    SnapshotWriter writer(stream.get(), header);
+    writer.Write(payload.data(), header.payload_bytes);
+    writer.Finish();
+  }
+  // flip a byte of the third chunk
+  FILE* file = fopen(kPath, "r+b");
+  fseek(file, SnapshotHeader::kHeaderBytes + 2 * (1024 + 4) + 100, SEEK_SET);
+  fputc(8, file);
+  fclose(file);
+
+  Log::ResetKillFatal(false);
+  std::unique_ptr<Stream> stream(Open(kPath, FileOpenMode::BinaryRead));
+  SnapshotReader reader(stream.get());
+  std::vector<int> read(payload.size());
+  reader.Read(read.data(), 2048);
+  BOOST_CHECK(reader.ok());
+  reader.Read(read.data() + 512, header.payload_bytes - 2048);
+  BOOST_CHECK(!reader.ok());
+  Log::ResetKillFatal(true);
+  stream.reset();
+  std::remove(kPath);
+}
+
+BOOST_AUTO_TEST_CASE(snapshot_read_at) {
+  std::vector<char> payload(100);
+  std::iota(payload.begin(), payload.end(), 0);
+  SnapshotHeader header;
+  header.payload_bytes = payload.size();
+  header.chunk_bytes = 10;
+  {
+    std::unique_ptr<Stream> stream(Open(kPath, FileOpenMode::BinaryWrite));
+    SnapshotWriter writer(stream.get(), header);
+    writer.Write(payload.data(), payload.size());
+    writer.Finish();
+  }
+  std::unique_ptr<Stream> stream(Open(kPath, FileOpenMode::BinaryRead));
+  SnapshotReader reader(stream.get());
+  char read[20];
+  reader.ReadAt(23, read, 15);
+  BOOST_CHECK(std::equal(read, read + 15, payload.begin() + 23));
+  // backwards, within one chunk, and the end of the payload
+  reader.ReadAt(5, read, 3);
+  BOOST_CHECK(std::equal(read, read + 3, payload.begin() + 5));
+  reader.ReadAt(90, read, 10);
+  BOOST_CHECK(std::equal(read, read + 10, payload.begin() + 90));
+  BOOST_CHECK(reader.ok());
+  stream.reset();
+  std::remove(kPath);
+}
+
+// rows 3 to 9 from the snapshots of three servers holding 0-3, 4-8, 9-10
+BOOST_AUTO_TEST_CASE(snapshot_reshard_rows) {
+  const int num_row = 11, num_col = 3;
+  const int bounds[] = { 0, 4, 9, num_row };
+  std::vector<std::unique_ptr<Stream>> streams;
+  std::vector<Stream*> snapshots;
+  for (int server = 0; server < 3; ++server) {
+    std::string path = SnapshotPath(kPath, 0, server);
+    WriteRows(path, server, 3, num_row, num_col, bounds[server],
+              bounds[server + 1]);
+    streams.push_back(std::unique_ptr<Stream>(
+      Open(path, FileOpenMode::BinaryRead)));
+    snapshots.push_back(streams.back().get());
+  }
+  SnapshotHeader table;
+  table.table_type = static_cast<uint32_t>(SnapshotTable::kMatrix);
+  table.element_type = SnapshotElementType<int>();
+  table.num_rows = num_row;
+  table.num_cols = num_col;
+  table.begin = 3;
+  table.end = 10;
+  std::vector<int> data(7 * num_col);
+  ReadSnapshotRows(table, snapshots, data.data());
+  for (int row = 3; row < 10; ++row) {
+    for (int col = 0; col < num_col; ++col) {
+      BOOST_CHECK_EQUAL(data[(row - 3) * num_col + col], row * 10 + col);
+    }
+  }
+  streams.clear();
+  for (int server = 0; server < 3; ++server) {
+    std::remove(SnapshotPath(kPath, 0, server).c_str());
+  }
+}
+
+// the snapshot holds the values at Start, whatever changes after
+BOOST_AUTO_TEST_CASE(snapshot_background_checkpoint) {
+  std::vector<int> data(100000);
+  std::iota(data.begin(), data.end(), 0);
+  const std::vector<int> expected = data;
+  SnapshotHeader header;
+  header.payload_bytes = data.size() * sizeof(int);
+  header.chunk_bytes = 3000;
+  {
+    BackgroundCheckpoint checkpoint;
+    checkpoint.Start(Open(kPath, FileOpenMode::BinaryWrite), header,
+                     data.data(), header.payload_bytes, 4096);
+    for (size_t i = data.size(); i-- > 0; ) {
+      checkpoint.BeforeWrite(i * sizeof(int), sizeof(int));
+      data[i] = -1;
+    }
+    checkpoint.BeforeWrite(0, data.size() * sizeof(int));
+    std::fill(data.begin(), data.end(), -2);
+    checkpoint.Wait();
+    BOOST_CHECK(!checkpoint.running());
+  }
+  std::unique_ptr<Stream> stream(Open(kPath, FileOpenMode::BinaryRead));
+  SnapshotReader reader(stream.get());
+  std::vector<int> read(data.size());
+  reader.Read(read.data(), header.payload_bytes);
+  reader.Finish();
+  BOOST_CHECK(read == expected);
+  stream.reset();
+  std::remove(kPath);
+}
+
+BOOST_FIXTURE_TEST_CASE(snapshot_checkpoint_restore, MultiversoEnv) {
+  const int num_row = 11, num_col = 3;
+  MatrixTableOption<float> matrix_option(num_row, num_col);
+  auto matrix = MV_CreateTable(matrix_option);
+  ArrayTableOption<int> array_option(17);
+  auto array = MV_CreateTable(array_option);
+  KVTableOption<int, double> kv_option;
+  auto kv = MV_CreateTable(kv_option);
+
+  std::vector<float> rows(num_row * num_col, 1.5f);
+  matrix->Add(rows.data(), rows.size());
+  std::vector<int> elements(17, 2);
+  array->Add(elements.data(), elements.size());
+  kv->Add(5, 0.25);
+  kv->Add(1 << 20, 4.0);
+
+  MV_Checkpoint(kPath);
+  // after the checkpoint, not restored
+  matrix->Add(rows.data(), rows.size());
+  array->Add(elements.data(), elements.size());
+  kv->Add(5, 1.0);
+  kv->Add(6, 1.0);
+  MV_WaitCheckpoint();
+
+  MV_Restore(kPath);
+  matrix->Get(rows.data(), rows.size());
+  for (auto value : rows) BOOST_CHECK_EQUAL(value, 1.5f);
+  array->Get(elements.data(), elements.size());
+  for (auto value : elements) BOOST_CHECK_EQUAL(value, 2);
+  std::vector<int> keys = { 5, 6, 1 << 20 };
+  kv->Get(keys);
+  BOOST_CHECK_EQUAL(kv->raw()[5], 0.25);
+  BOOST_CHECK_EQUAL(kv->raw()[6], 0.0);
+  BOOST_CHECK_EQUAL(kv->raw()[1 << 20], 4.0);
+
+  delete matrix;
+  delete array;
+  delete kv;
+  for (int table = 0; table < 3; ++table) {
+    std::remove(SnapshotPath(kPath, table, 0).c_str());
+  }
+}
+
+// a checkpoint of three servers restored on one
+BOOST_FIXTURE_TEST_CASE(snapshot_restore_resharded, MultiversoEnv) {
+  const int num_row = 11, num_col = 3;
+  auto matrix = MV_CreateTable(MatrixTableOption<int>(num_row, num_col));
+  auto kv = MV_CreateTable(KVTableOption<int, int>());
+
+  const int bounds[] = { 0, 2, 7, num_row };
+  for (int server = 0; server < 3; ++server) {
+    WriteRows(SnapshotPath(kPath, 0, server), server, 3, num_row, num_col,
+              bounds[server], bounds[server + 1]);
+    SnapshotHeader header;
+    header.table_type = static_cast<uint32_t>(SnapshotTable::kKV);
+    header.element_type = SnapshotElementType<int>();
+    header.key_type = SnapshotElementType<int>();
+    header.server_id = server;
+    header.num_servers = 3;
+    header.num_rows = header.end = 1;
+    header.payload_bytes = 2 * sizeof(int);
+    std::unique_ptr<Stream> stream(
+      Open(SnapshotPath(kPath, 1, server), FileOpenMode::BinaryWrite));
+    SnapshotWriter writer(stream.get(), header);
+    int entry[] = { 100 + server, server + 1 };
+    writer.Write(entry, sizeof(entry));
+    writer.Finish();
+  }
+
+  MV_Restore(kPath);
+  std::vector<int> data(num_row * num_col);
+  matrix->Get(data.data(), data.size());
+  for (int row = 0; row < num_row; ++row) {
+    for (int col = 0; col < num_col; ++col) {
+      BOOST_CHECK_EQUAL(data[row * num_col + col], row * 10 + col);
+    }
+  }
+  std::vector<int> keys = { 100, 101, 102 };
+  kv->Get(keys);
+  for (int server = 0; server < 3; ++server) {
+    BOOST_CHECK_EQUAL(kv->raw()[100 + server], server + 1);
+  }
+
+  delete matrix;
+  delete kv;
+  for (int table = 0; table < 2; ++table) {
+    for (int server = 0; server < 3; ++server) {
+      std::remove(SnapshotPath(kPath, table, server).c_str());
+    }
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}  // namespace test
+}  // namespace multiverso
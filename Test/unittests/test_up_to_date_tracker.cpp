@@ -0,0 +1,52 @@
+#include <boost/test/unit_test.hpp>
+#include <multiverso/util/up_to_date_tracker.h>
+
+namespace multiverso {
+namespace test {
+
+BOOST_AUTO_TEST_SUITE(up_to_date_tracker)
+
+BOOST_AUTO_TEST_CASE(tracker_refresh) {
+  UpToDateTracker tracker(10, 3);
+  BOOST_CHECK(tracker.Refresh(4, 1));
+  BOOST_CHECK(!tracker.Refresh(4, 1));
+  BOOST_CHECK(tracker.Refresh(4, 0));
+  BOOST_CHECK(tracker.Refresh(5, 1));
+}
+
+// rows of 70 workers straddle the 64 bit words
+BOOST_AUTO_TEST_CASE(tracker_invalidate) {
+  const int num_rows = 100, num_workers = 70;
+  UpToDateTracker tracker(num_rows, num_workers);
+  BOOST_CHECK_EQUAL(tracker.memory_size(),
+    (num_rows * num_workers + 63) / 64 * 8);
+  for (int row = 0; row < num_rows; ++row) {
+    for (int worker = 0; worker < num_workers; ++worker) {
+      tracker.Refresh(row, worker);
+    }
+  }
+
+  tracker.Invalidate(7, 65);
+  for (int worker = 0; worker < num_workers; ++worker) {
+    BOOST_CHECK_EQUAL(tracker.Refresh(7, worker), worker != 65);
+    BOOST_CHECK(!tracker.Refresh(6, worker));
+    BOOST_CHECK(!tracker.Refresh(8, worker));
+  }
+
+  tracker.Invalidate(9);
+  for (int worker = 0; worker < num_workers; ++worker) {
+    BOOST_CHECK(tracker.Refresh(9, worker));
+  }
+
+  tracker.InvalidateAll(3);
+  for (int row = 0; row < num_rows; ++row) {
+    for (int worker = 0; worker < num_workers; ++worker) {
+      BOOST_CHECK_EQUAL(tracker.Refresh(row, worker), worker != 3);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}  // namespace test
+}  // namespace multiverso
@@ -0,0 +1,93 @@
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+#include <multiverso/updater/simd_kernels.h>
+#include <multiverso/updater/updater.h>
+
+#include "multiverso_env.h"
+
+namespace multiverso {
+namespace test {
+
+BOOST_FIXTURE_TEST_SUITE(updater, MultiversoEnv)
+
+// UpdateRows must match one Update call per row, in key order, including
+// repeated rows and skipped (negative) rows
+BOOST_AUTO_TEST_CASE(updater_update_rows) {
+  const int num_row = 1000, num_col = 50, num_keys = 4000;
+  std::mt19937 gen(0);
+  std::uniform_int_distribution<int> row_dis(-1, num_row - 1);
+  std::uniform_real_distribution<float> value_dis(0.0f, 1.0f);
+  std::vector<integer_t> rows(num_keys);
+  for (auto& row : rows) row = row_dis(gen);
+  std::vector<float> delta(num_keys * num_col);
+  for (auto& value : delta) value = value_dis(gen);
+
+  AddOption option;
+  option.set_momentum(0.5f);
+  for (std::string type : { "default", "sgd", "momentum_sgd", "adagrad" }) {
+    MV_SetFlag("updater_type", type);
+    std::unique_ptr<Updater<float>> expected_updater(
+      Updater<float>::GetUpdater(num_row * num_col));
+    std::unique_ptr<Updater<float>> updater(
+      Updater<float>::GetUpdater(num_row * num_col));
+    std::vector<float> expected(num_row * num_col, 1.0f);
+    std::vector<float> data(num_row * num_col, 1.0f);
+
+    for (int i = 0; i < num_keys; ++i) {
+      if (rows[i] < 0) continue;
+      expected_updater->Update(num_col, expected.data(),
+        delta.data() + i * num_col, &option, rows[i] * num_col);
+    }
+    updater->UpdateRows(num_keys, num_col, rows.data(), data.data(),
+      delta.data(), &option);
+
+    for (int i = 0; i < num_row * num_col; ++i) {
+      BOOST_REQUIRE_CLOSE(data[i], expected[i], 1e-4);
+    }
+  }
+  MV_SetFlag("updater_type", std::string("default"));
+}
+
+// Every instruction set must give the scalar results, including the tail
+// elements that do not fill a vector
+BOOST_AUTO_TEST_CASE(updater_simd_kernels) {
+  const size_t n = 1000 + 13;
+  std::vector<float> delta(n);
+  for (size_t i = 0; i < n; ++i) delta[i] = 0.001f * (i % 97) - 0.03f;
+
+  MV_SetFlag("updater_simd", std::string("scalar"));
+  const simd::Kernels<float>* scalar = simd::GetKernels<float>();
+  BOOST_CHECK_EQUAL(std::string(scalar->isa), "scalar");
+  for (std::string isa : { "avx2", "avx512" }) {
+    MV_SetFlag("updater_simd", isa);
+    const simd::Kernels<float>* kernels = simd::GetKernels<float>();
+    std::vector<float> expected(n, 1.0f), expected_state(n, 0.5f);
+    std::vector<float> data(n, 1.0f), state(n, 0.5f);
+
+    scalar->add(n, expected.data(), delta.data());
+    kernels->add(n, data.data(), delta.data());
+    scalar->sub(n, expected.data(), delta.data());
+    kernels->sub(n, data.data(), delta.data());
+    scalar->momentum(n, expected.data(), expected_state.data(),
+                     delta.data(), 0.9f);
+    kernels->momentum(n, data.data(), state.data(), delta.data(), 0.9f);
+    scalar->adagrad(n, expected.data(), expected_state.data(),
+                    delta.data(), 0.1f, 0.1f, 1e-6f);
+    kernels->adagrad(n, data.data(), state.data(), delta.data(),
+                     0.1f, 0.1f, 1e-6f);
+
+    for (size_t i = 0; i < n; ++i) {
+      BOOST_REQUIRE_CLOSE(data[i], expected[i], 1e-3);
+      BOOST_REQUIRE_CLOSE(state[i], expected_state[i], 1e-3);
+    }
+  }
+  MV_SetFlag("updater_simd", std::string("auto"));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}  // namespace test
+}  // namespace multiverso
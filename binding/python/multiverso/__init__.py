@@ -2,4 +2,5 @@
 # coding:utf8
 
 from .api import init, shutdown, barrier, workers_num, worker_id, server_id, is_master_worker
+from .api import aggregate, aggregate_async, AggregateHandle
 from .tables import ArrayTableHandler, MatrixTableHandler
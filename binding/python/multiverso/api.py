@@ -3,10 +3,12 @@
 
 import ctypes
 from .utils import Loader
+from .utils import convert_data
 import numpy as np
 
 
 mv_lib = Loader.get_lib()
+C_FLOAT_P = ctypes.POINTER(ctypes.c_float)
 
 
 def init(sync=False):
@@ -73,3 +75,50 @@ def is_master_worker():
     the master worker to finish these things.
     '''
     return worker_id() == 0
+
+
+def aggregate(data):
+    '''Return the sum of data over all processes.
+
+    data is converted to a float32 numpy.ndarray first. Every process must call
+    `aggregate` and `aggregate_async` in the same order.
+    '''
+    data = np.ascontiguousarray(convert_data(data))
+    mv_lib.MV_Aggregate(data.ctypes.data_as(C_FLOAT_P), data.size)
+    return data
+
+
+class AggregateHandle(object):
+    '''The pending sum returned by `aggregate_async`.'''
+
+    def __init__(self, data):
+        self._data = data
+        self._handler = ctypes.c_void_p()
+        mv_lib.MV_AggregateAsync(data.ctypes.data_as(C_FLOAT_P), data.size,
+                                 ctypes.byref(self._handler))
+
+    def test(self):
+        '''Return True if the sum is done, without blocking.'''
+        return self._handler is None or mv_lib.MV_TestAggregate(self._handler) != 0
+
+    def wait(self):
+        '''Block until the sum is done and return it.'''
+        if self._handler is not None:
+            mv_lib.MV_WaitAggregate(self._handler)
+            self._handler = None
+        return self._data
+
+    def __del__(self):
+        # the sum is written into self._data, which must outlive it
+        self.wait()
+
+
+def aggregate_async(data):
+    '''Start the sum of data over all processes and return at once.
+
+    The returned `AggregateHandle` gives the sum by `wait`, so that for example
+    the gradients of one layer are summed while the next layer is computed.
+    The sums run one at a time in call order, every process must call
+    `aggregate` and `aggregate_async` in the same order.
+    '''
+    return AggregateHandle(np.ascontiguousarray(convert_data(data)))
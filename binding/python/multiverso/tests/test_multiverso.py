@@ -72,6 +72,45 @@ class TestMultiversoTables(unittest.TestCase):
                     self.assertEqual(expected, actual)
 
 
+class TestMultiversoAggregate(unittest.TestCase):
+    '''
+    Use the commands below to run test
+    $ nosetests
+    '''
+
+    def test_aggregate(self):
+        data = mv.aggregate(range(1000))
+        for j, actual in enumerate(data):
+            self.assertEqual(j * mv.workers_num(), actual)
+
+    def test_aggregate_async(self):
+        handles = [mv.aggregate_async(np.ones(1000) * i) for i in xrange(10)]
+        # a blocking aggregate runs after the pending ones
+        data = mv.aggregate(np.ones(10))
+        self.assertTrue(all(handle.test() for handle in handles))
+        for i, handle in enumerate(handles):
+            for actual in handle.wait():
+                self.assertEqual(i * mv.workers_num(), actual)
+        for actual in data:
+            self.assertEqual(mv.workers_num(), actual)
+
+    def test_aggregate_async_with_tables(self):
+        # the pending aggregates run while the tables use the network
+        size = 1000
+        tbh = mv.ArrayTableHandler(size)
+        mv.barrier()
+        handles = [mv.aggregate_async(np.ones(size) * i) for i in xrange(10)]
+        for _ in xrange(10):
+            tbh.add(np.ones(size))
+            tbh.get()
+        for i, handle in enumerate(handles):
+            for actual in handle.wait():
+                self.assertEqual(i * mv.workers_num(), actual)
+        mv.barrier()
+        for actual in tbh.get():
+            self.assertEqual(10 * mv.workers_num(), actual)
+
+
 class TestMultiversoSharedVariable(unittest.TestCase):
     '''
     Use the commands below to run test
@@ -12,6 +12,7 @@ namespace std { class thread; }
 
 namespace multiverso {
 
+template<typename T> class Queue;
 template<typename T> class MtQueue;
 
 // The basic computation and communication unit in the system
@@ -43,8 +44,8 @@ protected:
   // messages based on registered message handlers
   virtual void Main();
 
-  // message queue
-  std::unique_ptr<MtQueue<MessagePtr> > mailbox_;
+  // message queue, see flag mailbox_type
+  std::unique_ptr<Queue<MessagePtr> > mailbox_;
   // message handlers function
   std::unordered_map<int, Handler> handlers_;
   bool is_working_;
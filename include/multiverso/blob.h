@@ -13,7 +13,7 @@ namespace multiverso {
 class Blob {
 public:
   // an empty blob
-  Blob() : data_(nullptr), size_(0) {}
+  Blob() : base_(nullptr), data_(nullptr), size_(0) {}
 
   explicit Blob(size_t size);
 
@@ -24,6 +24,10 @@ public:
 
   Blob(const Blob& rhs);
 
+  // A view of size bytes of parent starting at offset. Shares (and keeps
+  // alive) the memory of parent, nothing is copied
+  Blob(const Blob& parent, size_t offset, size_t size);
+
   ~Blob();
 
   // Shallow copy by default. Call \ref CopyFrom for a deep copy
@@ -47,7 +51,9 @@ public:
   inline size_t size() const { return size_; }
 
 private:
-  // Memory is shared and auto managed
+  // Memory is shared and auto managed. base_ is the allocation this blob
+  // refers to, data_ points into it (data_ == base_ unless blob is a view)
+  char *base_;
   char *data_;
   size_t size_;
 };
@@ -13,6 +13,8 @@ extern "C" {
 
 typedef void* TableHandler;
 
+typedef void* AggregateHandler;
+
 DllExport void MV_Init(int* argc, char* argv[]);
 
 DllExport void MV_ShutDown();
@@ -25,6 +27,18 @@ DllExport int  MV_WorkerId();
 
 DllExport int  MV_ServerId();
 
+// Aggregate, inplace sum over all processes
+DllExport void MV_Aggregate(float* data, int size);
+
+// returns at once, data holds the sum once MV_TestAggregate returns 1 or
+// MV_WaitAggregate returns
+DllExport void MV_AggregateAsync(float* data, int size, AggregateHandler* out);
+
+DllExport int  MV_TestAggregate(AggregateHandler handler);
+
+// also frees the handler
+DllExport void MV_WaitAggregate(AggregateHandler handler);
+
 // Array Table
 DllExport void MV_NewArrayTable(int size, TableHandler* out);
 
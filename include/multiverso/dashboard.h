@@ -1,6 +1,7 @@
 #ifndef MULTIVERSO_DASHBOARD_H_
 #define MULTIVERSO_DASHBOARD_H_
 
+#include <atomic>
 #include <map>
 #include <mutex>
 #include <string>
@@ -10,6 +11,7 @@
 namespace multiverso {
 
 class Monitor;
+class Gauge;
 
 // Dashboard to record and query system running information
 // thread safe
@@ -17,10 +19,13 @@ class Dashboard {
 public:
   static void AddMonitor(const std::string& name, Monitor* monitor);
   static void RemoveMonitor(const std::string& name);
+  static void AddGauge(const std::string& name, Gauge* gauge);
+  static void RemoveGauge(const std::string& name);
   static std::string Watch(const std::string& name);
   static void Display();
 private:
   static std::map<std::string, Monitor*> record_;
+  static std::map<std::string, Gauge*> gauges_;
   static std::mutex m_;
 };
 
@@ -58,6 +63,43 @@ private:
   Timer timer_;
 };
 
+// Gauge records the current value of a quantity, e.g. a queue length or
+// a number of bytes, together with the peak value it ever reached
+class Gauge {
+public:
+  explicit Gauge(const std::string& name) : name_(name), value_(0), peak_(0) {
+    Dashboard::AddGauge(name_, this);
+  }
+
+  virtual ~Gauge() { Dashboard::RemoveGauge(name_); }
+
+  void Set(long long value) {
+    value_ = value;
+    UpdatePeak(value);
+  }
+
+  void Add(long long delta) { UpdatePeak(value_ += delta); }
+
+  std::string name() const { return name_; }
+  long long value() const { return value_; }
+  long long peak() const { return peak_; }
+
+  virtual std::string info_string() const;
+
+private:
+  void UpdatePeak(long long value) {
+    long long peak = peak_;
+    while (value > peak && !peak_.compare_exchange_weak(peak, value)) {}
+  }
+
+  // name of the Gauge
+  std::string name_;
+  // current value
+  std::atomic<long long> value_;
+  // max value ever set
+  std::atomic<long long> peak_;
+};
+
 #define REGISTER_MONITOR(name)           \
   static Monitor g_##name##_monitor(#name);
 
@@ -73,6 +115,20 @@ private:
 #define MONITOR_END(name)                \
   g_##name##_monitor.End();
 
+#define REGISTER_GAUGE(name)             \
+  static Gauge g_##name##_gauge(#name);
+
+// Usage:
+// GAUGE_SET(your_quantity_short_description, value)
+// GAUGE_ADD(your_quantity_short_description, delta)
+#define GAUGE_SET(name, value)           \
+  REGISTER_GAUGE(name)                   \
+  g_##name##_gauge.Set(value);
+
+#define GAUGE_ADD(name, delta)           \
+  REGISTER_GAUGE(name)                   \
+  g_##name##_gauge.Add(delta);
+
 
 }  // namespace multiverso
 
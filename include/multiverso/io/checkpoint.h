@@ -0,0 +1,51 @@
+/*! \brief Snapshot of a server table written in the background */
+
+#ifndef MULTIVERSO_IO_CHECKPOINT_H_
+#define MULTIVERSO_IO_CHECKPOINT_H_
+
+#include <cstddef>
+
+#include "multiverso/io/snapshot.h"
+
+namespace multiverso {
+
+/*!
+ * \brief Writes the snapshot of a flat array in a background thread while
+ *        the table keeps updating it, copy on write: the array is split in
+ *        blocks and the table calls BeforeWrite before changing a range,
+ *        which copies the blocks of the range not written yet. The thread
+ *        copies the other blocks one at a time, so only the blocks changed
+ *        during the checkpoint are held twice. The snapshot is the array as
+ *        it was at Start
+ */
+class BackgroundCheckpoint {
+public:
+  BackgroundCheckpoint();
+  /*! \brief waits for the running checkpoint */
+  ~BackgroundCheckpoint();
+  BackgroundCheckpoint(const BackgroundCheckpoint&) = delete;
+  BackgroundCheckpoint& operator=(const BackgroundCheckpoint&) = delete;
+
+  /*!
+   * \brief start writing the size bytes of data, header.payload_bytes,
+   *        after the running checkpoint (if any) is done. The stream is
+   *        deleted once written
+   */
+  void Start(Stream* stream, const SnapshotHeader& header, const void* data,
+             size_t size, size_t block_bytes = 1 << 20);
+  /*! \brief the bytes [offset, offset + size) of data are about to change,
+   *         may be called from several threads */
+  void BeforeWrite(size_t offset, size_t size);
+  bool running() const;
+  void Wait();
+
+private:
+  struct State;
+  void Main();
+
+  State* state_;
+};
+
+}  // namespace multiverso
+
+#endif  // MULTIVERSO_IO_CHECKPOINT_H_
@@ -43,6 +43,8 @@ public:
   */
   virtual size_t Read(void *buf, size_t size) override;
 
+  virtual bool Seek(size_t offset) override;
+
   virtual bool Good() override;
 
 private:
@@ -76,6 +76,13 @@ public:
   */
   virtual size_t Read(void *buf, size_t size) = 0;
 
+  /*!
+  * \brief move to a position of the stream, for positioned reads
+  * \param offset byte offset from the beginning
+  * \return false if the stream does not support seeking
+  */
+  virtual bool Seek(size_t) { return false; }
+
   virtual bool Good() = 0;
 
   virtual ~Stream(void) {};
@@ -0,0 +1,142 @@
+/*! \brief Versioned, chunked snapshot format of the server tables */
+
+#ifndef MULTIVERSO_IO_SNAPSHOT_H_
+#define MULTIVERSO_IO_SNAPSHOT_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace multiverso {
+
+class Stream;
+
+/*! \brief CRC-32 (IEEE) of size bytes, continuing crc */
+uint32_t Crc32(const void* data, size_t size, uint32_t crc = 0);
+
+enum class SnapshotTable : uint32_t {
+  // rows [begin, end) of num_rows x num_cols values, row major. Matrix
+  // tables of both kinds
+  kMatrix = 1,
+  // elements [begin, end) of num_rows values
+  kArray = 2,
+  // num_rows (key, value) pairs owned by server_id, in no order
+  kKV = 3
+};
+
+/*! \brief code of the element type T: size, signed integer, floating point */
+template <typename T>
+uint32_t SnapshotElementType() {
+  return (std::is_floating_point<T>::value ? 0x200u :
+          std::is_signed<T>::value ? 0x100u : 0u) |
+         static_cast<uint32_t>(sizeof(T));
+}
+
+/*!
+ * \brief Header of the snapshot of one server of a table. The file is the
+ *        header, then the payload in chunks of chunk_bytes bytes (the last
+ *        one shorter), each followed by the CRC-32 of its bytes. Byte p of
+ *        the payload is at kHeaderBytes + p + p / chunk_bytes * 4, so that
+ *        a reader can seek to any range of the payload
+ */
+struct SnapshotHeader {
+  enum : uint32_t { kMagic = 0x5353564D, kVersion = 1 };  // "MVSS"
+  enum : size_t { kHeaderBytes = 80 };
+
+  SnapshotHeader();
+
+  uint32_t table_type;                       // SnapshotTable
+  uint32_t element_type;                     // SnapshotElementType
+  uint32_t key_type;                         // of the KV keys, 0 otherwise
+  int32_t server_id;
+  int32_t num_servers;                       // when the snapshot was taken
+  uint64_t num_rows;
+  uint64_t num_cols;
+  uint64_t begin;                            // range held by server_id
+  uint64_t end;
+  uint64_t payload_bytes;
+  uint64_t chunk_bytes;
+};
+
+/*! \brief file of the snapshot of server_id of table_id in the checkpoint
+ *         at uri */
+std::string SnapshotPath(const std::string& uri, int table_id, int server_id);
+
+/*!
+ * \brief fatal unless snapshot was taken of a table of the same types and,
+ *        for the dense tables, the same shape. The number of servers and
+ *        the ranges they hold may differ
+ */
+void CheckSnapshotLayout(const SnapshotHeader& table,
+                         const SnapshotHeader& snapshot);
+
+/*!
+ * \brief fill data, the rows [table.begin, table.end) of a dense table,
+ *        from the snapshots of the table taken on any number of servers
+ *        with any split of the rows: the rows of each snapshot overlapping
+ *        the range are read with seeks. Fatal unless every row is found
+ */
+void ReadSnapshotRows(const SnapshotHeader& table,
+                      const std::vector<Stream*>& snapshots, void* data);
+
+/*!
+ * \brief Streams a snapshot: the header is written at construction, the
+ *        payload as it is passed to Write, with no copy
+ */
+class SnapshotWriter {
+public:
+  SnapshotWriter(Stream* stream, const SnapshotHeader& header);
+
+  void Write(const void* data, size_t size);
+  /*! \brief check the whole payload was written */
+  void Finish();
+
+private:
+  Stream* stream_;
+  SnapshotHeader header_;
+  uint64_t written_;
+  uint64_t chunk_left_;                      // bytes of the current chunk
+  uint32_t crc_;                             // of the current chunk
+};
+
+/*!
+ * \brief Reads a snapshot, checking each chunk as it is read to the end.
+ *        A corrupt or truncated snapshot is fatal
+ */
+class SnapshotReader {
+public:
+  explicit SnapshotReader(Stream* stream);
+
+  const SnapshotHeader& header() const { return header_; }
+  /*! \brief whether all the checks passed so far, false only when fatal
+   *         errors do not exit, see Log::ResetKillFatal */
+  bool ok() const { return ok_; }
+
+  void Read(void* data, size_t size);
+  /*!
+   * \brief read size bytes at offset of the payload, seeking to the chunks
+   *        holding them, which are read whole to check them. A stream that
+   *        cannot seek is read forward to offset
+   */
+  void ReadAt(uint64_t offset, void* data, size_t size);
+  /*! \brief check the whole payload was read */
+  void Finish();
+
+private:
+  void Check(bool ok, const char* what);
+  // read and drop size bytes
+  void Skip(uint64_t size);
+
+  Stream* stream_;
+  SnapshotHeader header_;
+  bool ok_;
+  uint64_t read_;
+  uint64_t chunk_left_;
+  uint32_t crc_;
+};
+
+}  // namespace multiverso
+
+#endif  // MULTIVERSO_IO_SNAPSHOT_H_
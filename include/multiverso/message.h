@@ -13,6 +13,12 @@ namespace multiverso {
 enum MsgType {
   Request_Get = 1,
   Request_Add = 2,
+  // between servers, see ServerTable::TakeServerMessages
+  Server_Merge = 3,
+  Server_Merge_Reply = 4,
+  // from the local rank, see Zoo::Checkpoint
+  Server_Checkpoint = 5,
+  Server_Restore = 6,
   Reply_Get = -1,
   Reply_Add = -2,
   Server_Finish_Train = 31,
@@ -2,6 +2,7 @@
 #define MULTIVERSO_INCLUDE_MULTIVERSO_H_
 
 #include <string>
+#include "net.h"
 #include "table_factory.h"
 
 namespace multiverso {
@@ -40,10 +41,36 @@ MV_CreateTable(const TableOptionType& option) {
   return table;
 }
 
-// inplace sum by allreduce
+// Checkpoint of the server tables: each server writes the snapshot of its
+// part of table i to uri.table<i>.server<server id> (see io/snapshot.h) in
+// the background, and keeps processing requests meanwhile. Returns once
+// the snapshots are taken: they hold the requests the server received
+// before. Call MV_Barrier before, with no request in flight, for a
+// consistent checkpoint of all the servers
+void MV_Checkpoint(const std::string& uri);
+// wait for the checkpoint of the tables of this rank to be written
+void MV_WaitCheckpoint();
+// load the server tables of this rank from the checkpoint at uri, taken
+// with the same tables. The matrix, array and KV tables may have been on
+// any number of servers, with any partition
+void MV_Restore(const std::string& uri);
+
+// Release the free memory pooled by the allocator of the Blobs, see
+// util/allocator.h. Returns the bytes released at once, the caches of the
+// other threads are released on their next allocation or free
+size_t MV_TrimAllocator();
+
+// inplace sum by allreduce, with the algorithms of net/allreduce_engine.h
+// in model average mode (flag ma), else with MPI_Allreduce
 template <typename ElemType>
 void MV_Aggregate(ElemType* data, int size);
 
+// nonblocking MV_Aggregate, runs on a collective thread after the aggregates
+// started before. Start them in the same order on all ranks, and leave data
+// alone until the handle is done
+template <typename ElemType>
+net::AllreduceHandle MV_AggregateAsync(ElemType* data, int size);
+
 // --- Net API -------------------------------------------------------------- //
 // NOTE(feiga): these API is only used for specific situation.
 // Init Multiverso Net with the provided endpoint. Multiverso Net will bind
@@ -1,6 +1,7 @@
 #ifndef MULTIVERSO_NET_NET_H_
 #define MULTIVERSO_NET_NET_H_
 
+#include <memory>
 #include <string>
 #include "multiverso/message.h"
 
@@ -50,10 +51,39 @@ public:
 
 namespace net {
 
-// inplace allreduce
+class Collective;
+
+// Handle of an allreduce running on the collective thread
+class AllreduceHandle {
+public:
+  // handle of a finished allreduce
+  AllreduceHandle();
+  // true once the result is in data, does not block
+  bool Test() const;
+  // blocks until the result is in data
+  void Wait() const;
+
+private:
+  friend class Collective;
+  struct State;
+  explicit AllreduceHandle(const std::shared_ptr<State>& state);
+
+  std::shared_ptr<State> state_;
+};
+
+// inplace allreduce, after the pending AllreduceAsync
 template <typename Typename>
 void Allreduce(Typename* data, size_t elem_count);
 
+// inplace allreduce on the collective thread, which runs the allreduces one
+// at a time in call order, so all ranks should start them in the same order.
+// data should not be used until the handle is done
+template <typename Typename>
+AllreduceHandle AllreduceAsync(Typename* data, size_t elem_count);
+
+// wait for the pending AllreduceAsync and stop the collective thread
+void FinishAllreduces();
+
 }
 
 }  // namespace multiverso
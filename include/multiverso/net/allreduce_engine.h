@@ -1,6 +1,8 @@
 #ifndef MULTIVERSO_NET_ALLREDUCE_ENGINE_H_
 #define MULTIVERSO_NET_ALLREDUCE_ENGINE_H_
 
+#include <atomic>
+#include <string>
 #include <vector>
 
 #include "multiverso/net.h"
@@ -10,6 +12,46 @@ namespace multiverso {
 /*! \brief Reduce function */
 typedef void (ReduceFunction)(const char *src, char *dst, int len);
 
+/*!
+* \brief Wire format of a compressed reduce. Objects are encoded before they are sent,
+* and decoded then reduced in their own format when received, so the sums are accumulated
+* at full precision
+*/
+class ReduceCodec {
+public:
+  virtual ~ReduceCodec() {}
+  /*! \brief Size of one object in its own format */
+  virtual int type_size() const = 0;
+  /*! \brief Size of one object on the wire */
+  virtual int wire_size() const = 0;
+  /*! \brief Encode count objects of src into dst */
+  virtual void Encode(const char* src, char* dst, int count) const = 0;
+  /*! \brief Decode count objects of src into dst */
+  virtual void Decode(const char* src, char* dst, int count) const = 0;
+  /*! \brief Decode count objects of src and reduce them into dst */
+  virtual void DecodeReduce(const char* src, char* dst, int count) const = 0;
+};
+
+/*! \brief Sum of float sent as IEEE 754 half precision, round to nearest even */
+class HalfCodec : public ReduceCodec {
+public:
+  int type_size() const override { return sizeof(float); }
+  int wire_size() const override { return 2; }
+  void Encode(const char* src, char* dst, int count) const override;
+  void Decode(const char* src, char* dst, int count) const override;
+  void DecodeReduce(const char* src, char* dst, int count) const override;
+};
+
+/*! \brief Sum of float sent as bfloat16, the upper half of the float rounded to nearest even */
+class BFloat16Codec : public ReduceCodec {
+public:
+  int type_size() const override { return sizeof(float); }
+  int wire_size() const override { return 2; }
+  void Encode(const char* src, char* dst, int count) const override;
+  void Decode(const char* src, char* dst, int count) const override;
+  void DecodeReduce(const char* src, char* dst, int count) const override;
+};
+
 /*! \brief The network structure for all gather */
 class BruckMap {
 public:
@@ -76,6 +118,45 @@ public:
   static RecursiveHalvingMap Construct(int rank, int num_machines);
 };
 
+/*!
+* \brief Layout of the machines on hosts for the hierarchical allreduce.
+* Hosts are numbered in the order of their first rank, and machines on a host in rank order.
+*/
+class HierarchicalMap {
+public:
+  /*! \brief Ranks of the machines on the host of this machine */
+  std::vector<int> local_ranks;
+  /*! \brief Index of this machine in local_ranks */
+  int local_rank;
+  /*! \brief cross_ranks[i] means the machine with the same local rank on i-th host */
+  std::vector<int> cross_ranks;
+  /*! \brief Index of the host of this machine in cross_ranks */
+  int cross_rank;
+  /*! \brief Number of hosts */
+  int num_hosts;
+  /*! \brief True if all hosts have the same number of machines, the hierarchical algorithm needs it */
+  bool balanced;
+
+  HierarchicalMap();
+
+  /*!
+  * \brief Create the object of hierarchical map
+  * \param rank rank of this machine
+  * \param hosts hosts[i] means the host name of i-th machine
+  * \return The object of hierarchical map
+  */
+  static HierarchicalMap Construct(int rank, const std::vector<std::string>& hosts);
+};
+
+/*! \brief Allreduce algorithms, Auto selects one by data size and layout */
+enum class AllreduceAlgorithm {
+  Auto,
+  AllGather, // all gather then local reduce, for small data
+  RecursiveHalving, // recursive halving reduce scatter followed by bruck all gather
+  Ring, // ring reduce scatter followed by ring all gather, bandwidth optimal
+  Hierarchical // reduce scatter within hosts, ring across hosts, all gather within hosts
+};
+
 /*! \brief A class that contains some collective communication algorithm */
 class AllreduceEngine {
 public:
@@ -83,7 +164,7 @@ public:
   AllreduceEngine();
 
   /*!
-  * \brief Initial
+  * \brief Initial, all machines should call it since it exchanges the host names
   * \param linkers, the low-level communication methods
   */
   void Init(const NetInterface* linkers);
@@ -95,7 +176,9 @@ public:
   inline int num_machines();
   
   /*!
-  * \brief Perform all reduce. if data size is small, will call AllreduceByAllGather, else with call ReduceScatter followed allgather
+  * \brief Perform all reduce with the algorithm of flag allreduce_algorithm, auto by default:
+  * AllreduceByAllGather for small data, HierarchicalAllreduce if several hosts run several machines,
+  * RingAllreduce from allreduce_ring_bytes, else ReduceScatter followed allgather
   * \param input Input data
   * \param input_size The size of input data
   * \param type_size The size of one object in the reduce function
@@ -103,6 +186,71 @@ public:
   * \param reducer Reduce function
   */
   void Allreduce(char* input, int input_size, int type_size, char* output, ReduceFunction reducer);
+
+  /*!
+  * \brief Perform all reduce with the given algorithm, all machines should pass the same one
+  */
+  void Allreduce(char* input, int input_size, int type_size, char* output, ReduceFunction reducer,
+                 AllreduceAlgorithm algorithm);
+
+  /*!
+  * \brief Perform all reduce, use ring reduce scatter followed by ring all gather.
+  * Communication times is O(n), and communication cost is O(input_size), independent of n
+  * \param input Input data, not changed
+  * \param input_size The size of input data
+  * \param type_size The size of one object in the reduce function
+  * \param output Output result
+  * \param reducer Reduce function
+  */
+  void RingAllreduce(char* input, int input_size, int type_size, char* output, ReduceFunction reducer);
+
+  /*!
+  * \brief Perform all reduce in two levels: ring reduce scatter among the machines of each host,
+  * ring all reduce of each slice among the machines with the same local rank on all hosts, then
+  * ring all gather within hosts. Only 1 / (machines per host) of the data crosses hosts from each
+  * machine. Falls back to RingAllreduce if the hosts have different numbers of machines
+  * \param input Input data, not changed
+  * \param input_size The size of input data
+  * \param type_size The size of one object in the reduce function
+  * \param output Output result
+  * \param reducer Reduce function
+  */
+  void HierarchicalAllreduce(char* input, int input_size, int type_size, char* output, ReduceFunction reducer);
+
+  /*!
+  * \brief Perform all reduce with the objects sent in the wire format of codec, with the ring
+  * algorithm or the hierarchical one if Auto selects it for the size of the data on the wire.
+  * Each block is reduced in the format of input, then rounded once through the wire format
+  * by its owner, so every machine gets the same result
+  * \param input Input data, not changed
+  * \param input_size The size of input data
+  * \param type_size The size of one object in the format of input, codec.type_size()
+  * \param output Output result
+  * \param codec Wire format of the objects
+  */
+  void CompressedAllreduce(char* input, int input_size, int type_size, char* output, const ReduceCodec& codec);
+
+  /*!
+  * \brief Perform sum of float gradients, sparsified: each machine adds input to its residual
+  * and sends its k elements of largest magnitude as (index, value) pairs by all gather, the
+  * others stay in residual for the next call (error feedback). Communication cost is
+  * O(k * n) instead of O(count)
+  * \param input Input data, not changed
+  * \param count Number of floats
+  * \param k Number of floats sent by each machine
+  * \param residual Error feedback of this machine, count floats, zero before the first call
+  * \param output Output result, the sum of the sent elements
+  */
+  void TopKAllreduce(const float* input, int count, int k, float* residual, float* output);
+
+  /*! \brief Select the algorithm for Auto */
+  AllreduceAlgorithm Select(int input_size, int type_size) const;
+
+  /*! \brief Get the bytes sent by this machine since Init */
+  long long bytes_sent() const { return bytes_sent_; }
+
+  /*! \brief Get the host layout of the machines */
+  const HierarchicalMap& hierarchical_map() const { return hierarchical_map_; }
   
   /*!
   * \brief Perform all reduce, use all gather. When data is small, can use this to reduce communication times
@@ -136,17 +284,45 @@ public:
  
   /*!
   * \brief Perform reduce scatter, use recursive halving algorithm. Communication times is O(log(n)), and communication cost is O(input_size)
-  * \param input Input data
+  * Each step is pipelined, see SendRecvReduce
+  * \param input Input data, reduced in place
   * \param input_size The size of input data
   * \param type_size The size of one object in the reduce function
   * \param block_start The block start for different machines
   * \param block_len The block size for different machines
-  * \param output Output result
+  * \param output Output result, the block of this machine
   * \param reducer Reduce function
   */
   void ReduceScatter(char* input, int input_size, int type_size, int* block_start, int* block_len, char* output, ReduceFunction reducer);
 
 private:
+  /*!
+  * \brief Ring reduce scatter in place over group, this machine is group[index].
+  * After it, block index of data is reduced over the group
+  */
+  void RingReduceScatter(const std::vector<int>& group, int index, char* data,
+                         const int* block_start, const int* block_len, int type_size, ReduceFunction reducer,
+                         const ReduceCodec* codec = nullptr);
+  /*! \brief Ring all gather in place over group, block i of data comes from group[i] */
+  void RingAllgather(const std::vector<int>& group, int index, char* data,
+                     const int* block_start, const int* block_len);
+  /*! \brief Split size bytes in n blocks of whole objects */
+  static void SplitBlocks(int size, int type_size, int n, int* block_start, int* block_len);
+  /*! \brief SendRecv that skips the empty sides, no empty message is sent */
+  void SendRecv(int send_rank, char* send_buf, int send_len, int recv_rank, char* recv_buf, int recv_len);
+  /*!
+  * \brief Send send_len bytes to send_rank and reduce the recv_len bytes from recv_rank into dst.
+  * Both are split in chunks of flag allreduce_chunk_bytes, one message each, and a communication
+  * thread receives up to allreduce_pipeline_depth chunks in the staging area ahead of the reduction,
+  * so chunk i is reduced while chunk i + 1 arrives. The chunk size should be the same on all machines,
+  * 0 (the default) sends whole blocks from the calling thread.
+  * With a codec, both buffers are in the wire format and each chunk is decoded and reduced into dst
+  */
+  void SendRecvReduce(int send_rank, char* send_buf, int send_len, int recv_rank, char* dst, int recv_len,
+                      int type_size, ReduceFunction reducer, const ReduceCodec* codec = nullptr);
+  /*! \brief Make buffer_ at least size bytes */
+  void ReserveBuffer(int size);
+
   /*! \brief Number of all machines */
   int num_machines_;
   /*! \brief Rank of local machine */
@@ -157,14 +333,25 @@ private:
   BruckMap bruck_map_;
   /*! \brief Recursive halving map for reduce scatter */
   RecursiveHalvingMap recursive_halving_map_;
+  /*! \brief Host layout for hierarchical algorithm */
+  HierarchicalMap hierarchical_map_;
+  /*! \brief All ranks in rank order, the group of the flat ring */
+  std::vector<int> all_ranks_;
   /*! \brief Buffer to store block start index */
   int* block_start_;
   /*! \brief Buffer to store block size */
   int* block_len_;
-  /*! \brief Buffer  */
+  /*! \brief Buffer for the copies of whole data, grows on demand */
   char* buffer_;
   /*! \brief Size of buffer_ */
   int buffer_size_;
+  /*! \brief Communication thread and staging area of SendRecvReduce */
+  struct Pipeline;
+  Pipeline* pipeline_;
+  /*! \brief Encoded block sent by a compressed reduce step */
+  std::vector<char> encoded_;
+  /*! \brief Bytes sent since Init, also counted by the communication thread */
+  std::atomic<long long> bytes_sent_;
 };
 
 inline int AllreduceEngine::rank() {
@@ -6,9 +6,14 @@
 #include "multiverso/net.h"
 
 #include <limits>
+#include <list>
+#include <memory>
 #include <mutex>
 #include <queue>
+#include <thread>
+#include <vector>
 
+#include "multiverso/blob.h"
 #include "multiverso/message.h"
 #include "multiverso/dashboard.h"
 #include "multiverso/util/log.h"
@@ -63,6 +68,9 @@ public:
 
   class MPIMsgHandle {
   public:
+    MPIMsgHandle() : size_(0), buffer_(nullptr), buffer_size_(0) {}
+    ~MPIMsgHandle() { free(buffer_); }
+
     void add_handle(MPI_Request handle) {
       handles_.push_back(handle);
     }
@@ -71,6 +79,26 @@ public:
     const MessagePtr& msg() const { return msg_; }
     void set_size(size_t size) { size_ = size; }
     size_t size() const { return size_; }
+    // blob size fields referenced in place by a zero-copy send
+    std::vector<size_t>& blob_sizes() { return blob_sizes_; }
+
+    // send buffer owned by this handle, kept across Reset for reuse
+    char* buffer(size_t size) {
+      if (size > buffer_size_) {
+        buffer_ = (char*)realloc(buffer_, size);
+        CHECK_NOTNULL(buffer_);
+        buffer_size_ = size;
+      }
+      return buffer_;
+    }
+
+    // drop the finished requests and the message, keep the buffer
+    void Reset() {
+      handles_.clear();
+      msg_.reset();
+      blob_sizes_.clear();
+      size_ = 0;
+    }
 
     void Wait() {
       // CHECK_NOTNULL(msg_.get());
@@ -93,6 +121,9 @@ public:
     std::vector<MPI_Request> handles_;
     MessagePtr msg_;
     size_t size_;
+    std::vector<size_t> blob_sizes_;
+    char* buffer_;
+    size_t buffer_size_;
   };
 
   void Init(int* argc, char** argv) override {
@@ -127,7 +158,19 @@ public:
       name().c_str(), rank(), size());
   }
 
-  void Finalize() override { inited_ = 0; MPI_Finalize(); }
+  void Finalize() override {
+    // the msgs still queued behind the window are sent before finalizing
+    MessagePtr none;
+    while (!send_queue_.Empty()) {
+      if (!msg_handles_.empty()) msg_handles_.front()->Wait();
+      Send(none);
+    }
+    for (auto& handle : msg_handles_) handle->Wait();
+    msg_handles_.clear();
+    free_handles_.clear();
+    inited_ = 0;
+    MPI_Finalize();
+  }
 
   int Bind(int, char*) override { 
     Log::Fatal("Shouldn't call this in MPI Net\n"); 
@@ -144,10 +187,26 @@ public:
   int size() const override { return size_; }
   std::string name() const override { return "MPI"; }
 
+  // Called by the collective thread while the communicator may run, MPI is
+  // only entered under mutex_ like Send and Recv, which MPI_THREAD_SERIALIZED
+  // needs. The allreduce is polled so that the communicator runs in between
   template <typename ElemType>
-  static void Allreduce(ElemType* data, size_t elem_count) {
-    MPI_Allreduce(MPI_IN_PLACE, data, (int)elem_count,
-      GetDataType(data), MPI_SUM, MPI_COMM_WORLD);
+  void Allreduce(ElemType* data, size_t elem_count) {
+    MPI_Request request;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      MV_MPI_CALL(MPI_Iallreduce(MPI_IN_PLACE, data, (int)elem_count,
+        GetDataType(data), MPI_SUM, MPI_COMM_WORLD, &request));
+    }
+    int done = 0;
+    while (true) {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        MV_MPI_CALL(MPI_Test(&request, &done, MPI_STATUS_IGNORE));
+      }
+      if (done) break;
+      std::this_thread::yield();
+    }
   }
 
   //size_t Send(MessagePtr& msg) override {
@@ -192,26 +251,42 @@ public:
   //  return size;
   //}
 
+  // Up to send_window() messages are kept on the air at the same time, each
+  // with its own send buffer, so that sends to different ranks overlap. MPI
+  // keeps messages to the same rank in order, whatever finishes first.
   int Send(MessagePtr& msg) override {
     if (msg.get()) { send_queue_.Push(msg); }
-    
-    if (last_handle_.get() != nullptr && !last_handle_->Test()) {
-      // Last msg is still on the air
-      return 0;
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    // free the finished msgs and recycle their handles
+    for (auto it = msg_handles_.begin(); it != msg_handles_.end();) {
+      if ((*it)->Test()) {
+        (*it)->Reset();
+        free_handles_.push_back(std::move(*it));
+        it = msg_handles_.erase(it);
+      } else {
+        ++it;
+      }
     }
 
-    // send over, free the last msg
-    last_handle_.reset();
-
-    // if there is more msg to send
-    if (send_queue_.Empty()) return 0;
-    
-    // Send a front msg of send queue
-    last_handle_.reset(new MPIMsgHandle()); 
-    MessagePtr sending_msg;
-    CHECK(send_queue_.TryPop(sending_msg));
-
-    int size = SerializeAndSend(sending_msg, last_handle_.get());
+    int size = 0;
+    int window = send_window();
+    while (static_cast<int>(msg_handles_.size()) < window &&
+           !send_queue_.Empty()) {
+      std::unique_ptr<MPIMsgHandle> handle;
+      if (free_handles_.empty()) {
+        handle.reset(new MPIMsgHandle());
+      } else {
+        handle = std::move(free_handles_.back());
+        free_handles_.pop_back();
+      }
+      MessagePtr sending_msg;
+      CHECK(send_queue_.TryPop(sending_msg));
+      size += SerializeAndSend(sending_msg, handle.get());
+      msg_handles_.push_back(std::move(handle));
+    }
+    GAUGE_SET(MPI_NET_SEND_WINDOW, window);
+    GAUGE_SET(MPI_NET_SEND_IN_FLIGHT, static_cast<long long>(msg_handles_.size()));
     return size;
   }
 
@@ -228,6 +303,7 @@ public:
   //}
 
   int Recv(MessagePtr* msg) override {
+    std::lock_guard<std::mutex> lock(mutex_);
     MPI_Status status;
     int flag;
     // non-blocking probe whether message comes
@@ -235,10 +311,6 @@ public:
     if (!flag) return 0;
     int count;
     MV_MPI_CALL(MPI_Get_count(&status, MPI_BYTE, &count));
-    if (count > recv_size_) {
-      recv_buffer_ = (char*)realloc(recv_buffer_, count);
-      recv_size_ = count;
-    }
     // CHECK(count == Message::kHeaderSize);
     return RecvAndDeserialize(status.MPI_SOURCE, count, msg);
   }
@@ -289,55 +361,110 @@ public:
   int SerializeAndSend(MessagePtr& msg, MPIMsgHandle* msg_handle) {
 
     CHECK_NOTNULL(msg_handle);
+    if (zero_copy_send()) return GatherAndSend(msg, msg_handle);
     MONITOR_BEGIN(MPI_NET_SEND_SERIALIZE);
     int size = sizeof(size_t) + Message::kHeaderSize;
     for (auto& data : msg->data()) 
-      size += static_cast<int>(sizeof(size_t) + data.size());
-    if (size > send_size_) {
-      send_buffer_ = (char*)realloc(send_buffer_, size);
-      send_size_ = size;
-    }
-    memcpy(send_buffer_, msg->header(), Message::kHeaderSize);
-    char* p = send_buffer_ + Message::kHeaderSize;
+      size += static_cast<int>(sizeof(size_t) + data.size() + Padding(data.size()));
+    char* send_buffer = msg_handle->buffer(size);
+    memcpy(send_buffer, msg->header(), Message::kHeaderSize);
+    char* p = send_buffer + Message::kHeaderSize;
     for (auto& data : msg->data()) {
       size_t s = data.size();
       memcpy(p, &s, sizeof(size_t));
       p += sizeof(size_t);
       memcpy(p, data.data(), s);
       p += s;
+      memset(p, 0, Padding(s));
+      p += Padding(s);
     }
     size_t over = kover_; // std::numeric_limits<size_t>::max(); -1;
     memcpy(p, &over, sizeof(size_t));
     MONITOR_END(MPI_NET_SEND_SERIALIZE);
 
     MPI_Request handle;
-    MV_MPI_CALL(MPI_Isend(send_buffer_, static_cast<int>(size), MPI_BYTE, msg->dst(), 0, MPI_COMM_WORLD, &handle));
+    MV_MPI_CALL(MPI_Isend(send_buffer, static_cast<int>(size), MPI_BYTE, msg->dst(), 0, MPI_COMM_WORLD, &handle));
+    msg_handle->add_handle(handle);
+    return size;
+  }
+
+  // Send without flattening the message into a send buffer: the header, the
+  // blob sizes, the blob payloads and the over tag are described in place by
+  // an MPI derived datatype. The wire format, padding included, is the same
+  // as SerializeAndSend, so the receiver is unaware of the send mode. The
+  // message is kept alive by the handle until the send completes.
+  int GatherAndSend(MessagePtr& msg, MPIMsgHandle* msg_handle) {
+    MONITOR_BEGIN(MPI_NET_SEND_GATHER);
+    std::vector<size_t>& sizes = msg_handle->blob_sizes();
+    sizes.clear();
+    for (auto& data : msg->data()) sizes.push_back(data.size());
+    sizes.push_back(kover_);
+
+    std::vector<int> lengths;
+    std::vector<MPI_Aint> displacements;
+    lengths.reserve(2 * sizes.size());
+    displacements.reserve(2 * sizes.size());
+    int size = 0;
+    auto append = [&](void* address, size_t len) {
+      if (len == 0) return;
+      MPI_Aint displacement;
+      MV_MPI_CALL(MPI_Get_address(address, &displacement));
+      lengths.push_back(static_cast<int>(len));
+      displacements.push_back(displacement);
+      size += static_cast<int>(len);
+    };
+    append(msg->header(), Message::kHeaderSize);
+    static char padding[kAlignment] = { 0 };
+    for (size_t i = 0; i < msg->size(); ++i) {
+      append(&sizes[i], sizeof(size_t));
+      append(msg->data()[i].data(), msg->data()[i].size());
+      append(padding, Padding(msg->data()[i].size()));
+    }
+    append(&sizes.back(), sizeof(size_t));
+
+    MPI_Datatype type;
+    MV_MPI_CALL(MPI_Type_create_hindexed(static_cast<int>(lengths.size()),
+      lengths.data(), displacements.data(), MPI_BYTE, &type));
+    MV_MPI_CALL(MPI_Type_commit(&type));
+    MONITOR_END(MPI_NET_SEND_GATHER);
+
+    MPI_Request handle;
+    MV_MPI_CALL(MPI_Isend(MPI_BOTTOM, 1, type, msg->dst(), 0, MPI_COMM_WORLD, &handle));
+    // a datatype may be freed while the send using it is still pending
+    MV_MPI_CALL(MPI_Type_free(&type));
     msg_handle->add_handle(handle);
+    msg_handle->set_msg(msg);
     return size;
   }
 
+  // Blobs of the received msg are views of one pooled receive buffer, the
+  // payload is not copied. The buffer goes back to the allocator when the
+  // last of these Blobs is released.
   int RecvAndDeserialize(int src, int count, MessagePtr* msg_ptr) {
     if (!msg_ptr->get()) msg_ptr->reset(new Message());
     MessagePtr& msg = *msg_ptr;
     msg->data().clear();
+    Blob recv_buffer(count);
     MPI_Status status;
-    MV_MPI_CALL(MPI_Recv(recv_buffer_, count,
+    MV_MPI_CALL(MPI_Recv(recv_buffer.data(), count,
       MPI_BYTE, src, 0, MPI_COMM_WORLD, &status));
 
     MONITOR_BEGIN(MPI_NET_RECV_DESERIALIZE)
-    char* p = recv_buffer_;
+    size_t offset = 0;
     size_t s;
-    memcpy(msg->header(), p, Message::kHeaderSize);
-    p += Message::kHeaderSize;
-    memcpy(&s, p, sizeof(size_t));
-    p += sizeof(size_t);
+    memcpy(msg->header(), recv_buffer.data(), Message::kHeaderSize);
+    offset += Message::kHeaderSize;
+    memcpy(&s, recv_buffer.data() + offset, sizeof(size_t));
+    offset += sizeof(size_t);
     while (s != kover_) {
-      Blob data(s);
-      memcpy(data.data(), p, data.size());
-      msg->Push(data);
-      p += data.size();
-      memcpy(&s, p, sizeof(size_t));
-      p += sizeof(size_t);
+      if (s == 0) {
+        msg->Push(Blob());
+      } else {
+        msg->Push(Blob(recv_buffer, offset, s));
+      }
+      offset += s + Padding(s);
+      memcpy(&s, recv_buffer.data() + offset, sizeof(size_t));
+      offset += sizeof(size_t);
     }
     MONITOR_END(MPI_NET_RECV_DESERIALIZE)
     return count;
@@ -350,6 +477,18 @@ public:
   }
 
 private:
+  // Blob payloads are padded on the wire so that every Blob received as
+  // a view of the receive buffer is aligned
+  static const size_t kAlignment = sizeof(size_t);
+  static size_t Padding(size_t size) {
+    return (kAlignment - size % kAlignment) % kAlignment;
+  }
+
+  // value of flag mpi_zero_copy_send, defined in mpi_net.cpp
+  static bool zero_copy_send();
+  // value of flag mpi_send_window, defined in mpi_net.cpp
+  static int send_window();
+
   //size_t SendAsync(const MessagePtr& msg, 
   //                 MPIMsgHandle* msg_handle) {
   //  CHECK_NOTNULL(msg_handle);
@@ -410,18 +549,17 @@ private:
 private:
   // const char more_;
   const size_t kover_;
+  // held by the calls into MPI of Send, Recv and Allreduce
   std::mutex mutex_;
   int thread_provided_;
   int inited_;
   int rank_;
   int size_;
-  // std::queue<MPIMsgHandle *> msg_handles_;
-  std::unique_ptr<MPIMsgHandle> last_handle_;
+  // msgs on the air, at most send_window()
+  std::list<std::unique_ptr<MPIMsgHandle>> msg_handles_;
+  // finished handles, kept with their send buffers for reuse
+  std::vector<std::unique_ptr<MPIMsgHandle>> free_handles_;
   MtQueue<MessagePtr> send_queue_;
-  char* send_buffer_;
-  long long send_size_;
-  char* recv_buffer_;
-  long long recv_size_;
 };
 
 }
@@ -1,7 +1,10 @@
 #ifndef MULTIVERSO_SERVER_H_
 #define MULTIVERSO_SERVER_H_
 
+#include <functional>
+#include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "multiverso/actor.h"
@@ -9,18 +12,58 @@
 namespace multiverso {
 
 class ServerTable;
+class Stream;
+struct Shard;
 
 class Server : public Actor {
 public:
   Server();
+  ~Server();
   static Server* GetServer();
   int RegisterTable(ServerTable* table);
+  // wait for the checkpoints of all tables to be written
+  void WaitCheckpoint();
 
 protected:
   virtual void ProcessGet(MessagePtr& msg);
   virtual void ProcessAdd(MessagePtr& msg);
+  // messages between the servers, see ServerTable::TakeServerMessages
+  void ProcessMerge(MessagePtr& msg);
+  void ProcessMergeReply(MessagePtr& msg);
+  // [uri, Waiter*] from Zoo::Checkpoint and Zoo::Restore, the waiter is
+  // notified once the snapshots are taken or loaded
+  void ProcessCheckpoint(MessagePtr& msg);
+  void ProcessRestore(MessagePtr& msg);
 
   std::vector<ServerTable*> store_;
+
+private:
+  // Executor thread of a sharded server. Executor i processes shard i of
+  // every request on a shardable table, in the order requests arrive
+  class Executor;
+  // Run process on every shard of the request msg to table, as split by
+  // its SplitShards. The executor finishing the last shard runs finish (if
+  // any) and sends the reply
+  void Dispatch(ServerTable* table, MessagePtr& msg, MessagePtr& reply,
+    const std::function<void(Message* msg, Message* reply,
+                             const Shard& shard)>& process,
+    const std::function<void(Message* msg, Message* reply)>& finish = nullptr);
+
+  // Send the reply to a request of table, or hold it until the messages
+  // the table has for the other servers are answered
+  void Reply(ServerTable* table, MessagePtr& reply);
+  // wait for the executors to finish the dispatched requests
+  void Drain();
+  Stream* OpenSnapshot(const std::string& uri, int table_id, int server_id);
+
+  std::vector<std::unique_ptr<Executor>> executors_;
+  // replies held by Reply, by id of their server messages
+  struct HeldReply {
+    MessagePtr reply;
+    size_t remaining;           // server messages not answered yet
+  };
+  std::unordered_map<int, HeldReply> held_replies_;
+  int next_held_id_;
 };
 
 }  // namespace multiverso
@@ -3,7 +3,11 @@
 
 #include "multiverso/multiverso.h"
 #include "multiverso/table_interface.h"
+#include "multiverso/io/checkpoint.h"
+#include "multiverso/util/block_versions.h"
 #include "multiverso/util/log.h"
+#include "multiverso/util/partition_map.h"
+#include "multiverso/util/storage_allocator.h"
 
 namespace multiverso {
 
@@ -13,7 +17,8 @@ struct ArrayTableOption;
 template <typename T>
 class ArrayWorker : public WorkerTable {
 public:
-  explicit ArrayWorker(size_t size);
+  explicit ArrayWorker(size_t size,
+                       const PartitionOption& partition = PartitionOption());
   explicit ArrayWorker(const ArrayTableOption<T> &option);
   // std::vector<T>& raw() { return table_; }
 
@@ -33,10 +38,21 @@ public:
   void ProcessReplyGet(std::vector<Blob>& reply_data) override;
 
 private:
+  // reply [server id, changed values, changed blocks, {server id, version}]
+  void ProcessReplyVersionedGet(std::vector<Blob>& reply_data);
+
   T* data_; // not owned
   size_t size_;
   int num_server_;
-  std::vector<size_t> server_offsets_;
+  PartitionMap partition_;  // element ranges of the servers
+  // versioned Get (option version_block_size > 0): a local copy of the
+  // array and the version each block of each server was last received at
+  size_t version_block_size_;
+  std::vector<T> mirror_;
+  std::vector<std::vector<int64_t>> block_version_;
+  // quantization error of each element not sent yet (option one_bit_block)
+  size_t one_bit_block_;
+  std::vector<T> add_residual_;
 };
 
 template <typename T>
@@ -46,7 +62,8 @@ class Updater;
 template <typename T>
 class ArrayServer : public ServerTable {
 public:
-  explicit ArrayServer(size_t size);
+  explicit ArrayServer(size_t size,
+                       const PartitionOption& partition = PartitionOption());
   explicit ArrayServer(const ArrayTableOption<T> &option);
 
   void ProcessAdd(const std::vector<Blob>& data) override;
@@ -54,21 +71,61 @@ public:
   void ProcessGet(const std::vector<Blob>& data,
                   std::vector<Blob>* result) override;
 
+  // each shard owns a contiguous range of the local elements
+  bool shardable() const override { return true; }
+  void PrepareGet(const std::vector<Blob>& data,
+                  std::vector<Blob>* result) override;
+  void ProcessGetShard(const std::vector<Blob>& data,
+                       std::vector<Blob>* result,
+                       const Shard& shard) override;
+  void ProcessAddShard(const std::vector<Blob>& data,
+                       const Shard& shard) override;
+  void FinishGet(const std::vector<Blob>& data,
+                 std::vector<Blob>* result) override;
+  // restores the 1-bit Adds (option one_bit_block)
+  void PrepareAdd(std::vector<Blob>* data) override;
+
   void Store(Stream* s) override;
   void Load(Stream* s) override;
+  void StartCheckpoint(Stream* s) override;
+  void WaitCheckpoint() override { checkpoint_.Wait(); }
+  void Restore(const std::vector<Stream*>& snapshots) override;
 
 private:
+  // local elements [begin, end) owned by shard, aligned to version blocks
+  void ShardRange(int shard, int num_shards, size_t* begin, size_t* end) const;
+  // local elements [begin, end) of version block
+  void BlockRange(size_t block, size_t* begin, size_t* end) const;
+  SnapshotHeader Layout() const;
+
   int32_t server_id_;
-  std::vector<T> storage_;
+  PartitionMap partition_;
+  // huge page / NUMA backing, see util/storage_allocator.h
+  std::vector<T, StorageAllocator<T>> storage_;
   Updater<T>* updater_;
   size_t size_; // number of element with type T
-  
+  // version stamp of each block of local elements, disabled by default
+  BlockVersions versions_;
+  BackgroundCheckpoint checkpoint_;
+  size_t one_bit_block_;
 };
 
 template<typename T>
 struct ArrayTableOption {
-  explicit ArrayTableOption(size_t s) : size(s) {}
+  explicit ArrayTableOption(size_t s) : size(s), version_block_size(0),
+    one_bit_block(0) {}
   size_t size;
+  // elements of each server, uniform ranges by default
+  PartitionOption partition;
+  // elements per version block, > 0 makes Get only transfer the blocks
+  // changed since the last Get of the worker (at the cost of a local copy
+  // of the array on each worker)
+  size_t version_block_size;
+  // > 0 makes Adds send 1 bit per element, its sign, and one scale per
+  // block of one_bit_block elements, their mean magnitude (1-bit SGD, see
+  // OneBitsFilter). The quantization error is kept by each worker (a copy
+  // of the array) and added to its next Add. Float arrays only
+  size_t one_bit_block;
   DEFINE_TABLE_TYPE(T, ArrayWorker, ArrayServer);
 };
 
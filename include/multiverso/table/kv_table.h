@@ -6,19 +6,37 @@
 
 #include "multiverso/multiverso.h"
 #include "multiverso/table_interface.h"
+#include "multiverso/io/snapshot.h"
+#include "multiverso/util/flat_hash_map.h"
+#include "multiverso/util/hot_keys.h"
 #include "multiverso/util/log.h"
+#include "multiverso/util/partition_map.h"
+#include "multiverso/util/timer.h"
 
 namespace multiverso {
 
 template <typename Key, typename Val>
 struct KVTableOption;
 
-// A distributed shared std::unordered_map<Key, Val> table
-// Key, Val should be the basic type
+// A distributed shared hash map table, stored in a FlatHashMap on both
+// sides. Key, Val should be the basic type
 template <typename Key, typename Val>
 class KVWorkerTable : public WorkerTable {
 public:
-  explicit KVWorkerTable(const KVTableOption<Key, Val>&) {}
+  explicit KVWorkerTable(const KVTableOption<Key, Val>& option) :
+    partition_(option.partition, 0, MV_NumServers()) {
+    if (partition_.contiguous()) {
+      Log::Fatal("kvTable needs the hashed block partition.\n");
+    }
+    if (option.hot_replicas > 1) {
+      if (hot_.Init(option.hot_replicas, MV_NumServers())) {
+        hot_.Set(option.hot_keys);
+      } else {
+        Log::Error("[Init] worker = %d, the hot keys of kvTable need async "
+          "mode, not replicated.\n", MV_Rank());
+      }
+    }
+  }
 
   void Get(Key key) { WorkerTable::Get(Blob(&key, sizeof(Key))); }
 
@@ -37,7 +55,7 @@ public:
     WorkerTable::Add(keys_blob, vals_blob);
   }
 
-  std::unordered_map<Key, Val>& raw() { return table_; }
+  FlatHashMap<Key, Val>& raw() { return table_; }
    
   int Partition(const std::vector<Blob>& kv, 
     MsgType, std::unordered_map<int, std::vector<Blob> >* out) override {
@@ -46,7 +64,7 @@ public:
     std::unordered_map<int, int> counts;
     Blob keys = kv[0];
     for (int i = 0; i < keys.size<Key>(); ++i) { // iterate as type Key
-      int dst = static_cast<int>(keys.As<Key>(i) % MV_NumServers());
+      int dst = MV_ServerIdToRank(Server(keys.As<Key>(i)));
       ++counts[dst];
     }
     for (auto& it : counts) { // Allocate memory
@@ -56,7 +74,7 @@ public:
     }
     counts.clear();
     for (int i = 0; i < keys.size<Key>(); ++i) {
-      int dst = static_cast<int>(keys.As<Key>(i) % MV_NumServers());
+      int dst = MV_ServerIdToRank(Server(keys.As<Key>(i)));
       (*out)[dst][0].As<Key>(counts[dst]) = keys.As<Key>(i);
       if (kv.size() == 2) 
         (*out)[dst][1].As<Val>(counts[dst]) = kv[1].As<Val>(i);
@@ -69,19 +87,46 @@ public:
     CHECK(data.size() == 2);
     Blob keys = data[0], vals = data[1];
     CHECK(keys.size<Key>() == vals.size<Val>());
-    for (int i = 0; i < keys.size<Key>(); ++i) {
+    int num_keys = static_cast<int>(keys.size<Key>());
+    for (int i = 0; i < num_keys; ++i) {
+      if (i + kPrefetchDistance < num_keys) {
+        table_.Prefetch(keys.As<Key>(i + kPrefetchDistance));
+      }
       table_[keys.As<Key>(i)] = vals.As<Val>(i);
     }
   }
 
 private:
-  std::unordered_map<Key, Val> table_;
+  // the owner of key, or the replica of this worker for a hot key
+  int Server(Key key) const {
+    int64_t k = static_cast<int64_t>(key);
+    return hot_.Server(k, partition_.Server(k), MV_WorkerId());
+  }
+
+  // keys looked up ahead of the current one in the batched loops
+  enum { kPrefetchDistance = 8 };
+
+  FlatHashMap<Key, Val> table_;
+  PartitionMap partition_;
+  HotKeys hot_;
 };
 
 template <typename Key, typename Val>
 class KVServerTable : public ServerTable {
 public:
-  explicit KVServerTable(const KVTableOption<Key, Val>&) {}
+  explicit KVServerTable(const KVTableOption<Key, Val>& option) :
+    partition_(option.partition, 0, MV_NumServers()),
+    merge_ms_(option.hot_merge_ms), merge_now_(false) {
+    CHECK(option.hot_replicas >= 1 && option.hot_merge_ms >= 0);
+    if (option.hot_replicas > 1 &&
+        hot_.Init(option.hot_replicas, MV_NumServers())) {
+      hot_.Set(option.hot_keys);
+      for (auto key : option.hot_keys) {
+        int owner = partition_.Server(static_cast<int64_t>(key));
+        if (hot_.Replicates(MV_ServerId(), owner)) deltas_[key] = 0;
+      }
+    }
+  }
 
   void ProcessGet(const std::vector<Blob>& data, 
                   std::vector<Blob>* result) override {
@@ -91,7 +136,11 @@ public:
     result->push_back(keys); // also push the key
     result->push_back(Blob(keys.size<Key>() * sizeof(Val)));
     Blob& vals = (*result)[1];
-    for (int i = 0; i < keys.size<Key>(); ++i) {
+    int num_keys = static_cast<int>(keys.size<Key>());
+    for (int i = 0; i < num_keys; ++i) {
+      if (i + kPrefetchDistance < num_keys) {
+        table_.Prefetch(keys.As<Key>(i + kPrefetchDistance));
+      }
       vals.As<Val>(i) = table_[keys.As<Key>(i)];
     }
   }
@@ -100,25 +149,164 @@ public:
     CHECK(data.size() == 2);
     Blob keys = data[0], vals = data[1];
     CHECK(keys.size<Key>() == vals.size<Val>());
-    for (int i = 0; i < keys.size<Key>(); ++i) {
+    int num_keys = static_cast<int>(keys.size<Key>());
+    for (int i = 0; i < num_keys; ++i) {
+      if (i + kPrefetchDistance < num_keys) {
+        table_.Prefetch(keys.As<Key>(i + kPrefetchDistance));
+      }
       table_[keys.As<Key>(i)] += vals.As<Val>(i);
     }
+    // the replicas keep the delta for the owner
+    for (size_t i = 0; !deltas_.empty() && i < keys.size<Key>(); ++i) {
+      auto it = deltas_.find(keys.As<Key>(i));
+      if (it != deltas_.end()) it->second += vals.As<Val>(i);
+    }
   }
 
-  void Store(Stream*) override {
-    Log::Fatal("Not implemented yet\n");
+  // every hot_merge_ms the replicas send [keys, deltas] to the owners,
+  // which reply [keys, values]
+  void TakeServerMessages(
+    std::unordered_map<int, std::vector<Blob> >* messages) override {
+    if (deltas_.empty()) return;
+    if (!merge_now_ && merge_timer_.elapse() < merge_ms_) return;
+    merge_now_ = false;
+    merge_timer_.Start();
+    std::unordered_map<int, std::pair<std::vector<Key>,
+                                      std::vector<Val>>> merges;
+    for (auto& delta : deltas_) {
+      auto& merge = merges[partition_.Server(
+        static_cast<int64_t>(delta.first))];
+      merge.first.push_back(delta.first);
+      merge.second.push_back(delta.second);
+      delta.second = 0;
+    }
+    for (auto& merge : merges) {
+      std::vector<Blob>& message =
+        (*messages)[MV_ServerIdToRank(merge.first)];
+      message.push_back(Blob(merge.second.first.data(),
+        merge.second.first.size() * sizeof(Key)));
+      message.push_back(Blob(merge.second.second.data(),
+        merge.second.second.size() * sizeof(Val)));
+    }
   }
 
-  void Load(Stream*) override {
-    Log::Fatal("Not implemented yet\n");
+  void ProcessServerMessage(const std::vector<Blob>& data,
+                            std::vector<Blob>* result) override {
+    ProcessAdd(data);
+    ProcessGet(std::vector<Blob>(1, data[0]), result);
+  }
+
+  void ProcessServerReply(const std::vector<Blob>& data) override {
+    CHECK(data.size() == 2);
+    Blob keys = data[0], vals = data[1];
+    for (size_t i = 0; i < keys.size<Key>(); ++i) {
+      // the owner value, with the deltas added here since the merge
+      Key key = keys.As<Key>(i);
+      table_[key] = vals.As<Val>(i) + deltas_[key];
+    }
+  }
+
+  // snapshot of the (key, value) pairs owned here, the replicas of the hot
+  // keys of other servers are not part of it. Written before returning, a
+  // rehash would move the entries under a background checkpoint
+  void Store(Stream* s) override {
+    uint64_t num_keys = 0;
+    for (auto& entry : table_) num_keys += Owned(entry.first);
+    SnapshotWriter writer(s, Layout(num_keys));
+    for (auto& entry : table_) {
+      if (!Owned(entry.first)) continue;
+      writer.Write(&entry.first, sizeof(Key));
+      writer.Write(&entry.second, sizeof(Val));
+    }
+    writer.Finish();
+  }
+
+  void Load(Stream* s) override { Restore(std::vector<Stream*>(1, s)); }
+
+  // the keys owned here of the snapshots of all the servers, each is read
+  // whole as the keys are not sorted. The replicas of the hot keys of other
+  // servers take the values of their owners from the snapshots, and keep
+  // theirs until the next merge when the owner snapshot is not read (Load)
+  void Restore(const std::vector<Stream*>& snapshots) override {
+    std::vector<std::pair<Key, Val>> replicas;
+    for (auto& delta : deltas_) {
+      auto it = table_.find(delta.first);
+      if (it != table_.end()) replicas.push_back(*it);
+    }
+    table_.clear();
+    for (auto& replica : replicas) table_[replica.first] = replica.second;
+    for (auto stream : snapshots) {
+      SnapshotReader reader(stream);
+      uint64_t num_keys = reader.header().num_rows;
+      CheckSnapshotLayout(Layout(num_keys), reader.header());
+      if (snapshots.size() == 1) table_.reserve(static_cast<size_t>(num_keys));
+      for (uint64_t i = 0; i < num_keys && reader.ok(); ++i) {
+        Key key;
+        Val val;
+        reader.Read(&key, sizeof(Key));
+        reader.Read(&val, sizeof(Val));
+        if (Owned(key) || deltas_.find(key) != deltas_.end()) {
+          table_[key] = val;
+        }
+      }
+      reader.Finish();
+    }
+    // the Adds kept for the owners are in the snapshots or lost with the
+    // owner state, the replicas merge with the next request
+    for (auto& delta : deltas_) delta.second = 0;
+    merge_now_ = !deltas_.empty();
   }
 
 private:
-  std::unordered_map<Key, Val> table_;
+  enum { kPrefetchDistance = 8 };
+
+  bool Owned(const Key& key) const {
+    return partition_.Server(static_cast<int64_t>(key)) == MV_ServerId();
+  }
+
+  SnapshotHeader Layout(uint64_t num_keys) const {
+    SnapshotHeader header;
+    header.table_type = static_cast<uint32_t>(SnapshotTable::kKV);
+    header.element_type = SnapshotElementType<Val>();
+    header.key_type = SnapshotElementType<Key>();
+    header.server_id = MV_ServerId();
+    header.num_servers = partition_.num_servers();
+    header.num_rows = num_keys;
+    header.num_cols = 1;
+    header.end = num_keys;
+    header.payload_bytes = num_keys * (sizeof(Key) + sizeof(Val));
+    return header;
+  }
+
+  FlatHashMap<Key, Val> table_;
+  PartitionMap partition_;
+  // replicated hot keys of other servers and their deltas since the last
+  // merge
+  HotKeys hot_;
+  FlatHashMap<Key, Val> deltas_;
+  double merge_ms_;
+  // merge with the next request instead of waiting for merge_ms_
+  bool merge_now_;
+  Timer merge_timer_;
 };
 
 template <typename Key, typename Val>
 struct KVTableOption {
+  KVTableOption() : hot_replicas(1), hot_merge_ms(10) {
+    partition.strategy = PartitionStrategy::kHashedBlock;
+  }
+  // keys of each server, blocks of partition.block_size consecutive keys
+  // on a consistent hash ring
+  PartitionOption partition;
+  // replicas of each hot key, > 1 replicates hot_keys on the
+  // hot_replicas - 1 servers after their owner, the workers spread their
+  // requests on them. The replicas merge their Adds into the owner and get
+  // its value back every hot_merge_ms (checked on each request), a worker
+  // may not see the Adds of the others on other replicas until then.
+  // Async mode only
+  std::vector<Key> hot_keys;
+  int hot_replicas;
+  double hot_merge_ms;
   typedef KVWorkerTable<Key, Val> WorkerTableType;
   typedef KVServerTable<Key, Val> ServerTableType;
 };
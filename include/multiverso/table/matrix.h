@@ -3,7 +3,11 @@
 
 #include "multiverso/multiverso.h"
 #include "multiverso/table_interface.h"
+#include "multiverso/io/checkpoint.h"
+#include "multiverso/util/partition_map.h"
+#include "multiverso/util/up_to_date_tracker.h"
 
+#include <memory>
 #include <vector>
 
 namespace multiverso {
@@ -16,7 +20,8 @@ namespace multiverso {
   public:
     explicit MatrixWorker(const MatrixOption<T>& option);
 
-    MatrixWorker(integer_t num_row, integer_t num_col, bool is_sparse = false);
+    MatrixWorker(integer_t num_row, integer_t num_col, bool is_sparse = false,
+      const PartitionOption& partition = PartitionOption());
 
     ~MatrixWorker();
 
@@ -64,8 +69,8 @@ namespace multiverso {
     integer_t num_row_;
     integer_t num_col_;
     integer_t row_size_;                           // equals to sizeof(T) * num_col_
-    int num_server_;                         // the number of running servers
-    std::vector<integer_t> server_offsets_;        // offset for the row in each servers
+    int num_server_;
+    PartitionMap partition_;                 // row ranges of the servers
     bool is_sparse_;
   };
 
@@ -78,7 +83,8 @@ namespace multiverso {
     explicit MatrixServer(const MatrixOption<T>& option);
 
     MatrixServer(integer_t num_row, integer_t num_col, bool is_sparse = false,
-                                            bool is_pipeline = false);
+                                            bool is_pipeline = false,
+      const PartitionOption& partition = PartitionOption());
 
     void ProcessAdd(const std::vector<Blob>& data) override;
 
@@ -87,6 +93,9 @@ namespace multiverso {
 
     void Store(Stream* s) override;
     void Load(Stream* s) override;
+    void StartCheckpoint(Stream* s) override;
+    void WaitCheckpoint() override { checkpoint_.Wait(); }
+    void Restore(const std::vector<Stream*>& snapshots) override;
 
   protected:
     void UpdateAddState(int worker_id, Blob keys);
@@ -100,16 +109,20 @@ namespace multiverso {
     inline integer_t GetPhysicalRow(integer_t logical_row) {
       return logical_row - row_offset_;
     }
+    SnapshotHeader Layout() const;
+
     int server_id_;
+    integer_t num_row_;
     integer_t my_num_row_;
     integer_t num_col_;
     integer_t row_offset_;
     Updater<T>* updater_;
     std::vector<T> storage_;
+    BackgroundCheckpoint checkpoint_;
 
     // following attibutes are used by sparse update
     bool is_sparse_;
-    bool** up_to_date_;
+    std::unique_ptr<UpToDateTracker> up_to_date_;
     int workers_nums_;
   };
 
@@ -119,6 +132,7 @@ namespace multiverso {
     integer_t num_col;
     bool is_sparse;
     bool is_pipeline;
+    PartitionOption partition;
     DEFINE_TABLE_TYPE(T, MatrixWorker, MatrixServer);
   };
 
@@ -4,7 +4,17 @@
 
 #include "multiverso/multiverso.h"
 #include "multiverso/table_interface.h"
-
+#include "multiverso/io/checkpoint.h"
+#include "multiverso/util/block_versions.h"
+#include "multiverso/util/hot_keys.h"
+#include "multiverso/util/log.h"
+#include "multiverso/util/partition_map.h"
+#include "multiverso/util/row_cache.h"
+#include "multiverso/util/storage_allocator.h"
+#include "multiverso/util/timer.h"
+
+#include <memory>
+#include <unordered_map>
 #include <vector>
 #include <random>
 
@@ -13,12 +23,19 @@ namespace multiverso {
 template <typename T>
 struct MatrixTableOption;
 
+// keys of the requests on the hot rows, -1 being the whole table.
+// Get [kHotRowsCount, k]: the k most accessed rows of each server,
+// Get [kHotRowsSet]: the replicated rows, Add [kHotRowsCount]: merge the
+// replicas now, Add [kHotRowsSet, rows...]: replicate rows
+enum : integer_t { kHotRowsCount = -2, kHotRowsSet = -3 };
+
 template <typename T>
 class MatrixWorkerTable : public WorkerTable {
 public:
   explicit MatrixWorkerTable(const MatrixTableOption<T>& option);
 
-  MatrixWorkerTable(integer_t num_row, integer_t num_col);
+  MatrixWorkerTable(integer_t num_row, integer_t num_col,
+                    const PartitionOption& partition = PartitionOption());
 
   ~MatrixWorkerTable();
 
@@ -74,20 +91,132 @@ public:
   int AddAsync(T* data, size_t size, integer_t* row_ids, integer_t row_ids_size,
     const AddOption* option = nullptr);
 
+  // Advance the clock of this worker: with the row cache (option
+  // cache_bytes > 0), rows fetched more than cache_staleness clocks ago
+  // are fetched again. Typically called once per mini-batch
+  void Clock();
+  int clock() const;
+  // nullptr if the row cache is disabled
+  const RowCache<T>* cache() const { return cache_.get(); }
+
+  // Send the Adds kept in the add buffer (option add_buffer_bytes > 0),
+  // blocking until the servers applied them. Also called by MV_Barrier,
+  // MV_ShutDown and the destructor
+  void Flush() override;
+  // rows added by keyed Adds per row sent to the servers, 1 without merges
+  double add_merge_ratio() const;
+
+  // Hot rows (option hot_replicas > 1) are replicated on several servers,
+  // each worker reads and writes one replica. The replicas send their
+  // Adds to the owner server every hot_merge_ms, MergeReplicas does it
+  // now (after a Flush) and blocks until the owners applied them
+  void MergeReplicas();
+  // the k rows with the most keyed Gets and Adds on the servers since the
+  // hot rows were last set
+  std::vector<integer_t> HotRows(size_t k);
+  // replicate the k rows HotRows reports instead of the current hot rows,
+  // must be called by all the workers
+  void ReplicateHotRows(size_t k);
+  const HotKeys& hot_rows() const { return hot_; }
+
+  // Partition of an Add, a Get is only known with its request id
   int Partition(const std::vector<Blob>& kv,
     MsgType partition_type,
     std::unordered_map<int, std::vector<Blob>>* out) override;
+  int Partition(int msg_id, const std::vector<Blob>& kv,
+    MsgType partition_type,
+    std::unordered_map<int, std::vector<Blob>>* out) override;
 
   void ProcessReplyGet(std::vector<Blob>& reply_data) override;
+  void ProcessReplyGet(int msg_id, std::vector<Blob>& reply_data) override;
 
 protected:
-  T** row_index_;
-  int get_reply_count_;                    // number of unprocessed get reply
+  // Destination of the rows of a pending Get. Each GetAsync has its own,
+  // so that several Gets of a table may be outstanding
+  struct GetRequest {
+    GetRequest() : whole_table(nullptr), num_replies(0), clock(0),
+      counts(nullptr) {}
+    // destination of row key, within whole_table if set
+    T* row(integer_t key, integer_t num_col) const {
+      if (whole_table != nullptr) {
+        return whole_table + static_cast<size_t>(key) * num_col;
+      }
+      auto it = rows.find(key);
+      CHECK(it != rows.end());
+      return it->second;
+    }
+
+    T* whole_table;
+    std::unordered_map<integer_t, T*> rows;
+    int num_replies;                         // replies still expected
+    int clock;                               // worker clock when sent
+    // access count of each row, for a kHotRowsCount Get
+    std::unordered_map<integer_t, int64_t>* counts;
+  };
+
+  // Send a Get of keys, the replies are written to the destinations of
+  // request. Return the id to Wait for
+  int RequestGet(Blob keys, GetRequest request,
+                 const GetOption* option = nullptr);
+  // pending request msg_id
+  GetRequest* FindRequest(int msg_id);
+  // the last reply of the request was processed
+  void FinishRequest(int msg_id);
+
+  // apply an Add of the worker to the cached rows, so that the worker
+  // reads its own writes
+  void UpdateCache(const integer_t* keys, size_t keys_size, const T* values);
+  // Merge the Add request into the add buffer. Return false if it is kept
+  // back, true with the Add to send in merged otherwise
+  bool BufferAdd(const std::vector<Blob>& request, std::vector<Blob>* merged);
+  // requests of keys kHotRowsCount and kHotRowsSet
+  int PartitionHotRows(int msg_id, const std::vector<Blob>& request,
+                       std::unordered_map<int, std::vector<Blob>>* out);
+  // reply [keys, rows ending with -1, counts] or [keys, rows ending with -1]
+  void ProcessReplyHotRows(GetRequest* request, std::vector<Blob>& reply_data);
+
+  // reply [keys, values] or [-1, values, server id]
+  void ProcessReplyPlainGet(const GetRequest& request,
+                            std::vector<Blob>& reply_data);
+  // reply [keys, changed values, changed units, {server id, version}]
+  void ProcessReplyVersionedGet(const GetRequest& request,
+                                std::vector<Blob>& reply_data);
+
+  // guards requests_, clock_ and the add buffer counters, which the user
+  // threads share with the worker actor
+  std::mutex* mutex_;
+  std::unordered_map<int, GetRequest> requests_;
   integer_t num_row_;
   integer_t num_col_;
   integer_t row_size_;                           // equals to sizeof(T) * num_col_
   int num_server_;
-  std::vector<integer_t> server_offsets_;        // row id offset
+  PartitionMap partition_;                       // row ranges of the servers
+  // versioned Get (option version_block_rows > 0): a local copy of the
+  // rows and the server version each was last received at, so that the
+  // servers only send the row blocks changed since
+  integer_t version_block_rows_;
+  std::vector<T> mirror_;
+  std::vector<int64_t> row_version_;
+  // rows of keyed Gets, only accessed by the worker actor
+  std::unique_ptr<RowCache<T>> cache_;
+  int clock_;
+  // add buffer, summed deltas of rows added by the worker and not sent yet,
+  // only accessed by the worker actor
+  size_t add_buffer_bytes_;
+  double add_buffer_ms_;
+  std::unordered_map<integer_t, size_t> buffer_index_;
+  std::vector<integer_t> buffer_keys_;
+  std::vector<T> buffer_values_;
+  Timer buffer_timer_;                       // since the oldest buffered Add
+  long long rows_added_;
+  long long rows_sent_;
+  size_t buffered_rows_;                     // guarded by mutex_
+  // replicated rows, only accessed by the worker actor
+  HotKeys hot_;
+  // quantization error of each element not sent yet (option one_bit_add),
+  // only accessed by the worker actor
+  bool one_bit_add_;
+  std::vector<T> add_residual_;
 };
 
 template <typename T>
@@ -98,7 +227,8 @@ class MatrixServerTable : public ServerTable {
 public:
   explicit MatrixServerTable(const MatrixTableOption<T>& option);
 
-  MatrixServerTable(integer_t num_row, integer_t num_col);
+  MatrixServerTable(integer_t num_row, integer_t num_col,
+                    const PartitionOption& partition = PartitionOption());
   MatrixServerTable(integer_t num_row, integer_t num_col, float min_value, float max_value);
 
   void ProcessAdd(const std::vector<Blob>& data) override;
@@ -106,23 +236,137 @@ public:
   void ProcessGet(const std::vector<Blob>& data,
                   std::vector<Blob>* result) override;
 
+  // each shard owns a contiguous range of the local rows. The replicas of
+  // hot rows are not split, they need all the requests on a single thread
+  bool shardable() const override { return !hot_.enabled(); }
+  // the keys of a keyed request go to the shards owning their rows
+  void SplitShards(const std::vector<Blob>& data, int num_shards,
+                   std::vector<Shard>* shards) const override;
+  void PrepareGet(const std::vector<Blob>& data,
+                  std::vector<Blob>* result) override;
+  void ProcessGetShard(const std::vector<Blob>& data,
+                       std::vector<Blob>* result,
+                       const Shard& shard) override;
+  void ProcessAddShard(const std::vector<Blob>& data,
+                       const Shard& shard) override;
+  void FinishGet(const std::vector<Blob>& data,
+                 std::vector<Blob>* result) override;
+  // restores the 1-bit Adds (option one_bit_add)
+  void PrepareAdd(std::vector<Blob>* data) override;
+
+  // snapshot of the local rows, the deltas kept by the replicas are not
+  // part of it, see MergeReplicas
   void Store(Stream* s) override;
   void Load(Stream* s) override;
+  void StartCheckpoint(Stream* s) override;
+  void WaitCheckpoint() override { checkpoint_.Wait(); }
+  // the local rows from the snapshots holding them, on any number of
+  // servers and any partition
+  void Restore(const std::vector<Stream*>& snapshots) override;
+
+  // merge of the replicas: [keys, deltas] to the owners, which reply
+  // [keys, values]
+  void TakeServerMessages(
+    std::unordered_map<int, std::vector<Blob> >* messages) override;
+  void ProcessServerMessage(const std::vector<Blob>& data,
+                            std::vector<Blob>* result) override;
+  void ProcessServerReply(const std::vector<Blob>& data) override;
 
 protected:
+  // local rows [begin, end) owned by shard, aligned to version blocks
+  void ShardRows(int shard, int num_shards,
+                 integer_t* begin, integer_t* end) const;
+  // local rows [begin, end) of version block
+  void BlockRows(size_t block, integer_t* begin, integer_t* end) const;
+  // replicate rows, dropping the replicas of the rows no longer hot
+  void SetHotRows(const std::vector<integer_t>& rows);
+  // Gets and Adds of keys kHotRowsCount and kHotRowsSet
+  void PrepareHotRowsGet(const std::vector<Blob>& data,
+                         std::vector<Blob>* result);
+  void ProcessHotRowsAdd(const integer_t* keys, size_t keys_size);
+  // slot of row in the replicas, -1 if not replicated here
+  integer_t ReplicaSlot(integer_t row) const;
+  SnapshotHeader Layout() const;
+  // before changing the local rows (-1 for none), see BackgroundCheckpoint
+  void CopyOnWrite(const std::vector<integer_t>& rows);
+
   int server_id_;
   integer_t my_num_row_;
   integer_t num_col_;
+  PartitionMap partition_;
   integer_t row_offset_;
   Updater<T>* updater_;
-  std::vector<T> storage_;
+  // huge page / NUMA backing is selected by flags storage_huge_page and
+  // storage_numa, see util/storage_allocator.h
+  std::vector<T, StorageAllocator<T>> storage_;
+  // version stamp of each block of local rows, disabled by default
+  BlockVersions versions_;
+  // keyed Gets and Adds of each local row since the hot rows were set
+  std::vector<uint32_t> access_count_;
+  // replicas of the hot rows of other servers, with the deltas added since
+  // the last merge and the access count of each
+  HotKeys hot_;
+  std::unordered_map<integer_t, integer_t> replica_slot_;
+  std::vector<integer_t> replica_rows_;
+  std::vector<T> replica_values_;
+  std::vector<T> replica_deltas_;
+  std::vector<uint32_t> replica_count_;
+  // deltas of rows no longer replicated, sent with the next merge
+  std::vector<integer_t> dropped_rows_;
+  std::vector<T> dropped_deltas_;
+  double merge_ms_;
+  bool merge_now_;
+  Timer merge_timer_;                        // since the last merge
+  BackgroundCheckpoint checkpoint_;
+  bool one_bit_add_;
 };
 
 template <typename T>
 struct MatrixTableOption {
-  MatrixTableOption(integer_t num_row, integer_t num_col):num_row(num_row), num_col(num_col){}
+  MatrixTableOption(integer_t num_row, integer_t num_col) :
+    num_row(num_row), num_col(num_col), version_block_rows(0),
+    cache_bytes(0), cache_staleness(0), add_buffer_bytes(0),
+    add_buffer_ms(0), hot_replicas(1), hot_merge_ms(10),
+    one_bit_add(false) {}
   integer_t num_row;
   integer_t num_col;
+  // rows of each server, uniform ranges by default. Any range strategy,
+  // e.g. kLoadAwareRange with the access counts of the rows to spread the
+  // hot rows over the servers
+  PartitionOption partition;
+  // rows per version block, > 0 makes Get only transfer the blocks changed
+  // since the last Get of the worker (at the cost of a local copy of the
+  // table on each worker)
+  integer_t version_block_rows;
+  // bytes of rows cached by each worker, > 0 serves the keyed Gets of rows
+  // fetched at most cache_staleness clocks ago (see MatrixWorkerTable::Clock)
+  // from the cache. Whole table Gets always go to the servers
+  size_t cache_bytes;
+  int cache_staleness;
+  // bytes of deltas each worker may keep back, > 0 sums the keyed Adds of
+  // the worker per row and sends them as one Add when add_buffer_bytes is
+  // reached, when the oldest kept Add is add_buffer_ms old (0 for no time
+  // limit, checked on each Add), on MatrixWorkerTable::Flush, MV_Barrier,
+  // MV_ShutDown or when the table is deleted. Gets do not see the Adds kept
+  // back. Only with the updaters linear in the delta (default, sgd) and in
+  // async mode, the AddOption of merged Adds is dropped
+  size_t add_buffer_bytes;
+  double add_buffer_ms;
+  // replicas of each hot row, > 1 replicates hot_rows (or the rows found
+  // by MatrixWorkerTable::ReplicateHotRows) on the hot_replicas - 1 servers
+  // after their owner, the workers spread their requests on them. The
+  // replicas merge their Adds into the owner and get its value back every
+  // hot_merge_ms (checked on each request). Only with the updaters linear
+  // in the delta (default, sgd), in async mode and without versioned Get
+  std::vector<integer_t> hot_rows;
+  int hot_replicas;
+  double hot_merge_ms;
+  // Adds send 1 bit per element, its sign, and one scale per row, the mean
+  // magnitude of the row (1-bit SGD, see OneBitsFilter). The quantization
+  // error is kept by each worker (a copy of the table) and added to its
+  // next Add of the same rows. Float tables only, the Adds of the hot rows
+  // replicas between the servers are not quantized
+  bool one_bit_add;
   DEFINE_TABLE_TYPE(T, MatrixWorkerTable, MatrixServerTable);
 };
 
@@ -7,6 +7,7 @@
 #include "multiverso/multiverso.h"
 #include "multiverso/table_interface.h"
 #include "multiverso/util/log.h"
+#include "multiverso/util/up_to_date_tracker.h"
 #include "multiverso/table/matrix_table.h"
 
 namespace multiverso {
@@ -16,10 +17,10 @@ class SparseMatrixWorkerTable : public MatrixWorkerTable<T> {
  public:
    SparseMatrixWorkerTable(integer_t num_row, integer_t num_col)
      : MatrixWorkerTable<T>(num_row, num_col) { }
-    int Partition(const std::vector<Blob>& kv,
+    using MatrixWorkerTable<T>::Partition;
+    int Partition(int msg_id, const std::vector<Blob>& kv,
       MsgType partition_type,
       std::unordered_map<int, std::vector<Blob>>* out) override;
-    void ProcessReplyGet(std::vector<Blob>& reply_data) override;
 
     // get whole table, data is user-allocated memory
     void Get(T* data, size_t size,
@@ -50,10 +51,11 @@ template <typename T>
 class SparseMatrixServerTable : public MatrixServerTable<T> {
  public:
      SparseMatrixServerTable(integer_t num_row, integer_t num_col, bool using_pipeline);
-     ~SparseMatrixServerTable();
     void ProcessAdd(const std::vector<Blob>& data) override;
     void ProcessGet(const std::vector<Blob>& data,
         std::vector<Blob>* result) override;
+    // the up-to-date state is shared by all rows of a request
+    bool shardable() const override { return false; }
  private:
      void UpdateAddState(int worker_id, Blob keys);
      void UpdateGetState(int worker_id, integer_t* keys, size_t key_size,
@@ -65,9 +67,9 @@ class SparseMatrixServerTable : public MatrixServerTable<T> {
        return global_row_id - this->row_offset_;
      }
  private:
-   bool** up_to_date_;
+   // rows each worker got since they were last changed by another worker
+   UpToDateTracker up_to_date_;
    int workers_nums_;
-   // std::vector<std::vector<bool>> up_to_date_;
 };
 
 }   // namespace multiverso
@@ -44,6 +44,22 @@ public:
 
   virtual void ProcessReplyGet(std::vector<Blob>&) = 0;
 
+  // The worker actor calls these with the id of the request, they forward
+  // to the versions above by default. Tables keeping state per request,
+  // such as the destination of a Get, override them
+  virtual int Partition(int, const std::vector<Blob>& kv,
+    MsgType partition_type,
+    std::unordered_map<int, std::vector<Blob> >* out) {
+    return Partition(kv, partition_type, out);
+  }
+  virtual void ProcessReplyGet(int, std::vector<Blob>& reply_data) {
+    ProcessReplyGet(reply_data);
+  }
+
+  // Send the Adds the table keeps back and block until they are applied,
+  // called on every table before a barrier and at shutdown
+  virtual void Flush() {}
+
   // add user defined data structure
 private:
   std::string table_name_;
@@ -57,6 +73,19 @@ private:
 
 class Stream;
 
+// The part of a request processed by one shard of a sharded server, see
+// ServerTable::SplitShards
+struct Shard {
+  Shard(int id, int num_shards) : id(id), num_shards(num_shards) {}
+  int id;
+  int num_shards;
+  // keyed requests: the positions in the keys of the request of the keys
+  // owned by the shard and their local rows (-1 for the keys not owned by
+  // this server, given to shard 0). Empty for the whole table
+  std::vector<size_t> positions;
+  std::vector<integer_t> rows;
+};
+
 // interface for checkpoint table
 class Serializable {
 public:
@@ -72,6 +101,53 @@ public:
   virtual void ProcessAdd(const std::vector<Blob>& data) = 0;
   virtual void ProcessGet(const std::vector<Blob>& data,
                           std::vector<Blob>* result) = 0;
+
+  // Sharded processing, used when the server runs several executor threads.
+  // The local elements of a shardable table are split into num_shards
+  // disjoint ranges. A shard call only touches the elements of its own
+  // range, so all shards of a request can be processed concurrently.
+  virtual bool shardable() const { return false; }
+  // Split a request between num_shards shards, once before it is
+  // dispatched, so that each shard only visits the keys it owns
+  virtual void SplitShards(const std::vector<Blob>& data, int num_shards,
+                           std::vector<Shard>* shards) const;
+  // Allocate the reply of a Get, it is filled by ProcessGetShard
+  virtual void PrepareGet(const std::vector<Blob>& data,
+                          std::vector<Blob>* result);
+  virtual void ProcessGetShard(const std::vector<Blob>& data,
+                               std::vector<Blob>* result,
+                               const Shard& shard);
+  virtual void ProcessAddShard(const std::vector<Blob>& data,
+                               const Shard& shard);
+  // Called once all shards of a Get are processed, before the reply is sent
+  virtual void FinishGet(const std::vector<Blob>&, std::vector<Blob>*) {}
+  // Called on the data of an Add before it is processed, sharded or not,
+  // for tables receiving their Adds compressed to restore them in place
+  virtual void PrepareAdd(std::vector<Blob>*) {}
+
+  // Exchange between servers, for tables keeping replicas of keys owned by
+  // other servers. After each request the server sends the messages of
+  // TakeServerMessages (per destination rank) and holds the reply to the
+  // request until they are answered. The destination answers with
+  // ProcessServerMessage, its answer is passed to ProcessServerReply.
+  // Only called on tables processing their requests unsharded
+  virtual void TakeServerMessages(
+    std::unordered_map<int, std::vector<Blob> >*) {}
+  virtual void ProcessServerMessage(const std::vector<Blob>&,
+                                    std::vector<Blob>*) {}
+  virtual void ProcessServerReply(const std::vector<Blob>&) {}
+
+  // Checkpoint: write the snapshot of Store to stream, which is deleted
+  // once written. By default it is written before returning, tables
+  // writing it in the background while processing requests override both.
+  // Load waits for the running checkpoint
+  virtual void StartCheckpoint(Stream* stream);
+  virtual void WaitCheckpoint() {}
+  // Restore from the snapshots of a checkpoint, one per server that took
+  // it in server order. They may be more or fewer than the servers now and
+  // hold other ranges of the table. By default the snapshot of this server
+  // is loaded, with as many servers only
+  virtual void Restore(const std::vector<Stream*>& snapshots);
 };
 
 #define DEFINE_TABLE_TYPE(template_type,                    \
@@ -5,8 +5,6 @@
 #include "multiverso/util/log.h"
 
 #include <vector>
-#include <cmath>
-#include <cstdint>
 
 
 namespace multiverso {
@@ -22,34 +20,26 @@ public:
 
   void Update(size_t num_element, T* data, T* delta, 
               AddOption* option, size_t offset) override {
-
-    auto g_sqr_data_ = historic_g_sqr_.at(option->worker_id());
-    for (size_t index = 0; index < num_element; ++index) {
-      g_sqr_data_[index + offset] -=
-        delta[index] * delta[index] / option->learning_rate() / 
-        option->learning_rate();
-
-      //[TODO(qiwye)] sqrt take too much time
-      data[index + offset] -= option->rho() /
-        std::sqrt(g_sqr_data_[index + offset] + e) *
-        delta[index] / option->learning_rate();
-
-      //data[index + offset] -= option->rho() *
-      //  QuakeRsqrt(g_sqr_data_[index + offset] + e) *
-      //  delta[index] / option->learning_rate();
-    }
+    auto adagrad = this->kernels_->adagrad;
+    T* g_sqr_data = historic_g_sqr_.at(option->worker_id()).data() + offset;
+    T learning_rate = option->learning_rate(), rho = option->rho(), e = this->e;
+    this->ForEachBlock(num_element, [=](size_t begin, size_t count) {
+      adagrad(count, data + offset + begin, g_sqr_data + begin,
+              delta + begin, learning_rate, rho, e);
+    });
   }
 
-
-private:
-
-  float QuakeRsqrt(float number){
-    float x = number * 0.5f, y = number;
-    std::uint32_t i;
-    std::memcpy(&i, &y, sizeof(float));
-    i = 0x5f3759df - (i >> 1);
-    std::memcpy(&y, &i, sizeof(float));
-    return y * (1.5f - (x * y * y));
+  void UpdateRows(size_t num_rows, size_t row_size, const integer_t* rows,
+                  T* data, T* delta, AddOption* option,
+                  const size_t* positions) override {
+    auto adagrad = this->kernels_->adagrad;
+    T* g_sqr_data = historic_g_sqr_.at(option->worker_id()).data();
+    T learning_rate = option->learning_rate(), rho = option->rho(), e = this->e;
+    this->ForEachRow(num_rows, row_size, rows, positions,
+      [=](size_t offset, size_t offset_d) {
+      adagrad(row_size, data + offset, g_sqr_data + offset,
+              delta + offset_d, learning_rate, rho, e);
+    });
   }
 
 protected:
@@ -16,12 +16,29 @@ public:
 
   void Update(size_t num_element, T* data, T* delta, 
               AddOption* option, size_t offset) override {
-    for (size_t index = 0; index < num_element; ++index) {
-      smooth_gradient_[index + offset] = 
-        option->momentum() * smooth_gradient_[index + offset] 
-        + (1 - option->momentum()) * delta[index];
-      data[index + offset] -= smooth_gradient_[index + offset];
-    }
+    auto momentum_kernel = this->kernels_->momentum;
+    T* smooth_gradient = smooth_gradient_.data() + offset;
+    T momentum = option->momentum();
+    this->ForEachBlock(num_element, [=](size_t begin, size_t count) {
+      momentum_kernel(count, data + offset + begin, smooth_gradient + begin,
+                      delta + begin, momentum);
+    });
+  }
+
+  // the smoothed gradient keeps moving the data
+  bool ignores_zero_delta() const override { return false; }
+
+  void UpdateRows(size_t num_rows, size_t row_size, const integer_t* rows,
+                  T* data, T* delta, AddOption* option,
+                  const size_t* positions) override {
+    auto momentum_kernel = this->kernels_->momentum;
+    T* smooth_gradient = smooth_gradient_.data();
+    T momentum = option->momentum();
+    this->ForEachRow(num_rows, row_size, rows, positions,
+      [=](size_t offset, size_t offset_d) {
+      momentum_kernel(row_size, data + offset, smooth_gradient + offset,
+                      delta + offset_d, momentum);
+    });
   }
 
   ~MomentumUpdater() { smooth_gradient_.clear(); }
@@ -13,9 +13,20 @@ public:
   }
   void Update(size_t num_element, T* data, T* delta,
               AddOption*, size_t offset) override {
-    for (size_t index = 0; index < num_element; ++index) {
-      data[index + offset] -= delta[index];
-    }
+    auto sub = this->kernels_->sub;
+    this->ForEachBlock(num_element, [=](size_t begin, size_t count) {
+      sub(count, data + offset + begin, delta + begin);
+    });
+  }
+
+  void UpdateRows(size_t num_rows, size_t row_size, const integer_t* rows,
+                  T* data, T* delta, AddOption*,
+                  const size_t* positions) override {
+    auto sub = this->kernels_->sub;
+    this->ForEachRow(num_rows, row_size, rows, positions,
+      [=](size_t offset, size_t offset_d) {
+      sub(row_size, data + offset, delta + offset_d);
+    });
   }
 
   void Access(size_t num_element, T* data, T* blob_data,
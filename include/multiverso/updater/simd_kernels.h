@@ -0,0 +1,40 @@
+/*! \brief Vectorised element kernels of the updaters */
+
+#ifndef MULTIVERSO_UPDATER_SIMD_KERNELS_H_
+#define MULTIVERSO_UPDATER_SIMD_KERNELS_H_
+
+#include <cstddef>
+
+namespace multiverso {
+
+namespace simd {
+
+// Element kernels of the updaters, each on n contiguous elements
+template <typename T>
+struct Kernels {
+  // data += delta
+  void (*add)(size_t n, T* data, const T* delta);
+  // data -= delta
+  void (*sub)(size_t n, T* data, const T* delta);
+  // smooth = momentum * smooth + (1 - momentum) * delta, data -= smooth
+  void (*momentum)(size_t n, T* data, T* smooth, const T* delta,
+                   T momentum);
+  // g = delta / learning_rate, g_sqr += g * g,
+  // data -= rho * g / sqrt(g_sqr + e)
+  void (*adagrad)(size_t n, T* data, T* g_sqr, const T* delta,
+                  T learning_rate, T rho, T e);
+  // instruction set of the kernels, avx512 / avx2 / scalar
+  const char* isa;
+};
+
+// Kernels of the widest instruction set supported by the CPU, or narrower
+// if asked by flag updater_simd. Only float and double are vectorised,
+// other types always get the scalar kernels
+template <typename T>
+const Kernels<T>* GetKernels();
+
+}  // namespace simd
+
+}  // namespace multiverso
+
+#endif  // MULTIVERSO_UPDATER_SIMD_KERNELS_H_
@@ -1,9 +1,15 @@
 #ifndef MULTIVERSO_UPDATER_UPDATER_H_
 #define MULTIVERSO_UPDATER_UPDATER_H_
 
+#include <algorithm>
 #include <cstring>
 #include <sstream>
 #include <multiverso/multiverso.h>
+#include <multiverso/updater/simd_kernels.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 namespace multiverso {
 
@@ -109,10 +115,15 @@ private:
   InternalType data_[kSize];
 };
 
+// Run the updates made by the calling thread on that thread alone, for
+// threads already running in parallel with each other such as the
+// executors of a sharded server, instead of each starting its own team
+void SetSerialUpdates(bool serial);
 
 template <typename T>
 class Updater {
 public:
+  Updater() : kernels_(simd::GetKernels<T>()) {}
   virtual ~Updater() = default;
   // The updater will update the data with delta in following way
   // Add delta[0 : num_element) to data[offset : offset+num_element)
@@ -127,8 +138,95 @@ public:
   //   Get data[offset : offset + num_element) to blob_data[0 : num_element)
   virtual void Access(size_t num_element, T* data, T* blob_data,
                       size_t offset = 0, AddOption* option = nullptr);
+
+  // Batched update of rows of row_size elements, for i in range(0, num_rows):
+  //    Update data[rows[i] * row_size : (rows[i] + 1) * row_size) with
+  //    delta[i * row_size : (i + 1) * row_size), skipped if rows[i] < 0
+  // or, given positions, with delta[positions[i] * row_size : ...)
+  // Work is split across rows, not within a row. Repeated rows are applied
+  // in order by the same thread
+  virtual void UpdateRows(size_t num_rows, size_t row_size,
+                          const integer_t* rows, T* data, T* delta,
+                          AddOption* option = nullptr,
+                          const size_t* positions = nullptr);
+
+  // Whether updating with an all zero delta leaves the data unchanged, so
+  // that such an update can be skipped. False for updaters with state
+  // carrying earlier deltas over
+  virtual bool ignores_zero_delta() const { return true; }
+
   // Factory method to get the updater
   static Updater<T>* GetUpdater(size_t size = 0);
+  // How the updaters of GetUpdater apply a delta: 1 if they add it, -1 if
+  // they subtract it, 0 if the result depends on their state. For the
+  // workers keeping copies of the values the servers update
+  static int DeltaSign();
+
+protected:
+  // Call row_kernel(data offset, delta offset) for each row not skipped,
+  // the delta offset of row i is taken from positions[i] if given.
+  // Thread t of the OpenMP team (flag omp_threads) owns the rows with
+  // rows[i] % num_threads == t, small batches run on the calling thread
+  template <typename RowKernel>
+  static void ForEachRow(size_t num_rows, size_t row_size,
+                         const integer_t* rows, const size_t* positions,
+                         RowKernel row_kernel) {
+    int num_threads = NumThreads(num_rows * row_size);
+    if (num_threads <= 1) {
+      for (size_t i = 0; i < num_rows; ++i) {
+        if (rows[i] >= 0) {
+          row_kernel(rows[i] * row_size,
+                     (positions ? positions[i] : i) * row_size);
+        }
+      }
+      return;
+    }
+#ifdef _OPENMP
+    #pragma omp parallel num_threads(num_threads)
+#endif
+    {
+#ifdef _OPENMP
+      int thread = omp_get_thread_num();
+#else
+      int thread = 0;
+      num_threads = 1;
+#endif
+      for (size_t i = 0; i < num_rows; ++i) {
+        if (rows[i] >= 0 && rows[i] % num_threads == thread) {
+          row_kernel(rows[i] * row_size,
+                     (positions ? positions[i] : i) * row_size);
+        }
+      }
+    }
+  }
+
+  // Call block_kernel(begin, count) on disjoint blocks covering
+  // [0, num_element), one block per thread of the OpenMP team
+  template <typename BlockKernel>
+  static void ForEachBlock(size_t num_element, BlockKernel block_kernel) {
+    int num_threads = NumThreads(num_element);
+    if (num_threads <= 1) {
+      block_kernel(0, num_element);
+      return;
+    }
+    // block bounds on multiples of 16 elements, keep cache lines apart
+    size_t block = (num_element / num_threads + 15) / 16 * 16;
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(static) num_threads(num_threads)
+#endif
+    for (int t = 0; t < num_threads; ++t) {
+      size_t begin = std::min(num_element, t * block);
+      size_t end = std::min(num_element, begin + block);
+      if (t == num_threads - 1) end = num_element;
+      if (begin < end) block_kernel(begin, end - begin);
+    }
+  }
+
+  // threads to use for num_element elements of work
+  static int NumThreads(size_t num_element);
+
+  // vectorised element kernels, selected when the updater is created
+  const simd::Kernels<T>* kernels_;
 };
 
 #define MV_INSTANTIATE_CLASS_WITH_REAL_TYPE(classname) \
@@ -2,6 +2,7 @@
 #define MULTIVERSO_ALLOCATOR_H_
 
 #include <atomic>
+#include <cstddef>
 #include <unordered_map>
 
 namespace std { class mutex; }
@@ -11,16 +12,34 @@ namespace multiverso {
 const size_t g_pointer_size = sizeof(void*);
 
 class MemoryBlock;
+class SizeClassStats;
 class FreeList {
 public:
   FreeList(size_t size);
   ~FreeList();
   char *Pop();
   void Push(MemoryBlock*);
+  // Move up to n free blocks into blocks, under a single lock. A new block
+  // is allocated if the list is empty. Return the number of blocks moved
+  int PopBatch(MemoryBlock** blocks, int n);
+  void PushBatch(MemoryBlock** blocks, int n);
+  // Release all blocks of the list, return the number of bytes released
+  size_t Trim();
+  size_t size() const { return size_; }
+  SizeClassStats* stats() const { return stats_; }
+  // whether the size class pools more than flag allocator_pool_limit_mb,
+  // in the free list and in the caches of the threads
+  bool over_limit() const;
 private:
+  // Keep the block in the list, or release it when over_limit. mutex_
+  // must be held
+  void PushLocked(MemoryBlock* block);
+  MemoryBlock* NewBlock();
+
   MemoryBlock* free_ = nullptr;
   size_t size_;
   std::mutex* mutex_;
+  SizeClassStats* stats_;
 };
 
 class MemoryBlock {
@@ -28,9 +47,13 @@ public:
   MemoryBlock(size_t size, FreeList* list);
   ~MemoryBlock();
   char* data();
-  void Unlink();
+  // Release a reference, return true if it was the last one
+  bool Unlink();
   void Link();
+  FreeList* list() const { return *(FreeList**)data_; }
   MemoryBlock* next;
+  // bytes asked by the user of the block, for rounding waste stats
+  size_t requested_size;
 private:
   char* data_;
   std::atomic<int> ref_;
@@ -43,11 +66,20 @@ public:
   virtual char* Alloc(size_t size);
   virtual void Free(char* data);
   virtual void Refer(char *data);
+  // Release the pooled memory not used by anyone, return the number of
+  // bytes released
+  virtual size_t Trim() { return 0; }
   static Allocator* Get();
 private:
   static const int header_size_ = sizeof(std::atomic<int>*);
 };
 
+// Allocate blocks of 2^k bytes from per size class free lists. Each thread
+// keeps a small cache of free blocks per size class in front of the shared
+// free lists, see flag allocator_thread_cache. The memory pooled per size
+// class, caches included, can be bounded by flag allocator_pool_limit_mb
+// and released with MV_TrimAllocator. Each size class
+// reports its live, peak, pooled and rounding waste bytes to the Dashboard
 class SmartAllocator : public Allocator {
 public:
   SmartAllocator();
@@ -55,8 +87,18 @@ public:
   char* Alloc(size_t size);
   void Free(char* data);
   void Refer(char *data);
+  // Release the blocks pooled by the free lists and by the cache of the
+  // calling thread, return the number of bytes released. The caches of
+  // the other threads release their blocks on their next Alloc or Free
+  size_t Trim() override;
+
+  // size class k holds blocks of 2^k bytes
+  static const int kNumSizeClass = 64;
+  static int SizeClass(size_t size);
 private:
-  std::unordered_map<size_t, FreeList*> pools_;
+  FreeList* GetFreeList(int size_class);
+
+  std::atomic<FreeList*> pools_[kNumSizeClass];
   std::mutex* mutex_;
 };
 
@@ -0,0 +1,77 @@
+/*! \brief Version stamps of the blocks of a server table storage */
+
+#ifndef MULTIVERSO_UTIL_BLOCK_VERSIONS_H_
+#define MULTIVERSO_UTIL_BLOCK_VERSIONS_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace multiverso {
+
+/*!
+ * \brief The storage is cut into blocks of block_size units (rows or
+ *        elements). Each Add takes a new version from a shared clock and
+ *        stamps the blocks it modifies, a Get can then skip the blocks not
+ *        stamped since the version the requester holds.
+ *        Stamps are plain integers: each block must only be stamped and
+ *        read by the thread owning it (shard ranges are aligned to blocks)
+ */
+class BlockVersions {
+public:
+  // versions held by a requester that never got the block
+  enum : int64_t { kNever = -1 };
+
+  BlockVersions();
+  ~BlockVersions();
+
+  void Init(size_t num_units, size_t block_size) {
+    block_size_ = block_size;
+    stamps_.assign(block_size == 0 ? 0 :
+      (num_units + block_size - 1) / block_size, 0);
+  }
+
+  bool enabled() const { return block_size_ > 0; }
+  size_t block_size() const { return block_size_; }
+  size_t num_blocks() const { return stamps_.size(); }
+
+  /*! \brief version of a new modification, thread safe */
+  int64_t Tick();
+  /*! \brief latest version handed out, thread safe */
+  int64_t clock() const;
+
+  size_t block(size_t unit) const { return unit / block_size_; }
+
+  void Stamp(size_t block, int64_t version) { stamps_[block] = version; }
+
+  void StampAll(int64_t version) {
+    for (auto& stamp : stamps_) stamp = version;
+  }
+
+  /*! \brief whether the block changed after version */
+  bool ChangedSince(size_t block, int64_t version) const {
+    return stamps_[block] > version;
+  }
+
+  /*! \brief round a unit offset up to the next block boundary */
+  size_t AlignUp(size_t unit) const {
+    if (block_size_ == 0) return unit;
+    return (unit + block_size_ - 1) / block_size_ * block_size_;
+  }
+
+private:
+  // atomic counter, defined in the .cpp to keep <atomic> out of the table
+  // headers (not available to the C++/CLI binding)
+  struct Clock;
+
+  BlockVersions(const BlockVersions&) = delete;
+  void operator=(const BlockVersions&) = delete;
+
+  size_t block_size_;
+  Clock* clock_;
+  std::vector<int64_t> stamps_;
+};
+
+}  // namespace multiverso
+
+#endif  // MULTIVERSO_UTIL_BLOCK_VERSIONS_H_
@@ -0,0 +1,300 @@
+/*! \brief Open addressing hash map of the key-value tables */
+
+#ifndef MULTIVERSO_UTIL_FLAT_HASH_MAP_H_
+#define MULTIVERSO_UTIL_FLAT_HASH_MAP_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+// the control bytes of a group are matched with one SSE2 compare, not
+// available to the C++/CLI binding, which takes the portable loop
+#if (defined(__SSE2__) || defined(_M_X64) || \
+     (defined(_M_IX86_FP) && _M_IX86_FP >= 2)) && !defined(_M_CEE)
+#define MULTIVERSO_FLAT_HASH_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace multiverso {
+
+/*!
+ * \brief Hash map of plain keys and values stored in one flat array of
+ *        slots, with one control byte per slot: empty, deleted, or 7 bits
+ *        of the hash of the key. A lookup probes groups of 16 slots,
+ *        matching the 16 control bytes at once and only comparing the keys
+ *        of the slots whose 7 bits match. At most 7/8 of the slots are used.
+ *        Inserting may move the entries, references and iterators are only
+ *        valid until the next insertion
+ */
+template <typename Key, typename Val, typename Hash = std::hash<Key> >
+class FlatHashMap {
+public:
+  typedef Key key_type;
+  typedef Val mapped_type;
+  typedef std::pair<Key, Val> value_type;
+
+  // Value is value_type or const value_type
+  template <typename Map, typename Value>
+  class Iterator {
+  public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef std::pair<Key, Val> value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef Value* pointer;
+    typedef Value& reference;
+
+    Iterator(Map* map, size_t index) : map_(map), index_(index) { Skip(); }
+    Value& operator*() const { return map_->slots_[index_]; }
+    Value* operator->() const { return &map_->slots_[index_]; }
+    Iterator& operator++() {
+      ++index_;
+      Skip();
+      return *this;
+    }
+    bool operator==(const Iterator& other) const {
+      return index_ == other.index_;
+    }
+    bool operator!=(const Iterator& other) const {
+      return index_ != other.index_;
+    }
+    size_t index() const { return index_; }
+
+  private:
+    void Skip() {
+      while (index_ < map_->capacity_ && map_->ctrl_[index_] < 0) ++index_;
+    }
+    Map* map_;
+    size_t index_;
+  };
+  typedef Iterator<FlatHashMap, value_type> iterator;
+  typedef Iterator<const FlatHashMap, const value_type> const_iterator;
+
+  FlatHashMap() : capacity_(0), group_mask_(0), size_(0), growth_left_(0) {}
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  size_t capacity() const { return capacity_; }
+  /*! \brief bytes of the slots and control bytes */
+  size_t bytes() const { return capacity_ * (sizeof(value_type) + 1); }
+
+  iterator begin() { return iterator(this, 0); }
+  iterator end() { return iterator(this, capacity_); }
+  const_iterator begin() const { return const_iterator(this, 0); }
+  const_iterator end() const { return const_iterator(this, capacity_); }
+
+  iterator find(const Key& key) {
+    size_t index = FindIndex(key, HashOf(key));
+    return iterator(this, index == kNone ? capacity_ : index);
+  }
+  const_iterator find(const Key& key) const {
+    size_t index = FindIndex(key, HashOf(key));
+    return const_iterator(this, index == kNone ? capacity_ : index);
+  }
+  size_t count(const Key& key) const {
+    return FindIndex(key, HashOf(key)) == kNone ? 0 : 1;
+  }
+
+  /*! \brief the value of key, inserted value-initialized if missing */
+  Val& operator[](const Key& key) {
+    return slots_[FindOrInsert(key).first].second;
+  }
+
+  std::pair<iterator, bool> insert(const value_type& value) {
+    std::pair<size_t, bool> slot = FindOrInsert(value.first);
+    if (slot.second) slots_[slot.first].second = value.second;
+    return std::make_pair(iterator(this, slot.first), slot.second);
+  }
+
+  size_t erase(const Key& key) {
+    size_t index = FindIndex(key, HashOf(key));
+    if (index == kNone) return 0;
+    // a group with an empty slot was never full, so no probe went past
+    // it and the slot may become empty again
+    if (MatchEmpty(&ctrl_[index & ~(kGroup - 1)]) != 0) {
+      ctrl_[index] = kEmpty;
+      ++growth_left_;
+    } else {
+      ctrl_[index] = kDeleted;
+    }
+    slots_[index] = value_type();
+    --size_;
+    return 1;
+  }
+
+  void clear() {
+    ctrl_.assign(capacity_, kEmpty);
+    slots_.assign(capacity_, value_type());
+    size_ = 0;
+    growth_left_ = MaxSize(capacity_);
+  }
+
+  /*! \brief room for num_entries entries without rehashing */
+  void reserve(size_t num_entries) {
+    size_t capacity = CapacityFor(num_entries);
+    if (capacity > capacity_) Resize(capacity);
+  }
+
+  /*! \brief bytes of a map reserved for num_entries entries */
+  static size_t bytes_for(size_t num_entries) {
+    return CapacityFor(num_entries) * (sizeof(value_type) + 1);
+  }
+
+  /*! \brief fetch the first slots probed for key into the cache, ahead
+   *         of the lookup */
+  void Prefetch(const Key& key) const {
+    if (capacity_ == 0) return;
+    size_t first = ((HashOf(key) >> 7) & group_mask_) * kGroup;
+    PrefetchAddress(&ctrl_[first]);
+    PrefetchAddress(&slots_[first]);
+  }
+
+private:
+  enum : int8_t { kEmpty = -128, kDeleted = -2 };
+  enum : size_t { kGroup = 16, kNone = ~static_cast<size_t>(0) };
+
+  static size_t MaxSize(size_t capacity) { return capacity - capacity / 8; }
+  static size_t CapacityFor(size_t num_entries) {
+    size_t capacity = kGroup;
+    while (MaxSize(capacity) < num_entries) capacity *= 2;
+    return capacity;
+  }
+
+  uint64_t HashOf(const Key& key) const {
+    // std::hash of the integers is the identity, spread the bits
+    uint64_t hash = static_cast<uint64_t>(hasher_(key));
+    hash ^= hash >> 33;
+    hash *= 0xFF51AFD7ED558CCDULL;
+    hash ^= hash >> 33;
+    return hash;
+  }
+  static int8_t H2(uint64_t hash) { return static_cast<int8_t>(hash & 0x7F); }
+
+  // bit i set for control byte i of the group equal to byte
+  static uint32_t Match(const int8_t* group, int8_t byte) {
+#ifdef MULTIVERSO_FLAT_HASH_SSE2
+    __m128i ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i*>(group));
+    return static_cast<uint32_t>(
+      _mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(byte))));
+#else
+    uint32_t mask = 0;
+    for (size_t i = 0; i < kGroup; ++i) {
+      mask |= static_cast<uint32_t>(group[i] == byte) << i;
+    }
+    return mask;
+#endif
+  }
+  static uint32_t MatchEmpty(const int8_t* group) {
+    return Match(group, kEmpty);
+  }
+  // empty or deleted, the control bytes with the sign bit set
+  static uint32_t MatchFree(const int8_t* group) {
+#ifdef MULTIVERSO_FLAT_HASH_SSE2
+    return static_cast<uint32_t>(_mm_movemask_epi8(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(group))));
+#else
+    uint32_t mask = 0;
+    for (size_t i = 0; i < kGroup; ++i) {
+      mask |= static_cast<uint32_t>(group[i] < 0) << i;
+    }
+    return mask;
+#endif
+  }
+  static size_t LowestBit(uint32_t mask) {
+#if defined(__GNUC__)
+    return static_cast<size_t>(__builtin_ctz(mask));
+#else
+    size_t bit = 0;
+    while ((mask & 1) == 0) {
+      mask >>= 1;
+      ++bit;
+    }
+    return bit;
+#endif
+  }
+  static void PrefetchAddress(const void* address) {
+#if defined(__GNUC__)
+    __builtin_prefetch(address);
+#elif defined(MULTIVERSO_FLAT_HASH_SSE2)
+    _mm_prefetch(reinterpret_cast<const char*>(address), _MM_HINT_T0);
+#else
+    (void)address;
+#endif
+  }
+
+  // groups in triangular order from the home group of hash, which visits
+  // every group of a power of two count
+  size_t FindIndex(const Key& key, uint64_t hash) const {
+    if (capacity_ == 0) return kNone;
+    int8_t h2 = H2(hash);
+    size_t group = (hash >> 7) & group_mask_;
+    for (size_t step = 1; ; ++step) {
+      const int8_t* ctrl = &ctrl_[group * kGroup];
+      for (uint32_t mask = Match(ctrl, h2); mask != 0; mask &= mask - 1) {
+        size_t index = group * kGroup + LowestBit(mask);
+        if (slots_[index].first == key) return index;
+      }
+      if (MatchEmpty(ctrl) != 0) return kNone;
+      group = (group + step) & group_mask_;
+    }
+  }
+
+  size_t FindFree(uint64_t hash) const {
+    size_t group = (hash >> 7) & group_mask_;
+    for (size_t step = 1; ; ++step) {
+      uint32_t mask = MatchFree(&ctrl_[group * kGroup]);
+      if (mask != 0) return group * kGroup + LowestBit(mask);
+      group = (group + step) & group_mask_;
+    }
+  }
+
+  // slot of key and whether it was inserted
+  std::pair<size_t, bool> FindOrInsert(const Key& key) {
+    uint64_t hash = HashOf(key);
+    size_t index = FindIndex(key, hash);
+    if (index != kNone) return std::make_pair(index, false);
+    if (capacity_ == 0) Resize(kGroup);
+    index = FindFree(hash);
+    if (ctrl_[index] == kEmpty && growth_left_ == 0) {
+      // grow, or only drop the deleted slots if most of the used are
+      Resize(size_ * 16 > capacity_ * 7 ? capacity_ * 2 : capacity_);
+      index = FindFree(hash);
+    }
+    if (ctrl_[index] == kEmpty) --growth_left_;
+    ctrl_[index] = H2(hash);
+    slots_[index] = value_type(key, Val());
+    ++size_;
+    return std::make_pair(index, true);
+  }
+
+  void Resize(size_t capacity) {
+    std::vector<int8_t> ctrl(capacity, kEmpty);
+    std::vector<value_type> slots(capacity);
+    ctrl.swap(ctrl_);
+    slots.swap(slots_);
+    capacity_ = capacity;
+    group_mask_ = capacity / kGroup - 1;
+    growth_left_ = MaxSize(capacity) - size_;
+    for (size_t i = 0; i < ctrl.size(); ++i) {
+      if (ctrl[i] < 0) continue;
+      uint64_t hash = HashOf(slots[i].first);
+      size_t index = FindFree(hash);
+      ctrl_[index] = H2(hash);
+      slots_[index] = slots[i];
+    }
+  }
+
+  Hash hasher_;
+  std::vector<int8_t> ctrl_;
+  std::vector<value_type> slots_;
+  size_t capacity_;
+  size_t group_mask_;
+  size_t size_;
+  size_t growth_left_;                       // empty slots left to fill
+};
+
+}  // namespace multiverso
+
+#endif  // MULTIVERSO_UTIL_FLAT_HASH_MAP_H_
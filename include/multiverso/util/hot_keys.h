@@ -0,0 +1,66 @@
+/*! \brief Keys of a table replicated on several servers */
+
+#ifndef MULTIVERSO_UTIL_HOT_KEYS_H_
+#define MULTIVERSO_UTIL_HOT_KEYS_H_
+
+#include <cstdint>
+#include <unordered_set>
+#include <vector>
+
+namespace multiverso {
+
+/*!
+ * \brief The hot keys of a table and the servers holding their replicas.
+ *        Replica j of a key owned by server o is on server (o + j) %
+ *        num_servers, replica 0 being the owner. A worker sends all its
+ *        requests on a hot key to the same replica, so that it reads its
+ *        own Adds, and the workers are spread over the replicas
+ */
+class HotKeys {
+public:
+  HotKeys() : num_replicas_(1), num_servers_(1) {}
+
+  /*!
+   * \brief replicate on num_replicas servers (the owner included), at most
+   *        all of them. Return false without replicas in sync mode, where
+   *        each server needs the requests of every worker
+   */
+  bool Init(int num_replicas, int num_servers);
+
+  /*! \brief whether keys are replicated at all */
+  bool enabled() const { return num_replicas_ > 1; }
+  int num_replicas() const { return num_replicas_; }
+
+  template <typename Key>
+  void Set(const std::vector<Key>& keys) {
+    keys_.clear();
+    for (auto key : keys) keys_.insert(static_cast<int64_t>(key));
+  }
+  const std::unordered_set<int64_t>& keys() const { return keys_; }
+
+  bool hot(int64_t key) const {
+    return enabled() && keys_.count(key) != 0;
+  }
+
+  /*! \brief server the worker sends its requests on key of owner to */
+  int Server(int64_t key, int owner, int worker) const {
+    if (!hot(key)) return owner;
+    return (owner + worker % num_replicas_) % num_servers_;
+  }
+
+  /*! \brief whether server keeps a replica of the keys of owner, the owner
+   *         itself excluded */
+  bool Replicates(int server, int owner) const {
+    int j = (server - owner + num_servers_) % num_servers_;
+    return j > 0 && j < num_replicas_;
+  }
+
+private:
+  int num_replicas_;
+  int num_servers_;
+  std::unordered_set<int64_t> keys_;
+};
+
+}  // namespace multiverso
+
+#endif  // MULTIVERSO_UTIL_HOT_KEYS_H_
@@ -0,0 +1,152 @@
+/*! \brief Defines a lock free multi-producer single-consumer queue */
+
+#ifndef MULTIVERSO_MPSC_QUEUE_H_
+#define MULTIVERSO_MPSC_QUEUE_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#include <xmmintrin.h>
+#define MV_CPU_RELAX() _mm_pause()
+#else
+#define MV_CPU_RELAX() std::this_thread::yield()
+#endif
+
+#include "multiverso/util/mt_queue.h"
+
+namespace multiverso {
+
+/*!
+ * \brief A queue for many producer threads and a single consumer thread.
+ *        Push is lock free (one atomic exchange). Pop spins, then yields,
+ *        then parks the consumer on a condition variable. The spin budget
+ *        adapts: it grows when spinning finds an element and shrinks when
+ *        the consumer has to park anyway.
+ *        Pop and TryPop must only be called by the consumer thread.
+ */
+template<typename T>
+class MpscQueue : public Queue<T> {
+public:
+  MpscQueue() : size_(0), exit_(false), sleeping_(false),
+                spin_limit_(kMinSpin) {
+    tail_ = new Node();
+    head_.store(tail_);
+  }
+
+  ~MpscQueue() {
+    while (tail_ != nullptr) {
+      Node* next = tail_->next.load();
+      delete tail_;
+      tail_ = next;
+    }
+  }
+
+  /*!
+   * \brief Push an element into the queue, based on move semantics
+   * \param item item to be pushed
+   */
+  void Push(T& item) override {
+    Node* node = new Node(item);
+    // count first, so that size_ never goes below the number of linked nodes
+    ++size_;
+    Node* prev = head_.exchange(node, std::memory_order_acq_rel);
+    prev->next.store(node, std::memory_order_release);
+    if (sleeping_.load()) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      empty_condition_.notify_one();
+    }
+  }
+
+  /*!
+   * \brief Pop an element from the queue, block if the queue is empty
+   * \return true when pop successfully; false when the queue is exited
+   */
+  bool Pop(T& result) override {
+    // spin
+    for (int i = 0; i < spin_limit_; ++i) {
+      if (TryPop(result)) {
+        if (spin_limit_ < kMaxSpin) spin_limit_ *= 2;
+        return true;
+      }
+      MV_CPU_RELAX();
+    }
+    // yield
+    for (int i = 0; i < kYield; ++i) {
+      if (TryPop(result)) return true;
+      std::this_thread::yield();
+    }
+    if (spin_limit_ > kMinSpin) spin_limit_ /= 2;
+    // park
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      sleeping_.store(true);
+      while (size_.load() == 0 && !exit_.load()) {
+        empty_condition_.wait(lock);
+      }
+      sleeping_.store(false);
+      if (size_.load() == 0) return false;
+    }
+    // an element is counted, it may still be being linked by a producer
+    while (!TryPop(result)) MV_CPU_RELAX();
+    return true;
+  }
+
+  /*! \brief Non-blocking pop. Return false if queue is empty */
+  bool TryPop(T& result) override {
+    Node* next = tail_->next.load(std::memory_order_acquire);
+    if (next == nullptr) return false;
+    result = std::move(next->value);
+    delete tail_;
+    tail_ = next;
+    --size_;
+    return true;
+  }
+
+  int Size() const override { return size_.load(); }
+
+  bool Empty() const override { return size_.load() == 0; }
+
+  /*! \brief Exit queue, awake the consumer if it is parked */
+  void Exit() override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    exit_.store(true);
+    empty_condition_.notify_all();
+  }
+
+  bool Alive() override { return !exit_.load(); }
+
+private:
+  struct Node {
+    Node() : next(nullptr) {}
+    explicit Node(T& item) : next(nullptr), value(std::move(item)) {}
+    std::atomic<Node*> next;
+    T value;
+  };
+
+  static const int kMinSpin = 16;
+  static const int kMaxSpin = 4096;
+  static const int kYield = 16;
+
+  /*! producers append after head_ */
+  std::atomic<Node*> head_;
+  /*! the consumer reads tail_->next, tail_ is a consumed (or dummy) node */
+  Node* tail_;
+  std::atomic<int> size_;
+  std::atomic<bool> exit_;
+  /*! whether the consumer is parked, or going to be */
+  std::atomic<bool> sleeping_;
+  int spin_limit_;
+  std::mutex mutex_;
+  std::condition_variable empty_condition_;
+
+  // No copying allowed
+  MpscQueue(const MpscQueue&);
+  void operator=(const MpscQueue&);
+};
+
+}  // namespace multiverso
+
+#endif  // MULTIVERSO_MPSC_QUEUE_H_
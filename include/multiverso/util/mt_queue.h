@@ -11,12 +11,28 @@
 #include "multiverso/zoo.h"
 
 namespace multiverso {
+/*!
+ * \brief Interface of the thread safe queues used as actor mailboxes
+ */
+template<typename T>
+class Queue {
+public:
+  virtual ~Queue() = default;
+  virtual void Push(T& item) = 0;
+  virtual bool Pop(T& result) = 0;
+  virtual bool TryPop(T& result) = 0;
+  virtual int Size() const = 0;
+  virtual bool Empty() const = 0;
+  virtual void Exit() = 0;
+  virtual bool Alive() = 0;
+};
+
 /*!
  * \brief A thread safe queue support multithread push and pop concurrently
  *        The queue is based on move semantics.
  */
 template<typename T>
-class MtQueue {
+class MtQueue : public Queue<T> {
 public:
   /*! \brief Constructor */
   MtQueue() { exit_.store(false); }
@@ -27,7 +43,7 @@ public:
    *        uninitialized variable.
    * \param item item to be pushed
    */
-  void Push(T& item);
+  void Push(T& item) override;
 
   /*!
    * \brief Pop an element from the queue, if the queue is empty, thread
@@ -35,10 +51,10 @@ public:
    * \param result the returned result
    * \return true when pop successfully; false when the queue is exited
    */
-  bool Pop(T& result);
+  bool Pop(T& result) override;
 
   /*! \brief thread will not be blocked. Return false if queue is empty */
-  bool TryPop(T& result);
+  bool TryPop(T& result) override;
 
   /*!
    * \brief Get the front element from the queue, if the queue is empty,
@@ -52,18 +68,18 @@ public:
    * \brief Gets the number of elements in the queue
    * \return size of queue
    */
-  int Size() const;
+  int Size() const override;
 
   /*!
    * \brief Whether queue is empty or not
    * \return true if queue is empty; false otherwise
    */
-  bool Empty() const;
+  bool Empty() const override;
 
   /*! \brief Exit queue, awake all threads blocked by the queue */
-  void Exit();
+  void Exit() override;
 
-  bool Alive();
+  bool Alive() override;
 
 private:
   /*! the underlying container of queue */
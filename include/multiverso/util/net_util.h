@@ -9,6 +9,8 @@ namespace net {
 
 void GetLocalIPAddress(std::unordered_set<std::string>* result);
 
+std::string GetHostName();
+
 }  // namespace net
 }  // namespace multiverso
 
@@ -0,0 +1,84 @@
+/*! \brief Assignment of the keys of a table to the servers */
+
+#ifndef MULTIVERSO_UTIL_PARTITION_MAP_H_
+#define MULTIVERSO_UTIL_PARTITION_MAP_H_
+
+#include <cstdint>
+#include <vector>
+
+namespace multiverso {
+
+enum class PartitionStrategy : int {
+  // contiguous ranges of (almost) the same size, the first num_keys %
+  // num_servers servers hold one key more
+  kUniformRange = 0,
+  // contiguous ranges sized after one weight per server
+  kWeightedRange = 1,
+  // contiguous ranges holding the same load, weights are the load of each
+  // block of num_keys / weights.size() keys (e.g. access counts of a
+  // previous run), so that hot keys are spread over the servers
+  kLoadAwareRange = 2,
+  // blocks of block_size keys placed on a consistent hash ring, with
+  // virtual nodes in proportion to one weight per server (all the same if
+  // no weights). Any key, no contiguous ranges
+  kHashedBlock = 3
+};
+
+/*! \brief How a table is partitioned, part of the table options */
+struct PartitionOption {
+  PartitionOption() : strategy(PartitionStrategy::kUniformRange),
+    block_size(1) {}
+  PartitionStrategy strategy;
+  std::vector<double> weights;
+  int64_t block_size;
+};
+
+/*!
+ * \brief Maps each key of a table to the server owning it. Worker and
+ *        server sides build the same map from the same option, a range
+ *        map also gives the range [begin, end) of each server
+ */
+class PartitionMap {
+public:
+  /*! \brief uniform range of num_keys keys */
+  PartitionMap(int64_t num_keys, int num_servers);
+  /*! \brief num_keys is unbounded (0) for the hashed strategy only */
+  PartitionMap(const PartitionOption& option, int64_t num_keys,
+               int num_servers);
+
+  int num_servers() const { return num_servers_; }
+  int64_t num_keys() const { return num_keys_; }
+  PartitionStrategy strategy() const { return strategy_; }
+  bool contiguous() const {
+    return strategy_ != PartitionStrategy::kHashedBlock;
+  }
+
+  /*! \brief server owning key */
+  int Server(int64_t key) const;
+
+  // range of server, contiguous maps only
+  int64_t begin(int server) const { return offsets_[server]; }
+  int64_t end(int server) const { return offsets_[server + 1]; }
+  int64_t size(int server) const { return end(server) - begin(server); }
+  /*! \brief num_servers + 1 range boundaries, contiguous maps only */
+  const std::vector<int64_t>& offsets() const { return offsets_; }
+
+private:
+  void InitUniform();
+  void InitWeighted(const std::vector<double>& weights);
+  void InitLoadAware(const std::vector<double>& load);
+  void InitHashed(const std::vector<double>& weights);
+
+  PartitionStrategy strategy_;
+  int64_t num_keys_;
+  int num_servers_;
+  std::vector<int64_t> offsets_;
+  // hashed block: sorted hashes of the virtual nodes and their servers
+  int64_t block_size_;
+  std::vector<uint64_t> ring_;
+  std::vector<int> ring_server_;
+};
+
+}  // namespace multiverso
+
+#endif  // MULTIVERSO_UTIL_PARTITION_MAP_H_
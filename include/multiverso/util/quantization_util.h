@@ -2,8 +2,11 @@
 #define MULTIVERSO_UTIL_QUANTIZATION_UTIL_H_
 
 #include <multiverso/blob.h>
-#include <vector>
+#include <algorithm>
 #include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
 #include <multiverso/util/log.h>
 
 namespace multiverso {
@@ -157,7 +160,130 @@ namespace multiverso {
     bool skip_option_blob_;
   };
 
-  class OneBitsFilter : public QuantizationFilter{
+  // 1-bit quantization of Adds (1-bit SGD): each element is sent as its
+  // sign, the elements of each row of num_cols elements with one scale, the
+  // mean magnitude of the row. The quantization error stays in a residual
+  // on the worker and is added to the next Add of the same elements, so it
+  // is delayed rather than lost.
+  // - FilterIn takes [row ids, values] and gives [row ids, count, scales and
+  //   signs], count being the number of values as an int64_t
+  // - the option blob is kept last, like SparseFilter
+  // - the values are the rows of the ids, or consecutive elements for the
+  //   id -1 (whole table), which start at first_element of the table
+  template<typename data_type, typename index_type>
+  class OneBitsFilter : public QuantizationFilter {
+  public:
+    // residual holds one element per table element, zero before the first
+    // Add. FilterOut does not use it
+    OneBitsFilter(size_t num_cols, std::vector<data_type>* residual,
+      bool skip_last_line = false) : num_cols_(num_cols),
+      residual_(residual), skip_option_blob_(skip_last_line) {
+      CHECK(num_cols_ > 0);
+    }
+
+    ~OneBitsFilter() {}
+
+    void FilterIn(const std::vector<Blob>& blobs,
+      std::vector<Blob>* outputs) override {
+      FilterIn(blobs, 0, outputs);
+    }
+
+    void FilterIn(const std::vector<Blob>& blobs, size_t first_element,
+      std::vector<Blob>* outputs) {
+      CHECK_NOTNULL(outputs);
+      CHECK_NOTNULL(residual_);
+      size_t data_blobs_size = skip_option_blob_ ? blobs.size() - 1 : blobs.size();
+      CHECK(data_blobs_size == 2);
+      outputs->clear();
+      outputs->push_back(blobs[0]);
+      Blob count_blob(sizeof(int64_t));
+      count_blob.As<int64_t>() = static_cast<int64_t>(blobs[1].size<data_type>());
+      outputs->push_back(count_blob);
+      outputs->push_back(Compress(blobs[0], blobs[1], first_element));
+      if (skip_option_blob_) {
+        outputs->push_back(blobs[blobs.size() - 1]);
+      }
+    }
+
+    //  Restore the values, each as the scale of its row with its sign
+    void FilterOut(const std::vector<Blob>& blobs,
+      std::vector<Blob>* outputs) override {
+      CHECK_NOTNULL(outputs);
+      CHECK(blobs.size() == (skip_option_blob_ ? 4 : 3));
+      outputs->clear();
+      outputs->push_back(blobs[0]);
+      outputs->push_back(DeCompress(blobs[2],
+        static_cast<size_t>(blobs[1].As<int64_t>())));
+      if (skip_option_blob_) {
+        outputs->push_back(blobs[blobs.size() - 1]);
+      }
+    }
+
+    // bytes of count values once compressed
+    static size_t CompressedSize(size_t count, size_t num_cols) {
+      return (count + num_cols - 1) / num_cols * sizeof(data_type) +
+        (count + 31) / 32 * sizeof(uint32_t);
+    }
+
+  protected:
+    // the scale of each row then the sign bits, 32 per word
+    Blob Compress(const Blob& keys, const Blob& values, size_t first_element) {
+      size_t count = values.size<data_type>();
+      size_t num_rows = (count + num_cols_ - 1) / num_cols_;
+      bool whole_table = keys.size<index_type>() == 1 &&
+        keys.As<index_type>() == -1;
+      if (!whole_table) CHECK(keys.size<index_type>() == num_rows);
+      Blob result(CompressedSize(count, num_cols_));
+      data_type* scales = reinterpret_cast<data_type*>(result.data());
+      uint32_t* signs = reinterpret_cast<uint32_t*>(result.data() +
+        num_rows * sizeof(data_type));
+      memset(signs, 0, (count + 31) / 32 * sizeof(uint32_t));
+      const data_type* in = reinterpret_cast<const data_type*>(values.data());
+      for (size_t r = 0; r < num_rows; ++r) {
+        size_t begin = r * num_cols_;
+        size_t end = std::min(begin + num_cols_, count);
+        size_t offset = whole_table ? first_element + begin :
+          static_cast<size_t>(keys.As<index_type>(r)) * num_cols_;
+        CHECK(offset + end - begin <= residual_->size());
+        data_type* error = residual_->data() + offset;
+        double sum = 0;
+        for (size_t i = begin; i < end; ++i) {
+          error[i - begin] += in[i];
+          sum += std::abs(error[i - begin]);
+        }
+        data_type scale = static_cast<data_type>(sum / (end - begin));
+        scales[r] = scale;
+        for (size_t i = begin; i < end; ++i) {
+          uint32_t negative = error[i - begin] < 0;
+          signs[i >> 5] |= negative << (i & 31);
+          error[i - begin] -= negative ? -scale : scale;
+        }
+      }
+      return result;
+    }
+
+    Blob DeCompress(const Blob& in_blob, size_t count) {
+      CHECK(in_blob.size() == CompressedSize(count, num_cols_));
+      size_t num_rows = (count + num_cols_ - 1) / num_cols_;
+      const data_type* scales = reinterpret_cast<const data_type*>(in_blob.data());
+      const uint32_t* signs = reinterpret_cast<const uint32_t*>(
+        in_blob.data() + num_rows * sizeof(data_type));
+      Blob result(count * sizeof(data_type));
+      data_type* out = reinterpret_cast<data_type*>(result.data());
+      for (size_t r = 0; r < num_rows; ++r) {
+        const data_type values[2] = { scales[r], -scales[r] };
+        size_t end = std::min((r + 1) * num_cols_, count);
+        for (size_t i = r * num_cols_; i < end; ++i) {
+          out[i] = values[(signs[i >> 5] >> (i & 31)) & 1];
+        }
+      }
+      return result;
+    }
+
+  private:
+    size_t num_cols_;
+    std::vector<data_type>* residual_;
+    bool skip_option_blob_;
   };
 }  // namespace multiverso
 
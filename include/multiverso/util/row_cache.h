@@ -0,0 +1,157 @@
+/*! \brief Worker side cache of table rows with bounded staleness */
+
+#ifndef MULTIVERSO_UTIL_ROW_CACHE_H_
+#define MULTIVERSO_UTIL_ROW_CACHE_H_
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "multiverso/table_interface.h"
+#include "multiverso/util/flat_hash_map.h"
+#include "multiverso/util/log.h"
+
+namespace multiverso {
+
+/*!
+ * \brief Holds up to capacity rows of num_col elements, each with the clock
+ *        of the worker it was fetched at. A row is fresh while the worker
+ *        is at most staleness clocks ahead (stale synchronous parallel).
+ *        Rows are evicted with the CLOCK algorithm, which approximates LRU
+ *        with one reference bit per row. The rows are indexed by a hash
+ *        map sized to the capacity, not to the table. Not thread safe
+ */
+template <typename T>
+class RowCache {
+public:
+  RowCache(integer_t num_row, integer_t num_col, size_t capacity,
+           int staleness) : num_col_(num_col), staleness_(staleness),
+    hand_(0), hits_(0), misses_(0) {
+    CHECK(capacity > 0 && staleness >= 0);
+    capacity = std::min(capacity, static_cast<size_t>(num_row));
+    slots_.resize(capacity);
+    values_.resize(capacity * num_col);
+    slot_of_.reserve(capacity);
+  }
+
+  /*! \brief the capacity of a cache of rows of num_col elements whose
+   *         memory_size is at most bytes */
+  static size_t RowsIn(size_t bytes, integer_t num_col) {
+    size_t row_bytes = num_col * sizeof(T) + sizeof(Slot);
+    size_t low = 0, high = bytes / row_bytes;
+    while (low < high) {
+      size_t rows = high - (high - low) / 2;
+      if (rows * row_bytes + Index::bytes_for(rows) <= bytes) {
+        low = rows;
+      } else {
+        high = rows - 1;
+      }
+    }
+    return low;
+  }
+
+  /*! \brief the cached row, nullptr if not cached or not fresh at clock */
+  const T* Find(integer_t row, int clock) {
+    int slot = SlotOf(row);
+    if (slot < 0 || clock - slots_[slot].clock > staleness_) {
+      ++misses_;
+      return nullptr;
+    }
+    ++hits_;
+    slots_[slot].referenced = true;
+    return values(slot);
+  }
+
+  /*! \brief the cached row whatever its age, nullptr if not cached */
+  T* Peek(integer_t row) {
+    int slot = SlotOf(row);
+    return slot < 0 ? nullptr : values(slot);
+  }
+
+  /*! \brief cache values as row fetched at clock, may evict another row */
+  void Put(integer_t row, int clock, const T* data) {
+    int slot = SlotOf(row);
+    if (slot < 0) {
+      slot = Evict();
+      slot_of_[row] = slot;
+      slots_[slot].row = row;
+    }
+    slots_[slot].clock = clock;
+    slots_[slot].referenced = true;
+    memcpy(values(slot), data, num_col_ * sizeof(T));
+  }
+
+  void Erase(integer_t row) {
+    int slot = SlotOf(row);
+    if (slot < 0) return;
+    slots_[slot].row = -1;
+    slot_of_.erase(row);
+  }
+
+  /*! \brief call fn(row, values) for every cached row */
+  template <typename Fn>
+  void ForEach(Fn fn) {
+    for (size_t slot = 0; slot < slots_.size(); ++slot) {
+      if (slots_[slot].row >= 0) fn(slots_[slot].row, values(slot));
+    }
+  }
+
+  size_t capacity() const { return slots_.size(); }
+  size_t hits() const { return hits_; }
+  size_t misses() const { return misses_; }
+  /*! \brief bytes of cached values and bookkeeping */
+  size_t memory_size() const {
+    return values_.size() * sizeof(T) + slots_.size() * sizeof(Slot) +
+      slot_of_.bytes();
+  }
+
+private:
+  typedef FlatHashMap<integer_t, int> Index;
+
+  struct Slot {
+    Slot() : row(-1), clock(0), referenced(false) {}
+    integer_t row;      // -1 for a free slot
+    int clock;
+    bool referenced;
+  };
+
+  int SlotOf(integer_t row) const {
+    auto it = slot_of_.find(row);
+    return it == slot_of_.end() ? -1 : it->second;
+  }
+
+  T* values(int slot) {
+    return values_.data() + static_cast<size_t>(slot) * num_col_;
+  }
+
+  // a free slot, or the first unreferenced one after the hand, clearing
+  // the reference bits on the way
+  int Evict() {
+    while (true) {
+      int slot = static_cast<int>(hand_);
+      hand_ = (hand_ + 1) % slots_.size();
+      Slot& s = slots_[slot];
+      if (s.row < 0) return slot;
+      if (s.referenced) {
+        s.referenced = false;
+        continue;
+      }
+      slot_of_.erase(s.row);
+      s.row = -1;
+      return slot;
+    }
+  }
+
+  integer_t num_col_;
+  int staleness_;
+  Index slot_of_;             // slot of each cached row
+  std::vector<Slot> slots_;
+  std::vector<T> values_;
+  size_t hand_;
+  size_t hits_;
+  size_t misses_;
+};
+
+}  // namespace multiverso
+
+#endif  // MULTIVERSO_UTIL_ROW_CACHE_H_
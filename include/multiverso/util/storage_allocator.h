@@ -0,0 +1,93 @@
+/*! \brief Allocator for the large parameter storage of server tables */
+
+#ifndef MULTIVERSO_UTIL_STORAGE_ALLOCATOR_H_
+#define MULTIVERSO_UTIL_STORAGE_ALLOCATOR_H_
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace multiverso {
+
+namespace storage {
+
+enum Mode {
+  // operator new, memory is value initialized as usual
+  kHeap = 0,
+  // anonymous mmap with the page size and NUMA policy given by the flags
+  // storage_huge_page and storage_numa. Pages are zero filled by the kernel
+  // and only backed when first touched
+  kMapped = 1
+};
+
+// Mode selected by the flags at the time of the call
+Mode CurrentMode();
+
+void* Alloc(size_t bytes, Mode mode);
+
+void Free(void* p, size_t bytes, Mode mode);
+
+}  // namespace storage
+
+/*!
+ * \brief std allocator for the storage_ of server tables. The backing is
+ *        chosen when the allocator is created. With kMapped backing,
+ *        arithmetic elements are not value initialized on resize: the
+ *        kernel hands out zero pages, so each page is first touched (and
+ *        placed on a NUMA node) by the server thread that first updates it
+ */
+template <typename T>
+class StorageAllocator {
+public:
+  typedef T value_type;
+  typedef std::true_type propagate_on_container_copy_assignment;
+  typedef std::true_type propagate_on_container_move_assignment;
+  typedef std::true_type propagate_on_container_swap;
+
+  template <typename U>
+  struct rebind { typedef StorageAllocator<U> other; };
+
+  StorageAllocator() : mode_(storage::CurrentMode()) {}
+
+  template <typename U>
+  StorageAllocator(const StorageAllocator<U>& other) : mode_(other.mode()) {}
+
+  T* allocate(size_t n) {
+    return static_cast<T*>(storage::Alloc(n * sizeof(T), mode_));
+  }
+
+  void deallocate(T* p, size_t n) {
+    storage::Free(p, n * sizeof(T), mode_);
+  }
+
+  template <typename U>
+  void construct(U* p) {
+    if (std::is_arithmetic<U>::value && mode_ == storage::kMapped) return;
+    ::new(static_cast<void*>(p)) U();
+  }
+
+  template <typename U, typename... Args>
+  void construct(U* p, Args&&... args) {
+    ::new(static_cast<void*>(p)) U(std::forward<Args>(args)...);
+  }
+
+  storage::Mode mode() const { return mode_; }
+
+private:
+  storage::Mode mode_;
+};
+
+template <typename T, typename U>
+bool operator==(const StorageAllocator<T>& a, const StorageAllocator<U>& b) {
+  return a.mode() == b.mode();
+}
+
+template <typename T, typename U>
+bool operator!=(const StorageAllocator<T>& a, const StorageAllocator<U>& b) {
+  return !(a == b);
+}
+
+}  // namespace multiverso
+
+#endif  // MULTIVERSO_UTIL_STORAGE_ALLOCATOR_H_
@@ -0,0 +1,52 @@
+/*! \brief Tracks which rows each worker holds an up to date copy of */
+
+#ifndef MULTIVERSO_UTIL_UP_TO_DATE_TRACKER_H_
+#define MULTIVERSO_UTIL_UP_TO_DATE_TRACKER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace multiverso {
+
+/*!
+ * \brief One bit per (row, worker), packed row by row: the bits of a row
+ *        are contiguous, so invalidating a row for all workers is a few
+ *        word operations, whatever the number of workers. Rows start out
+ *        of date for every worker. Not thread safe
+ */
+class UpToDateTracker {
+public:
+  UpToDateTracker(size_t num_rows, int num_workers);
+
+  /*! \brief row changed, keep the state of worker except (-1 for none) */
+  void Invalidate(size_t row, int except = -1);
+
+  /*! \brief all rows changed, keep the state of worker except */
+  void InvalidateAll(int except = -1);
+
+  /*!
+   * \brief the worker is sent the row
+   * \return true if the copy of worker was out of date
+   */
+  bool Refresh(size_t row, int worker);
+
+  size_t num_rows() const { return num_rows_; }
+  int num_workers() const { return num_workers_; }
+  /*! \brief bytes of bookkeeping */
+  size_t memory_size() const { return bits_.size() * sizeof(uint64_t); }
+
+private:
+  static const size_t kWordBits = 64;
+
+  // clear bits [begin, end)
+  void ClearRange(size_t begin, size_t end);
+
+  size_t num_rows_;
+  int num_workers_;
+  std::vector<uint64_t> bits_;
+};
+
+}  // namespace multiverso
+
+#endif  // MULTIVERSO_UTIL_UP_TO_DATE_TRACKER_H_
@@ -24,6 +24,8 @@ public:
   void Reset(int num_wait) {
     std::unique_lock<std::mutex> lock(mutex_);
     num_wait_ = num_wait;
+    // nothing to wait for, e.g. a Get served from the worker cache
+    if (num_wait_ <= 0) cv_.notify_all();
   }
 
 private:
@@ -14,6 +14,9 @@ public:
   Worker();
 
   int RegisterTable(WorkerTable* worker_table);
+  void DeregisterTable(int table_id);
+  // WorkerTable::Flush on every registered table, called by the user thread
+  void FlushTables();
 
 private:
   void ProcessGet(MessagePtr& msg);
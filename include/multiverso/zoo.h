@@ -28,6 +28,12 @@ public:
 
   void Barrier();
 
+  // checkpoint and restore of the server tables of this rank, see
+  // MV_Checkpoint
+  void Checkpoint(const std::string& uri);
+  void WaitCheckpoint();
+  void Restore(const std::string& uri);
+
   void SendTo(const std::string& name, MessagePtr&);
   void Receive(MessagePtr& msg);
 
@@ -59,6 +65,8 @@ public:
 
   int RegisterTable(WorkerTable* worker_table);
   int RegisterTable(ServerTable* server_table);
+  // no-op once the worker is stopped
+  void DeregisterTable(int worker_table_id);
 
   void RegisterActor(const std::string name, Actor* actor);
 
@@ -69,6 +77,9 @@ private:
   void FinishTrain();
   void StartPS();
   void StopPS();
+  // send a Server_Checkpoint or Server_Restore to the local server and
+  // wait until it is processed
+  void SendToServer(MsgType type, const std::string& uri);
 
   std::unordered_map<std::string, Actor*> zoo_;
 
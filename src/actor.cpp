@@ -5,14 +5,23 @@
 #include <thread>
 
 #include "multiverso/message.h"
+#include "multiverso/util/configure.h"
 #include "multiverso/util/log.h"
+#include "multiverso/util/mpsc_queue.h"
 #include "multiverso/util/mt_queue.h"
 #include "multiverso/zoo.h"
 
 namespace multiverso {
 
+MV_DEFINE_string(mailbox_type, "default", "actor mailbox, default (mutex and condition variable) / lockfree");
+
 Actor::Actor(const std::string& name) : name_(name) {
-  mailbox_.reset(new MtQueue<MessagePtr>());
+  if (MV_CONFIG_mailbox_type == "lockfree") {
+    mailbox_.reset(new MpscQueue<MessagePtr>());
+  } else {
+    CHECK(MV_CONFIG_mailbox_type == "default");
+    mailbox_.reset(new MtQueue<MessagePtr>());
+  }
   Zoo::Get()->RegisterActor(name, this);
   is_working_ = false;
 }
@@ -7,39 +7,55 @@ namespace multiverso {
 
 Blob::Blob(size_t size) : size_(size) {
   CHECK(size > 0);
-  data_ = Allocator::Get()->Alloc(size);
+  base_ = data_ = Allocator::Get()->Alloc(size);
 }
 
 // Construct from external memory. Will copy a new piece
 Blob::Blob(const void* data, size_t size) : size_(size) {
-  data_ = Allocator::Get()->Alloc(size);
+  base_ = data_ = Allocator::Get()->Alloc(size);
   memcpy(data_, data, size_);
 }
 
 Blob::Blob(void* data, size_t size) : size_(size) {
-  data_ = Allocator::Get()->Alloc(size);
+  base_ = data_ = Allocator::Get()->Alloc(size);
   memcpy(data_, data, size_);
 }
 
 Blob::Blob(const Blob& rhs) {
-  if (rhs.size() != 0) {
-    Allocator::Get()->Refer(rhs.data_);
+  if (rhs.base_ != nullptr) {
+    Allocator::Get()->Refer(rhs.base_);
   }
+  this->base_ = rhs.base_;
   this->data_ = rhs.data_;
   this->size_ = rhs.size_;
 }
 
+Blob::Blob(const Blob& parent, size_t offset, size_t size) {
+  CHECK(offset + size <= parent.size_);
+  if (parent.base_ != nullptr) {
+    Allocator::Get()->Refer(parent.base_);
+  }
+  this->base_ = parent.base_;
+  this->data_ = parent.data_ + offset;
+  this->size_ = size;
+}
+
 Blob::~Blob() {
-  if (data_ != nullptr) {
-    Allocator::Get()->Free(data_);
+  if (base_ != nullptr) {
+    Allocator::Get()->Free(base_);
   }
 }
 
 // Shallow copy by default. Call \ref CopyFrom for a deep copy
 void Blob::operator=(const Blob& rhs) {
-  if (rhs.size() != 0) {
-    Allocator::Get()->Refer(rhs.data_);
+  // refer first, rhs may share memory with this
+  if (rhs.base_ != nullptr) {
+    Allocator::Get()->Refer(rhs.base_);
+  }
+  if (this->base_ != nullptr) {
+    Allocator::Get()->Free(this->base_);
   }
+  this->base_ = rhs.base_;
   this->data_ = rhs.data_;
   this->size_ = rhs.size_;
 }
@@ -31,6 +31,27 @@ int  MV_ServerId(){
   return multiverso::MV_ServerId();
 }
 
+// Aggregate
+void MV_Aggregate(float* data, int size) {
+  multiverso::MV_Aggregate(data, size);
+}
+
+void MV_AggregateAsync(float* data, int size, AggregateHandler* out) {
+  *out = new multiverso::net::AllreduceHandle(
+    multiverso::MV_AggregateAsync(data, size));
+}
+
+int MV_TestAggregate(AggregateHandler handler) {
+  auto handle = reinterpret_cast<multiverso::net::AllreduceHandle*>(handler);
+  return handle->Test() ? 1 : 0;
+}
+
+void MV_WaitAggregate(AggregateHandler handler) {
+  auto handle = reinterpret_cast<multiverso::net::AllreduceHandle*>(handler);
+  handle->Wait();
+  delete handle;
+}
+
 // Array Table
 void MV_NewArrayTable(int size, TableHandler* out) {
   *out = multiverso::MV_CreateTable(multiverso::ArrayTableOption<float>(size));
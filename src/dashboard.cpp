@@ -9,6 +9,7 @@
 namespace multiverso {
 
 std::map<std::string, Monitor*> Dashboard::record_;
+std::map<std::string, Gauge*> Dashboard::gauges_;
 std::mutex Dashboard::m_;
 
 void Dashboard::AddMonitor(const std::string& name, Monitor* monitor) {
@@ -23,9 +24,26 @@ void Dashboard::RemoveMonitor(const std::string& name) {
   record_.erase(name);
 }
 
+void Dashboard::AddGauge(const std::string& name, Gauge* gauge) {
+  std::lock_guard<std::mutex> l(m_);
+  CHECK(gauges_[name] == nullptr);
+  gauges_[name] = gauge;
+}
+
+void Dashboard::RemoveGauge(const std::string& name) {
+  std::lock_guard<std::mutex> l(m_);
+  CHECK_NOTNULL(gauges_[name]);
+  gauges_.erase(name);
+}
+
 std::string Dashboard::Watch(const std::string& name) {
   std::lock_guard<std::mutex> l(m_);
   std::string result;
+  if (gauges_.find(name) != gauges_.end()) {
+    Gauge* gauge = gauges_[name];
+    CHECK_NOTNULL(gauge);
+    return gauge->info_string();
+  }
   if (record_.find(name) == record_.end()) return result;
   Monitor* monitor = record_[name];
   CHECK_NOTNULL(monitor);
@@ -41,10 +59,19 @@ std::string Monitor::info_string() const {
   return oss.str();
 }
 
+std::string Gauge::info_string() const {
+  std::ostringstream oss;
+  oss << "[" << name_ << "] "
+      << " value = " << value_
+      << " peak = " << peak_;
+  return oss.str();
+}
+
 void Dashboard::Display() {
   std::lock_guard<std::mutex> l(m_);
   Log::Info("--------------Show dashboard monitor information--------------\n");
   for (auto& it : record_) Log::Info("%s\n", it.second->info_string().c_str());
+  for (auto& it : gauges_) Log::Info("%s\n", it.second->info_string().c_str());
   Log::Info("--------------------------------------------------------------\n");
 }
 
@@ -0,0 +1,107 @@
+#include "multiverso/io/checkpoint.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "multiverso/io/io.h"
+#include "multiverso/util/log.h"
+
+namespace multiverso {
+
+namespace {
+
+enum BlockState : char { kPending = 0, kCopied = 1, kWritten = 2 };
+
+}  // namespace
+
+struct BackgroundCheckpoint::State {
+  State() : running(false) {}
+
+  std::atomic<bool> running;
+  std::thread thread;
+  Stream* stream;
+  SnapshotHeader header;
+  const char* data;
+  size_t size;
+  size_t block_bytes;
+  // guards blocks and copies
+  std::mutex mutex;
+  std::vector<char> blocks;                  // BlockState of each block
+  std::unordered_map<size_t, std::vector<char>> copies;
+};
+
+BackgroundCheckpoint::BackgroundCheckpoint() : state_(new State()) {}
+
+BackgroundCheckpoint::~BackgroundCheckpoint() {
+  Wait();
+  delete state_;
+}
+
+void BackgroundCheckpoint::Start(Stream* stream, const SnapshotHeader& header,
+  const void* data, size_t size, size_t block_bytes) {
+  CHECK_NOTNULL(stream);
+  CHECK(header.payload_bytes == size && block_bytes > 0);
+  Wait();
+  state_->stream = stream;
+  state_->header = header;
+  state_->data = static_cast<const char*>(data);
+  state_->size = size;
+  state_->block_bytes = block_bytes;
+  state_->blocks.assign((size + block_bytes - 1) / block_bytes, kPending);
+  state_->copies.clear();
+  state_->running = true;
+  state_->thread = std::thread(&BackgroundCheckpoint::Main, this);
+}
+
+void BackgroundCheckpoint::BeforeWrite(size_t offset, size_t size) {
+  if (!state_->running || size == 0) return;
+  std::lock_guard<std::mutex> lock(state_->mutex);
+  size_t last = std::min((offset + size - 1) / state_->block_bytes,
+                         state_->blocks.size() - 1);
+  for (size_t b = offset / state_->block_bytes; b <= last; ++b) {
+    if (state_->blocks[b] != kPending) continue;
+    size_t begin = b * state_->block_bytes;
+    size_t end = std::min(begin + state_->block_bytes, state_->size);
+    state_->copies[b].assign(state_->data + begin, state_->data + end);
+    state_->blocks[b] = kCopied;
+  }
+}
+
+bool BackgroundCheckpoint::running() const { return state_->running; }
+
+void BackgroundCheckpoint::Wait() {
+  if (state_->thread.joinable()) state_->thread.join();
+}
+
+void BackgroundCheckpoint::Main() {
+  SnapshotWriter writer(state_->stream, state_->header);
+  std::vector<char> buffer;
+  for (size_t b = 0; b < state_->blocks.size(); ++b) {
+    size_t begin = b * state_->block_bytes;
+    size_t end = std::min(begin + state_->block_bytes, state_->size);
+    {
+      // the block is copied under the lock, the table changes it only
+      // once it is marked written or copied
+      std::lock_guard<std::mutex> lock(state_->mutex);
+      if (state_->blocks[b] == kCopied) {
+        buffer.swap(state_->copies[b]);
+        state_->copies.erase(b);
+      } else {
+        buffer.assign(state_->data + begin, state_->data + end);
+      }
+      state_->blocks[b] = kWritten;
+    }
+    writer.Write(buffer.data(), end - begin);
+  }
+  state_->running = false;
+  writer.Finish();
+  delete state_->stream;
+  state_->stream = nullptr;
+}
+
+}  // namespace multiverso
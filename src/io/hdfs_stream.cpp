@@ -112,6 +112,11 @@ size_t HDFSStream::Read(void *buf, size_t size) {
   return i;
 }
 
+// only streams opened for reading can seek
+bool HDFSStream::Seek(size_t offset) {
+  return hdfsSeek(fs_, fp_, static_cast<tOffset>(offset)) == 0;
+}
+
 bool HDFSStream::Good() { return is_good_; }
 
 HDFSStreamFactory::HDFSStreamFactory(const std::string &host) {
@@ -80,6 +80,14 @@ size_t LocalStream::Read(void *buf, size_t size) {
   return std::fread(buf, 1, size, fp_);
 }
 
+bool LocalStream::Seek(size_t offset) {
+#ifdef _MSC_VER
+  return _fseeki64(fp_, static_cast<__int64>(offset), SEEK_SET) == 0;
+#else
+  return fseeko(fp_, static_cast<off_t>(offset), SEEK_SET) == 0;
+#endif
+}
+
 bool LocalStream::Good() { return is_good_; }
 
 LocalStreamFactory::LocalStreamFactory(const std::string& host) {
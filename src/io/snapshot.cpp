@@ -0,0 +1,257 @@
+#include "multiverso/io/snapshot.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "multiverso/io/io.h"
+#include "multiverso/util/log.h"
+
+namespace multiverso {
+
+namespace {
+
+struct Crc32Table {
+  Crc32Table() {
+    for (uint32_t i = 0; i < 256; ++i) {
+      uint32_t c = i;
+      for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+      entries[i] = c;
+    }
+  }
+  uint32_t entries[256];
+};
+
+// fields of the header in file order, the CRC-32 of the first
+// kHeaderBytes - 4 bytes closes it
+template <typename Header, typename Visit>
+void VisitFields(Header& header, uint32_t& magic, uint32_t& version,
+                 Visit visit) {
+  visit(&magic, sizeof(magic));
+  visit(&version, sizeof(version));
+  visit(&header.table_type, sizeof(header.table_type));
+  visit(&header.element_type, sizeof(header.element_type));
+  visit(&header.key_type, sizeof(header.key_type));
+  visit(&header.server_id, sizeof(header.server_id));
+  visit(&header.num_servers, sizeof(header.num_servers));
+  visit(&header.num_rows, sizeof(header.num_rows));
+  visit(&header.num_cols, sizeof(header.num_cols));
+  visit(&header.begin, sizeof(header.begin));
+  visit(&header.end, sizeof(header.end));
+  visit(&header.payload_bytes, sizeof(header.payload_bytes));
+  visit(&header.chunk_bytes, sizeof(header.chunk_bytes));
+}
+
+}  // namespace
+
+uint32_t Crc32(const void* data, size_t size, uint32_t crc) {
+  static const Crc32Table table;
+  const unsigned char* bytes = static_cast<const unsigned char*>(data);
+  crc = ~crc;
+  for (size_t i = 0; i < size; ++i) {
+    crc = table.entries[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+SnapshotHeader::SnapshotHeader() : table_type(0), element_type(0),
+  key_type(0), server_id(0), num_servers(1), num_rows(0), num_cols(0),
+  begin(0), end(0), payload_bytes(0), chunk_bytes(4 << 20) {}
+
+std::string SnapshotPath(const std::string& uri, int table_id,
+                         int server_id) {
+  return uri + ".table" + std::to_string(table_id) +
+    ".server" + std::to_string(server_id);
+}
+
+void CheckSnapshotLayout(const SnapshotHeader& table,
+                         const SnapshotHeader& snapshot) {
+  if (table.table_type != snapshot.table_type ||
+      table.element_type != snapshot.element_type ||
+      table.key_type != snapshot.key_type) {
+    Log::Fatal("Snapshot of another type of table: table %u, element %#x, "
+               "key %#x\n", snapshot.table_type, snapshot.element_type,
+               snapshot.key_type);
+  }
+  if (table.table_type == static_cast<uint32_t>(SnapshotTable::kKV)) return;
+  if (table.num_rows != snapshot.num_rows ||
+      table.num_cols != snapshot.num_cols) {
+    Log::Fatal("Snapshot of a %llu x %llu table loaded into %llu x %llu\n",
+               static_cast<unsigned long long>(snapshot.num_rows),
+               static_cast<unsigned long long>(snapshot.num_cols),
+               static_cast<unsigned long long>(table.num_rows),
+               static_cast<unsigned long long>(table.num_cols));
+  }
+}
+
+void ReadSnapshotRows(const SnapshotHeader& table,
+                      const std::vector<Stream*>& snapshots, void* data) {
+  uint64_t row_bytes = table.num_cols * (table.element_type & 0xFF);
+  uint64_t found = 0;
+  for (auto stream : snapshots) {
+    SnapshotReader reader(stream);
+    const SnapshotHeader& header = reader.header();
+    CheckSnapshotLayout(table, header);
+    if (header.payload_bytes != (header.end - header.begin) * row_bytes) {
+      Log::Fatal("Snapshot of server %d holds %llu bytes for rows [%llu, "
+                 "%llu)\n", header.server_id,
+                 static_cast<unsigned long long>(header.payload_bytes),
+                 static_cast<unsigned long long>(header.begin),
+                 static_cast<unsigned long long>(header.end));
+    }
+    uint64_t begin = std::max(table.begin, header.begin);
+    uint64_t end = std::min(table.end, header.end);
+    if (begin >= end) continue;
+    reader.ReadAt((begin - header.begin) * row_bytes,
+      static_cast<char*>(data) + (begin - table.begin) * row_bytes,
+      static_cast<size_t>((end - begin) * row_bytes));
+    found += end - begin;
+  }
+  if (found != table.end - table.begin) {
+    Log::Fatal("The snapshots hold %llu of the rows [%llu, %llu) of server "
+               "%d\n", static_cast<unsigned long long>(found),
+               static_cast<unsigned long long>(table.begin),
+               static_cast<unsigned long long>(table.end), table.server_id);
+  }
+}
+
+SnapshotWriter::SnapshotWriter(Stream* stream, const SnapshotHeader& header)
+  : stream_(stream), header_(header), written_(0), crc_(0) {
+  CHECK_NOTNULL(stream_);
+  CHECK(header_.chunk_bytes > 0);
+  char bytes[SnapshotHeader::kHeaderBytes];
+  size_t used = 0;
+  uint32_t magic = SnapshotHeader::kMagic;
+  uint32_t version = SnapshotHeader::kVersion;
+  VisitFields(header_, magic, version, [&](const void* field, size_t size) {
+    memcpy(bytes + used, field, size);
+    used += size;
+  });
+  CHECK(used + sizeof(uint32_t) == sizeof(bytes));
+  uint32_t crc = Crc32(bytes, used);
+  memcpy(bytes + used, &crc, sizeof(crc));
+  stream_->Write(bytes, sizeof(bytes));
+  chunk_left_ = std::min(header_.chunk_bytes, header_.payload_bytes);
+}
+
+void SnapshotWriter::Write(const void* data, size_t size) {
+  const char* bytes = static_cast<const char*>(data);
+  CHECK(written_ + size <= header_.payload_bytes);
+  while (size > 0) {
+    size_t n = static_cast<size_t>(std::min<uint64_t>(size, chunk_left_));
+    stream_->Write(bytes, n);
+    crc_ = Crc32(bytes, n, crc_);
+    bytes += n;
+    size -= n;
+    written_ += n;
+    chunk_left_ -= n;
+    if (chunk_left_ == 0) {
+      stream_->Write(&crc_, sizeof(crc_));
+      crc_ = 0;
+      chunk_left_ = std::min(header_.chunk_bytes,
+                             header_.payload_bytes - written_);
+    }
+  }
+}
+
+void SnapshotWriter::Finish() {
+  CHECK(written_ == header_.payload_bytes);
+  if (!stream_->Good()) {
+    Log::Error("Failed to write the snapshot of server %d\n",
+               header_.server_id);
+  }
+}
+
+SnapshotReader::SnapshotReader(Stream* stream) : stream_(stream), ok_(true),
+  read_(0), chunk_left_(0), crc_(0) {
+  CHECK_NOTNULL(stream_);
+  char bytes[SnapshotHeader::kHeaderBytes];
+  Check(stream_->Read(bytes, sizeof(bytes)) == sizeof(bytes), "header");
+  size_t used = 0;
+  uint32_t magic, version;
+  VisitFields(header_, magic, version, [&](void* field, size_t size) {
+    memcpy(field, bytes + used, size);
+    used += size;
+  });
+  if (magic != SnapshotHeader::kMagic) {
+    ok_ = false;
+    Log::Fatal("Not a snapshot of a table\n");
+    return;
+  }
+  if (version != SnapshotHeader::kVersion) {
+    ok_ = false;
+    Log::Fatal("Snapshot version %u is not supported, expected %u\n",
+               version, static_cast<uint32_t>(SnapshotHeader::kVersion));
+    return;
+  }
+  uint32_t crc;
+  memcpy(&crc, bytes + used, sizeof(crc));
+  Check(crc == Crc32(bytes, used), "header");
+  Check(header_.chunk_bytes > 0, "header");
+  if (!ok_) return;
+  chunk_left_ = std::min(header_.chunk_bytes, header_.payload_bytes);
+}
+
+void SnapshotReader::Read(void* data, size_t size) {
+  char* bytes = static_cast<char*>(data);
+  Check(read_ + size <= header_.payload_bytes, "payload size");
+  while (ok_ && size > 0) {
+    size_t n = static_cast<size_t>(std::min<uint64_t>(size, chunk_left_));
+    Check(stream_->Read(bytes, n) == n, "payload");
+    crc_ = Crc32(bytes, n, crc_);
+    bytes += n;
+    size -= n;
+    read_ += n;
+    chunk_left_ -= n;
+    if (chunk_left_ == 0) {
+      uint32_t crc;
+      Check(stream_->Read(&crc, sizeof(crc)) == sizeof(crc), "payload");
+      Check(crc == crc_, "chunk");
+      crc_ = 0;
+      chunk_left_ = std::min(header_.chunk_bytes,
+                             header_.payload_bytes - read_);
+    }
+  }
+}
+
+void SnapshotReader::ReadAt(uint64_t offset, void* data, size_t size) {
+  Check(offset + size <= header_.payload_bytes, "payload size");
+  if (!ok_) return;
+  uint64_t chunk = offset / header_.chunk_bytes;
+  if (stream_->Seek(static_cast<size_t>(SnapshotHeader::kHeaderBytes +
+      chunk * (header_.chunk_bytes + sizeof(uint32_t))))) {
+    read_ = chunk * header_.chunk_bytes;
+    chunk_left_ = std::min(header_.chunk_bytes,
+                           header_.payload_bytes - read_);
+    crc_ = 0;
+  } else {
+    Check(offset >= read_, "seek");
+  }
+  Skip(offset - read_);
+  Read(data, size);
+  // the rest of the last chunk, to check it
+  if (read_ % header_.chunk_bytes != 0) Skip(chunk_left_);
+}
+
+void SnapshotReader::Skip(uint64_t size) {
+  char buffer[4096];
+  while (ok_ && size > 0) {
+    size_t n = static_cast<size_t>(std::min<uint64_t>(size, sizeof(buffer)));
+    Read(buffer, n);
+    size -= n;
+  }
+}
+
+void SnapshotReader::Finish() {
+  Check(read_ == header_.payload_bytes, "payload size");
+}
+
+void SnapshotReader::Check(bool ok, const char* what) {
+  if (!ok) {
+    ok_ = false;
+    Log::Fatal("Corrupt snapshot of server %d: bad %s at payload byte "
+               "%llu\n", header_.server_id, what,
+               static_cast<unsigned long long>(read_));
+  }
+}
+
+}  // namespace multiverso
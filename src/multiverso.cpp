@@ -4,6 +4,7 @@
 #include "multiverso/net.h"
 #include "multiverso/zoo.h"
 #include "multiverso/table_factory.h"
+#include "multiverso/util/allocator.h"
 #include "multiverso/util/configure.h"
 
 namespace multiverso {
@@ -45,6 +46,16 @@ int  MV_ServerIdToRank(int server_id) {
   return Zoo::Get()->server_id_to_rank(server_id);
 }
 
+void MV_Checkpoint(const std::string& uri) {
+  Zoo::Get()->Checkpoint(uri);
+}
+
+void MV_WaitCheckpoint() { Zoo::Get()->WaitCheckpoint(); }
+
+void MV_Restore(const std::string& uri) { Zoo::Get()->Restore(uri); }
+
+size_t MV_TrimAllocator() { return Allocator::Get()->Trim(); }
+
 template <typename T>
 void MV_SetFlag(const std::string& name, const T& value) {
   SetCMDFlag(name, value);
@@ -55,6 +66,11 @@ void MV_Aggregate(ElemType* data, int size) {
   net::Allreduce(data, size);
 }
 
+template <typename ElemType>
+net::AllreduceHandle MV_AggregateAsync(ElemType* data, int size) {
+  return net::AllreduceAsync(data, size);
+}
+
 int  MV_NetBind(int rank, char* endpoint) {
   return NetInterface::Get()->Bind(rank, endpoint);
 }
@@ -72,6 +88,11 @@ template void MV_Aggregate<int>(int*, int);
 template void MV_Aggregate<float>(float*, int);
 template void MV_Aggregate<double>(double*, int);
 
+template net::AllreduceHandle MV_AggregateAsync<char>(char*, int);
+template net::AllreduceHandle MV_AggregateAsync<int>(int*, int);
+template net::AllreduceHandle MV_AggregateAsync<float>(float*, int);
+template net::AllreduceHandle MV_AggregateAsync<double>(double*, int);
+
 template void MV_SetFlag<int>(const std::string&, const int&);
 template void MV_SetFlag<bool>(const std::string&, const bool&);
 template void MV_SetFlag<std::string>(const std::string&, const std::string&);
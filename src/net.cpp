@@ -1,8 +1,15 @@
 #include "multiverso/net.h"
 
+#include <condition_variable>
+#include <deque>
+#include <functional>
 #include <limits>
 #include <mutex>
+#include <thread>
+#include <utility>
 #include "multiverso/message.h"
+#include "multiverso/net/allreduce_engine.h"
+#include "multiverso/util/configure.h"
 #include "multiverso/util/log.h"
 
 #include "multiverso/net/zmq_net.h"
@@ -23,22 +30,207 @@ NetInterface* NetInterface::Get() {
 #endif
 }
 
+MV_DECLARE_bool(ma);
+MV_DEFINE_string(allreduce_compression, "none", "wire format of the float allreduce of model average: none, fp16 or bf16");
+
 namespace net {
+
+#ifdef MULTIVERSO_USE_MPI
+namespace {
+
 template <typename Typename>
-void Allreduce(Typename* data, size_t elem_count) {
+void Sum(const char* src, char* dst, int len) {
+  const Typename* from = reinterpret_cast<const Typename*>(src);
+  Typename* to = reinterpret_cast<Typename*>(dst);
+  for (int i = 0; i < len / static_cast<int>(sizeof(Typename)); ++i) {
+    to[i] += from[i];
+  }
+}
+
+AllreduceEngine* Engine() {
+  // Init is collective, the first allreduce is called by all ranks
+  static AllreduceEngine* engine = [] {
+    AllreduceEngine* result = new AllreduceEngine();
+    result->Init(NetInterface::Get());
+    return result;
+  }();
+  return engine;
+}
+
+// Only float is sent compressed
+template <typename Typename>
+bool CompressedAllreduce(Typename*, int) { return false; }
+
+bool CompressedAllreduce(float* data, int input_size) {
+  static HalfCodec half;
+  static BFloat16Codec bfloat16;
+  const ReduceCodec* codec = nullptr;
+  if (MV_CONFIG_allreduce_compression == "fp16") {
+    codec = &half;
+  } else if (MV_CONFIG_allreduce_compression == "bf16") {
+    codec = &bfloat16;
+  } else if (MV_CONFIG_allreduce_compression != "none") {
+    Log::Fatal("Unknown allreduce compression %s\n", MV_CONFIG_allreduce_compression.c_str());
+  }
+  if (codec == nullptr) return false;
+  char* bytes = reinterpret_cast<char*>(data);
+  Engine()->CompressedAllreduce(bytes, input_size, sizeof(float), bytes, *codec);
+  return true;
+}
+
+}  // namespace
+#endif
+
+namespace {
+
+template <typename Typename>
+void RunAllreduce(Typename* data, size_t elem_count) {
 #ifdef MULTIVERSO_USE_MPI
   CHECK(NetInterface::Get()->active());
-  MPINetWrapper::Allreduce(data, elem_count);
+  // The engine uses the point to point links, which the communicator
+  // receives from when the parameter server runs
+  if (MV_CONFIG_ma) {
+    CHECK(elem_count <= std::numeric_limits<int>::max() / sizeof(Typename));
+    int input_size = static_cast<int>(elem_count * sizeof(Typename));
+    if (CompressedAllreduce(data, input_size)) return;
+    char* bytes = reinterpret_cast<char*>(data);
+    Engine()->Allreduce(bytes, input_size, sizeof(Typename), bytes, &Sum<Typename>);
+    return;
+  }
+  MPINetWrapper* mpi = dynamic_cast<MPINetWrapper*>(NetInterface::Get());
+  CHECK_NOTNULL(mpi);
+  mpi->Allreduce(data, elem_count);
 #else
   Log::Fatal("Not implemented yet");
 #endif
 }
 
+}  // namespace
+
+struct AllreduceHandle::State {
+  State() : done(false) {}
+  // guarded by the mutex of Collective
+  bool done;
+};
+
+// The collective thread, runs the queued allreduces in order
+class Collective {
+public:
+  static Collective* Get() {
+    static Collective collective;
+    return &collective;
+  }
+
+  ~Collective() { Finish(); }
+
+  AllreduceHandle Push(const std::function<void()>& job) {
+    std::shared_ptr<AllreduceHandle::State> state(new AllreduceHandle::State());
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!thread_.joinable()) { thread_ = std::thread(&Collective::Main, this); }
+      jobs_.emplace_back(job, state);
+    }
+    cv_.notify_all();
+    return AllreduceHandle(state);
+  }
+
+  bool running() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return thread_.joinable();
+  }
+
+  bool Test(const AllreduceHandle::State& state) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return state.done;
+  }
+
+  void Wait(const AllreduceHandle::State& state) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [&state] { return state.done; });
+  }
+
+  // runs the queued jobs, then stops the thread
+  void Finish() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!thread_.joinable()) return;
+      stop_ = true;
+    }
+    cv_.notify_all();
+    thread_.join();
+    std::lock_guard<std::mutex> lock(mutex_);
+    thread_ = std::thread();
+    stop_ = false;
+  }
+
+private:
+  Collective() : stop_(false) {}
+
+  void Main() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      cv_.wait(lock, [this] { return stop_ || !jobs_.empty(); });
+      if (jobs_.empty()) return;
+      auto job = std::move(jobs_.front());
+      jobs_.pop_front();
+      lock.unlock();
+      job.first();
+      lock.lock();
+      job.second->done = true;
+      cv_.notify_all();
+    }
+  }
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<std::pair<std::function<void()>,
+    std::shared_ptr<AllreduceHandle::State>>> jobs_;
+  std::thread thread_;
+  bool stop_;
+};
+
+AllreduceHandle::AllreduceHandle() {}
+
+AllreduceHandle::AllreduceHandle(const std::shared_ptr<State>& state)
+  : state_(state) {}
+
+bool AllreduceHandle::Test() const {
+  return state_ == nullptr || Collective::Get()->Test(*state_);
+}
+
+void AllreduceHandle::Wait() const {
+  if (state_ != nullptr) Collective::Get()->Wait(*state_);
+}
+
+template <typename Typename>
+void Allreduce(Typename* data, size_t elem_count) {
+  // after the allreduces queued before
+  if (Collective::Get()->running()) {
+    AllreduceAsync(data, elem_count).Wait();
+    return;
+  }
+  RunAllreduce(data, elem_count);
+}
+
+template <typename Typename>
+AllreduceHandle AllreduceAsync(Typename* data, size_t elem_count) {
+  return Collective::Get()->Push([data, elem_count] {
+    RunAllreduce(data, elem_count);
+  });
+}
+
+void FinishAllreduces() { Collective::Get()->Finish(); }
+
 template void Allreduce<char>(char*, size_t);
 template void Allreduce<int>(int*, size_t);
 template void Allreduce<float>(float*, size_t);
 template void Allreduce<double>(double*, size_t);
 
+template AllreduceHandle AllreduceAsync<char>(char*, size_t);
+template AllreduceHandle AllreduceAsync<int>(int*, size_t);
+template AllreduceHandle AllreduceAsync<float>(float*, size_t);
+template AllreduceHandle AllreduceAsync<double>(double*, size_t);
+
 }  // namespace net
 
 
@@ -1,12 +1,216 @@
 #include <string.h>
+#include <stdint.h>
 #include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include "multiverso/net/allreduce_engine.h"
+#include "multiverso/util/configure.h"
+#include "multiverso/util/log.h"
+#include "multiverso/util/net_util.h"
 
 namespace multiverso {
 
+MV_DEFINE_string(allreduce_algorithm, "auto", "allreduce algorithm, auto / allgather / halving / ring / hierarchical");
+MV_DEFINE_int(allreduce_ring_bytes, 64 * 1024, "min bytes to allreduce with the ring or hierarchical algorithms in auto mode");
+MV_DEFINE_int(allreduce_chunk_bytes, 0, "chunk of the pipelined reduce steps, same on all machines, 0 to send whole blocks");
+MV_DEFINE_int(allreduce_pipeline_depth, 2, "chunks received ahead of the reduction in the pipelined reduce steps");
+MV_DEFINE_int(allreduce_ranks_per_host, 0, "group every n consecutive ranks as one host in the hierarchical allreduce, 0 to group by host name");
+
+namespace {
+
+// max bytes of a host name exchanged in Init
+const int kHostNameBytes = 256;
+
+AllreduceAlgorithm ParseAllreduceAlgorithm(const std::string& name) {
+  if (name == "auto")         return AllreduceAlgorithm::Auto;
+  if (name == "allgather")    return AllreduceAlgorithm::AllGather;
+  if (name == "halving")      return AllreduceAlgorithm::RecursiveHalving;
+  if (name == "ring")         return AllreduceAlgorithm::Ring;
+  if (name == "hierarchical") return AllreduceAlgorithm::Hierarchical;
+  Log::Fatal("Unknown allreduce algorithm %s\n", name.c_str());
+  return AllreduceAlgorithm::Auto;
+}
+
+//blocks of objects of type_size bytes, in the wire format
+std::vector<int> WireBlocks(const int* blocks, int n, int type_size, int wire_size) {
+  std::vector<int> result(n);
+  for (int i = 0; i < n; ++i) { result[i] = blocks[i] / type_size * wire_size; }
+  return result;
+}
+
+uint32_t FloatBits(float value) {
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+float BitsFloat(uint32_t bits) {
+  float value;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+uint16_t FloatToHalf(float value) {
+  uint32_t bits = FloatBits(value);
+  uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000);
+  uint32_t abs = bits & 0x7FFFFFFF;
+  //inf and nan, nan stays quiet
+  if (abs >= 0x7F800000) {
+    return sign | 0x7C00 | (abs > 0x7F800000 ? 0x200 : 0);
+  }
+  //from 65520 on, rounds to inf
+  if (abs >= 0x477FF000) {
+    return sign | 0x7C00;
+  }
+  //below 2^-14, subnormal half: the mantissa with the implicit bit, rounded at 2^-24
+  if (abs < 0x38800000) {
+    int shift = 126 - static_cast<int>(abs >> 23);
+    if (shift > 24) { return sign; }
+    uint32_t mantissa = (abs & 0x7FFFFF) | 0x800000;
+    uint32_t result = mantissa >> shift;
+    uint32_t rest = mantissa & ((1u << shift) - 1);
+    uint32_t half = 1u << (shift - 1);
+    if (rest > half || (rest == half && (result & 1))) { ++result; }
+    return sign | static_cast<uint16_t>(result);
+  }
+  //normal, round to nearest even at the 13 dropped bits then rebias the exponent
+  abs += 0xFFF + ((abs >> 13) & 1);
+  return sign | static_cast<uint16_t>((abs - 0x38000000) >> 13);
+}
+
+float HalfToFloat(uint16_t half) {
+  uint32_t sign = static_cast<uint32_t>(half & 0x8000) << 16;
+  uint32_t exponent = (half >> 10) & 0x1F;
+  uint32_t mantissa = half & 0x3FF;
+  if (exponent == 0x1F) {
+    return BitsFloat(sign | 0x7F800000 | (mantissa << 13));
+  }
+  if (exponent == 0) {
+    //zero or subnormal, mantissa * 2^-24
+    float value = mantissa * 5.9604644775390625e-8f;
+    return sign ? -value : value;
+  }
+  return BitsFloat(sign | ((exponent + 112) << 23) | (mantissa << 13));
+}
+
+uint16_t FloatToBFloat16(float value) {
+  uint32_t bits = FloatBits(value);
+  if ((bits & 0x7FFFFFFF) > 0x7F800000) {
+    return static_cast<uint16_t>((bits >> 16) | 0x40);
+  }
+  bits += 0x7FFF + ((bits >> 16) & 1);
+  return static_cast<uint16_t>(bits >> 16);
+}
+
+float BFloat16ToFloat(uint16_t value) {
+  return BitsFloat(static_cast<uint32_t>(value) << 16);
+}
+
+}  // namespace
+
+void HalfCodec::Encode(const char* src, char* dst, int count) const {
+  const float* from = reinterpret_cast<const float*>(src);
+  uint16_t* to = reinterpret_cast<uint16_t*>(dst);
+  for (int i = 0; i < count; ++i) { to[i] = FloatToHalf(from[i]); }
+}
+
+void HalfCodec::Decode(const char* src, char* dst, int count) const {
+  const uint16_t* from = reinterpret_cast<const uint16_t*>(src);
+  float* to = reinterpret_cast<float*>(dst);
+  for (int i = 0; i < count; ++i) { to[i] = HalfToFloat(from[i]); }
+}
+
+void HalfCodec::DecodeReduce(const char* src, char* dst, int count) const {
+  const uint16_t* from = reinterpret_cast<const uint16_t*>(src);
+  float* to = reinterpret_cast<float*>(dst);
+  for (int i = 0; i < count; ++i) { to[i] += HalfToFloat(from[i]); }
+}
+
+void BFloat16Codec::Encode(const char* src, char* dst, int count) const {
+  const float* from = reinterpret_cast<const float*>(src);
+  uint16_t* to = reinterpret_cast<uint16_t*>(dst);
+  for (int i = 0; i < count; ++i) { to[i] = FloatToBFloat16(from[i]); }
+}
+
+void BFloat16Codec::Decode(const char* src, char* dst, int count) const {
+  const uint16_t* from = reinterpret_cast<const uint16_t*>(src);
+  float* to = reinterpret_cast<float*>(dst);
+  for (int i = 0; i < count; ++i) { to[i] = BFloat16ToFloat(from[i]); }
+}
+
+void BFloat16Codec::DecodeReduce(const char* src, char* dst, int count) const {
+  const uint16_t* from = reinterpret_cast<const uint16_t*>(src);
+  float* to = reinterpret_cast<float*>(dst);
+  for (int i = 0; i < count; ++i) { to[i] += BFloat16ToFloat(from[i]); }
+}
+
+struct AllreduceEngine::Pipeline {
+  Pipeline() : stop(false), has_job(false), done(false), received(0), reduced(0) {}
+
+  ~Pipeline() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stop = true;
+    }
+    cv.notify_all();
+    if (thread.joinable()) { thread.join(); }
+  }
+
+  //run job on the communication thread
+  void Run(const std::function<void()>& next) {
+    if (!thread.joinable()) { thread = std::thread(&Pipeline::Main, this); }
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      job = next;
+      has_job = true;
+      done = false;
+    }
+    cv.notify_all();
+  }
+
+  void Wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [this] { return done; });
+  }
+
+  void Main() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+      cv.wait(lock, [this] { return stop || has_job; });
+      if (stop) { return; }
+      has_job = false;
+      lock.unlock();
+      job();
+      lock.lock();
+      done = true;
+      cv.notify_all();
+    }
+  }
+
+  //pipeline_depth slots of one chunk
+  std::vector<char> staging;
+  std::thread thread;
+  //guards all below
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::function<void()> job;
+  bool stop;
+  bool has_job;
+  bool done;
+  //chunks received by the communication thread, reduced by the caller
+  int received;
+  int reduced;
+};
+
 AllreduceEngine::AllreduceEngine()
-  :block_start_(nullptr), block_len_(nullptr), buffer_(nullptr) {
+  :block_start_(nullptr), block_len_(nullptr), buffer_(nullptr), buffer_size_(0),
+  pipeline_(new Pipeline()), bytes_sent_(0) {
 
 }
 
@@ -18,41 +222,328 @@ void AllreduceEngine::Init(const NetInterface* linkers) {
   recursive_halving_map_ = RecursiveHalvingMap::Construct(rank_, num_machines_);
   block_start_ = new int[num_machines_];
   block_len_ = new int[num_machines_];
-  buffer_size_ = 1024 * 1024;
-  buffer_ = new char[buffer_size_];
+  all_ranks_.resize(num_machines_);
+  for (int i = 0; i < num_machines_; ++i) { all_ranks_[i] = i; }
+
+  //exchange the host names for the hierarchical algorithm
+  std::string host = MV_CONFIG_allreduce_ranks_per_host > 0 ?
+    std::to_string(rank_ / MV_CONFIG_allreduce_ranks_per_host) : net::GetHostName();
+  std::vector<char> name(kHostNameBytes, 0);
+  std::vector<char> names(kHostNameBytes * num_machines_);
+  strncpy(name.data(), host.c_str(), kHostNameBytes - 1);
+  Allgather(name.data(), kHostNameBytes, names.data());
+  std::vector<std::string> hosts(num_machines_);
+  for (int i = 0; i < num_machines_; ++i) {
+    hosts[i] = names.data() + i * kHostNameBytes;
+  }
+  hierarchical_map_ = HierarchicalMap::Construct(rank_, hosts);
 }
 
 AllreduceEngine::~AllreduceEngine() {
   if (block_start_ != nullptr) { delete[]block_start_; }
   if (block_len_ != nullptr) { delete[]block_len_; }
   if (buffer_ != nullptr) { delete[] buffer_; }
+  delete pipeline_;
 }
 
 void AllreduceEngine::Allreduce(char* input, int input_size, int type_size, char* output, ReduceFunction reducer) {
+  Allreduce(input, input_size, type_size, output, reducer,
+            ParseAllreduceAlgorithm(MV_CONFIG_allreduce_algorithm));
+}
 
-  int count = input_size / type_size;
-  //if small package or small count , do it by all gather.(reduce the communication times.)
-  if (count < num_machines_ || input_size < 4096) {
+void AllreduceEngine::Allreduce(char* input, int input_size, int type_size, char* output, ReduceFunction reducer,
+                                AllreduceAlgorithm algorithm) {
+  if (algorithm == AllreduceAlgorithm::Auto) {
+    algorithm = Select(input_size, type_size);
+  }
+  //recursive halving needs a block for every machine
+  if (algorithm == AllreduceAlgorithm::RecursiveHalving && input_size / type_size < num_machines_) {
+    algorithm = AllreduceAlgorithm::AllGather;
+  }
+  switch (algorithm) {
+  case AllreduceAlgorithm::AllGather:
     AllreduceByAllGather(input, input_size, type_size, output, reducer);
     return;
+  case AllreduceAlgorithm::Ring:
+    RingAllreduce(input, input_size, type_size, output, reducer);
+    return;
+  case AllreduceAlgorithm::Hierarchical:
+    HierarchicalAllreduce(input, input_size, type_size, output, reducer);
+    return;
+  default:
+    break;
   }
   //assign the blocks to every rank_s.
-  int step = (count + num_machines_ - 1) / num_machines_;
-  if (step < 1) {
-    step = 1;
-  }
-  block_start_[0] = 0;
-  for (int i = 0; i < num_machines_ - 1; ++i) {
-    block_len_[i] = step * type_size < input_size - block_start_[i] ? step * type_size : input_size - block_start_[i];
-    block_start_[i + 1] = block_start_[i] + block_len_[i];
-  }
-  block_len_[num_machines_ - 1] = input_size - block_start_[num_machines_ - 1];
+  SplitBlocks(input_size, type_size, num_machines_, block_start_, block_len_);
+  //reduce scatter reduces into input and receives into output, keep input
+  ReserveBuffer(input_size);
+  std::memcpy(buffer_, input, input_size);
   //do reduce scatter
-  ReduceScatter(input, input_size, type_size, block_start_, block_len_, output, reducer);
+  ReduceScatter(buffer_, input_size, type_size, block_start_, block_len_, output, reducer);
   //do all gather
   Allgather(output, input_size, block_start_, block_len_, output);
 }
 
+AllreduceAlgorithm AllreduceEngine::Select(int input_size, int type_size) const {
+  int count = input_size / type_size;
+  //if small package or small count , do it by all gather.(reduce the communication times.)
+  if (count < num_machines_ || input_size < 4096) {
+    return AllreduceAlgorithm::AllGather;
+  }
+  //the ring takes 2 * (n - 1) communications, worth it for large data only
+  if (input_size < MV_CONFIG_allreduce_ring_bytes) {
+    return AllreduceAlgorithm::RecursiveHalving;
+  }
+  //several hosts with several machines each, keep most traffic within hosts
+  if (hierarchical_map_.num_hosts > 1 && hierarchical_map_.num_hosts < num_machines_ &&
+      hierarchical_map_.balanced) {
+    return AllreduceAlgorithm::Hierarchical;
+  }
+  return AllreduceAlgorithm::Ring;
+}
+
+void AllreduceEngine::RingAllreduce(char* input, int input_size, int type_size, char* output, ReduceFunction reducer) {
+  if (input != output) { std::memcpy(output, input, input_size); }
+  SplitBlocks(input_size, type_size, num_machines_, block_start_, block_len_);
+  RingReduceScatter(all_ranks_, rank_, output, block_start_, block_len_, type_size, reducer);
+  RingAllgather(all_ranks_, rank_, output, block_start_, block_len_);
+}
+
+void AllreduceEngine::HierarchicalAllreduce(char* input, int input_size, int type_size, char* output, ReduceFunction reducer) {
+  const HierarchicalMap& map = hierarchical_map_;
+  if (!map.balanced) {
+    RingAllreduce(input, input_size, type_size, output, reducer);
+    return;
+  }
+  if (input != output) { std::memcpy(output, input, input_size); }
+  //reduce scatter within the host, this machine reduces the slice local_rank
+  int local_size = static_cast<int>(map.local_ranks.size());
+  std::vector<int> local_start(local_size), local_len(local_size);
+  SplitBlocks(input_size, type_size, local_size, local_start.data(), local_len.data());
+  RingReduceScatter(map.local_ranks, map.local_rank, output, local_start.data(), local_len.data(),
+                    type_size, reducer);
+  //all reduce the slice with the machines of the same local rank on the other hosts
+  char* slice = output + local_start[map.local_rank];
+  std::vector<int> cross_start(map.num_hosts), cross_len(map.num_hosts);
+  SplitBlocks(local_len[map.local_rank], type_size, map.num_hosts, cross_start.data(), cross_len.data());
+  RingReduceScatter(map.cross_ranks, map.cross_rank, slice, cross_start.data(), cross_len.data(),
+                    type_size, reducer);
+  RingAllgather(map.cross_ranks, map.cross_rank, slice, cross_start.data(), cross_len.data());
+  //all gather the slices within the host
+  RingAllgather(map.local_ranks, map.local_rank, output, local_start.data(), local_len.data());
+}
+
+void AllreduceEngine::CompressedAllreduce(char* input, int input_size, int type_size, char* output,
+                                          const ReduceCodec& codec) {
+  CHECK(type_size == codec.type_size());
+  CHECK(input_size % type_size == 0);
+  int count = input_size / type_size;
+  int wire_size = codec.wire_size();
+  if (input != output) { std::memcpy(output, input, input_size); }
+  //the result is gathered in the wire format in buffer_, then decoded
+  ReserveBuffer(count * wire_size);
+  const HierarchicalMap& map = hierarchical_map_;
+  if (Select(count * wire_size, wire_size) != AllreduceAlgorithm::Hierarchical) {
+    SplitBlocks(input_size, type_size, num_machines_, block_start_, block_len_);
+    RingReduceScatter(all_ranks_, rank_, output, block_start_, block_len_, type_size, nullptr, &codec);
+    std::vector<int> wire_start = WireBlocks(block_start_, num_machines_, type_size, wire_size);
+    std::vector<int> wire_len = WireBlocks(block_len_, num_machines_, type_size, wire_size);
+    codec.Encode(output + block_start_[rank_], buffer_ + wire_start[rank_], block_len_[rank_] / type_size);
+    RingAllgather(all_ranks_, rank_, buffer_, wire_start.data(), wire_len.data());
+  } else {
+    int local_size = static_cast<int>(map.local_ranks.size());
+    std::vector<int> local_start(local_size), local_len(local_size);
+    SplitBlocks(input_size, type_size, local_size, local_start.data(), local_len.data());
+    RingReduceScatter(map.local_ranks, map.local_rank, output, local_start.data(), local_len.data(),
+                      type_size, nullptr, &codec);
+    int slice = local_start[map.local_rank];
+    std::vector<int> cross_start(map.num_hosts), cross_len(map.num_hosts);
+    SplitBlocks(local_len[map.local_rank], type_size, map.num_hosts, cross_start.data(), cross_len.data());
+    RingReduceScatter(map.cross_ranks, map.cross_rank, output + slice, cross_start.data(), cross_len.data(),
+                      type_size, nullptr, &codec);
+    std::vector<int> wire_local_start = WireBlocks(local_start.data(), local_size, type_size, wire_size);
+    std::vector<int> wire_local_len = WireBlocks(local_len.data(), local_size, type_size, wire_size);
+    std::vector<int> wire_cross_start = WireBlocks(cross_start.data(), map.num_hosts, type_size, wire_size);
+    std::vector<int> wire_cross_len = WireBlocks(cross_len.data(), map.num_hosts, type_size, wire_size);
+    char* wire_slice = buffer_ + wire_local_start[map.local_rank];
+    codec.Encode(output + slice + cross_start[map.cross_rank], wire_slice + wire_cross_start[map.cross_rank],
+                 cross_len[map.cross_rank] / type_size);
+    RingAllgather(map.cross_ranks, map.cross_rank, wire_slice, wire_cross_start.data(), wire_cross_len.data());
+    RingAllgather(map.local_ranks, map.local_rank, buffer_, wire_local_start.data(), wire_local_len.data());
+  }
+  codec.Decode(buffer_, output, count);
+}
+
+void AllreduceEngine::TopKAllreduce(const float* input, int count, int k, float* residual, float* output) {
+  struct Entry {
+    int32_t index;
+    float value;
+  };
+  k = std::max(1, std::min(k, count));
+  //error feedback, what was not sent before is added to the new input
+  for (int i = 0; i < count; ++i) { residual[i] += input[i]; }
+  std::vector<int> index(count);
+  for (int i = 0; i < count; ++i) { index[i] = i; }
+  std::nth_element(index.begin(), index.begin() + (k - 1), index.end(), [residual](int a, int b) {
+    return std::fabs(residual[a]) > std::fabs(residual[b]);
+  });
+  std::vector<Entry> sent(k);
+  for (int j = 0; j < k; ++j) {
+    sent[j].index = index[j];
+    sent[j].value = residual[index[j]];
+    residual[index[j]] = 0.0f;
+  }
+  int send_size = k * static_cast<int>(sizeof(Entry));
+  ReserveBuffer(send_size * num_machines_);
+  Allgather(reinterpret_cast<char*>(sent.data()), send_size, buffer_);
+  //summed in rank order, the same on all machines
+  std::fill(output, output + count, 0.0f);
+  const Entry* entries = reinterpret_cast<const Entry*>(buffer_);
+  for (int j = 0; j < k * num_machines_; ++j) {
+    output[entries[j].index] += entries[j].value;
+  }
+}
+
+void AllreduceEngine::RingReduceScatter(const std::vector<int>& group, int index, char* data,
+                                        const int* block_start, const int* block_len, int type_size,
+                                        ReduceFunction reducer, const ReduceCodec* codec) {
+  int n = static_cast<int>(group.size());
+  if (n == 1) { return; }
+  int next = group[(index + 1) % n];
+  int prev = group[(index + n - 1) % n];
+  //at step i, pass on the block reduced over i + 1 machines, the last one received is block index
+  for (int i = 0; i < n - 1; ++i) {
+    int send_block = (index + 2 * n - i - 1) % n;
+    int recv_block = (index + 2 * n - i - 2) % n;
+    char* send_buf = data + block_start[send_block];
+    int send_len = block_len[send_block];
+    int recv_len = block_len[recv_block];
+    if (codec != nullptr) {
+      //send the partial sum in the wire format
+      int count = send_len / type_size;
+      encoded_.resize(static_cast<size_t>(count) * codec->wire_size());
+      codec->Encode(send_buf, encoded_.data(), count);
+      send_buf = encoded_.data();
+      send_len = count * codec->wire_size();
+      recv_len = recv_len / type_size * codec->wire_size();
+    }
+    SendRecvReduce(next, send_buf, send_len, prev, data + block_start[recv_block], recv_len,
+                   type_size, reducer, codec);
+  }
+}
+
+void AllreduceEngine::RingAllgather(const std::vector<int>& group, int index, char* data,
+                                    const int* block_start, const int* block_len) {
+  int n = static_cast<int>(group.size());
+  int next = group[(index + 1) % n];
+  int prev = group[(index + n - 1) % n];
+  for (int i = 0; i < n - 1; ++i) {
+    int send_block = (index + n - i) % n;
+    int recv_block = (index + 2 * n - i - 1) % n;
+    SendRecv(next, data + block_start[send_block], block_len[send_block],
+             prev, data + block_start[recv_block], block_len[recv_block]);
+  }
+}
+
+void AllreduceEngine::SplitBlocks(int size, int type_size, int n, int* block_start, int* block_len) {
+  int count = size / type_size;
+  block_start[0] = 0;
+  for (int i = 0; i < n - 1; ++i) {
+    block_len[i] = (count / n + (i < count % n ? 1 : 0)) * type_size;
+    block_start[i + 1] = block_start[i] + block_len[i];
+  }
+  block_len[n - 1] = size - block_start[n - 1];
+}
+
+void AllreduceEngine::SendRecv(int send_rank, char* send_buf, int send_len,
+                               int recv_rank, char* recv_buf, int recv_len) {
+  //an empty message would be left to the next receive from send_rank
+  if (send_len > 0) { bytes_sent_ += send_len; }
+  if (send_len > 0 && recv_len > 0) {
+    linkers_->SendRecv(send_rank, send_buf, send_len, recv_rank, recv_buf, recv_len);
+  } else if (send_len > 0) {
+    linkers_->SendTo(send_rank, send_buf, send_len);
+  } else if (recv_len > 0) {
+    linkers_->RecvFrom(recv_rank, recv_buf, recv_len);
+  }
+}
+
+void AllreduceEngine::SendRecvReduce(int send_rank, char* send_buf, int send_len, int recv_rank, char* dst,
+                                     int recv_len, int type_size, ReduceFunction reducer, const ReduceCodec* codec) {
+  //chunks of whole objects, whole blocks if not pipelined
+  int wire_size = codec != nullptr ? codec->wire_size() : type_size;
+  int chunk = MV_CONFIG_allreduce_chunk_bytes / wire_size * wire_size;
+  if (chunk <= 0) { chunk = std::max(std::max(send_len, recv_len), 1); }
+  int send_chunks = (send_len + chunk - 1) / chunk;
+  int recv_chunks = (recv_len + chunk - 1) / chunk;
+  int num_chunks = std::max(send_chunks, recv_chunks);
+  int depth = std::max(MV_CONFIG_allreduce_pipeline_depth, 1);
+  int slot = std::min(chunk, recv_len);
+  Pipeline* pipeline = pipeline_;
+  if (pipeline->staging.size() < static_cast<size_t>(depth) * slot) {
+    pipeline->staging.resize(static_cast<size_t>(depth) * slot);
+  }
+  char* staging = pipeline->staging.data();
+  auto exchange = [&](int c) {
+    int offset = c * chunk;
+    SendRecv(send_rank, send_buf + std::min(offset, send_len), std::max(std::min(chunk, send_len - offset), 0),
+             recv_rank, staging + (c % depth) * slot, std::max(std::min(chunk, recv_len - offset), 0));
+  };
+  //reduce the len bytes of chunk c in slot
+  auto reduce = [&](int c, const char* slot, int len) {
+    char* to = dst + c * chunk / wire_size * type_size;
+    if (codec != nullptr) {
+      codec->DecodeReduce(slot, to, len / wire_size);
+    } else {
+      reducer(slot, to, len);
+    }
+  };
+  if (num_chunks <= 1) {
+    exchange(0);
+    if (recv_len > 0) { reduce(0, staging, recv_len); }
+    return;
+  }
+
+  //the communication thread receives chunk c in slot c % depth once chunk c - depth is reduced
+  pipeline->received = 0;
+  pipeline->reduced = 0;
+  pipeline->Run([&] {
+    for (int c = 0; c < num_chunks; ++c) {
+      {
+        std::unique_lock<std::mutex> lock(pipeline->mutex);
+        pipeline->cv.wait(lock, [&] { return c >= recv_chunks || c - pipeline->reduced < depth; });
+      }
+      exchange(c);
+      {
+        std::lock_guard<std::mutex> lock(pipeline->mutex);
+        pipeline->received = c + 1;
+      }
+      pipeline->cv.notify_all();
+    }
+  });
+  for (int c = 0; c < recv_chunks; ++c) {
+    {
+      std::unique_lock<std::mutex> lock(pipeline->mutex);
+      pipeline->cv.wait(lock, [&] { return pipeline->received > c; });
+    }
+    reduce(c, staging + (c % depth) * slot, std::min(chunk, recv_len - c * chunk));
+    {
+      std::lock_guard<std::mutex> lock(pipeline->mutex);
+      pipeline->reduced = c + 1;
+    }
+    pipeline->cv.notify_all();
+  }
+  pipeline->Wait();
+}
+
+void AllreduceEngine::ReserveBuffer(int size) {
+  if (size > buffer_size_) {
+    delete[] buffer_;
+    buffer_size_ = size;
+    buffer_ = new char[buffer_size_];
+  }
+}
+
 // REVIEW(feiga): the third argument type_size never used
 void AllreduceEngine::AllreduceByAllGather(char* input, int input_size, int, char* output, ReduceFunction reducer) {
   //assign blocks
@@ -64,11 +555,7 @@ void AllreduceEngine::AllreduceByAllGather(char* input, int input_size, int, cha
     block_len_[i] = input_size;
   }
 
-  if (input_size*num_machines_ > buffer_size_) {
-    delete[] buffer_;
-    buffer_size_ = input_size*num_machines_;
-    buffer_ = new char[buffer_size_];
-  }
+  ReserveBuffer(input_size*num_machines_);
   Allgather(input, all_size, block_start_, block_len_, buffer_);
   for (int i = 1; i < num_machines_; ++i) {
     reducer(buffer_ + block_start_[i], buffer_ + block_start_[0], input_size);
@@ -106,7 +593,7 @@ void AllreduceEngine::Allgather(char* input, int all_size, int* block_start, int
       need_recv_cnt += block_len[(rank_ + accumulated_block + j) % num_machines_];
     }
 
-    linkers_->SendRecv(target, output, send_len, incoming, output + write_ptr, need_recv_cnt);
+    SendRecv(target, output, send_len, incoming, output + write_ptr, need_recv_cnt);
     write_ptr += need_recv_cnt;
     accumulated_block += cur_block_size;
   }
@@ -116,20 +603,19 @@ void AllreduceEngine::Allgather(char* input, int all_size, int* block_start, int
   std::reverse<char*>(output + block_start[rank_], output + all_size);
 }
 
-// REVIEW(feiga): the third argument type_size never used
-void AllreduceEngine::ReduceScatter(char* input, int input_size, int, int* block_start, int* block_len, char* output, ReduceFunction reducer) {
+void AllreduceEngine::ReduceScatter(char* input, int input_size, int type_size, int* block_start, int* block_len, char* output, ReduceFunction reducer) {
 
   bool is_powerof_2 = (num_machines_ & (num_machines_ - 1)) == 0 ? true : false;
   if (!is_powerof_2) {
     if (recursive_halving_map_.type == RecursiveHalvingNodeType::Other) {
       //send local data to neighbor first
-      linkers_->SendTo(recursive_halving_map_.neighbor, input, input_size);
+      SendRecvReduce(recursive_halving_map_.neighbor, input, input_size,
+                     recursive_halving_map_.neighbor, nullptr, 0, type_size, reducer);
     }
     else if (recursive_halving_map_.type == RecursiveHalvingNodeType::GroupLeader) {
       //receive neighbor data first
-      int need_recv_cnt = input_size;
-      linkers_->RecvFrom(recursive_halving_map_.neighbor, output, need_recv_cnt);
-      reducer(output, input, input_size);
+      SendRecvReduce(recursive_halving_map_.neighbor, nullptr, 0,
+                     recursive_halving_map_.neighbor, input, input_size, type_size, reducer);
     }
   }
   //start recursive halfing
@@ -149,9 +635,9 @@ void AllreduceEngine::ReduceScatter(char* input, int input_size, int, int* block
         need_recv_cnt += block_len[recv_block_start + j];
       }
 
-      linkers_->SendRecv(target, input + block_start[send_block_start], send_size, target, output, need_recv_cnt);
-      //reduce
-      reducer(output, input + block_start[recv_block_start], need_recv_cnt);
+      //send and reduce
+      SendRecvReduce(target, input + block_start[send_block_start], send_size,
+                     target, input + block_start[recv_block_start], need_recv_cnt, type_size, reducer);
     }
   }
   int my_reduce_block_idx = rank_;
@@ -159,12 +645,13 @@ void AllreduceEngine::ReduceScatter(char* input, int input_size, int, int* block
   if (!is_powerof_2) {
     if (recursive_halving_map_.type == RecursiveHalvingNodeType::GroupLeader) {
       //send result to neighbor
-      linkers_->SendTo(recursive_halving_map_.neighbor, input + block_start[recursive_halving_map_.neighbor], block_len[recursive_halving_map_.neighbor]);
+      SendRecv(recursive_halving_map_.neighbor, input + block_start[recursive_halving_map_.neighbor],
+               block_len[recursive_halving_map_.neighbor], recursive_halving_map_.neighbor, nullptr, 0);
     }
     else if (recursive_halving_map_.type == RecursiveHalvingNodeType::Other) {
       //receive result from neighbor
       int need_recv_cnt = block_len[my_reduce_block_idx];
-      linkers_->RecvFrom(recursive_halving_map_.neighbor, output, need_recv_cnt);
+      SendRecv(recursive_halving_map_.neighbor, nullptr, 0, recursive_halving_map_.neighbor, output, need_recv_cnt);
       return;
     }
   }
@@ -1,3 +1,5 @@
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "multiverso/net/allreduce_engine.h"
@@ -167,4 +169,42 @@ RecursiveHalvingMap RecursiveHalvingMap::Construct(int rank, int num_machines) {
   }
 }
 
+HierarchicalMap::HierarchicalMap() {
+  local_rank = 0;
+  cross_rank = 0;
+  num_hosts = 1;
+  balanced = true;
+}
+
+HierarchicalMap HierarchicalMap::Construct(int rank, const std::vector<std::string>& hosts) {
+  // number the hosts by their first rank
+  std::unordered_map<std::string, int> host_idx;
+  std::vector<std::vector<int>> host_ranks;
+  for (int i = 0; i < static_cast<int>(hosts.size()); ++i) {
+    auto it = host_idx.find(hosts[i]);
+    if (it == host_idx.end()) {
+      it = host_idx.emplace(hosts[i], static_cast<int>(host_ranks.size())).first;
+      host_ranks.emplace_back();
+    }
+    host_ranks[it->second].push_back(i);
+  }
+  HierarchicalMap map;
+  map.num_hosts = static_cast<int>(host_ranks.size());
+  map.cross_rank = host_idx[hosts[rank]];
+  map.local_ranks = host_ranks[map.cross_rank];
+  for (int i = 0; i < static_cast<int>(map.local_ranks.size()); ++i) {
+    if (map.local_ranks[i] == rank) { map.local_rank = i; }
+  }
+  for (auto& ranks : host_ranks) {
+    if (ranks.size() != map.local_ranks.size()) { map.balanced = false; }
+  }
+  // the machine with the same local rank on every host
+  if (map.balanced) {
+    for (auto& ranks : host_ranks) {
+      map.cross_ranks.push_back(ranks[map.local_rank]);
+    }
+  }
+  return map;
+}
+
 }
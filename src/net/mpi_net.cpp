@@ -2,8 +2,23 @@
 
 #include "multiverso/net/mpi_net.h"
 
+#include "multiverso/util/configure.h"
+
 namespace multiverso {
 
+MV_DEFINE_bool(mpi_zero_copy_send, false, "send messages with MPI derived datatypes instead of copying them into a send buffer");
+
+MV_DEFINE_int(mpi_send_window, 8, "max number of messages sent concurrently by MPI net");
+
+bool MPINetWrapper::zero_copy_send() {
+  return MV_CONFIG_mpi_zero_copy_send;
+}
+
+int MPINetWrapper::send_window() {
+  CHECK(MV_CONFIG_mpi_send_window > 0);
+  return MV_CONFIG_mpi_send_window;
+}
+
 template void MPINetWrapper::Allreduce<char>(char*, size_t);
 template void MPINetWrapper::Allreduce<int>(int*, size_t);
 template void MPINetWrapper::Allreduce<float>(float*, size_t);
@@ -1,8 +1,10 @@
 #include "multiverso/server.h"
 
 #include <algorithm>
+#include <atomic>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "multiverso/actor.h"
@@ -10,8 +12,11 @@
 #include "multiverso/multiverso.h"
 #include "multiverso/table_interface.h"
 #include "multiverso/io/io.h"
+#include "multiverso/io/snapshot.h"
+#include "multiverso/updater/updater.h"
 #include "multiverso/util/configure.h"
 #include "multiverso/util/mt_queue.h"
+#include "multiverso/util/waiter.h"
 #include "multiverso/zoo.h"
 
 
@@ -19,14 +24,56 @@ namespace multiverso {
 
 MV_DEFINE_bool(sync, false, "sync or async");
 MV_DEFINE_int(backup_worker_ratio, 0, "ratio% of backup workers, set 20 means 20%");
+MV_DEFINE_int(server_threads, 1, "#threads of server, each owns a range of every matrix / array table");
 
-Server::Server() : Actor(actor::kServer) {
+class Server::Executor {
+public:
+  Executor() : thread_(&Executor::Main, this) {}
+
+  // finish the queued tasks and exit
+  ~Executor() {
+    tasks_.Exit();
+    thread_.join();
+  }
+
+  void Push(std::function<void()>& task) { tasks_.Push(task); }
+
+private:
+  void Main() {
+    // the executors already run the shards in parallel
+    SetSerialUpdates(true);
+    std::function<void()> task;
+    while (tasks_.Pop(task)) task();
+  }
+
+  MtQueue<std::function<void()>> tasks_;
+  std::thread thread_;
+};
+
+Server::Server() : Actor(actor::kServer), next_held_id_(0) {
   RegisterHandler(MsgType::Request_Get, std::bind(
     &Server::ProcessGet, this, std::placeholders::_1));
   RegisterHandler(MsgType::Request_Add, std::bind(
     &Server::ProcessAdd, this, std::placeholders::_1));
+  RegisterHandler(MsgType::Server_Merge, std::bind(
+    &Server::ProcessMerge, this, std::placeholders::_1));
+  RegisterHandler(MsgType::Server_Merge_Reply, std::bind(
+    &Server::ProcessMergeReply, this, std::placeholders::_1));
+  RegisterHandler(MsgType::Server_Checkpoint, std::bind(
+    &Server::ProcessCheckpoint, this, std::placeholders::_1));
+  RegisterHandler(MsgType::Server_Restore, std::bind(
+    &Server::ProcessRestore, this, std::placeholders::_1));
+  CHECK(MV_CONFIG_server_threads > 0);
+  if (MV_CONFIG_server_threads > 1) {
+    Log::Info("Server runs %d executor threads\n", MV_CONFIG_server_threads);
+    for (int i = 0; i < MV_CONFIG_server_threads; ++i) {
+      executors_.push_back(std::unique_ptr<Executor>(new Executor()));
+    }
+  }
 }
 
+Server::~Server() {}
+
 int Server::RegisterTable(ServerTable* server_table) {
   int id = static_cast<int>(store_.size());
   store_.push_back(server_table);
@@ -39,8 +86,19 @@ void Server::ProcessGet(MessagePtr& msg) {
     MessagePtr reply(msg->CreateReplyMessage());
     int table_id = msg->table_id();
     CHECK(table_id >= 0 && table_id < static_cast<int>(store_.size()));
-    store_[table_id]->ProcessGet(msg->data(), &reply->data());
-    SendTo(actor::kCommunicator, reply);
+    ServerTable* table = store_[table_id];
+    if (!executors_.empty() && table->shardable()) {
+      table->PrepareGet(msg->data(), &reply->data());
+      Dispatch(table, msg, reply, [table](Message* msg, Message* reply,
+                                          const Shard& shard) {
+        table->ProcessGetShard(msg->data(), &reply->data(), shard);
+      }, [table](Message* msg, Message* reply) {
+        table->FinishGet(msg->data(), &reply->data());
+      });
+    } else {
+      table->ProcessGet(msg->data(), &reply->data());
+      Reply(table, reply);
+    }
   }
   MONITOR_END(SERVER_PROCESS_GET);
 }
@@ -51,12 +109,158 @@ void Server::ProcessAdd(MessagePtr& msg) {
     MessagePtr reply(msg->CreateReplyMessage());
     int table_id = msg->table_id();
     CHECK(table_id >= 0 && table_id < static_cast<int>(store_.size()));
-    store_[table_id]->ProcessAdd(msg->data());
-    SendTo(actor::kCommunicator, reply);
+    ServerTable* table = store_[table_id];
+    table->PrepareAdd(&msg->data());
+    if (!executors_.empty() && table->shardable()) {
+      Dispatch(table, msg, reply, [table](Message* msg, Message*,
+                                          const Shard& shard) {
+        table->ProcessAddShard(msg->data(), shard);
+      });
+    } else {
+      table->ProcessAdd(msg->data());
+      Reply(table, reply);
+    }
   }
   MONITOR_END(SERVER_PROCESS_ADD)
 }
 
+void Server::Reply(ServerTable* table, MessagePtr& reply) {
+  std::unordered_map<int, std::vector<Blob>> messages;
+  table->TakeServerMessages(&messages);
+  if (messages.empty()) {
+    SendTo(actor::kCommunicator, reply);
+    return;
+  }
+  int id = next_held_id_++;
+  for (auto& it : messages) {
+    MessagePtr msg(new Message());
+    msg->set_src(Zoo::Get()->rank());
+    msg->set_dst(it.first);
+    msg->set_type(MsgType::Server_Merge);
+    msg->set_table_id(reply->table_id());
+    msg->set_msg_id(id);
+    msg->set_data(it.second);
+    SendTo(actor::kCommunicator, msg);
+  }
+  HeldReply& held = held_replies_[id];
+  held.reply = std::move(reply);
+  held.remaining = messages.size();
+}
+
+void Server::ProcessMerge(MessagePtr& msg) {
+  MessagePtr reply(msg->CreateReplyMessage());
+  reply->set_type(MsgType::Server_Merge_Reply);
+  int table_id = msg->table_id();
+  CHECK(table_id >= 0 && table_id < static_cast<int>(store_.size()));
+  store_[table_id]->ProcessServerMessage(msg->data(), &reply->data());
+  SendTo(actor::kCommunicator, reply);
+}
+
+void Server::ProcessMergeReply(MessagePtr& msg) {
+  int table_id = msg->table_id();
+  CHECK(table_id >= 0 && table_id < static_cast<int>(store_.size()));
+  store_[table_id]->ProcessServerReply(msg->data());
+  auto it = held_replies_.find(msg->msg_id());
+  CHECK(it != held_replies_.end());
+  if (--it->second.remaining == 0) {
+    SendTo(actor::kCommunicator, it->second.reply);
+    held_replies_.erase(it);
+  }
+}
+
+void Server::ProcessCheckpoint(MessagePtr& msg) {
+  CHECK(msg->data().size() == 2);
+  std::string uri(msg->data()[0].data(), msg->data()[0].size());
+  Waiter* waiter = msg->data()[1].As<Waiter*>();
+  // the snapshots hold the requests received so far
+  Drain();
+  int server_id = Zoo::Get()->server_rank();
+  for (int i = 0; i < static_cast<int>(store_.size()); ++i) {
+    Stream* stream = StreamFactory::GetStream(
+      URI(SnapshotPath(uri, i, server_id)), FileOpenMode::BinaryWrite);
+    store_[i]->StartCheckpoint(stream);
+  }
+  waiter->Notify();
+}
+
+void Server::ProcessRestore(MessagePtr& msg) {
+  CHECK(msg->data().size() == 2);
+  std::string uri(msg->data()[0].data(), msg->data()[0].size());
+  Waiter* waiter = msg->data()[1].As<Waiter*>();
+  Drain();
+  for (int i = 0; i < static_cast<int>(store_.size()); ++i) {
+    // the number of servers that took the checkpoint is in any snapshot
+    int num_snapshots;
+    {
+      std::unique_ptr<Stream> stream(OpenSnapshot(uri, i, 0));
+      num_snapshots = SnapshotReader(stream.get()).header().num_servers;
+    }
+    std::vector<std::unique_ptr<Stream>> streams;
+    std::vector<Stream*> snapshots;
+    for (int server_id = 0; server_id < num_snapshots; ++server_id) {
+      streams.push_back(std::unique_ptr<Stream>(
+        OpenSnapshot(uri, i, server_id)));
+      snapshots.push_back(streams.back().get());
+    }
+    store_[i]->Restore(snapshots);
+  }
+  waiter->Notify();
+}
+
+Stream* Server::OpenSnapshot(const std::string& uri, int table_id,
+                             int server_id) {
+  Stream* stream = StreamFactory::GetStream(
+    URI(SnapshotPath(uri, table_id, server_id)), FileOpenMode::BinaryRead);
+  if (!stream->Good()) {
+    Log::Fatal("Failed to restore table %d from %s, no snapshot of server "
+               "%d\n", table_id, uri.c_str(), server_id);
+  }
+  return stream;
+}
+
+void Server::WaitCheckpoint() {
+  for (auto table : store_) table->WaitCheckpoint();
+}
+
+void Server::Drain() {
+  if (executors_.empty()) return;
+  Waiter waiter(static_cast<int>(executors_.size()));
+  for (auto& executor : executors_) {
+    std::function<void()> task = [&waiter]() { waiter.Notify(); };
+    executor->Push(task);
+  }
+  waiter.Wait();
+}
+
+void Server::Dispatch(ServerTable* table, MessagePtr& msg, MessagePtr& reply,
+  const std::function<void(Message*, Message*, const Shard&)>& process,
+  const std::function<void(Message*, Message*)>& finish) {
+  struct ShardedRequest {
+    MessagePtr msg;
+    MessagePtr reply;
+    std::vector<Shard> shards;
+    std::atomic<int> remaining;
+  };
+  int num_shards = static_cast<int>(executors_.size());
+  std::shared_ptr<ShardedRequest> request(new ShardedRequest());
+  table->SplitShards(msg->data(), num_shards, &request->shards);
+  CHECK(request->shards.size() == executors_.size());
+  request->msg = std::move(msg);
+  request->reply = std::move(reply);
+  request->remaining = num_shards;
+  for (int shard = 0; shard < num_shards; ++shard) {
+    std::function<void()> task = [this, request, process, finish, shard]() {
+      process(request->msg.get(), request->reply.get(),
+              request->shards[shard]);
+      if (--request->remaining == 0) {
+        if (finish) finish(request->msg.get(), request->reply.get());
+        SendTo(actor::kCommunicator, request->reply);
+      }
+    };
+    executors_[shard]->Push(task);
+  }
+}
+
 
 // The Sync Server implement logic to support Sync SGD training
 // The implementation assumes all the workers will call same number
@@ -3,6 +3,7 @@
 #include <mutex>
 
 #include "multiverso/dashboard.h"
+#include "multiverso/io/io.h"
 #include "multiverso/updater/updater.h"
 #include "multiverso/util/log.h"
 #include "multiverso/util/waiter.h"
@@ -17,6 +18,7 @@ WorkerTable::WorkerTable() {
 }
 
 WorkerTable::~WorkerTable() {
+  Zoo::Get()->DeregisterTable(table_id_);
   delete m_;
 }
 
@@ -24,6 +26,37 @@ ServerTable::ServerTable() {
   Zoo::Get()->RegisterTable(this);
 }
 
+void ServerTable::SplitShards(const std::vector<Blob>&, int num_shards,
+                              std::vector<Shard>* shards) const {
+  for (int i = 0; i < num_shards; ++i) shards->push_back(Shard(i, num_shards));
+}
+
+void ServerTable::PrepareGet(const std::vector<Blob>&, std::vector<Blob>*) {
+  Log::Fatal("Sharded processing is not supported by this table\n");
+}
+
+void ServerTable::ProcessGetShard(const std::vector<Blob>&,
+                                  std::vector<Blob>*, const Shard&) {
+  Log::Fatal("Sharded processing is not supported by this table\n");
+}
+
+void ServerTable::ProcessAddShard(const std::vector<Blob>&, const Shard&) {
+  Log::Fatal("Sharded processing is not supported by this table\n");
+}
+
+void ServerTable::StartCheckpoint(Stream* stream) {
+  Store(stream);
+  delete stream;
+}
+
+void ServerTable::Restore(const std::vector<Stream*>& snapshots) {
+  if (static_cast<int>(snapshots.size()) != Zoo::Get()->num_servers()) {
+    Log::Fatal("Checkpoint of %d servers, this table is restored on as "
+               "many servers only\n", static_cast<int>(snapshots.size()));
+  }
+  Load(snapshots[Zoo::Get()->server_rank()]);
+}
+
 void WorkerTable::Get(Blob keys, 
                       const GetOption* option) {
   MONITOR_BEGIN(WORKER_TABLE_SYNC_GET)
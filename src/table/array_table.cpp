@@ -1,28 +1,50 @@
 #include "multiverso/table/array_table.h"
 
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+
 #include "multiverso/io/io.h"
 #include "multiverso/multiverso.h"
 #include "multiverso/util/log.h"
+#include "multiverso/util/quantization_util.h"
 #include "multiverso/updater/updater.h"
 
 namespace multiverso {
 
 template <typename T>
-ArrayWorker<T>::ArrayWorker(size_t size) : WorkerTable(), size_(size) {
+ArrayWorker<T>::ArrayWorker(size_t size, const PartitionOption& partition) :
+  WorkerTable(), size_(size),
+  partition_(partition, static_cast<int64_t>(size), MV_NumServers()),
+  version_block_size_(0), one_bit_block_(0) {
   num_server_ = MV_NumServers();
-  server_offsets_.push_back(0);
   CHECK(size_ > MV_NumServers());
-  integer_t length = static_cast<integer_t>(size_) / MV_NumServers();
-  for (auto i = 1; i < MV_NumServers(); ++i) {
-    server_offsets_.push_back(i * length); // may not balance
+  if (!partition_.contiguous()) {
+    Log::Fatal("arrayTable needs a range partition.\n");
   }
-  server_offsets_.push_back(size_);
   Log::Debug("worker %d create arrayTable with %d elements.\n", MV_Rank(), size);
 }
 
 template <typename T>
 ArrayWorker<T>::ArrayWorker(const ArrayTableOption<T> &option)
-: ArrayWorker<T>(option.size) {
+: ArrayWorker<T>(option.size, option.partition) {
+  version_block_size_ = option.version_block_size;
+  if (version_block_size_ > 0) {
+    mirror_.resize(size_);
+    block_version_.resize(num_server_);
+    for (int i = 0; i < num_server_; ++i) {
+      size_t server_size = static_cast<size_t>(partition_.size(i));
+      block_version_[i].assign((server_size + version_block_size_ - 1) /
+        version_block_size_, BlockVersions::kNever);
+    }
+  }
+  if (option.one_bit_block > 0) {
+    if (!std::is_floating_point<T>::value) {
+      Log::Fatal("1-bit Adds need a float arrayTable.\n");
+    }
+    one_bit_block_ = option.one_bit_block;
+    add_residual_.assign(size_, 0);
+  }
 }
 
 template <typename T>
@@ -70,37 +92,77 @@ int ArrayWorker<T>::Partition(const std::vector<Blob>& kv,
   MsgType,
   std::unordered_map<int, std::vector<Blob> >* out) {
   CHECK(kv.size() == 1 || kv.size() == 2 || kv.size() == 3);
-  for (int i = 0; i < num_server_; ++i) (*out)[i].push_back(kv[0]);
-  if (kv.size() >= 2) {
-    CHECK(kv[1].size() == size_ * sizeof(T));
-    for (int i = 0; i < num_server_; ++i) {
-      Blob blob(kv[1].data() + server_offsets_[i] * sizeof(T),
-        (server_offsets_[i + 1] - server_offsets_[i]) * sizeof(T));
-      (*out)[i].push_back(blob);
+  if (kv.size() >= 2) CHECK(kv[1].size() == size_ * sizeof(T));
+  OneBitsFilter<T, integer_t> filter(std::max<size_t>(one_bit_block_, 1),
+                                     &add_residual_, kv.size() == 3);
+  for (int i = 0; i < num_server_; ++i) {
+    // no message to the servers without elements
+    if (partition_.size(i) == 0) continue;
+    std::vector<Blob>& blobs = (*out)[MV_ServerIdToRank(i)];
+    blobs.push_back(kv[0]);
+    if (kv.size() >= 2) {
+      blobs.push_back(Blob(kv[1].data() + partition_.begin(i) * sizeof(T),
+        partition_.size(i) * sizeof(T)));
       if (kv.size() == 3) {// update option blob
-        (*out)[i].push_back(kv[2]);
+        blobs.push_back(kv[2]);
       }
+      if (one_bit_block_ > 0) {
+        std::vector<Blob> compressed;
+        filter.FilterIn(blobs, static_cast<size_t>(partition_.begin(i)),
+                        &compressed);
+        blobs.swap(compressed);
+      }
+    } else if (version_block_size_ > 0) {
+      blobs.push_back(Blob(block_version_[i].data(),
+        block_version_[i].size() * sizeof(int64_t)));
     }
   }
-  return num_server_;
+  return static_cast<int>(out->size());
 }
 
 template <typename T>
 void ArrayWorker<T>::ProcessReplyGet(std::vector<Blob>& reply_data) {
+  if (reply_data.size() == 4) {
+    ProcessReplyVersionedGet(reply_data);
+    return;
+  }
   CHECK(reply_data.size() == 2);
   int id = (reply_data[0]).As<int>();
-  CHECK(reply_data[1].size<T>() == (server_offsets_[id + 1] - server_offsets_[id]));
+  CHECK(static_cast<int64_t>(reply_data[1].size<T>()) == partition_.size(id));
 
-  memcpy(data_ + server_offsets_[id], reply_data[1].data(), reply_data[1].size());
+  memcpy(data_ + partition_.begin(id), reply_data[1].data(),
+         reply_data[1].size());
 }
 
 template <typename T>
-ArrayServer<T>::ArrayServer(size_t size) : ServerTable() {
-  server_id_ = MV_Rank();
-  size_ = size / MV_NumServers();
-  if (server_id_ == MV_NumServers() - 1) { // last server 
-    size_ += size % MV_NumServers();
+void ArrayWorker<T>::ProcessReplyVersionedGet(std::vector<Blob>& reply_data) {
+  int id = static_cast<int>(reply_data[3].As<int64_t>(0));
+  int64_t version = reply_data[3].As<int64_t>(1);
+  T* values = reinterpret_cast<T*>(reply_data[1].data());
+  size_t begin = static_cast<size_t>(partition_.begin(id));
+  size_t end = static_cast<size_t>(partition_.end(id));
+  // update the local copy with the blocks that changed on the server, then
+  // hand out the whole range of the server from it
+  for (integer_t* block = reinterpret_cast<integer_t*>(reply_data[2].data());
+       *block != -1; ++block) {
+    size_t first = begin + *block * version_block_size_;
+    size_t count = std::min(version_block_size_, end - first);
+    memcpy(mirror_.data() + first, values, count * sizeof(T));
+    values += count;
   }
+  std::fill(block_version_[id].begin(), block_version_[id].end(), version);
+  memcpy(data_ + begin, mirror_.data() + begin, (end - begin) * sizeof(T));
+}
+
+template <typename T>
+ArrayServer<T>::ArrayServer(size_t size, const PartitionOption& partition) :
+  ServerTable(), partition_(partition, static_cast<int64_t>(size),
+                            MV_NumServers()), one_bit_block_(0) {
+  server_id_ = MV_ServerId();
+  CHECK(server_id_ != -1);
+  // the elements the workers send here, see ArrayWorker::Partition
+  CHECK(partition_.contiguous());
+  size_ = static_cast<size_t>(partition_.size(server_id_));
   storage_.resize(size_);
   updater_ = Updater<T>::GetUpdater(size_);
   Log::Debug("server %d create arrayTable with %d elements of %d elements.\n", 
@@ -109,11 +171,52 @@ ArrayServer<T>::ArrayServer(size_t size) : ServerTable() {
 
 template <typename T>
 ArrayServer<T>::ArrayServer(const ArrayTableOption<T> &option) 
-: ArrayServer<T>(option.size) {
+: ArrayServer<T>(option.size, option.partition) {
+  versions_.Init(size_, option.version_block_size);
+  one_bit_block_ = option.one_bit_block;
 }
 
 template <typename T>
 void ArrayServer<T>::ProcessAdd(const std::vector<Blob>& data) {
+  ProcessAddShard(data, Shard(0, 1));
+}
+
+template <typename T>
+void ArrayServer<T>::PrepareAdd(std::vector<Blob>* data) {
+  if (one_bit_block_ == 0) return;
+  OneBitsFilter<T, integer_t> filter(one_bit_block_, nullptr,
+                                     data->size() == 4);
+  std::vector<Blob> restored;
+  filter.FilterOut(*data, &restored);
+  data->swap(restored);
+}
+
+template <typename T>
+void ArrayServer<T>::ProcessGet(const std::vector<Blob>& data,
+  std::vector<Blob>* result) {
+  PrepareGet(data, result);
+  ProcessGetShard(data, result, Shard(0, 1));
+  FinishGet(data, result);
+}
+
+template <typename T>
+void ArrayServer<T>::ShardRange(int shard, int num_shards,
+  size_t* begin, size_t* end) const {
+  // a version block is stamped and read by a single shard
+  *begin = std::min(versions_.AlignUp(size_ * shard / num_shards), size_);
+  *end = std::min(versions_.AlignUp(size_ * (shard + 1) / num_shards), size_);
+}
+
+template <typename T>
+void ArrayServer<T>::BlockRange(size_t block,
+  size_t* begin, size_t* end) const {
+  *begin = block * versions_.block_size();
+  *end = std::min(*begin + versions_.block_size(), size_);
+}
+
+template <typename T>
+void ArrayServer<T>::ProcessAddShard(const std::vector<Blob>& data,
+  const Shard& shard) {
   Blob keys = data[0], values = data[1];
   AddOption* option = nullptr;
   if (data.size() == 3)
@@ -122,32 +225,140 @@ void ArrayServer<T>::ProcessAdd(const std::vector<Blob>& data) {
   CHECK(keys.size<integer_t>() == 1 && keys.As<integer_t>() == -1); 
   CHECK(values.size() == size_ * sizeof(T));
   T* pvalues = reinterpret_cast<T*>(values.data());
-  updater_->Update(size_, storage_.data(), pvalues, option);
+  size_t begin, end;
+  ShardRange(shard.id, shard.num_shards, &begin, &end);
+  checkpoint_.BeforeWrite(begin * sizeof(T), (end - begin) * sizeof(T));
+  updater_->Update(end - begin, storage_.data(), pvalues + begin, option, begin);
+  if (versions_.enabled() && begin < end) {
+    int64_t version = versions_.Tick();
+    bool skip_zero = updater_->ignores_zero_delta();
+    for (size_t b = versions_.block(begin); b <= versions_.block(end - 1);
+         ++b) {
+      size_t first, last;
+      BlockRange(b, &first, &last);
+      if (skip_zero && std::all_of(pvalues + first, pvalues + last,
+                                   [](T v) { return v == 0; })) continue;
+      versions_.Stamp(b, version);
+    }
+  }
   delete option;
 }
 
 template <typename T>
-void ArrayServer<T>::ProcessGet(const std::vector<Blob>& data,
+void ArrayServer<T>::PrepareGet(const std::vector<Blob>& data,
   std::vector<Blob>* result) {
   size_t key_size = data[0].size<integer_t>();
   CHECK(key_size == 1 && data[0].As<integer_t>() == -1); 
   // Always request the whole table
   Blob key(sizeof(integer_t)); key.As<integer_t>() = server_id_;
   Blob values(sizeof(T) * size_);
-  T* pvalues = reinterpret_cast<T*>(values.data());
-  updater_->Access(size_, storage_.data(), pvalues);
   result->push_back(key);
   result->push_back(values);
+  // versioned: one changed flag per block and {server id, version},
+  // compacted by FinishGet
+  if (data.size() == 2) {
+    CHECK(versions_.enabled());
+    CHECK(data[1].size<int64_t>() == versions_.num_blocks());
+    Blob changed(versions_.num_blocks());
+    memset(changed.data(), 0, changed.size());
+    result->push_back(changed);
+    Blob info(2 * sizeof(int64_t));
+    info.As<int64_t>(0) = server_id_;
+    // a lower bound, as in MatrixServerTable::PrepareGet
+    info.As<int64_t>(1) = versions_.clock();
+    result->push_back(info);
+  }
+}
+
+template <typename T>
+void ArrayServer<T>::ProcessGetShard(const std::vector<Blob>& data,
+  std::vector<Blob>* result, const Shard& shard) {
+  T* pvalues = reinterpret_cast<T*>((*result)[1].data());
+  size_t begin, end;
+  ShardRange(shard.id, shard.num_shards, &begin, &end);
+  if (data.size() == 1) {
+    updater_->Access(end - begin, storage_.data(), pvalues + begin, begin);
+    return;
+  }
+  const int64_t* known = reinterpret_cast<const int64_t*>(data[1].data());
+  char* changed = (*result)[2].data();
+  for (size_t b = versions_.block(begin); begin < end &&
+       b <= versions_.block(end - 1); ++b) {
+    if (!versions_.ChangedSince(b, known[b])) continue;
+    size_t first, last;
+    BlockRange(b, &first, &last);
+    updater_->Access(last - first, storage_.data(), pvalues + first, first);
+    changed[b] = 1;
+  }
+}
+
+template <typename T>
+void ArrayServer<T>::FinishGet(const std::vector<Blob>& data,
+  std::vector<Blob>* result) {
+  if (data.size() != 2) return;
+  // move the changed blocks to the front of the values, in block order,
+  // and replace the flags by the list of changed blocks. As in
+  // MatrixServerTable, the list ends with -1 and at least one value is
+  // sent so that no blob is empty
+  Blob& values = (*result)[1];
+  const char* flags = (*result)[2].data();
+  std::vector<integer_t> changed;
+  size_t used = 0;
+  for (size_t b = 0; b < versions_.num_blocks(); ++b) {
+    if (!flags[b]) continue;
+    size_t first, last;
+    BlockRange(b, &first, &last);
+    if (first * sizeof(T) != used) {
+      memmove(values.data() + used, values.data() + first * sizeof(T),
+              (last - first) * sizeof(T));
+    }
+    used += (last - first) * sizeof(T);
+    changed.push_back(static_cast<integer_t>(b));
+  }
+  changed.push_back(-1);
+  values = Blob(values, 0, std::max(used, sizeof(T)));
+  (*result)[2] = Blob(changed.data(), changed.size() * sizeof(integer_t));
 }
 
 template <typename T>
 void ArrayServer<T>::Store(Stream* s) {
-  s->Write(storage_.data(), storage_.size() * sizeof(T));
+  SnapshotWriter writer(s, Layout());
+  writer.Write(storage_.data(), storage_.size() * sizeof(T));
+  writer.Finish();
 }
 
 template <typename T>
 void ArrayServer<T>::Load(Stream* s) {
-  s->Read(storage_.data(), storage_.size() * sizeof(T));
+  Restore(std::vector<Stream*>(1, s));
+}
+
+// the elements are the rows of a one column snapshot
+template <typename T>
+void ArrayServer<T>::Restore(const std::vector<Stream*>& snapshots) {
+  checkpoint_.Wait();
+  ReadSnapshotRows(Layout(), snapshots, storage_.data());
+  if (versions_.enabled()) versions_.StampAll(versions_.Tick());
+}
+
+template <typename T>
+void ArrayServer<T>::StartCheckpoint(Stream* s) {
+  checkpoint_.Start(s, Layout(), storage_.data(),
+                    storage_.size() * sizeof(T));
+}
+
+template <typename T>
+SnapshotHeader ArrayServer<T>::Layout() const {
+  SnapshotHeader header;
+  header.table_type = static_cast<uint32_t>(SnapshotTable::kArray);
+  header.element_type = SnapshotElementType<T>();
+  header.server_id = server_id_;
+  header.num_servers = partition_.num_servers();
+  header.num_rows = static_cast<uint64_t>(partition_.num_keys());
+  header.num_cols = 1;
+  header.begin = static_cast<uint64_t>(partition_.begin(server_id_));
+  header.end = static_cast<uint64_t>(partition_.end(server_id_));
+  header.payload_bytes = storage_.size() * sizeof(T);
+  return header;
 }
 
 MV_INSTANTIATE_CLASS_WITH_BASE_TYPE(ArrayWorker);
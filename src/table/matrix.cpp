@@ -13,38 +13,20 @@ namespace multiverso {
 
 template <typename T>
 MatrixWorker<T>::MatrixWorker(const MatrixOption<T>& option) :
-MatrixWorker(option.num_row, option.num_col, option.is_sparse) {}
+MatrixWorker(option.num_row, option.num_col, option.is_sparse,
+             option.partition) {}
 
 template <typename T>
-MatrixWorker<T>::MatrixWorker(integer_t num_row, integer_t num_col, bool is_sparse) :
-WorkerTable(), num_row_(num_row), num_col_(num_col), is_sparse_(is_sparse) {
+MatrixWorker<T>::MatrixWorker(integer_t num_row, integer_t num_col,
+  bool is_sparse, const PartitionOption& partition) :
+WorkerTable(), num_row_(num_row), num_col_(num_col),
+partition_(partition, num_row, MV_NumServers()), is_sparse_(is_sparse) {
   row_size_ = num_col * sizeof(T);
   get_reply_count_ = 0;
-
-  num_server_ = MV_NumServers();
-  // compute row offsets in all servers
-  server_offsets_.push_back(0);
-  integer_t length = num_row / num_server_;
-  integer_t offset = length;
-  if (length > 0) {
-    int i = 0;
-    while (length > 0 && offset < num_row && ++i < num_server_) {
-      server_offsets_.push_back(offset);
-      offset += length;
-    }
-    server_offsets_.push_back(num_row);
-  }
-  else {
-    int i = 0;
-    offset += 1;
-    while (offset < num_row && ++i < num_server_) {
-      server_offsets_.push_back(offset);
-      offset += 1;
-    }
-    server_offsets_.push_back(num_row);
+  if (!partition_.contiguous()) {
+    Log::Fatal("[Init] matrixTable needs a range partition.\n");
   }
-  // using actual number of servers
-  num_server_ = static_cast<int>(server_offsets_.size() - 1);
+  num_server_ = partition_.num_servers();
 
   Log::Debug("[Init] worker =  %d, type = matrixTable, size =  [ %d x %d ].\n",
     MV_Rank(), num_row, num_col);
@@ -55,7 +37,6 @@ WorkerTable(), num_row_(num_row), num_col_(num_col), is_sparse_(is_sparse) {
 
 template <typename T>
 MatrixWorker<T>::~MatrixWorker() {
-  server_offsets_.clear();
   delete[]row_index_;
 }
 
@@ -257,16 +238,19 @@ int MatrixWorker<T>::Partition(const std::vector<Blob>& kv,
 
 
   if (keys_size == 1 && keys[0] == -1) {
+    // no message to the servers without rows
     for (auto i = 0; i < num_server_; ++i) {
+      if (partition_.size(i) == 0) continue;
       int rank = MV_ServerIdToRank(i);
       (*out)[rank].push_back(kv[0]);
     }
 
     if (partition_type == MsgType::Request_Add) {
       for (integer_t i = 0; i < num_server_; ++i) {
+        if (partition_.size(i) == 0) continue;
         int rank = MV_ServerIdToRank(i);
-        Blob blob(kv[1].data() + server_offsets_[i] * row_size_,
-          (server_offsets_[i + 1] - server_offsets_[i]) * row_size_);
+        Blob blob(kv[1].data() + partition_.begin(i) * row_size_,
+          partition_.size(i) * row_size_);
         (*out)[rank].push_back(blob);
         if (kv.size() == 3) {  // adding update options
           (*out)[rank].push_back(kv[2]);
@@ -275,6 +259,7 @@ int MatrixWorker<T>::Partition(const std::vector<Blob>& kv,
     }
     else if (partition_type == MsgType::Request_Get) {
       for (auto i = 0; i < num_server_; ++i) {
+        if (partition_.size(i) == 0) continue;
         int rank = MV_ServerIdToRank(i);
         if (kv.size() == 2) {  // adding update options
           (*out)[rank].push_back(kv[1]);
@@ -290,10 +275,8 @@ int MatrixWorker<T>::Partition(const std::vector<Blob>& kv,
   std::vector<int> dest;
   std::vector<integer_t> count;
   count.resize(num_server_, 0);
-  integer_t num_row_each = num_row_ / num_server_;
   for (auto i = 0; i < keys_size; ++i) {
-    int dst = keys[i] / num_row_each;
-    dst = (dst >= num_server_ ? num_server_ - 1 : dst);
+    int dst = partition_.Server(keys[i]);
     dest.push_back(dst);
     ++count[dst];
   }
@@ -360,8 +343,8 @@ void MatrixWorker<T>::ProcessReplyGet(std::vector<Blob>& reply_data) {
   if (keys_size == 1 && keys[0] == -1) {
     int server_id = reply_data[2].As<int>();
     CHECK_NOTNULL(row_index_[num_row_]);
-    CHECK(server_id < server_offsets_.size() - 1);
-    memcpy(row_index_[num_row_] + server_offsets_[server_id] * num_col_,
+    CHECK(server_id < num_server_);
+    memcpy(row_index_[num_row_] + partition_.begin(server_id) * num_col_,
       data, reply_data[1].size());
   }
   else {
@@ -378,26 +361,21 @@ void MatrixWorker<T>::ProcessReplyGet(std::vector<Blob>& reply_data) {
 
 template <typename T>
 MatrixServer<T>::MatrixServer(const MatrixOption<T>& option) :
-MatrixServer(option.num_row, option.num_col, option.is_sparse, option.is_pipeline) {}
+MatrixServer(option.num_row, option.num_col, option.is_sparse, option.is_pipeline,
+             option.partition) {}
 
 template <typename T>
 MatrixServer<T>::MatrixServer(integer_t num_row, integer_t num_col,
-  bool is_sparse, bool is_use_pipeline) :
-  ServerTable(), num_col_(num_col), is_sparse_(is_sparse) {
+  bool is_sparse, bool is_use_pipeline, const PartitionOption& partition) :
+  ServerTable(), num_row_(num_row), num_col_(num_col), is_sparse_(is_sparse) {
   server_id_ = MV_ServerId();
   CHECK(server_id_ != -1);
 
-  integer_t size = num_row / MV_NumServers();
-  if (size > 0) {
-    row_offset_ = size * server_id_;
-    if (server_id_ == MV_NumServers() - 1) {
-      size = num_row - row_offset_;
-    }
-  }
-  else {
-    size = server_id_ < num_row ? 1 : 0;
-    row_offset_ = server_id_;
-  }
+  // the rows the workers send here, see MatrixWorker::Partition
+  PartitionMap rows(partition, num_row, MV_NumServers());
+  CHECK(rows.contiguous());
+  row_offset_ = static_cast<integer_t>(rows.begin(server_id_));
+  integer_t size = static_cast<integer_t>(rows.size(server_id_));
   my_num_row_ = size;
   storage_.resize(my_num_row_ * num_col);
   updater_ = Updater<T>::GetUpdater(my_num_row_ * num_col);
@@ -409,11 +387,7 @@ MatrixServer<T>::MatrixServer(integer_t num_row, integer_t num_col,
     if (is_use_pipeline) {
       workers_nums_ *= 2;
     }
-    up_to_date_ = new bool*[workers_nums_];
-    for (auto i = 0; i < workers_nums_; ++i) {
-      up_to_date_[i] = new bool[my_num_row_];
-      memset(up_to_date_[i], 0, sizeof(bool) * my_num_row_);
-    }
+    up_to_date_.reset(new UpToDateTracker(my_num_row_, workers_nums_));
     Log::Info("[Init] Server = %d, with sparse updater.\n", server_id_);
   }
 }
@@ -437,6 +411,7 @@ void MatrixServer<T>::ProcessAdd(const std::vector<Blob>& data) {
   if (keys_size == 1 && keys[0] == -1) {
     size_t ssize = storage_.size();
     CHECK(ssize == data[1].size<T>());
+    checkpoint_.BeforeWrite(0, ssize * sizeof(T));
     updater_->Update(ssize, storage_.data(), values, option);
     Log::Debug("[ProcessAdd] Server = %d, adding all rows offset = %d, #rows = %d\n",
       server_id_, row_offset_, ssize / num_col_);
@@ -444,13 +419,15 @@ void MatrixServer<T>::ProcessAdd(const std::vector<Blob>& data) {
   else {
     CHECK(data[1].size() == keys_size * sizeof(T) * num_col_);
 
-    integer_t offset_v = 0;
     CHECK(storage_.size() >= keys_size * num_col_);
-    for (auto i = 0; i < keys_size; ++i) {
-      integer_t offset_s = (keys[i] - row_offset_) * num_col_;
-      updater_->Update(num_col_, storage_.data(), values + offset_v, option, offset_s);
-      offset_v += num_col_;
+    std::vector<integer_t> rows(keys_size);
+    for (size_t i = 0; i < keys_size; ++i) rows[i] = keys[i] - row_offset_;
+    for (size_t i = 0; checkpoint_.running() && i < keys_size; ++i) {
+      checkpoint_.BeforeWrite(static_cast<size_t>(rows[i]) * num_col_ *
+                              sizeof(T), num_col_ * sizeof(T));
     }
+    updater_->UpdateRows(keys_size, num_col_, rows.data(),
+      storage_.data(), values, option);
     Log::Debug("[ProcessAdd] Server = %d, adding #rows = %d\n",
       server_id_, keys_size);
   }
@@ -520,18 +497,11 @@ void MatrixServer<T>::UpdateAddState(int,
   integer_t* keys = reinterpret_cast<integer_t*>(keys_blob.data());
 
   if (keys_size == 1 && keys[0] == -1) {
-    for (auto id = 0; id < workers_nums_; ++id) {
-      for (auto local_row_id = 0; local_row_id < this->my_num_row_; ++local_row_id) {
-        up_to_date_[id][local_row_id] = false;
-      }
-    }
+    up_to_date_->InvalidateAll();
   }
   else {
-    for (auto id = 0; id < workers_nums_; ++id) {
-      for (auto i = 0; i < keys_size; ++i) {
-        auto local_row_id = GetPhysicalRow(keys[i]);
-        up_to_date_[id][local_row_id] = false;
-      }
+    for (size_t i = 0; i < keys_size; ++i) {
+      up_to_date_->Invalidate(GetPhysicalRow(keys[i]));
     }
   }
 }
@@ -548,18 +518,15 @@ void MatrixServer<T>::UpdateGetState(int worker_id, integer_t* keys,
 
   if (key_size == 1 && keys[0] == -1) {
     for (auto local_row_id = 0; local_row_id < this->my_num_row_; ++local_row_id)  {
-      if (!up_to_date_[worker_id][local_row_id]) {
+      if (up_to_date_->Refresh(local_row_id, worker_id)) {
         out_rows->push_back(GetLogicalRow(local_row_id));
-        up_to_date_[worker_id][local_row_id] = true;
       }
     }
   }
   else {
     for (auto i = 0; i < key_size; ++i)  {
       auto global_row_id = keys[i];
-      auto local_row_id = GetPhysicalRow(global_row_id);
-      if (!up_to_date_[worker_id][local_row_id]) {
-        up_to_date_[worker_id][local_row_id] = true;
+      if (up_to_date_->Refresh(GetPhysicalRow(global_row_id), worker_id)) {
         out_rows->push_back(global_row_id);
       }
     }
@@ -573,12 +540,43 @@ void MatrixServer<T>::UpdateGetState(int worker_id, integer_t* keys,
 
 template <typename T>
 void MatrixServer<T>::Store(Stream* s) {
-  s->Write(storage_.data(), storage_.size() * sizeof(T));
+  SnapshotWriter writer(s, Layout());
+  writer.Write(storage_.data(), storage_.size() * sizeof(T));
+  writer.Finish();
 }
 
 template <typename T>
 void MatrixServer<T>::Load(Stream* s) {
-  s->Read(storage_.data(), storage_.size() * sizeof(T));
+  Restore(std::vector<Stream*>(1, s));
+}
+
+template <typename T>
+void MatrixServer<T>::Restore(const std::vector<Stream*>& snapshots) {
+  checkpoint_.Wait();
+  ReadSnapshotRows(Layout(), snapshots, storage_.data());
+}
+
+template <typename T>
+void MatrixServer<T>::StartCheckpoint(Stream* s) {
+  checkpoint_.Start(s, Layout(), storage_.data(),
+                    storage_.size() * sizeof(T));
+}
+
+// the same layout as MatrixServerTable, either loads the snapshots of
+// the other
+template <typename T>
+SnapshotHeader MatrixServer<T>::Layout() const {
+  SnapshotHeader header;
+  header.table_type = static_cast<uint32_t>(SnapshotTable::kMatrix);
+  header.element_type = SnapshotElementType<T>();
+  header.server_id = server_id_;
+  header.num_servers = MV_NumServers();
+  header.num_rows = static_cast<uint64_t>(num_row_);
+  header.num_cols = static_cast<uint64_t>(num_col_);
+  header.begin = static_cast<uint64_t>(row_offset_);
+  header.end = static_cast<uint64_t>(row_offset_ + my_num_row_);
+  header.payload_bytes = storage_.size() * sizeof(T);
+  return header;
 }
 
 MV_INSTANTIATE_CLASS_WITH_BASE_TYPE(MatrixWorker);
@@ -1,58 +1,117 @@
 #include "multiverso/table/matrix_table.h"
 
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <type_traits>
 #include <vector>
 
+#include "multiverso/dashboard.h"
 #include "multiverso/io/io.h"
 #include "multiverso/multiverso.h"
+#include "multiverso/util/configure.h"
 #include "multiverso/util/log.h"
 #include "multiverso/util/quantization_util.h"
 #include "multiverso/updater/updater.h"
 
 namespace multiverso {
 
+MV_DECLARE_string(updater_type);
+MV_DECLARE_bool(sync);
+
+namespace {
+
+// dashboard gauges of the add buffers of all matrix tables, their ratio is
+// the merge ratio. Outside the templates so that each is registered once
+void CountAddBufferRows(long long added, long long sent) {
+  GAUGE_ADD(MATRIX_WORKER_ADD_BUFFER_ROWS_ADDED, added);
+  GAUGE_ADD(MATRIX_WORKER_ADD_BUFFER_ROWS_SENT, sent);
+}
+
+// whether the replicas of the hot rows may merge their deltas into the
+// owner in any order, see MatrixTableOption::hot_replicas
+bool CanReplicateRows(integer_t version_block_rows) {
+  return version_block_rows == 0 &&
+    (MV_CONFIG_updater_type == "default" || MV_CONFIG_updater_type == "sgd");
+}
+
+}  // namespace
+
 template <typename T>
 MatrixWorkerTable<T>::MatrixWorkerTable(const MatrixTableOption<T>& option) :
-MatrixWorkerTable(option.num_row, option.num_col) {}
+MatrixWorkerTable(option.num_row, option.num_col, option.partition) {
+  CHECK(option.version_block_rows >= 0);
+  version_block_rows_ = option.version_block_rows;
+  if (version_block_rows_ > 0) {
+    mirror_.resize(static_cast<size_t>(num_row_) * num_col_);
+    row_version_.assign(num_row_, BlockVersions::kNever);
+  }
+  size_t cache_rows = RowCache<T>::RowsIn(option.cache_bytes, num_col_);
+  if (cache_rows > 0) {
+    cache_.reset(new RowCache<T>(num_row_, num_col_, cache_rows,
+                                 option.cache_staleness));
+    Log::Debug("[Init] worker = %d, caching %d rows of matrixTable, "
+      "staleness = %d.\n", MV_Rank(), cache_->capacity(),
+      option.cache_staleness);
+  }
+  CHECK(option.add_buffer_ms >= 0);
+  add_buffer_bytes_ = option.add_buffer_bytes;
+  add_buffer_ms_ = option.add_buffer_ms;
+  if (add_buffer_bytes_ > 0 && (MV_CONFIG_sync ||
+      (MV_CONFIG_updater_type != "default" &&
+       MV_CONFIG_updater_type != "sgd"))) {
+    Log::Error("[Init] worker = %d, the add buffer of matrixTable needs "
+      "async mode and updater default or sgd, disabled.\n", MV_Rank());
+    add_buffer_bytes_ = 0;
+  }
+  CHECK(option.hot_replicas >= 1);
+  if (option.hot_replicas > 1) {
+    if (CanReplicateRows(version_block_rows_) &&
+        hot_.Init(option.hot_replicas, num_server_)) {
+      hot_.Set(option.hot_rows);
+    } else {
+      Log::Error("[Init] worker = %d, the hot rows of matrixTable need async "
+        "mode, updater default or sgd and no versioned Get, not "
+        "replicated.\n", MV_Rank());
+    }
+  }
+  if (option.one_bit_add) {
+    if (!std::is_floating_point<T>::value) {
+      Log::Fatal("[Init] 1-bit Adds need a float matrixTable.\n");
+    }
+    one_bit_add_ = true;
+    add_residual_.assign(static_cast<size_t>(num_row_) * num_col_, 0);
+  }
+}
 
 template <typename T>
-MatrixWorkerTable<T>::MatrixWorkerTable(integer_t num_row, integer_t num_col) :
-  WorkerTable(), num_row_(num_row), num_col_(num_col) {
+MatrixWorkerTable<T>::MatrixWorkerTable(integer_t num_row, integer_t num_col,
+  const PartitionOption& partition) :
+  WorkerTable(), num_row_(num_row), num_col_(num_col),
+  partition_(partition, num_row, MV_NumServers()), version_block_rows_(0), clock_(0), add_buffer_bytes_(0),
+  add_buffer_ms_(0), rows_added_(0), rows_sent_(0), buffered_rows_(0),
+  one_bit_add_(false) {
   row_size_ = num_col * sizeof(T);
-  get_reply_count_ = 0;
-
-  num_server_ = MV_NumServers();
-  //  compute row offsets in all servers
-  server_offsets_.push_back(0);
-  integer_t length = num_row / num_server_;
-  integer_t offset = length;
-  if (length > 0) {
-    int i = 0;
-    while (length > 0 && offset < num_row && ++i < num_server_) {
-      server_offsets_.push_back(offset);
-      offset += length;
-    }
-    server_offsets_.push_back(num_row);
-  } else {
-    int i = 0;
-    offset += 1;
-    while (offset < num_row && ++i < num_server_) {
-      server_offsets_.push_back(offset);
-      offset += 1;
-    }
-    server_offsets_.push_back(num_row);
+  mutex_ = new std::mutex();
+
+  if (!partition_.contiguous()) {
+    Log::Fatal("[Init] matrixTable needs a range partition.\n");
   }
-  // using actual number of servers
-  num_server_ = static_cast<int>(server_offsets_.size() - 1);
+  num_server_ = partition_.num_servers();
 
   Log::Debug("[Init] worker =  %d, type = matrixTable, size =  [ %d x %d ].\n",
     MV_Rank(), num_row, num_col);
-  row_index_ = new T*[num_row_ + 1];
 }
 
 template <typename T>
 MatrixWorkerTable<T>::~MatrixWorkerTable() {
-  server_offsets_.clear();
-  delete[]row_index_;
+  bool buffered;
+  {
+    std::lock_guard<std::mutex> lock(*mutex_);
+    buffered = buffered_rows_ > 0;
+  }
+  if (buffered) Flush();
+  delete mutex_;
 }
 
 template <typename T>
@@ -64,14 +123,7 @@ void MatrixWorkerTable<T>::Get(T* data, size_t size) {
 
 template <typename T>
 void MatrixWorkerTable<T>::Get(integer_t row_id, T* data, size_t size) {
-  if (row_id >= 0) CHECK(size == num_col_);
-  for (auto i = 0; i < num_row_ + 1; ++i) row_index_[i] = nullptr;
-  if (row_id == -1) {
-    row_index_[num_row_] = data;
-  } else {
-    row_index_[row_id] = data;  // data_ = data;
-  }
-  WorkerTable::Get(Blob(&row_id, sizeof(integer_t)));
+  Wait(GetAsync(row_id, data, size));
   Log::Debug("[Get] worker = %d, #row = %d\n", MV_Rank(), row_id);
 }
 
@@ -79,26 +131,14 @@ template <typename T>
 void MatrixWorkerTable<T>::Get(const std::vector<integer_t>& row_ids,
   const std::vector<T*>& data_vec,
   size_t size) {
-  CHECK(size == num_col_);
-  CHECK(row_ids.size() == data_vec.size());
-  for (auto i = 0; i < num_row_ + 1; ++i) row_index_[i] = nullptr;
-  for (auto i = 0; i < row_ids.size(); ++i) {
-    row_index_[row_ids[i]] = data_vec[i];
-  }
-  WorkerTable::Get(Blob(row_ids.data(), sizeof(integer_t)* row_ids.size()));
+  Wait(GetAsync(row_ids, data_vec, size));
   Log::Debug("[Get] worker = %d, #rows_set = %d\n", MV_Rank(), row_ids.size());
 }
 
 template <typename T>
 void MatrixWorkerTable<T>::Get(T* data, size_t size, integer_t* row_ids,
   integer_t row_ids_size) {
-  CHECK(size == num_col_ * row_ids_size);
-  for (auto i = 0; i < num_row_ + 1; ++i) row_index_[i] = nullptr;
-  for (auto i = 0; i < row_ids_size; ++i) {
-    row_index_[row_ids[i]] = &data[i * num_col_];
-  }
-  Blob ids_blob(row_ids, sizeof(integer_t) * row_ids_size);
-  WorkerTable::Get(ids_blob);
+  Wait(GetAsync(data, size, row_ids, row_ids_size));
   Log::Debug("[Get] worker = %d, #rows_set = %d\n", MV_Rank(), row_ids_size);
 }
 
@@ -156,13 +196,13 @@ int MatrixWorkerTable<T>::GetAsync(T* data, size_t size) {
 template <typename T>
 int MatrixWorkerTable<T>::GetAsync(integer_t row_id, T* data, size_t size) {
   if (row_id >= 0) CHECK(size == num_col_);
-  for (auto i = 0; i < num_row_ + 1; ++i) row_index_[i] = nullptr;
+  GetRequest request;
   if (row_id == -1) {
-    row_index_[num_row_] = data;
+    request.whole_table = data;
   } else {
-    row_index_[row_id] = data;  // data_ = data;
+    request.rows[row_id] = data;
   }
-  return WorkerTable::GetAsync(Blob(&row_id, sizeof(integer_t)));
+  return RequestGet(Blob(&row_id, sizeof(integer_t)), std::move(request));
 }
 
 template <typename T>
@@ -171,23 +211,64 @@ int MatrixWorkerTable<T>::GetAsync(const std::vector<integer_t>& row_ids,
   size_t size) {
   CHECK(size == num_col_);
   CHECK(row_ids.size() == data_vec.size());
-  for (auto i = 0; i < num_row_ + 1; ++i) row_index_[i] = nullptr;
+  GetRequest request;
   for (auto i = 0; i < row_ids.size(); ++i) {
-    row_index_[row_ids[i]] = data_vec[i];
+    request.rows[row_ids[i]] = data_vec[i];
   }
-  return WorkerTable::GetAsync(Blob(row_ids.data(), sizeof(integer_t)* row_ids.size()));
+  return RequestGet(Blob(row_ids.data(), sizeof(integer_t)* row_ids.size()),
+                    std::move(request));
 }
 
 template <typename T>
 int MatrixWorkerTable<T>::GetAsync(T* data, size_t size, integer_t* row_ids,
   integer_t row_ids_size) {
   CHECK(size == num_col_ * row_ids_size);
-  for (auto i = 0; i < num_row_ + 1; ++i) row_index_[i] = nullptr;
+  GetRequest request;
   for (auto i = 0; i < row_ids_size; ++i) {
-    row_index_[row_ids[i]] = &data[i * num_col_];
+    request.rows[row_ids[i]] = &data[i * num_col_];
   }
   Blob ids_blob(row_ids, sizeof(integer_t) * row_ids_size);
-  return WorkerTable::GetAsync(ids_blob);
+  return RequestGet(ids_blob, std::move(request));
+}
+
+template <typename T>
+int MatrixWorkerTable<T>::RequestGet(Blob keys, GetRequest request,
+  const GetOption* option) {
+  // the request is registered before the worker actor, which looks it up
+  // under the same lock, can process the Get
+  std::lock_guard<std::mutex> lock(*mutex_);
+  request.clock = clock_;
+  int msg_id = WorkerTable::GetAsync(keys, option);
+  requests_[msg_id] = std::move(request);
+  return msg_id;
+}
+
+template <typename T>
+typename MatrixWorkerTable<T>::GetRequest*
+MatrixWorkerTable<T>::FindRequest(int msg_id) {
+  std::lock_guard<std::mutex> lock(*mutex_);
+  auto it = requests_.find(msg_id);
+  CHECK(it != requests_.end());
+  // the element stays in place while other requests come and go
+  return &it->second;
+}
+
+template <typename T>
+void MatrixWorkerTable<T>::FinishRequest(int msg_id) {
+  std::lock_guard<std::mutex> lock(*mutex_);
+  requests_.erase(msg_id);
+}
+
+template <typename T>
+void MatrixWorkerTable<T>::Clock() {
+  std::lock_guard<std::mutex> lock(*mutex_);
+  ++clock_;
+}
+
+template <typename T>
+int MatrixWorkerTable<T>::clock() const {
+  std::lock_guard<std::mutex> lock(*mutex_);
+  return clock_;
 }
 
 template <typename T>
@@ -231,46 +312,234 @@ int MatrixWorkerTable<T>::AddAsync(T* data, size_t size, integer_t* row_ids,
   return WorkerTable::AddAsync(ids_blob, data_blob, option);
 }
 
+template <typename T>
+void MatrixWorkerTable<T>::Flush() {
+  if (add_buffer_bytes_ == 0) return;
+  // an Add of no rows sends the buffer
+  WorkerTable::Add(Blob(), Blob());
+}
+
+template <typename T>
+void MatrixWorkerTable<T>::MergeReplicas() {
+  Flush();
+  integer_t key = kHotRowsCount;
+  T dummy = 0;
+  WorkerTable::Add(Blob(&key, sizeof(integer_t)), Blob(&dummy, sizeof(T)));
+}
+
+template <typename T>
+std::vector<integer_t> MatrixWorkerTable<T>::HotRows(size_t k) {
+  CHECK(k > 0);
+  std::unordered_map<integer_t, int64_t> counts;
+  GetRequest request;
+  request.counts = &counts;
+  integer_t keys[2] = { kHotRowsCount, static_cast<integer_t>(k) };
+  Wait(RequestGet(Blob(keys, sizeof(keys)), std::move(request)));
+
+  // the counts of a replicated row are summed over its replicas
+  std::vector<std::pair<int64_t, integer_t>> order;
+  for (auto& count : counts) {
+    order.push_back(std::make_pair(-count.second, count.first));
+  }
+  size_t num = std::min(k, order.size());
+  std::partial_sort(order.begin(), order.begin() + num, order.end());
+  std::vector<integer_t> rows;
+  for (size_t i = 0; i < num; ++i) rows.push_back(order[i].second);
+  return rows;
+}
+
+template <typename T>
+void MatrixWorkerTable<T>::ReplicateHotRows(size_t k) {
+  if (!hot_.enabled()) {
+    Log::Error("[ReplicateHotRows] worker = %d, matrixTable replicates no "
+      "rows (option hot_replicas).\n", MV_Rank());
+    return;
+  }
+  // the Adds sent to the old replicas reach the servers first
+  Flush();
+  MV_Barrier();
+  if (MV_WorkerId() == 0) {
+    std::vector<integer_t> keys(1, kHotRowsSet);
+    std::vector<integer_t> rows = HotRows(k);
+    keys.insert(keys.end(), rows.begin(), rows.end());
+    T dummy = 0;
+    WorkerTable::Add(Blob(keys.data(), keys.size() * sizeof(integer_t)),
+                     Blob(&dummy, sizeof(T)));
+  }
+  MV_Barrier();
+  integer_t key = kHotRowsSet;
+  Wait(RequestGet(Blob(&key, sizeof(integer_t)), GetRequest()));
+}
+
+template <typename T>
+double MatrixWorkerTable<T>::add_merge_ratio() const {
+  std::lock_guard<std::mutex> lock(*mutex_);
+  return rows_sent_ == 0 ? 1.0 :
+    static_cast<double>(rows_added_) / rows_sent_;
+}
+
+template <typename T>
+bool MatrixWorkerTable<T>::BufferAdd(const std::vector<Blob>& request,
+  std::vector<Blob>* merged) {
+  size_t keys_size = request[0].size<integer_t>();
+  const integer_t* keys = reinterpret_cast<integer_t*>(request[0].data());
+  const T* values = reinterpret_cast<T*>(request[1].data());
+
+  if (keys_size == 1 && keys[0] == -1) {
+    // the buffered rows join the whole table Add
+    Blob whole(request[1].size());
+    memcpy(whole.data(), values, request[1].size());
+    T* sum = reinterpret_cast<T*>(whole.data());
+    for (size_t i = 0; i < buffer_keys_.size(); ++i) {
+      T* row = sum + static_cast<size_t>(buffer_keys_[i]) * num_col_;
+      const T* delta = buffer_values_.data() + i * num_col_;
+      for (auto j = 0; j < num_col_; ++j) row[j] += delta[j];
+    }
+    merged->push_back(request[0]);
+    merged->push_back(whole);
+    std::lock_guard<std::mutex> lock(*mutex_);
+    buffered_rows_ = 0;
+  } else {
+    if (buffer_keys_.empty()) buffer_timer_.Start();
+    for (size_t i = 0; i < keys_size; ++i) {
+      const T* delta = values + i * num_col_;
+      auto it = buffer_index_.find(keys[i]);
+      if (it == buffer_index_.end()) {
+        buffer_index_[keys[i]] = buffer_keys_.size();
+        buffer_keys_.push_back(keys[i]);
+        buffer_values_.insert(buffer_values_.end(), delta, delta + num_col_);
+        continue;
+      }
+      T* row = buffer_values_.data() + it->second * num_col_;
+      for (auto j = 0; j < num_col_; ++j) row[j] += delta[j];
+    }
+    bool flush = keys_size == 0 ||
+      buffer_values_.size() * sizeof(T) >= add_buffer_bytes_ ||
+      (add_buffer_ms_ > 0 && buffer_timer_.elapse() >= add_buffer_ms_);
+    size_t rows_sent = flush ? buffer_keys_.size() : 0;
+    {
+      std::lock_guard<std::mutex> lock(*mutex_);
+      rows_added_ += keys_size;
+      rows_sent_ += rows_sent;
+      buffered_rows_ = rows_sent > 0 ? 0 : buffer_keys_.size();
+    }
+    CountAddBufferRows(keys_size, rows_sent);
+    if (rows_sent == 0) return false;
+    merged->push_back(Blob(buffer_keys_.data(),
+      buffer_keys_.size() * sizeof(integer_t)));
+    merged->push_back(Blob(buffer_values_.data(),
+      buffer_values_.size() * sizeof(T)));
+  }
+  buffer_index_.clear();
+  buffer_keys_.clear();
+  buffer_values_.clear();
+  return true;
+}
+
 template <typename T>
 int MatrixWorkerTable<T>::Partition(const std::vector<Blob>& kv,
+  MsgType partition_type, std::unordered_map<int, std::vector<Blob>>* out) {
+  return Partition(-1, kv, partition_type, out);
+}
+
+template <typename T>
+int MatrixWorkerTable<T>::Partition(int msg_id,
+  const std::vector<Blob>& request,
   MsgType, std::unordered_map<int, std::vector<Blob>>* out) {
-  CHECK(kv.size() == 1 || kv.size() == 2 || kv.size() == 3);
+  CHECK(request.size() == 1 || request.size() == 2 || request.size() == 3);
   CHECK_NOTNULL(out);
 
+  if (request[0].size<integer_t>() > 0 &&
+      request[0].As<integer_t>(0) < -1) {
+    return PartitionHotRows(msg_id, request, out);
+  }
+  if (cache_ && request.size() >= 2) {
+    UpdateCache(reinterpret_cast<integer_t*>(request[0].data()),
+      request[0].size<integer_t>(), reinterpret_cast<T*>(request[1].data()));
+  }
+  // Adds go through the add buffer, which may keep them back
+  std::vector<Blob> merged;
+  if (add_buffer_bytes_ > 0 && request.size() >= 2 &&
+      !BufferAdd(request, &merged)) {
+    return 0;
+  }
+  const std::vector<Blob>& kv = merged.empty() ? request : merged;
+  GetRequest* get = kv.size() == 1 ? FindRequest(msg_id) : nullptr;
+
   size_t keys_size = kv[0].size<integer_t>();
   integer_t *keys = reinterpret_cast<integer_t*>(kv[0].data());
   if (keys_size == 1 && keys[0] == -1) {
-    // using actual number of servers, so that one don't send message
-    // to empty servers.
+    // no message to the servers without rows
     for (auto i = 0; i < num_server_; ++i) {
+      if (partition_.size(i) == 0) continue;
       int rank = MV_ServerIdToRank(i);
       (*out)[rank].push_back(kv[0]);
     }
     if (kv.size() >= 2) {  // process add values
+      OneBitsFilter<T, integer_t> filter(num_col_, &add_residual_,
+                                         kv.size() == 3);
       for (integer_t i = 0; i < num_server_; ++i){
+        if (partition_.size(i) == 0) continue;
         int rank = MV_ServerIdToRank(i);
-        Blob blob(kv[1].data() + server_offsets_[i] * row_size_,
-          (server_offsets_[i + 1] - server_offsets_[i]) * row_size_);
+        Blob blob(kv[1].data() + partition_.begin(i) * row_size_,
+          partition_.size(i) * row_size_);
         (*out)[rank].push_back(blob);
         if (kv.size() == 3) {  // update option blob
           (*out)[rank].push_back(kv[2]);
         }
+        if (one_bit_add_) {
+          std::vector<Blob> compressed;
+          filter.FilterIn((*out)[rank],
+            static_cast<size_t>(partition_.begin(i)) * num_col_, &compressed);
+          (*out)[rank].swap(compressed);
+        }
       }
     } else {
-      CHECK(get_reply_count_ == 0);
-      get_reply_count_ = static_cast<int>(out->size());
+      if (version_block_rows_ > 0) {
+        // oldest version of the rows of each block of the server
+        for (auto i = 0; i < num_server_; ++i) {
+          if (partition_.size(i) == 0) continue;
+          integer_t begin = static_cast<integer_t>(partition_.begin(i));
+          integer_t end = static_cast<integer_t>(partition_.end(i));
+          integer_t num_blocks = (end - begin + version_block_rows_ - 1) /
+            version_block_rows_;
+          Blob versions(num_blocks * sizeof(int64_t));
+          for (integer_t b = 0; b < num_blocks; ++b) {
+            auto first = row_version_.begin() + begin + b * version_block_rows_;
+            auto last = row_version_.begin() +
+              std::min(begin + (b + 1) * version_block_rows_, end);
+            versions.As<int64_t>(b) = *std::min_element(first, last);
+          }
+          (*out)[MV_ServerIdToRank(i)].push_back(versions);
+        }
+      }
+      get->num_replies = static_cast<int>(out->size());
     }
     return static_cast<int>(out->size());
   }
 
+  // serve the fresh cached rows, only request the others
+  std::vector<integer_t> missing;
+  if (cache_ && kv.size() == 1) {
+    for (size_t i = 0; i < keys_size; ++i) {
+      const T* row = cache_->Find(keys[i], get->clock);
+      if (row == nullptr) {
+        missing.push_back(keys[i]);
+        continue;
+      }
+      memcpy(get->row(keys[i], num_col_), row, row_size_);
+    }
+    keys = missing.data();
+    keys_size = missing.size();
+  }
+
   //count row number in each server
   std::vector<int> dest;
   std::vector<integer_t> count;
   count.resize(num_server_, 0);
-  integer_t num_row_each = num_row_ / num_server_;
-  for (auto i = 0; i < keys_size; ++i){
-    int dst = keys[i] / num_row_each;
-    dst = (dst >= num_server_ ? num_server_ - 1 : dst);
+  int worker = MV_WorkerId();
+  for (size_t i = 0; i < keys_size; ++i){
+    int dst = hot_.Server(keys[i], partition_.Server(keys[i]), worker);
     dest.push_back(dst);
     ++count[dst];
   }
@@ -286,7 +555,7 @@ int MatrixWorkerTable<T>::Partition(const std::vector<Blob>& kv,
   count.resize(num_server_, 0);
 
   integer_t offset = 0;
-  for (auto i = 0; i < keys_size; ++i) {
+  for (size_t i = 0; i < keys_size; ++i) {
     int dst = dest[i];
     int rank = MV_ServerIdToRank(dst);
     (*out)[rank][0].As<integer_t>(count[dst]) = keys[i];
@@ -303,20 +572,105 @@ int MatrixWorkerTable<T>::Partition(const std::vector<Blob>& kv,
       if (kv.size() == 3) {// update option blob
         (*out)[rank].push_back(kv[2]);
       }
+      if (kv.size() == 1 && version_block_rows_ > 0) {
+        // version of each requested row
+        Blob& server_keys = (*out)[rank][0];
+        Blob versions(count[i] * sizeof(int64_t));
+        for (integer_t j = 0; j < count[i]; ++j) {
+          versions.As<int64_t>(j) =
+            row_version_[server_keys.As<integer_t>(j)];
+        }
+        (*out)[rank].push_back(versions);
+      }
     }
   }
 
   if (kv.size() == 1){
-    CHECK(get_reply_count_ == 0);
-    get_reply_count_ = static_cast<int>(out->size());
+    get->num_replies = static_cast<int>(out->size());
+    // all rows were served by the cache
+    if (out->empty()) FinishRequest(msg_id);
+  } else if (one_bit_add_) {
+    OneBitsFilter<T, integer_t> filter(num_col_, &add_residual_,
+                                       kv.size() == 3);
+    for (auto& pair : *out) {
+      std::vector<Blob> compressed;
+      filter.FilterIn(pair.second, &compressed);
+      pair.second.swap(compressed);
+    }
   }
   return static_cast<int>(out->size());
 }
 
 template <typename T>
-void MatrixWorkerTable<T>::ProcessReplyGet(std::vector<Blob>& reply_data) {
-  CHECK(reply_data.size() == 2 || reply_data.size() == 3); //3 for get all rows
+int MatrixWorkerTable<T>::PartitionHotRows(int msg_id,
+  const std::vector<Blob>& request,
+  std::unordered_map<int, std::vector<Blob>>* out) {
+  // the hot row set is the same on all the servers, ask the first one.
+  // The other requests go to every server, rows or replicas may be anywhere
+  if (request.size() == 1 && request[0].As<integer_t>(0) == kHotRowsSet) {
+    (*out)[MV_ServerIdToRank(0)] = request;
+  } else {
+    for (auto i = 0; i < num_server_; ++i) {
+      (*out)[MV_ServerIdToRank(i)] = request;
+    }
+  }
+  if (request.size() == 1) {
+    FindRequest(msg_id)->num_replies = static_cast<int>(out->size());
+  }
+  return static_cast<int>(out->size());
+}
 
+template <typename T>
+void MatrixWorkerTable<T>::ProcessReplyHotRows(GetRequest* request,
+  std::vector<Blob>& reply_data) {
+  const integer_t* rows = reinterpret_cast<integer_t*>(reply_data[1].data());
+  if (reply_data[0].As<integer_t>(0) == kHotRowsSet) {
+    std::vector<integer_t> hot;
+    for (; *rows != -1; ++rows) hot.push_back(*rows);
+    hot_.Set(hot);
+    return;
+  }
+  CHECK_NOTNULL(request->counts);
+  const int64_t* counts = reinterpret_cast<int64_t*>(reply_data[2].data());
+  for (size_t i = 0; rows[i] != -1; ++i) {
+    (*request->counts)[rows[i]] += counts[i];
+  }
+}
+
+template <typename T>
+void MatrixWorkerTable<T>::ProcessReplyGet(std::vector<Blob>&) {
+  Log::Fatal("[ProcessReplyGet] a reply of matrixTable needs its request id\n");
+}
+
+template <typename T>
+void MatrixWorkerTable<T>::ProcessReplyGet(int msg_id,
+  std::vector<Blob>& reply_data) {
+  GetRequest* request = FindRequest(msg_id);
+  size_t keys_size = reply_data[0].size<integer_t>();
+  integer_t* keys = reinterpret_cast<integer_t*>(reply_data[0].data());
+  bool whole_table = keys_size == 1 && keys[0] == -1;
+  if (keys_size > 0 && keys[0] < -1) {
+    ProcessReplyHotRows(request, reply_data);
+    if (--request->num_replies == 0) FinishRequest(msg_id);
+    return;
+  }
+  if (reply_data.size() == 4) {
+    ProcessReplyVersionedGet(*request, reply_data);
+  } else {
+    CHECK(reply_data.size() == 2 || reply_data.size() == 3); //3 for get all rows
+    ProcessReplyPlainGet(*request, reply_data);
+  }
+  if (cache_ && !whole_table) {
+    for (size_t i = 0; i < keys_size; ++i) {
+      cache_->Put(keys[i], request->clock, request->row(keys[i], num_col_));
+    }
+  }
+  if (--request->num_replies == 0) FinishRequest(msg_id);
+}
+
+template <typename T>
+void MatrixWorkerTable<T>::ProcessReplyPlainGet(const GetRequest& request,
+  std::vector<Blob>& reply_data) {
   size_t keys_size = reply_data[0].size<integer_t>();
   integer_t* keys = reinterpret_cast<integer_t*>(reply_data[0].data());
   T* data = reinterpret_cast<T*>(reply_data[1].data());
@@ -324,45 +678,121 @@ void MatrixWorkerTable<T>::ProcessReplyGet(std::vector<Blob>& reply_data) {
   //get all rows, only happen in T*
   if (keys_size == 1 && keys[0] == -1) {
     int server_id = reply_data[2].As<int>();
-    CHECK_NOTNULL(row_index_[num_row_]);
-    CHECK(server_id < server_offsets_.size() - 1);
-    memcpy(row_index_[num_row_] + server_offsets_[server_id] * num_col_,
+    CHECK_NOTNULL(request.whole_table);
+    CHECK(server_id < num_server_);
+    memcpy(request.whole_table + partition_.begin(server_id) * num_col_,
       data, reply_data[1].size());
   } else {
     CHECK(reply_data[1].size() == keys_size * row_size_);
     integer_t offset = 0;
-    for (auto i = 0; i < keys_size; ++i) {
-      CHECK_NOTNULL(row_index_[keys[i]]);
-      memcpy(row_index_[keys[i]], data + offset, row_size_);
+    for (size_t i = 0; i < keys_size; ++i) {
+      memcpy(request.row(keys[i], num_col_), data + offset, row_size_);
       offset += num_col_;
     }
   }
-  --get_reply_count_;
+}
+
+template <typename T>
+void MatrixWorkerTable<T>::UpdateCache(const integer_t* keys,
+  size_t keys_size, const T* values) {
+  // the effect of the updaters keeping state is not known here
+  int sign = Updater<T>::DeltaSign();
+  auto apply = [&](integer_t row, T* cached, const T* delta) {
+    if (sign == 0) {
+      cache_->Erase(row);
+      return;
+    }
+    for (auto j = 0; j < num_col_; ++j) cached[j] += sign * delta[j];
+  };
+  if (keys_size == 1 && keys[0] == -1) {
+    std::vector<integer_t> rows;
+    cache_->ForEach([&](integer_t row, T*) { rows.push_back(row); });
+    for (auto row : rows) {
+      apply(row, cache_->Peek(row),
+            values + static_cast<size_t>(row) * num_col_);
+    }
+    return;
+  }
+  for (size_t i = 0; i < keys_size; ++i) {
+    T* cached = cache_->Peek(keys[i]);
+    if (cached != nullptr) apply(keys[i], cached, values + i * num_col_);
+  }
+}
+
+template <typename T>
+void MatrixWorkerTable<T>::ProcessReplyVersionedGet(const GetRequest& request,
+  std::vector<Blob>& reply_data) {
+  size_t keys_size = reply_data[0].size<integer_t>();
+  integer_t* keys = reinterpret_cast<integer_t*>(reply_data[0].data());
+  T* data = reinterpret_cast<T*>(reply_data[1].data());
+  integer_t* changed = reinterpret_cast<integer_t*>(reply_data[2].data());
+  int server_id = static_cast<int>(reply_data[3].As<int64_t>(0));
+  int64_t version = reply_data[3].As<int64_t>(1);
+  CHECK(server_id < num_server_);
+
+  // update the local copy with the rows that changed on the server, then
+  // hand out the requested rows from it
+  if (keys_size == 1 && keys[0] == -1) {
+    integer_t begin = static_cast<integer_t>(partition_.begin(server_id));
+    integer_t end = static_cast<integer_t>(partition_.end(server_id));
+    for (; *changed != -1; ++changed) {
+      integer_t first = begin + *changed * version_block_rows_;
+      size_t size = std::min(version_block_rows_, end - first) * row_size_;
+      memcpy(mirror_.data() + static_cast<size_t>(first) * num_col_,
+        data, size);
+      data += size / sizeof(T);
+    }
+    std::fill(row_version_.begin() + begin, row_version_.begin() + end,
+              version);
+    CHECK_NOTNULL(request.whole_table);
+    memcpy(request.whole_table + static_cast<size_t>(begin) * num_col_,
+      mirror_.data() + static_cast<size_t>(begin) * num_col_,
+      (end - begin) * row_size_);
+    return;
+  }
+  for (; *changed != -1; ++changed) {
+    memcpy(mirror_.data() + static_cast<size_t>(keys[*changed]) * num_col_,
+      data, row_size_);
+    data += num_col_;
+  }
+  for (size_t i = 0; i < keys_size; ++i) {
+    row_version_[keys[i]] = version;
+    memcpy(request.row(keys[i], num_col_),
+      mirror_.data() + static_cast<size_t>(keys[i]) * num_col_, row_size_);
+  }
 }
 
 template <typename T>
 MatrixServerTable<T>::MatrixServerTable(const MatrixTableOption<T>& option) :
-MatrixServerTable(option.num_row, option.num_col) {}
+MatrixServerTable(option.num_row, option.num_col, option.partition) {
+  CHECK(option.version_block_rows >= 0);
+  versions_.Init(my_num_row_, option.version_block_rows);
+  CHECK(option.hot_replicas >= 1 && option.hot_merge_ms >= 0);
+  if (option.hot_replicas > 1 &&
+      CanReplicateRows(option.version_block_rows) &&
+      hot_.Init(option.hot_replicas, MV_NumServers())) {
+    merge_ms_ = option.hot_merge_ms;
+    SetHotRows(option.hot_rows);
+  }
+  one_bit_add_ = option.one_bit_add;
+}
 
 template <typename T>
-MatrixServerTable<T>::MatrixServerTable(integer_t num_row, integer_t num_col) :
-  ServerTable(), num_col_(num_col) {
+MatrixServerTable<T>::MatrixServerTable(integer_t num_row, integer_t num_col,
+  const PartitionOption& partition) : ServerTable(), num_col_(num_col),
+  partition_(partition, num_row, MV_NumServers()), merge_ms_(0),
+  merge_now_(false), one_bit_add_(false) {
 
   server_id_ = MV_ServerId();
   CHECK(server_id_ != -1);
 
-  integer_t size = num_row / MV_NumServers();
-  if (size > 0) {
-    row_offset_ = size * server_id_; // Zoo::Get()->rank();
-    if (server_id_ == MV_NumServers() - 1) {
-      size = num_row - row_offset_;
-    }
-  } else {
-    size = server_id_ < num_row ? 1 : 0;
-    row_offset_ = server_id_;
-  }
+  // the rows the workers send here, see MatrixWorkerTable::Partition
+  CHECK(partition_.contiguous());
+  row_offset_ = static_cast<integer_t>(partition_.begin(server_id_));
+  integer_t size = static_cast<integer_t>(partition_.size(server_id_));
   my_num_row_ = size;
   storage_.resize(my_num_row_ * num_col);
+  access_count_.assign(my_num_row_, 0);
   updater_ = Updater<T>::GetUpdater(my_num_row_ * num_col);
   Log::Debug("[Init] Server =  %d, type = matrixTable, size =  [ %d x %d ], total =  [ %d x %d ].\n",
     server_id_, size, num_col, num_row, num_col);
@@ -385,30 +815,160 @@ MatrixServerTable<T>::MatrixServerTable(num_row, num_col) {
 
 template <typename T>
 void MatrixServerTable<T>::ProcessAdd(const std::vector<Blob>& data) {
+  std::vector<Shard> shards;
+  SplitShards(data, 1, &shards);
+  ProcessAddShard(data, shards[0]);
+}
+
+template <typename T>
+void MatrixServerTable<T>::PrepareAdd(std::vector<Blob>* data) {
+  // the Adds of the hot rows are sent as they are
+  if (!one_bit_add_ || ((*data)[0].size<integer_t>() > 0 &&
+      (*data)[0].As<integer_t>(0) < -1)) return;
+  OneBitsFilter<T, integer_t> filter(num_col_, nullptr, data->size() == 4);
+  std::vector<Blob> restored;
+  filter.FilterOut(*data, &restored);
+  data->swap(restored);
+}
+
+template <typename T>
+void MatrixServerTable<T>::ProcessGet(const std::vector<Blob>& data,
+  std::vector<Blob>* result) {
+  PrepareGet(data, result);
+  std::vector<Shard> shards;
+  SplitShards(data, 1, &shards);
+  ProcessGetShard(data, result, shards[0]);
+  FinishGet(data, result);
+}
+
+template <typename T>
+void MatrixServerTable<T>::ShardRows(int shard, int num_shards,
+  integer_t* begin, integer_t* end) const {
+  *begin = static_cast<integer_t>(
+    static_cast<int64_t>(my_num_row_) * shard / num_shards);
+  *end = static_cast<integer_t>(
+    static_cast<int64_t>(my_num_row_) * (shard + 1) / num_shards);
+  // a version block is stamped and read by a single shard
+  *begin = std::min(static_cast<integer_t>(versions_.AlignUp(*begin)),
+                    my_num_row_);
+  *end = std::min(static_cast<integer_t>(versions_.AlignUp(*end)),
+                  my_num_row_);
+}
+
+template <typename T>
+void MatrixServerTable<T>::SplitShards(const std::vector<Blob>& data,
+  int num_shards, std::vector<Shard>* shards) const {
+  ServerTable::SplitShards(data, num_shards, shards);
+  size_t keys_size = data[0].size<integer_t>();
+  const integer_t* keys = reinterpret_cast<const integer_t*>(data[0].data());
+  // requests on the whole table or on the hot rows are not split by key
+  if (keys_size == 0 || keys[0] < 0) return;
+  // first local row of each shard, then the end of the last one
+  std::vector<integer_t> bounds(num_shards + 1);
+  for (int shard = 0; shard < num_shards; ++shard) {
+    integer_t end;
+    ShardRows(shard, num_shards, &bounds[shard], &end);
+  }
+  bounds[num_shards] = my_num_row_;
+  if (num_shards == 1) {
+    (*shards)[0].positions.reserve(keys_size);
+    (*shards)[0].rows.reserve(keys_size);
+  }
+  for (size_t i = 0; i < keys_size; ++i) {
+    integer_t local_row = keys[i] - row_offset_;
+    int shard = 0;
+    if (local_row < 0 || local_row >= my_num_row_) {
+      local_row = -1;
+    } else if (num_shards > 1) {
+      // the last shard starting at or before the row, empty shards share
+      // their start with the next one
+      shard = static_cast<int>(std::upper_bound(bounds.begin(),
+        bounds.end() - 1, local_row) - bounds.begin()) - 1;
+    }
+    (*shards)[shard].positions.push_back(i);
+    (*shards)[shard].rows.push_back(local_row);
+  }
+}
+
+template <typename T>
+void MatrixServerTable<T>::BlockRows(size_t block,
+  integer_t* begin, integer_t* end) const {
+  *begin = static_cast<integer_t>(block * versions_.block_size());
+  *end = std::min(static_cast<integer_t>(*begin + versions_.block_size()),
+                  my_num_row_);
+}
+
+template <typename T>
+void MatrixServerTable<T>::ProcessAddShard(const std::vector<Blob>& data,
+  const Shard& shard) {
   CHECK(data.size() == 2 || data.size() == 3);
   size_t keys_size = data[0].size<integer_t>();
   integer_t* keys = reinterpret_cast<integer_t*>(data[0].data());
   T *values = reinterpret_cast<T*>(data[1].data());
+  if (keys_size > 0 && keys[0] < -1) {
+    if (shard.id == 0) ProcessHotRowsAdd(keys, keys_size);
+    return;
+  }
   AddOption* option = nullptr;
   if (data.size() == 3) {
     option = new AddOption(data[2].data(), data[2].size());
   }
+  integer_t row_begin, row_end;
+  ShardRows(shard.id, shard.num_shards, &row_begin, &row_end);
   // add all values
   if (keys_size == 1 && keys[0] == -1){
     size_t ssize = storage_.size();
     CHECK(ssize == data[1].size<T>());
-    updater_->Update(ssize, storage_.data(), values, option);
+    size_t offset = static_cast<size_t>(row_begin) * num_col_;
+    checkpoint_.BeforeWrite(offset * sizeof(T),
+      static_cast<size_t>(row_end - row_begin) * num_col_ * sizeof(T));
+    updater_->Update(static_cast<size_t>(row_end - row_begin) * num_col_,
+      storage_.data(), values + offset, option, offset);
+    if (versions_.enabled()) {
+      int64_t version = versions_.Tick();
+      bool skip_zero = updater_->ignores_zero_delta();
+      for (size_t b = versions_.block(row_begin);
+           row_begin < row_end && b <= versions_.block(row_end - 1); ++b) {
+        integer_t begin, end;
+        BlockRows(b, &begin, &end);
+        T* delta = values + static_cast<size_t>(begin) * num_col_;
+        if (skip_zero && std::all_of(delta,
+          delta + static_cast<size_t>(end - begin) * num_col_,
+          [](T v) { return v == 0; })) continue;
+        versions_.Stamp(b, version);
+      }
+    }
     Log::Debug("[ProcessAdd] Server = %d, adding all rows offset = %d, #rows = %d\n",
-      server_id_, row_offset_, ssize / num_col_);
+      server_id_, row_offset_ + row_begin, row_end - row_begin);
   } else {
     CHECK(data[1].size() == keys_size * sizeof(T) * num_col_);
 
-    integer_t offset_v = 0;
     CHECK(storage_.size() >= keys_size * num_col_);
-    for (auto i = 0; i < keys_size; ++i) {
-      integer_t offset_s = (keys[i] - row_offset_) * num_col_;
-      updater_->Update(num_col_, storage_.data(), values + offset_v, option, offset_s);
-      offset_v += num_col_;
+    const std::vector<integer_t>& rows = shard.rows;
+    for (auto row : rows) {
+      if (row >= 0) ++access_count_[row];
+    }
+    CopyOnWrite(rows);
+    updater_->UpdateRows(rows.size(), num_col_, rows.data(),
+      storage_.data(), values, option, shard.positions.data());
+    // the replicas take the delta now and keep it for the owner
+    for (size_t k = 0; !replica_rows_.empty() && k < rows.size(); ++k) {
+      size_t i = shard.positions[k];
+      integer_t slot = ReplicaSlot(keys[i]);
+      if (slot < 0) continue;
+      size_t offset = static_cast<size_t>(slot) * num_col_;
+      T* delta = values + static_cast<size_t>(i) * num_col_;
+      updater_->Update(num_col_, replica_values_.data(), delta, option,
+                       offset);
+      T* kept = replica_deltas_.data() + offset;
+      for (auto j = 0; j < num_col_; ++j) kept[j] += delta[j];
+      ++replica_count_[slot];
+    }
+    if (versions_.enabled()) {
+      int64_t version = versions_.Tick();
+      for (auto row : rows) {
+        if (row >= 0) versions_.Stamp(versions_.block(row), version);
+      }
     }
     Log::Debug("[ProcessAdd] Server = %d, adding #rows = %d\n",
       server_id_, keys_size);
@@ -417,50 +977,391 @@ void MatrixServerTable<T>::ProcessAdd(const std::vector<Blob>& data) {
 }
 
 template <typename T>
-void MatrixServerTable<T>::ProcessGet(const std::vector<Blob>& data,
+void MatrixServerTable<T>::PrepareGet(const std::vector<Blob>& data,
   std::vector<Blob>* result) {
-  CHECK(data.size() == 1);
+  CHECK(data.size() == 1 || data.size() == 2);
   CHECK_NOTNULL(result);
 
   result->push_back(data[0]); // also push the key
 
   size_t keys_size = data[0].size<integer_t>();
   integer_t* keys = reinterpret_cast<integer_t*>(data[0].data());
+  bool whole_table = keys_size == 1 && keys[0] == -1;
+  if (keys_size > 0 && keys[0] < -1) {
+    PrepareHotRowsGet(data, result);
+    return;
+  }
+
+  // versioned: [keys, values, one changed flag per unit (key or block),
+  // {server id, version}], compacted by FinishGet
+  if (data.size() == 2) {
+    CHECK(versions_.enabled());
+    size_t num_units = whole_table ? versions_.num_blocks() : keys_size;
+    CHECK(data[1].size<int64_t>() == num_units);
+    result->push_back(Blob(whole_table ? sizeof(T) * storage_.size() :
+      keys_size * sizeof(T) * num_col_));
+    Blob changed(num_units);
+    memset(changed.data(), 0, num_units);
+    result->push_back(changed);
+    Blob info(2 * sizeof(int64_t));
+    info.As<int64_t>(0) = server_id_;
+    // the reply reflects all the Adds before this Get, the clock is a lower
+    // bound of their versions: a shard of an earlier Add still running on
+    // an executor may stamp its blocks later, at worst they are sent again
+    info.As<int64_t>(1) = versions_.clock();
+    result->push_back(info);
+    return;
+  }
 
   //get all rows
-  if (keys_size == 1 && keys[0] == -1){
-    Blob value(sizeof(T) * storage_.size());
-    T* pvalues = reinterpret_cast<T*>(value.data());
-    updater_->Access(storage_.size(), storage_.data(), pvalues);
-    result->push_back(value);
+  if (whole_table){
+    result->push_back(Blob(sizeof(T) * storage_.size()));
     result->push_back(Blob(&server_id_, sizeof(int)));
-    Log::Debug("[ProcessGet] Server = %d, getting all rows offset = %d, #rows = %d\n",
-      server_id_, row_offset_, storage_.size() / num_col_);
     return;
   }
+  result->push_back(Blob(keys_size * sizeof(T) * num_col_));
+}
 
-  integer_t row_size = sizeof(T)* num_col_;
-  result->push_back(Blob(keys_size * row_size));
+template <typename T>
+void MatrixServerTable<T>::ProcessGetShard(const std::vector<Blob>& data,
+  std::vector<Blob>* result, const Shard& shard) {
+  size_t keys_size = data[0].size<integer_t>();
+  integer_t* keys = reinterpret_cast<integer_t*>(data[0].data());
+  if (keys_size > 0 && keys[0] < -1) return;
   T* vals = reinterpret_cast<T*>((*result)[1].data());
-  integer_t offset_v = 0;
-  for (auto i = 0; i < keys_size; ++i) {
-    integer_t offset_s = (keys[i] - row_offset_) * num_col_;
-    updater_->Access(num_col_, storage_.data(), vals + offset_v, offset_s);
-    offset_v += num_col_;
+  integer_t row_begin, row_end;
+  ShardRows(shard.id, shard.num_shards, &row_begin, &row_end);
+
+  if (data.size() == 2) {
+    const int64_t* known = reinterpret_cast<const int64_t*>(data[1].data());
+    char* changed = (*result)[2].data();
+    if (keys_size == 1 && keys[0] == -1) {
+      for (size_t b = versions_.block(row_begin);
+           row_begin < row_end && b <= versions_.block(row_end - 1); ++b) {
+        if (!versions_.ChangedSince(b, known[b])) continue;
+        integer_t begin, end;
+        BlockRows(b, &begin, &end);
+        size_t offset = static_cast<size_t>(begin) * num_col_;
+        updater_->Access(static_cast<size_t>(end - begin) * num_col_,
+          storage_.data(), vals + offset, offset);
+        changed[b] = 1;
+      }
+      return;
+    }
+    for (size_t k = 0; k < shard.rows.size(); ++k) {
+      size_t i = shard.positions[k];
+      integer_t local_row = shard.rows[k];
+      if (local_row >= 0 &&
+          versions_.ChangedSince(versions_.block(local_row), known[i])) {
+        updater_->Access(num_col_, storage_.data(),
+          vals + static_cast<size_t>(i) * num_col_,
+          static_cast<size_t>(local_row) * num_col_);
+        changed[i] = 1;
+      }
+    }
+    return;
+  }
+
+  //get all rows
+  if (keys_size == 1 && keys[0] == -1){
+    size_t offset = static_cast<size_t>(row_begin) * num_col_;
+    updater_->Access(static_cast<size_t>(row_end - row_begin) * num_col_,
+      storage_.data(), vals + offset, offset);
+    Log::Debug("[ProcessGet] Server = %d, getting all rows offset = %d, #rows = %d\n",
+      server_id_, row_offset_ + row_begin, row_end - row_begin);
+    return;
+  }
+
+  for (size_t k = 0; k < shard.rows.size(); ++k) {
+    size_t i = shard.positions[k];
+    integer_t local_row = shard.rows[k];
+    T* val = vals + i * num_col_;
+    if (local_row >= 0) {
+      updater_->Access(num_col_, storage_.data(), val,
+                       static_cast<size_t>(local_row) * num_col_);
+      ++access_count_[local_row];
+    } else if (!replica_rows_.empty()) {
+      integer_t slot = ReplicaSlot(keys[i]);
+      if (slot >= 0) {
+        updater_->Access(num_col_, replica_values_.data(), val,
+                         static_cast<size_t>(slot) * num_col_);
+        ++replica_count_[slot];
+      }
+    }
   }
   Log::Debug("[ProcessGet] Server = %d, getting row #rows = %d\n",
     server_id_, keys_size);
   return;
 }
 
+template <typename T>
+void MatrixServerTable<T>::FinishGet(const std::vector<Blob>& data,
+  std::vector<Blob>* result) {
+  if (data.size() != 2) return;
+  // move the values of the changed units to the front, in unit order, and
+  // replace the flags by the list of changed units
+  size_t keys_size = data[0].size<integer_t>();
+  bool whole_table = keys_size == 1 &&
+    reinterpret_cast<integer_t*>(data[0].data())[0] == -1;
+  Blob& values = (*result)[1];
+  const char* flags = (*result)[2].data();
+  size_t num_units = (*result)[2].size();
+  std::vector<integer_t> changed;
+  size_t used = 0;
+  for (size_t u = 0; u < num_units; ++u) {
+    if (!flags[u]) continue;
+    size_t offset = u * sizeof(T) * num_col_, size = sizeof(T) * num_col_;
+    if (whole_table) {
+      integer_t begin, end;
+      BlockRows(u, &begin, &end);
+      offset = static_cast<size_t>(begin) * sizeof(T) * num_col_;
+      size = static_cast<size_t>(end - begin) * sizeof(T) * num_col_;
+    }
+    if (offset != used) memmove(values.data() + used,
+                                values.data() + offset, size);
+    used += size;
+    changed.push_back(static_cast<integer_t>(u));
+  }
+  // no blob may be empty on the wire (see ZMQNet): the list of changed
+  // units ends with -1 and at least one value is sent
+  changed.push_back(-1);
+  values = Blob(values, 0, std::max(used, sizeof(T)));
+  (*result)[2] = Blob(changed.data(), changed.size() * sizeof(integer_t));
+}
+
 template <typename T>
 void MatrixServerTable<T>::Store(Stream* s) {
-  s->Write(storage_.data(), storage_.size() * sizeof(T));
+  SnapshotWriter writer(s, Layout());
+  writer.Write(storage_.data(), storage_.size() * sizeof(T));
+  writer.Finish();
 }
 
 template <typename T>
 void MatrixServerTable<T>::Load(Stream* s) {
-  s->Read(storage_.data(), storage_.size() * sizeof(T));
+  Restore(std::vector<Stream*>(1, s));
+}
+
+template <typename T>
+void MatrixServerTable<T>::Restore(const std::vector<Stream*>& snapshots) {
+  checkpoint_.Wait();
+  ReadSnapshotRows(Layout(), snapshots, storage_.data());
+  if (versions_.enabled()) versions_.StampAll(versions_.Tick());
+  // the replicas get the loaded values with the next request
+  merge_now_ = !replica_rows_.empty();
+}
+
+template <typename T>
+void MatrixServerTable<T>::StartCheckpoint(Stream* s) {
+  checkpoint_.Start(s, Layout(), storage_.data(),
+                    storage_.size() * sizeof(T));
+}
+
+template <typename T>
+SnapshotHeader MatrixServerTable<T>::Layout() const {
+  SnapshotHeader header;
+  header.table_type = static_cast<uint32_t>(SnapshotTable::kMatrix);
+  header.element_type = SnapshotElementType<T>();
+  header.server_id = server_id_;
+  header.num_servers = partition_.num_servers();
+  header.num_rows = static_cast<uint64_t>(partition_.num_keys());
+  header.num_cols = static_cast<uint64_t>(num_col_);
+  header.begin = static_cast<uint64_t>(row_offset_);
+  header.end = static_cast<uint64_t>(row_offset_ + my_num_row_);
+  header.payload_bytes = storage_.size() * sizeof(T);
+  return header;
+}
+
+template <typename T>
+void MatrixServerTable<T>::CopyOnWrite(const std::vector<integer_t>& rows) {
+  if (!checkpoint_.running()) return;
+  size_t row_bytes = num_col_ * sizeof(T);
+  for (auto row : rows) {
+    if (row >= 0) {
+      checkpoint_.BeforeWrite(static_cast<size_t>(row) * row_bytes, row_bytes);
+    }
+  }
+}
+
+template <typename T>
+integer_t MatrixServerTable<T>::ReplicaSlot(integer_t row) const {
+  auto it = replica_slot_.find(row);
+  return it == replica_slot_.end() ? -1 : it->second;
+}
+
+template <typename T>
+void MatrixServerTable<T>::SetHotRows(const std::vector<integer_t>& rows) {
+  std::unordered_map<integer_t, integer_t> old_slot;
+  std::vector<integer_t> old_rows;
+  std::vector<T> old_values, old_deltas;
+  old_slot.swap(replica_slot_);
+  old_rows.swap(replica_rows_);
+  old_values.swap(replica_values_);
+  old_deltas.swap(replica_deltas_);
+  replica_count_.clear();
+
+  hot_.Set(rows);
+  for (auto row : rows) {
+    CHECK(row >= 0 && row < partition_.num_keys());
+    if (replica_slot_.count(row) ||
+        !hot_.Replicates(server_id_, partition_.Server(row))) continue;
+    replica_slot_[row] = static_cast<integer_t>(replica_rows_.size());
+    replica_rows_.push_back(row);
+    auto it = old_slot.find(row);
+    if (it == old_slot.end()) {
+      // the value comes with the merge before the reply
+      replica_values_.resize(replica_values_.size() + num_col_, 0);
+      replica_deltas_.resize(replica_deltas_.size() + num_col_, 0);
+      merge_now_ = true;
+      continue;
+    }
+    size_t offset = static_cast<size_t>(it->second) * num_col_;
+    replica_values_.insert(replica_values_.end(),
+      old_values.begin() + offset, old_values.begin() + offset + num_col_);
+    replica_deltas_.insert(replica_deltas_.end(),
+      old_deltas.begin() + offset, old_deltas.begin() + offset + num_col_);
+  }
+  replica_count_.assign(replica_rows_.size(), 0);
+  for (size_t i = 0; i < old_rows.size(); ++i) {
+    if (replica_slot_.count(old_rows[i])) continue;
+    dropped_rows_.push_back(old_rows[i]);
+    dropped_deltas_.insert(dropped_deltas_.end(),
+      old_deltas.begin() + i * num_col_,
+      old_deltas.begin() + (i + 1) * num_col_);
+    merge_now_ = true;
+  }
+  std::fill(access_count_.begin(), access_count_.end(), 0);
+  Log::Debug("[SetHotRows] Server = %d, %d hot rows, %d replicated here\n",
+    server_id_, static_cast<int>(rows.size()),
+    static_cast<int>(replica_rows_.size()));
+}
+
+template <typename T>
+void MatrixServerTable<T>::PrepareHotRowsGet(const std::vector<Blob>& data,
+  std::vector<Blob>* result) {
+  const integer_t* keys = reinterpret_cast<integer_t*>(data[0].data());
+  std::vector<integer_t> rows;
+  if (keys[0] == kHotRowsSet) {
+    for (auto row : hot_.keys()) rows.push_back(static_cast<integer_t>(row));
+    rows.push_back(-1);
+    result->push_back(Blob(rows.data(), rows.size() * sizeof(integer_t)));
+    return;
+  }
+  // the k local rows accessed most, and all the replicas
+  CHECK(data[0].size<integer_t>() == 2 && keys[1] > 0);
+  std::vector<std::pair<int64_t, integer_t>> order;
+  for (integer_t i = 0; i < my_num_row_; ++i) {
+    if (access_count_[i] > 0) {
+      order.push_back(std::make_pair(-static_cast<int64_t>(access_count_[i]),
+                                     row_offset_ + i));
+    }
+  }
+  size_t num = std::min(static_cast<size_t>(keys[1]), order.size());
+  std::partial_sort(order.begin(), order.begin() + num, order.end());
+  std::vector<int64_t> counts;
+  for (size_t i = 0; i < num; ++i) {
+    rows.push_back(order[i].second);
+    counts.push_back(-order[i].first);
+  }
+  for (size_t i = 0; i < replica_rows_.size(); ++i) {
+    if (replica_count_[i] == 0) continue;
+    rows.push_back(replica_rows_[i]);
+    counts.push_back(replica_count_[i]);
+  }
+  // no blob may be empty on the wire (see ZMQNet)
+  rows.push_back(-1);
+  counts.push_back(0);
+  result->push_back(Blob(rows.data(), rows.size() * sizeof(integer_t)));
+  result->push_back(Blob(counts.data(), counts.size() * sizeof(int64_t)));
+}
+
+template <typename T>
+void MatrixServerTable<T>::ProcessHotRowsAdd(const integer_t* keys,
+  size_t keys_size) {
+  if (!hot_.enabled()) return;
+  if (keys[0] == kHotRowsSet) {
+    SetHotRows(std::vector<integer_t>(keys + 1, keys + keys_size));
+  } else {
+    merge_now_ = !replica_rows_.empty() || !dropped_rows_.empty();
+  }
+}
+
+template <typename T>
+void MatrixServerTable<T>::TakeServerMessages(
+  std::unordered_map<int, std::vector<Blob> >* messages) {
+  if (replica_rows_.empty() && dropped_rows_.empty()) return;
+  if (!merge_now_ && merge_timer_.elapse() < merge_ms_) return;
+  merge_now_ = false;
+  merge_timer_.Start();
+
+  // [keys, deltas] of the rows of each owner
+  std::unordered_map<int, std::pair<std::vector<integer_t>,
+                                    std::vector<T>>> merges;
+  auto take = [&](integer_t row, T* delta) {
+    auto& merge = merges[partition_.Server(row)];
+    merge.first.push_back(row);
+    merge.second.insert(merge.second.end(), delta, delta + num_col_);
+    std::fill(delta, delta + num_col_, 0);
+  };
+  for (size_t i = 0; i < replica_rows_.size(); ++i) {
+    take(replica_rows_[i], replica_deltas_.data() + i * num_col_);
+  }
+  for (size_t i = 0; i < dropped_rows_.size(); ++i) {
+    take(dropped_rows_[i], dropped_deltas_.data() + i * num_col_);
+  }
+  dropped_rows_.clear();
+  dropped_deltas_.clear();
+  for (auto& merge : merges) {
+    std::vector<Blob>& message = (*messages)[MV_ServerIdToRank(merge.first)];
+    message.push_back(Blob(merge.second.first.data(),
+      merge.second.first.size() * sizeof(integer_t)));
+    message.push_back(Blob(merge.second.second.data(),
+      merge.second.second.size() * sizeof(T)));
+  }
+}
+
+template <typename T>
+void MatrixServerTable<T>::ProcessServerMessage(const std::vector<Blob>& data,
+  std::vector<Blob>* result) {
+  CHECK(data.size() == 2);
+  size_t keys_size = data[0].size<integer_t>();
+  const integer_t* keys = reinterpret_cast<integer_t*>(data[0].data());
+  T* deltas = reinterpret_cast<T*>(data[1].data());
+  CHECK(data[1].size() == keys_size * sizeof(T) * num_col_);
+  // merges do not count as accesses of the rows
+  std::vector<integer_t> rows(keys_size);
+  for (size_t i = 0; i < keys_size; ++i) {
+    rows[i] = keys[i] - row_offset_;
+    CHECK(rows[i] >= 0 && rows[i] < my_num_row_);
+  }
+  CopyOnWrite(rows);
+  updater_->UpdateRows(keys_size, num_col_, rows.data(), storage_.data(),
+                       deltas);
+  Blob values(data[1].size());
+  for (size_t i = 0; i < keys_size; ++i) {
+    updater_->Access(num_col_, storage_.data(),
+      reinterpret_cast<T*>(values.data()) + i * num_col_,
+      static_cast<size_t>(rows[i]) * num_col_);
+  }
+  result->push_back(data[0]);
+  result->push_back(values);
+}
+
+template <typename T>
+void MatrixServerTable<T>::ProcessServerReply(const std::vector<Blob>& data) {
+  CHECK(data.size() == 2);
+  size_t keys_size = data[0].size<integer_t>();
+  const integer_t* keys = reinterpret_cast<integer_t*>(data[0].data());
+  const T* values = reinterpret_cast<T*>(data[1].data());
+  for (size_t i = 0; i < keys_size; ++i) {
+    integer_t slot = ReplicaSlot(keys[i]);
+    if (slot < 0) continue;                  // dropped since
+    // the owner value, with the deltas added here since the merge
+    size_t offset = static_cast<size_t>(slot) * num_col_;
+    memcpy(replica_values_.data() + offset, values + i * num_col_,
+           sizeof(T) * num_col_);
+    updater_->Update(num_col_, replica_values_.data(),
+                     replica_deltas_.data() + offset, nullptr, offset);
+  }
 }
 
 MV_INSTANTIATE_CLASS_WITH_BASE_TYPE(MatrixWorkerTable);
@@ -24,11 +24,11 @@ template <typename T>
 void SparseMatrixWorkerTable<T>::Get(integer_t row_id, T* data, size_t size,
   const GetOption* option) {
   if (row_id >= 0) CHECK(size == this->num_col_);
-  for (auto i = 0; i < this->num_row_ + 1; ++i) this->row_index_[i] = nullptr;
+  typename MatrixWorkerTable<T>::GetRequest request;
   if (row_id == -1) {
-    this->row_index_[this->num_row_] = data;
+    request.whole_table = data;
   } else {
-    this->row_index_[row_id] = data; // data_ = data;
+    request.rows[row_id] = data;
   }
   Blob keys(&row_id, sizeof(integer_t) * 1);
 
@@ -38,7 +38,7 @@ void SparseMatrixWorkerTable<T>::Get(integer_t row_id, T* data, size_t size,
     option = new GetOption();
   }
 
-  WorkerTable::Get(keys, option);
+  this->Wait(this->RequestGet(keys, std::move(request), option));
   Log::Debug("[Get] worker = %d, #row = %d\n", MV_Rank(), row_id);
   if (is_option_mine) delete option;
 }
@@ -47,11 +47,11 @@ template <typename T>
 void SparseMatrixWorkerTable<T>::Get(const std::vector<integer_t>& row_ids,
   const std::vector<T*>& data_vec, size_t size, 
   const GetOption* option) {
-  for (auto i = 0; i < this->num_row_ + 1; ++i) this->row_index_[i] = nullptr;
   CHECK(size == this->num_col_);
   CHECK(row_ids.size() == data_vec.size());
+  typename MatrixWorkerTable<T>::GetRequest request;
   for (integer_t i = 0; i < row_ids.size(); ++i) {
-    this->row_index_[row_ids[i]] = data_vec[i];
+    request.rows[row_ids[i]] = data_vec[i];
   }
   Blob keys(row_ids.data(), sizeof(integer_t) * row_ids.size());
 
@@ -61,15 +61,15 @@ void SparseMatrixWorkerTable<T>::Get(const std::vector<integer_t>& row_ids,
     option = new GetOption();
   }
 
-  WorkerTable::Get(keys, option);
+  this->Wait(this->RequestGet(keys, std::move(request), option));
   Log::Debug("[Get] worker = %d, #rows_set = %d\n", MV_Rank(),
     row_ids.size());
   if (is_option_mine) delete option;
 }
 
 template <typename T>
-int SparseMatrixWorkerTable<T>::Partition(const std::vector<Blob>& kv,
-  MsgType partition_type,
+int SparseMatrixWorkerTable<T>::Partition(int msg_id,
+  const std::vector<Blob>& kv, MsgType partition_type,
   std::unordered_map<int, std::vector<Blob>>* out) {
   int res;
   CHECK(kv.size() == 1 || kv.size() == 2 || kv.size() == 3);
@@ -80,19 +80,13 @@ int SparseMatrixWorkerTable<T>::Partition(const std::vector<Blob>& kv,
     integer_t* keys = reinterpret_cast<integer_t*>(kv[0].data());
     if (keys[0] == -1) {
       for (auto i = 0; i < this->num_server_; ++i) {
+        if (this->partition_.size(i) == 0) continue;
         int rank = MV_ServerIdToRank(i);
         (*out)[rank].push_back(kv[0]);
+        (*out)[rank].push_back(kv[1]);  // general option blob
       }
 
-      for (auto i = 0; i < this->num_server_; ++i){
-        int rank = MV_ServerIdToRank(i);
-        if (kv.size() == 2) {// general option blob
-          (*out)[rank].push_back(kv[1]);
-        }
-      }
-
-      CHECK(this->get_reply_count_ == 0);
-      this->get_reply_count_ = static_cast<int>(out->size());
+      this->FindRequest(msg_id)->num_replies = static_cast<int>(out->size());
       res = static_cast<int>(out->size());
     } else {
       // count row number in each server
@@ -100,10 +94,8 @@ int SparseMatrixWorkerTable<T>::Partition(const std::vector<Blob>& kv,
       std::vector<integer_t> count;
       std::vector<int> dest;
       count.resize(this->num_server_, 0);
-      integer_t num_row_each = this->num_row_ / this->num_server_;  //  num_server_;
       for (auto i = 0; i < keys_size; ++i) {
-        int dst = keys[i] / num_row_each;
-        dst = (dst >= this->num_server_ ? this->num_server_ - 1 : dst);
+        int dst = this->partition_.Server(keys[i]);
         dest.push_back(dst);
         ++count[dst];
       }
@@ -135,13 +127,12 @@ int SparseMatrixWorkerTable<T>::Partition(const std::vector<Blob>& kv,
         }
       }
 
-      CHECK(this->get_reply_count_ == 0);
-      this->get_reply_count_ = static_cast<int>(out->size());
+      this->FindRequest(msg_id)->num_replies = static_cast<int>(out->size());
       res = static_cast<int>(out->size());
     }
   } else {  // processing Add()
     // call base class's Partition
-    res = MatrixWorkerTable<T>::Partition(kv, partition_type, out);
+    res = MatrixWorkerTable<T>::Partition(msg_id, kv, partition_type, out);
   }
 
    // only have effect when adding elements
@@ -155,45 +146,14 @@ int SparseMatrixWorkerTable<T>::Partition(const std::vector<Blob>& kv,
   return res;
 }
 
-template <typename T>
-void SparseMatrixWorkerTable<T>::ProcessReplyGet(
-  std::vector<Blob>& reply_data) {
-  // replace row_index when original key == -1
-  if (this->row_index_[this->num_row_] != nullptr) {
-    size_t keys_size = reply_data[0].size<integer_t>();
-    Log::Debug("[SparseMatrixWorkerTable:ProcessReplyGet] worker = %d, #keys_size = %d\n", MV_Rank(),
-      keys_size);
-    integer_t* keys = reinterpret_cast<integer_t*>(reply_data[0].data());
-    for (auto i = 0; i < keys_size; ++i) {
-      this->row_index_[keys[i]] = this->row_index_[this->num_row_] + keys[i] * this->num_col_;
-    }
-  }
-
-  MatrixWorkerTable<T>::ProcessReplyGet(reply_data);
-}
-
-template <typename T>
-SparseMatrixServerTable<T>::~SparseMatrixServerTable() {
-  for (auto i = 0; i < workers_nums_; ++i) {
-    delete[]up_to_date_[i];
-  }
-  delete[]up_to_date_;
-}
-
 template <typename T>
 SparseMatrixServerTable<T>::SparseMatrixServerTable(integer_t num_row, integer_t num_col,
-  bool using_pipeline) : MatrixServerTable<T>(num_row, num_col) {
-   workers_nums_ = multiverso::MV_NumWorkers();
-  if (using_pipeline) {
-    workers_nums_ *= 2;
-  }
-        
-  up_to_date_ = new bool*[workers_nums_];
-  for (auto i = 0; i < workers_nums_; ++i) {
-    up_to_date_[i] = new bool[this->my_num_row_];
-    memset(up_to_date_[i], 0, sizeof(bool) * this->my_num_row_);
-  }
-  Log::Debug("[SparseMatrixServerTable] workers_nums_= %d .\n", workers_nums_);
+  bool using_pipeline) : MatrixServerTable<T>(num_row, num_col),
+  up_to_date_(this->my_num_row_,
+    MV_NumWorkers() * (using_pipeline ? 2 : 1)) {
+  workers_nums_ = up_to_date_.num_workers();
+  Log::Debug("[SparseMatrixServerTable] workers_nums_= %d, tracker = %lld bytes.\n",
+    workers_nums_, static_cast<long long>(up_to_date_.memory_size()));
 }
 
 template <typename T>
@@ -202,22 +162,12 @@ void SparseMatrixServerTable<T>::UpdateAddState(int worker_id,
   size_t keys_size = keys_blob.size<integer_t>();
   integer_t* keys = reinterpret_cast<integer_t*>(keys_blob.data());
   // add all values
+  // the adding worker keeps its state, other workers are out of date
   if (keys_size == 1 && keys[0] == -1) {
-    for (auto id = 0; id < workers_nums_; ++id) {
-      if (id == worker_id) continue;
-      for (auto local_row_id = 0; local_row_id < this->my_num_row_; ++local_row_id) {
-        // if other worker doesn't update the row, we can marked it as the updated.
-        up_to_date_[id][local_row_id] = false;
-      }
-    }
+    up_to_date_.InvalidateAll(worker_id);
   } else {
-    for (auto id = 0; id < workers_nums_; ++id) {
-      if (id == worker_id) continue;
-      for (auto i = 0; i < keys_size; ++i) {
-        // if other worker doesn't update the row, we can marked it as the updated.
-        auto local_row_id = GetPhysicalRow(keys[i]);
-        up_to_date_[id][local_row_id] = false;
-      }
+    for (size_t i = 0; i < keys_size; ++i) {
+      up_to_date_.Invalidate(GetPhysicalRow(keys[i]), worker_id);
     }
   }
 }
@@ -235,17 +185,14 @@ void SparseMatrixServerTable<T>::UpdateGetState(int worker_id, integer_t* keys,
 
   if (key_size == 1 && keys[0] == -1) {
     for (auto local_row_id = 0; local_row_id < this->my_num_row_; ++local_row_id)  {
-      if (!up_to_date_[worker_id][local_row_id]) {
+      if (up_to_date_.Refresh(local_row_id, worker_id)) {
         out_rows->push_back(GetLogicalRow(local_row_id));
-        up_to_date_[worker_id][local_row_id] = true;
       }
     }
   } else {
     for (auto i = 0; i < key_size; ++i)  {
       auto global_row_id = keys[i];
-      auto local_row_id = GetPhysicalRow(global_row_id);
-      if (!up_to_date_[worker_id][local_row_id]) {
-        up_to_date_[worker_id][local_row_id] = true;
+      if (up_to_date_.Refresh(GetPhysicalRow(global_row_id), worker_id)) {
         out_rows->push_back(global_row_id);
       }
     }
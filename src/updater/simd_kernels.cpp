@@ -0,0 +1,129 @@
+#include "multiverso/updater/simd_kernels.h"
+
+#include <cmath>
+#include <string>
+
+#include "simd_kernels_vec.h"
+#include "multiverso/util/configure.h"
+#include "multiverso/util/log.h"
+
+#if defined(MULTIVERSO_SIMD_X86) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace multiverso {
+
+MV_DEFINE_string(updater_simd, "auto", "instruction set of the updater kernels, auto (widest supported) / avx512 / avx2 / scalar");
+
+namespace simd {
+
+namespace {
+
+template <typename T>
+void ScalarAdd(size_t n, T* data, const T* delta) {
+  for (size_t i = 0; i < n; ++i) data[i] += delta[i];
+}
+
+template <typename T>
+void ScalarSub(size_t n, T* data, const T* delta) {
+  for (size_t i = 0; i < n; ++i) data[i] -= delta[i];
+}
+
+template <typename T>
+void ScalarMomentum(size_t n, T* data, T* smooth, const T* delta,
+                    T momentum) {
+  for (size_t i = 0; i < n; ++i) {
+    smooth[i] = momentum * smooth[i] + (1 - momentum) * delta[i];
+    data[i] -= smooth[i];
+  }
+}
+
+template <typename T>
+void ScalarAdaGrad(size_t n, T* data, T* g_sqr, const T* delta,
+                   T learning_rate, T rho, T e) {
+  T inv_lr = 1 / learning_rate;
+  for (size_t i = 0; i < n; ++i) {
+    T g = delta[i] * inv_lr;
+    g_sqr[i] += g * g;
+    data[i] -= static_cast<T>(rho * g / std::sqrt(g_sqr[i] + e));
+  }
+}
+
+template <typename T>
+const Kernels<T>* ScalarKernels() {
+  static const Kernels<T> kernels = { ScalarAdd<T>, ScalarSub<T>,
+    ScalarMomentum<T>, ScalarAdaGrad<T>, "scalar" };
+  return &kernels;
+}
+
+enum Isa { kScalar = 0, kAvx2 = 1, kAvx512 = 2 };
+
+// widest instruction set usable on this CPU and OS
+Isa CpuIsa() {
+#if defined(MULTIVERSO_SIMD_X86) && defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 1);
+  bool os_avx = (info[2] & (1 << 27)) != 0 &&   // OSXSAVE
+    (_xgetbv(0) & 0x6) == 0x6;                  // XMM and YMM state
+  bool fma = (info[2] & (1 << 12)) != 0;
+  __cpuidex(info, 7, 0);
+  bool avx2 = os_avx && fma && (info[1] & (1 << 5)) != 0;
+  bool avx512 = avx2 && (info[1] & (1 << 16)) != 0 &&
+    (_xgetbv(0) & 0xe6) == 0xe6;                // opmask and ZMM state
+  return avx512 ? kAvx512 : (avx2 ? kAvx2 : kScalar);
+#elif defined(MULTIVERSO_SIMD_X86) && defined(__GNUC__)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f")) return kAvx512;
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+    return kAvx2;
+  }
+  return kScalar;
+#else
+  return kScalar;
+#endif
+}
+
+Isa FlagIsa() {
+  std::string isa = MV_CONFIG_updater_simd;
+  if (isa == "auto" || isa == "avx512") return kAvx512;
+  if (isa == "avx2") return kAvx2;
+  if (isa != "scalar") {
+    Log::Fatal("[Updater] unknown updater_simd %s\n", isa.c_str());
+  }
+  return kScalar;
+}
+
+template <typename T>
+const Kernels<T>* VectorKernels() {
+  static const Isa cpu_isa = CpuIsa();
+  Isa isa = FlagIsa() < cpu_isa ? FlagIsa() : cpu_isa;
+  // the kernels of an instruction set are only called once the CPU is
+  // known to support it
+  const Kernels<T>* kernels = nullptr;
+  if (isa >= kAvx512) kernels = Avx512Kernels<T>();
+  if (kernels == nullptr && isa >= kAvx2) kernels = Avx2Kernels<T>();
+  return kernels != nullptr ? kernels : ScalarKernels<T>();
+}
+
+}  // namespace
+
+template <typename T>
+const Kernels<T>* GetKernels() {
+  return ScalarKernels<T>();
+}
+
+template <>
+const Kernels<float>* GetKernels<float>() {
+  return VectorKernels<float>();
+}
+
+template <>
+const Kernels<double>* GetKernels<double>() {
+  return VectorKernels<double>();
+}
+
+template const Kernels<int>* GetKernels<int>();
+
+}  // namespace simd
+
+}  // namespace multiverso
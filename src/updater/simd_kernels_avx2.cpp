@@ -0,0 +1,66 @@
+// Built with AVX2 and FMA enabled, see src/CMakeLists.txt
+#include "simd_kernels_vec.h"
+
+namespace multiverso {
+
+namespace simd {
+
+#if defined(MULTIVERSO_SIMD_X86) && defined(__AVX2__)
+
+namespace {
+
+struct Avx2Float {
+  typedef float Elem;
+  typedef __m256 Reg;
+  enum { kWidth = 8 };
+  static const char* Isa() { return "avx2"; }
+  static Reg Load(const float* p) { return _mm256_loadu_ps(p); }
+  static void Store(float* p, Reg a) { _mm256_storeu_ps(p, a); }
+  static Reg Set1(float a) { return _mm256_set1_ps(a); }
+  static Reg Add(Reg a, Reg b) { return _mm256_add_ps(a, b); }
+  static Reg Sub(Reg a, Reg b) { return _mm256_sub_ps(a, b); }
+  static Reg Mul(Reg a, Reg b) { return _mm256_mul_ps(a, b); }
+  static Reg Div(Reg a, Reg b) { return _mm256_div_ps(a, b); }
+  static Reg Sqrt(Reg a) { return _mm256_sqrt_ps(a); }
+};
+
+struct Avx2Double {
+  typedef double Elem;
+  typedef __m256d Reg;
+  enum { kWidth = 4 };
+  static const char* Isa() { return "avx2"; }
+  static Reg Load(const double* p) { return _mm256_loadu_pd(p); }
+  static void Store(double* p, Reg a) { _mm256_storeu_pd(p, a); }
+  static Reg Set1(double a) { return _mm256_set1_pd(a); }
+  static Reg Add(Reg a, Reg b) { return _mm256_add_pd(a, b); }
+  static Reg Sub(Reg a, Reg b) { return _mm256_sub_pd(a, b); }
+  static Reg Mul(Reg a, Reg b) { return _mm256_mul_pd(a, b); }
+  static Reg Div(Reg a, Reg b) { return _mm256_div_pd(a, b); }
+  static Reg Sqrt(Reg a) { return _mm256_sqrt_pd(a); }
+};
+
+}  // namespace
+
+template <>
+const Kernels<float>* Avx2Kernels<float>() {
+  return VecKernels<Avx2Float>::Get();
+}
+
+template <>
+const Kernels<double>* Avx2Kernels<double>() {
+  return VecKernels<Avx2Double>::Get();
+}
+
+#else
+
+template <>
+const Kernels<float>* Avx2Kernels<float>() { return nullptr; }
+
+template <>
+const Kernels<double>* Avx2Kernels<double>() { return nullptr; }
+
+#endif
+
+}  // namespace simd
+
+}  // namespace multiverso
@@ -0,0 +1,69 @@
+// Built with AVX-512F enabled, see src/CMakeLists.txt
+#include "simd_kernels_vec.h"
+
+namespace multiverso {
+
+namespace simd {
+
+#if defined(MULTIVERSO_SIMD_X86) && defined(__AVX512F__)
+
+namespace {
+
+struct Avx512Float {
+  typedef float Elem;
+  typedef __m512 Reg;
+  enum { kWidth = 16 };
+  static const char* Isa() { return "avx512"; }
+  static Reg Load(const float* p) { return _mm512_loadu_ps(p); }
+  static void Store(float* p, Reg a) { _mm512_storeu_ps(p, a); }
+  static Reg Set1(float a) { return _mm512_set1_ps(a); }
+  static Reg Add(Reg a, Reg b) { return _mm512_add_ps(a, b); }
+  static Reg Sub(Reg a, Reg b) { return _mm512_sub_ps(a, b); }
+  static Reg Mul(Reg a, Reg b) { return _mm512_mul_ps(a, b); }
+  static Reg Div(Reg a, Reg b) { return _mm512_div_ps(a, b); }
+  // all lanes selected: the masked form takes a as its pass through source
+  // where _mm512_sqrt_ps passes an undefined register, which GCC reports
+  // as maybe uninitialized
+  static Reg Sqrt(Reg a) { return _mm512_mask_sqrt_ps(a, 0xFFFF, a); }
+};
+
+struct Avx512Double {
+  typedef double Elem;
+  typedef __m512d Reg;
+  enum { kWidth = 8 };
+  static const char* Isa() { return "avx512"; }
+  static Reg Load(const double* p) { return _mm512_loadu_pd(p); }
+  static void Store(double* p, Reg a) { _mm512_storeu_pd(p, a); }
+  static Reg Set1(double a) { return _mm512_set1_pd(a); }
+  static Reg Add(Reg a, Reg b) { return _mm512_add_pd(a, b); }
+  static Reg Sub(Reg a, Reg b) { return _mm512_sub_pd(a, b); }
+  static Reg Mul(Reg a, Reg b) { return _mm512_mul_pd(a, b); }
+  static Reg Div(Reg a, Reg b) { return _mm512_div_pd(a, b); }
+  static Reg Sqrt(Reg a) { return _mm512_mask_sqrt_pd(a, 0xFF, a); }
+};
+
+}  // namespace
+
+template <>
+const Kernels<float>* Avx512Kernels<float>() {
+  return VecKernels<Avx512Float>::Get();
+}
+
+template <>
+const Kernels<double>* Avx512Kernels<double>() {
+  return VecKernels<Avx512Double>::Get();
+}
+
+#else
+
+template <>
+const Kernels<float>* Avx512Kernels<float>() { return nullptr; }
+
+template <>
+const Kernels<double>* Avx512Kernels<double>() { return nullptr; }
+
+#endif
+
+}  // namespace simd
+
+}  // namespace multiverso
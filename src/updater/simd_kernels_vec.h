@@ -0,0 +1,144 @@
+/*!
+ * \brief Vector kernels shared by the instruction set specific sources
+ *        simd_kernels_avx2.cpp and simd_kernels_avx512.cpp. Everything
+ *        built from here has internal linkage, so that no code compiled
+ *        for a wider instruction set can be picked by the linker for the
+ *        scalar path
+ */
+
+#ifndef MULTIVERSO_UPDATER_SIMD_KERNELS_VEC_H_
+#define MULTIVERSO_UPDATER_SIMD_KERNELS_VEC_H_
+
+#include <cstring>
+
+#include "multiverso/updater/simd_kernels.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define MULTIVERSO_SIMD_X86
+#include <immintrin.h>
+#endif
+
+namespace multiverso {
+
+namespace simd {
+
+// Kernels of each instruction set, nullptr when the source was not built
+// for it (compiler flags in src/CMakeLists.txt)
+template <typename T>
+const Kernels<T>* Avx2Kernels();
+
+template <typename T>
+const Kernels<T>* Avx512Kernels();
+
+namespace {
+
+// V describes one vector register: Elem, Reg, kWidth, Isa() and the
+// Load, Store, Set1, Add, Sub, Mul, Div and Sqrt operations
+template <typename V>
+struct VecKernels {
+  typedef typename V::Elem T;
+  typedef typename V::Reg R;
+
+  // The last n < kWidth elements go through zero padded copies, so that
+  // no scalar math is compiled for this instruction set
+  class Tail {
+  public:
+    explicit Tail(size_t n) : n_(n) { memset(buffer_, 0, sizeof(buffer_)); }
+    T* In(int k, const T* p) {
+      memcpy(buffer_[k], p, n_ * sizeof(T));
+      return buffer_[k];
+    }
+    void Out(int k, T* p) const { memcpy(p, buffer_[k], n_ * sizeof(T)); }
+  private:
+    size_t n_;
+    T buffer_[3][V::kWidth];
+  };
+
+  static void AddBlock(T* data, const T* delta) {
+    V::Store(data, V::Add(V::Load(data), V::Load(delta)));
+  }
+
+  static void SubBlock(T* data, const T* delta) {
+    V::Store(data, V::Sub(V::Load(data), V::Load(delta)));
+  }
+
+  static void MomentumBlock(T* data, T* smooth, const T* delta,
+                            R momentum, R one_minus_momentum) {
+    R s = V::Add(V::Mul(momentum, V::Load(smooth)),
+                 V::Mul(one_minus_momentum, V::Load(delta)));
+    V::Store(smooth, s);
+    V::Store(data, V::Sub(V::Load(data), s));
+  }
+
+  static void AdaGradBlock(T* data, T* g_sqr, const T* delta,
+                           R inv_lr, R rho, R e) {
+    R g = V::Mul(V::Load(delta), inv_lr);
+    R s = V::Add(V::Load(g_sqr), V::Mul(g, g));
+    V::Store(g_sqr, s);
+    R step = V::Div(V::Mul(rho, g), V::Sqrt(V::Add(s, e)));
+    V::Store(data, V::Sub(V::Load(data), step));
+  }
+
+  static void Add(size_t n, T* data, const T* delta) {
+    size_t i = 0;
+    for (; i + V::kWidth <= n; i += V::kWidth) AddBlock(data + i, delta + i);
+    if (i == n) return;
+    Tail tail(n - i);
+    AddBlock(tail.In(0, data + i), tail.In(1, delta + i));
+    tail.Out(0, data + i);
+  }
+
+  static void Sub(size_t n, T* data, const T* delta) {
+    size_t i = 0;
+    for (; i + V::kWidth <= n; i += V::kWidth) SubBlock(data + i, delta + i);
+    if (i == n) return;
+    Tail tail(n - i);
+    SubBlock(tail.In(0, data + i), tail.In(1, delta + i));
+    tail.Out(0, data + i);
+  }
+
+  static void Momentum(size_t n, T* data, T* smooth, const T* delta,
+                       T momentum) {
+    R m = V::Set1(momentum), one_minus_m = V::Set1(1 - momentum);
+    size_t i = 0;
+    for (; i + V::kWidth <= n; i += V::kWidth) {
+      MomentumBlock(data + i, smooth + i, delta + i, m, one_minus_m);
+    }
+    if (i == n) return;
+    Tail tail(n - i);
+    MomentumBlock(tail.In(0, data + i), tail.In(1, smooth + i),
+                  tail.In(2, delta + i), m, one_minus_m);
+    tail.Out(0, data + i);
+    tail.Out(1, smooth + i);
+  }
+
+  static void AdaGrad(size_t n, T* data, T* g_sqr, const T* delta,
+                      T learning_rate, T rho, T e) {
+    R r_inv_lr = V::Set1(1 / learning_rate);
+    R r_rho = V::Set1(rho), r_e = V::Set1(e);
+    size_t i = 0;
+    for (; i + V::kWidth <= n; i += V::kWidth) {
+      AdaGradBlock(data + i, g_sqr + i, delta + i, r_inv_lr, r_rho, r_e);
+    }
+    if (i == n) return;
+    Tail tail(n - i);
+    AdaGradBlock(tail.In(0, data + i), tail.In(1, g_sqr + i),
+                 tail.In(2, delta + i), r_inv_lr, r_rho, r_e);
+    tail.Out(0, data + i);
+    tail.Out(1, g_sqr + i);
+  }
+
+  static const Kernels<T>* Get() {
+    static const Kernels<T> kernels = {
+      Add, Sub, Momentum, AdaGrad, V::Isa() };
+    return &kernels;
+  }
+};
+
+}  // namespace
+
+}  // namespace simd
+
+}  // namespace multiverso
+
+#endif  // MULTIVERSO_UPDATER_SIMD_KERNELS_VEC_H_
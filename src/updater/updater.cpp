@@ -1,4 +1,7 @@
 #include "multiverso/updater/updater.h"
+
+#include <algorithm>
+
 // TODO(qiwye) to make this a option in CMakelist
 //#define ENABLE_DCASGD
 
@@ -22,10 +25,39 @@ template <typename T>
 void Updater<T>::Update(size_t num_element, T* data, T* delta,
                         AddOption*, size_t offset) {
   // parallelism with openMP
-  #pragma omp parallel for schedule(static) num_threads(MV_CONFIG_omp_threads)
-  for (int i = 0; i < num_element; ++i) {
-    data[i + offset] += delta[i];
-  }
+  auto add = kernels_->add;
+  ForEachBlock(num_element, [=](size_t begin, size_t count) {
+    add(count, data + offset + begin, delta + begin);
+  });
+}
+
+template <typename T>
+void Updater<T>::UpdateRows(size_t num_rows, size_t row_size,
+                            const integer_t* rows, T* data, T* delta,
+                            AddOption*, const size_t* positions) {
+  auto add = kernels_->add;
+  ForEachRow(num_rows, row_size, rows, positions,
+             [=](size_t offset, size_t offset_d) {
+    add(row_size, data + offset, delta + offset_d);
+  });
+}
+
+namespace {
+// see SetSerialUpdates
+thread_local bool g_serial_updates = false;
+}
+
+void SetSerialUpdates(bool serial) { g_serial_updates = serial; }
+
+template <typename T>
+int Updater<T>::NumThreads(size_t num_element) {
+  if (g_serial_updates) return 1;
+  // a parallel region costs about as much as updating this many elements
+  const size_t kMinElementPerThread = 1 << 15;
+  size_t max_threads = num_element / kMinElementPerThread;
+  if (max_threads < 1) return 1;
+  return static_cast<int>(std::min(max_threads,
+    static_cast<size_t>(MV_CONFIG_omp_threads)));
 }
 
 template <typename T>
@@ -56,6 +88,23 @@ Updater<T>* Updater<T>::GetUpdater(size_t size) {
   return new Updater<T>();
 }
 
+template<>
+int Updater<int>::DeltaSign() {
+  return 1;
+}
+
+template <typename T>
+int Updater<T>::DeltaSign() {
+  // as chosen by GetUpdater
+  std::string type = MV_CONFIG_updater_type;
+  if (type == "sgd") return -1;
+  if (type == "adagrad" || type == "momentum_sgd") return 0;
+#ifdef ENABLE_DCASGD
+  if (type == "dcasgd" || type == "dcasgda") return 0;
+#endif
+  return 1;
+}
+
 MV_INSTANTIATE_CLASS_WITH_BASE_TYPE(Updater);
 
 }
\ No newline at end of file
@@ -1,7 +1,12 @@
 #include "multiverso/util/allocator.h"
 
+#include <algorithm>
 #include <mutex>
+#include <sstream>
+#include <string>
+#include <unordered_set>
 
+#include "multiverso/dashboard.h"
 #include "multiverso/util/log.h"
 #include "multiverso/util/configure.h"
 
@@ -29,9 +34,52 @@ inline void AlignFree(char *data) {
 #endif
 }
 
+MV_DEFINE_int(allocator_pool_limit_mb, 0, "max MB of free memory pooled per size class by smart allocator, 0 for no limit");
+
+// Dashboard entry of a size class. The value of the Gauge is the number of
+// bytes in live blocks
+class SizeClassStats : public Gauge {
+public:
+  explicit SizeClassStats(size_t block_size) :
+    Gauge("ALLOCATOR_CLASS_" + std::to_string(block_size)),
+    block_size_(block_size), num_blocks_(0), waste_(0) {}
+
+  void OnAlloc(size_t requested) {
+    Add(block_size_);
+    waste_ += block_size_ - requested;
+  }
+
+  void OnFree(size_t requested) {
+    Add(-static_cast<long long>(block_size_));
+    waste_ -= block_size_ - requested;
+  }
+
+  void OnNewBlock() { ++num_blocks_; }
+  void OnDeleteBlock() { --num_blocks_; }
+
+  // bytes of the blocks allocated but not live, in free lists and caches
+  long long pooled() const { return num_blocks_ * block_size_ - value(); }
+
+  std::string info_string() const override {
+    std::ostringstream oss;
+    oss << "[" << name() << "] "
+        << " live = " << value() << " bytes"
+        << " peak = " << peak() << " bytes"
+        << " pooled = " << pooled() << " bytes"
+        << " waste = " << waste_ << " bytes";
+    return oss.str();
+  }
+
+private:
+  long long block_size_;
+  std::atomic<long long> num_blocks_;
+  std::atomic<long long> waste_;
+};
+
 inline FreeList::FreeList(size_t size) : size_(size) {
   mutex_ = new std::mutex();
-  free_ = new MemoryBlock(size, this);
+  stats_ = new SizeClassStats(size);
+  free_ = NewBlock();
 }
 
 FreeList::~FreeList() {
@@ -42,12 +90,33 @@ FreeList::~FreeList() {
     move = next;
   }
   delete mutex_;
+  delete stats_;
+}
+
+inline MemoryBlock* FreeList::NewBlock() {
+  stats_->OnNewBlock();
+  return new MemoryBlock(size_, this);
+}
+
+bool FreeList::over_limit() const {
+  long long limit = static_cast<long long>(MV_CONFIG_allocator_pool_limit_mb) << 20;
+  return limit > 0 && stats_->pooled() > limit;
+}
+
+inline void FreeList::PushLocked(MemoryBlock* block) {
+  if (over_limit()) {
+    stats_->OnDeleteBlock();
+    delete block;
+    return;
+  }
+  block->next = free_;
+  free_ = block;
 }
 
 inline char* FreeList::Pop() {
   std::lock_guard<std::mutex> lock(*mutex_);
   if (free_ == nullptr) {
-    free_ = new MemoryBlock(size_, this);
+    free_ = NewBlock();
   }
   char* data = free_->data();
   free_ = free_->next;
@@ -56,12 +125,49 @@ inline char* FreeList::Pop() {
 
 inline void FreeList::Push(MemoryBlock*block) {
   std::lock_guard<std::mutex> lock(*mutex_);
-  block->next = free_;
-  free_ = block;
+  PushLocked(block);
+}
+
+int FreeList::PopBatch(MemoryBlock** blocks, int n) {
+  std::lock_guard<std::mutex> lock(*mutex_);
+  int count = 0;
+  while (count < n && free_ != nullptr) {
+    blocks[count++] = free_;
+    free_ = free_->next;
+  }
+  if (count == 0) {
+    blocks[count++] = NewBlock();
+  }
+  return count;
+}
+
+void FreeList::PushBatch(MemoryBlock** blocks, int n) {
+  std::lock_guard<std::mutex> lock(*mutex_);
+  for (int i = 0; i < n; ++i) {
+    PushLocked(blocks[i]);
+  }
+}
+
+size_t FreeList::Trim() {
+  MemoryBlock* move;
+  {
+    std::lock_guard<std::mutex> lock(*mutex_);
+    move = free_;
+    free_ = nullptr;
+  }
+  size_t released = 0;
+  while (move) {
+    MemoryBlock* next = move->next;
+    stats_->OnDeleteBlock();
+    delete move;
+    released += size_;
+    move = next;
+  }
+  return released;
 }
 
 inline MemoryBlock::MemoryBlock(size_t size, FreeList* list) :
-next(nullptr), ref_(0) {
+next(nullptr), requested_size(0), ref_(0) {
   data_ = AlignMalloc(size + header_size_);
   *(FreeList**)(data_) = list;
   *(MemoryBlock**)(data_ + g_pointer_size) = this;
@@ -71,10 +177,8 @@ MemoryBlock::~MemoryBlock() {
   AlignFree(data_);
 }
 
-inline void MemoryBlock::Unlink() {
-  if ((--ref_) == 0) {
-    (*(FreeList**)data_)->Push(this);
-  }
+inline bool MemoryBlock::Unlink() {
+  return (--ref_) == 0;
 }
 
 inline char* MemoryBlock::data() {
@@ -86,48 +190,189 @@ inline void MemoryBlock::Link() {
   ++ref_;
 }
 
-char* SmartAllocator::Alloc(size_t size) {
-  if (size <= 32) {
-    size = 32;
+MV_DEFINE_bool(allocator_thread_cache, true, "cache free blocks per thread in smart allocator");
+
+namespace {
+
+// Magazines of free blocks owned by one thread, one per size class. Blocks
+// move between a magazine and the shared FreeList in batches, so that most
+// Alloc and Free take no lock at all. A magazine holds at most
+// kMagazineBytes (and at least 2 blocks), its blocks count as pooled
+// against flag allocator_pool_limit_mb like those of the FreeList
+class ThreadCache {
+public:
+  // only small blocks are cached, large ones go to the FreeList directly
+  static const int kMaxSizeClass = 20;
+  static const int kMagazineSize = 32;
+  static const size_t kMagazineBytes = 256 << 10;
+
+  ThreadCache() : trim_(false) {
+    for (auto& magazine : magazines_) magazine.count = 0;
+    std::lock_guard<std::mutex> lock(*registry_mutex());
+    registry()->insert(this);
   }
-  else { // 2^n
-    size -= 1;
-    size |= size >> 32;
-    size |= size >> 16;
-    size |= size >> 8;
-    size |= size >> 4;
-    size |= size >> 2;
-    size |= size >> 1;
-    size += 1;
+
+  ~ThreadCache() {
+    {
+      std::lock_guard<std::mutex> lock(*registry_mutex());
+      registry()->erase(this);
+    }
+    Flush(false);
   }
 
-  {
+  // Return all cached blocks to their free lists, and release the free
+  // blocks of these lists if trim
+  void Flush(bool trim) {
+    trim_.store(false, std::memory_order_relaxed);
+    for (auto& magazine : magazines_) {
+      if (magazine.count > 0) {
+        FreeList* list = magazine.blocks[0]->list();
+        list->PushBatch(magazine.blocks, magazine.count);
+        magazine.count = 0;
+        if (trim) list->Trim();
+      }
+    }
+  }
+
+  // Ask every thread to release its cached blocks. The caches are owned by
+  // their threads, each one is trimmed on its next Alloc or Free
+  static void TrimAll() {
+    std::lock_guard<std::mutex> lock(*registry_mutex());
+    for (auto cache : *registry()) {
+      cache->trim_.store(true, std::memory_order_relaxed);
+    }
+  }
+
+  MemoryBlock* Pop(FreeList* list, int size_class) {
+    if (trim_.load(std::memory_order_relaxed)) Flush(true);
+    Magazine& magazine = magazines_[size_class];
+    if (magazine.count == 0) {
+      magazine.count = list->PopBatch(magazine.blocks,
+                                      Capacity(size_class) / 2);
+    }
+    return magazine.blocks[--magazine.count];
+  }
+
+  void Push(MemoryBlock* block, int size_class) {
+    if (trim_.load(std::memory_order_relaxed)) Flush(true);
+    // over the limit the block is released by the FreeList
+    if (block->list()->over_limit()) {
+      block->list()->Push(block);
+      return;
+    }
+    Magazine& magazine = magazines_[size_class];
+    int capacity = Capacity(size_class);
+    if (magazine.count == capacity) {
+      int batch = capacity / 2;
+      magazine.count -= batch;
+      block->list()->PushBatch(magazine.blocks + magazine.count, batch);
+    }
+    magazine.blocks[magazine.count++] = block;
+  }
+
+private:
+  static int Capacity(int size_class) {
+    size_t blocks = kMagazineBytes >> size_class;
+    return static_cast<int>(std::max(static_cast<size_t>(2),
+      std::min(blocks, static_cast<size_t>(kMagazineSize))));
+  }
+
+  // caches of all the threads, see TrimAll. Never destroyed, the caches of
+  // the threads still running at exit unregister after static destruction
+  static std::mutex* registry_mutex() {
+    static std::mutex* mutex = new std::mutex();
+    return mutex;
+  }
+  static std::unordered_set<ThreadCache*>* registry() {
+    static auto caches = new std::unordered_set<ThreadCache*>();
+    return caches;
+  }
+
+  struct Magazine {
+    MemoryBlock* blocks[kMagazineSize];
+    int count;
+  };
+  Magazine magazines_[kMaxSizeClass + 1];
+  std::atomic<bool> trim_;
+};
+
+thread_local ThreadCache g_thread_cache;
+
+}  // namespace
+
+int SmartAllocator::SizeClass(size_t size) {
+  int size_class = 5;  // at least 32 bytes
+  while ((static_cast<size_t>(1) << size_class) < size) ++size_class;
+  return size_class;
+}
+
+FreeList* SmartAllocator::GetFreeList(int size_class) {
+  FreeList* list = pools_[size_class].load(std::memory_order_acquire);
+  if (list == nullptr) {
     std::lock_guard<std::mutex> lock(*mutex_);
-    if (pools_[size] == nullptr) {
-      pools_[size] = new FreeList(size);
+    list = pools_[size_class].load();
+    if (list == nullptr) {
+      list = new FreeList(static_cast<size_t>(1) << size_class);
+      pools_[size_class].store(list, std::memory_order_release);
     }
   }
+  return list;
+}
 
-  return pools_[size]->Pop();
+char* SmartAllocator::Alloc(size_t size) {
+  int size_class = SizeClass(size);
+  FreeList* list = GetFreeList(size_class);
+  char* data;
+  if (MV_CONFIG_allocator_thread_cache &&
+      size_class <= ThreadCache::kMaxSizeClass) {
+    data = g_thread_cache.Pop(list, size_class)->data();
+  } else {
+    data = list->Pop();
+  }
+  (*(MemoryBlock**)(data - g_pointer_size))->requested_size = size;
+  list->stats()->OnAlloc(size);
+  return data;
 }
 
 void SmartAllocator::Free(char *data) {
-  (*(MemoryBlock**)(data - g_pointer_size))->Unlink();
+  MemoryBlock* block = *(MemoryBlock**)(data - g_pointer_size);
+  if (!block->Unlink()) return;
+  block->list()->stats()->OnFree(block->requested_size);
+  int size_class = SizeClass(block->list()->size());
+  if (MV_CONFIG_allocator_thread_cache &&
+      size_class <= ThreadCache::kMaxSizeClass) {
+    g_thread_cache.Push(block, size_class);
+  } else {
+    block->list()->Push(block);
+  }
 }
 
 void SmartAllocator::Refer(char *data) {
   (*(MemoryBlock**)(data - g_pointer_size))->Link();
 }
 
+size_t SmartAllocator::Trim() {
+  ThreadCache::TrimAll();
+  g_thread_cache.Flush(false);
+  size_t released = 0;
+  for (auto& pool : pools_) {
+    FreeList* list = pool.load();
+    if (list != nullptr) released += list->Trim();
+  }
+  Log::Debug("SmartAllocator trimmed %lld bytes\n", (long long)released);
+  return released;
+}
+
 SmartAllocator::SmartAllocator() {
   mutex_ = new std::mutex();
+  for (auto& pool : pools_) pool.store(nullptr);
 }
 
 SmartAllocator::~SmartAllocator() {
-  Log::Debug("~SmartAllocator, final pool size: %d\n", pools_.size());
+  Log::Debug("~SmartAllocator\n");
   delete mutex_;
-  for (auto i : pools_) {
-    delete i.second;
+  for (auto& pool : pools_) {
+    delete pool.load();
   }
 }
 
@@ -151,7 +396,9 @@ void Allocator::Refer(char* data) {
 }
 
 MV_DEFINE_string(allocator_type, "smart", "use smart allocator by default");
-Allocator* Allocator::Get() {
+namespace {
+
+Allocator* CreateAllocator() {
   if (MV_CONFIG_allocator_type == "smart") {
     static SmartAllocator allocator_;
     return &allocator_;
@@ -160,4 +407,13 @@ Allocator* Allocator::Get() {
   return &allocator_;
 }
 
+}  // namespace
+
+// The allocator is chosen on first use: memory must always be freed by the
+// allocator it came from. This also keeps the flag lookup off the hot path
+Allocator* Allocator::Get() {
+  static Allocator* allocator = CreateAllocator();
+  return allocator;
+}
+
 } // namespace multiverso 
@@ -0,0 +1,27 @@
+#include "multiverso/util/block_versions.h"
+
+#include <atomic>
+
+namespace multiverso {
+
+struct BlockVersions::Clock {
+  std::atomic<int64_t> value;
+};
+
+BlockVersions::BlockVersions() : block_size_(0), clock_(new Clock()) {
+  clock_->value = 0;
+}
+
+BlockVersions::~BlockVersions() {
+  delete clock_;
+}
+
+int64_t BlockVersions::Tick() {
+  return ++clock_->value;
+}
+
+int64_t BlockVersions::clock() const {
+  return clock_->value.load();
+}
+
+}  // namespace multiverso
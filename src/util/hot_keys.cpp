@@ -0,0 +1,18 @@
+#include "multiverso/util/hot_keys.h"
+
+#include "multiverso/util/configure.h"
+#include "multiverso/util/log.h"
+
+namespace multiverso {
+
+MV_DECLARE_bool(sync);
+
+bool HotKeys::Init(int num_replicas, int num_servers) {
+  CHECK(num_replicas >= 1 && num_servers >= 1);
+  num_servers_ = num_servers;
+  num_replicas_ = num_replicas < num_servers ? num_replicas : num_servers;
+  if (MV_CONFIG_sync) num_replicas_ = 1;
+  return enabled();
+}
+
+}  // namespace multiverso
@@ -12,6 +12,7 @@
 #include <arpa/inet.h>
 #include <ifaddrs.h>
 #include <netinet/in.h>
+#include <unistd.h>
 #endif
 
 namespace multiverso {
@@ -68,6 +69,15 @@ void GetLocalIPAddress(std::unordered_set<std::string>* result) {
     FREE(pAdapterInfo);
 }
 
+std::string GetHostName() {
+  char name[MAX_COMPUTERNAME_LENGTH + 1];
+  DWORD size = sizeof(name);
+  if (!GetComputerNameA(name, &size)) {
+    Log::Fatal("GetComputerName failed with error: %d\n", GetLastError());
+  }
+  return std::string(name, size);
+}
+
 #else
 
 void GetLocalIPAddress(std::unordered_set<std::string>* result) {
@@ -95,6 +105,14 @@ void GetLocalIPAddress(std::unordered_set<std::string>* result) {
   return;
 }
 
+std::string GetHostName() {
+  char name[256] = { 0 };
+  if (gethostname(name, sizeof(name) - 1) != 0) {
+    Log::Fatal("gethostname failed\n");
+  }
+  return std::string(name);
+}
+
 #endif  // _MSC_VER
 
 }  // namespace net
@@ -0,0 +1,160 @@
+#include "multiverso/util/partition_map.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <utility>
+
+#include "multiverso/util/log.h"
+
+namespace multiverso {
+
+namespace {
+
+// virtual nodes of a server of average weight on the hash ring
+const int kVirtualNodes = 128;
+
+// splitmix64 finalizer, spreads consecutive block ids over the ring
+uint64_t Mix(uint64_t x) {
+  x += 0x9E3779B97F4A7C15ULL;
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+  return x ^ (x >> 31);
+}
+
+}  // namespace
+
+PartitionMap::PartitionMap(int64_t num_keys, int num_servers) :
+  PartitionMap(PartitionOption(), num_keys, num_servers) {}
+
+PartitionMap::PartitionMap(const PartitionOption& option, int64_t num_keys,
+  int num_servers) : strategy_(option.strategy), num_keys_(num_keys),
+  num_servers_(num_servers), block_size_(option.block_size) {
+  CHECK(num_servers_ > 0 && num_keys_ >= 0);
+  switch (strategy_) {
+  case PartitionStrategy::kUniformRange:
+    InitUniform();
+    break;
+  case PartitionStrategy::kWeightedRange:
+    InitWeighted(option.weights);
+    break;
+  case PartitionStrategy::kLoadAwareRange:
+    InitLoadAware(option.weights);
+    break;
+  case PartitionStrategy::kHashedBlock:
+    InitHashed(option.weights);
+    break;
+  default:
+    Log::Fatal("[PartitionMap] unknown strategy %d\n",
+               static_cast<int>(strategy_));
+  }
+}
+
+int PartitionMap::Server(int64_t key) const {
+  switch (strategy_) {
+  case PartitionStrategy::kUniformRange: {
+    int64_t small = num_keys_ / num_servers_;
+    int64_t num_large = num_keys_ % num_servers_;
+    int64_t large_keys = num_large * (small + 1);
+    if (key < large_keys) return static_cast<int>(key / (small + 1));
+    return static_cast<int>(num_large + (key - large_keys) / small);
+  }
+  case PartitionStrategy::kHashedBlock: {
+    uint64_t hash = Mix(static_cast<uint64_t>(key) / block_size_);
+    auto it = std::upper_bound(ring_.begin(), ring_.end(), hash);
+    if (it == ring_.end()) it = ring_.begin();
+    return ring_server_[it - ring_.begin()];
+  }
+  default: {
+    // the first server ending after key, empty ranges never match
+    auto it = std::upper_bound(offsets_.begin() + 1, offsets_.end(), key);
+    return static_cast<int>(it - offsets_.begin() - 1);
+  }
+  }
+}
+
+void PartitionMap::InitUniform() {
+  int64_t small = num_keys_ / num_servers_;
+  int64_t num_large = num_keys_ % num_servers_;
+  offsets_.resize(num_servers_ + 1);
+  for (int i = 0; i <= num_servers_; ++i) {
+    offsets_[i] = i * small + std::min<int64_t>(i, num_large);
+  }
+}
+
+void PartitionMap::InitWeighted(const std::vector<double>& weights) {
+  CHECK(weights.size() == static_cast<size_t>(num_servers_));
+  double total = 0;
+  for (auto weight : weights) {
+    CHECK(weight >= 0);
+    total += weight;
+  }
+  CHECK(total > 0);
+  offsets_.assign(1, 0);
+  double sum = 0;
+  for (int i = 0; i < num_servers_ - 1; ++i) {
+    sum += weights[i];
+    offsets_.push_back(std::min(num_keys_,
+      static_cast<int64_t>(std::llround(num_keys_ * (sum / total)))));
+  }
+  offsets_.push_back(num_keys_);
+}
+
+void PartitionMap::InitLoadAware(const std::vector<double>& load) {
+  CHECK(!load.empty() && num_keys_ > 0);
+  int64_t num_blocks = static_cast<int64_t>(load.size());
+  int64_t keys_per_block = (num_keys_ + num_blocks - 1) / num_blocks;
+  double total = 0;
+  for (auto block_load : load) {
+    CHECK(block_load >= 0);
+    total += block_load;
+  }
+  if (total == 0) {
+    InitUniform();
+    return;
+  }
+  // cut between blocks, each boundary at the prefix load closest to the
+  // share of the servers before it
+  offsets_.assign(1, 0);
+  double prefix = 0;
+  int64_t block = 0;
+  for (int i = 1; i < num_servers_; ++i) {
+    double target = total * i / num_servers_;
+    while (block < num_blocks && prefix + load[block] <= target) {
+      prefix += load[block++];
+    }
+    if (block < num_blocks &&
+        prefix + load[block] - target < target - prefix) {
+      prefix += load[block++];
+    }
+    offsets_.push_back(std::min(num_keys_, block * keys_per_block));
+  }
+  offsets_.push_back(num_keys_);
+}
+
+void PartitionMap::InitHashed(const std::vector<double>& weights) {
+  CHECK(block_size_ > 0);
+  CHECK(weights.empty() ||
+        weights.size() == static_cast<size_t>(num_servers_));
+  double mean = weights.empty() ? 1.0 :
+    std::accumulate(weights.begin(), weights.end(), 0.0) / num_servers_;
+  CHECK(mean > 0);
+  std::vector<std::pair<uint64_t, int>> nodes;
+  for (int server = 0; server < num_servers_; ++server) {
+    double weight = weights.empty() ? 1.0 : weights[server];
+    CHECK(weight >= 0);
+    int num_nodes = static_cast<int>(std::lround(kVirtualNodes * weight / mean));
+    if (weight > 0) num_nodes = std::max(num_nodes, 1);
+    for (int node = 0; node < num_nodes; ++node) {
+      uint64_t id = (static_cast<uint64_t>(server) << 32) | node;
+      nodes.push_back(std::make_pair(Mix(~id), server));
+    }
+  }
+  std::sort(nodes.begin(), nodes.end());
+  for (auto& node : nodes) {
+    ring_.push_back(node.first);
+    ring_server_.push_back(node.second);
+  }
+}
+
+}  // namespace multiverso
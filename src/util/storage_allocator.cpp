@@ -0,0 +1,134 @@
+#include "multiverso/util/storage_allocator.h"
+
+#include <cerrno>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "multiverso/util/configure.h"
+#include "multiverso/util/log.h"
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace multiverso {
+
+MV_DEFINE_string(storage_huge_page, "none", "page size of server table storage, none / transparent (madvise huge pages) / explicit (hugetlbfs pages, falls back to transparent)");
+MV_DEFINE_string(storage_numa, "default", "NUMA placement of server table storage, default (first touch by the server thread) / interleave (across all online nodes)");
+
+namespace storage {
+
+namespace {
+
+#ifdef __linux__
+const size_t kHugePageSize = 2 * 1024 * 1024;
+const int kMpolInterleave = 3;
+
+size_t MappedSize(size_t bytes) {
+  return (bytes + kHugePageSize - 1) / kHugePageSize * kHugePageSize;
+}
+
+// parse /sys/devices/system/node/online, e.g. "0-3,6"
+std::vector<unsigned long> OnlineNodeMask(unsigned long* max_node) {
+  std::vector<unsigned long> mask;
+  *max_node = 0;
+  std::ifstream in("/sys/devices/system/node/online");
+  std::string range;
+  const unsigned long bits = 8 * sizeof(unsigned long);
+  while (std::getline(in, range, ',')) {
+    unsigned long first = 0, last = 0;
+    char dash;
+    std::istringstream ss(range);
+    if (!(ss >> first)) continue;
+    last = (ss >> dash >> last) ? last : first;
+    for (unsigned long node = first; node <= last; ++node) {
+      if (mask.size() <= node / bits) mask.resize(node / bits + 1, 0);
+      mask[node / bits] |= 1UL << (node % bits);
+      if (node + 1 > *max_node) *max_node = node + 1;
+    }
+  }
+  return mask;
+}
+
+void Interleave(void* p, size_t bytes) {
+  unsigned long max_node;
+  std::vector<unsigned long> mask = OnlineNodeMask(&max_node);
+  if (mask.empty()) {
+    Log::Error("[Storage] no online NUMA node found, interleave ignored\n");
+    return;
+  }
+  // maxnode counts one past the highest node bit, as the kernel expects
+  if (syscall(SYS_mbind, p, bytes, kMpolInterleave, mask.data(),
+              max_node + 1, 0) != 0) {
+    Log::Error("[Storage] mbind interleave failed, errno = %d\n", errno);
+  }
+}
+
+void* Map(size_t bytes) {
+  size_t size = MappedSize(bytes);
+  void* p = MAP_FAILED;
+  if (MV_CONFIG_storage_huge_page == "explicit") {
+#ifdef MAP_HUGETLB
+    p = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+    if (p == MAP_FAILED) {
+      Log::Info("[Storage] no explicit huge pages for %lld bytes, "
+                "using transparent huge pages\n",
+                static_cast<long long>(size));
+    }
+  }
+  if (p == MAP_FAILED) {
+    p = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) throw std::bad_alloc();
+#ifdef MADV_HUGEPAGE
+    if (MV_CONFIG_storage_huge_page != "none" &&
+        madvise(p, size, MADV_HUGEPAGE) != 0) {
+      Log::Debug("[Storage] madvise huge page failed, errno = %d\n", errno);
+    }
+#endif
+  }
+  if (MV_CONFIG_storage_numa == "interleave") Interleave(p, size);
+  return p;
+}
+#endif
+
+}  // namespace
+
+Mode CurrentMode() {
+#ifdef __linux__
+  if (MV_CONFIG_storage_huge_page != "none" ||
+      MV_CONFIG_storage_numa != "default") {
+    return kMapped;
+  }
+#endif
+  return kHeap;
+}
+
+void* Alloc(size_t bytes, Mode mode) {
+  if (bytes == 0) return nullptr;
+#ifdef __linux__
+  if (mode == kMapped) return Map(bytes);
+#endif
+  return ::operator new(bytes);
+}
+
+void Free(void* p, size_t bytes, Mode mode) {
+  if (p == nullptr) return;
+#ifdef __linux__
+  if (mode == kMapped) {
+    munmap(p, MappedSize(bytes));
+    return;
+  }
+#endif
+  ::operator delete(p);
+}
+
+}  // namespace storage
+
+}  // namespace multiverso
@@ -0,0 +1,58 @@
+#include "multiverso/util/up_to_date_tracker.h"
+
+#include <algorithm>
+
+#include "multiverso/util/log.h"
+
+namespace multiverso {
+
+UpToDateTracker::UpToDateTracker(size_t num_rows, int num_workers)
+  : num_rows_(num_rows), num_workers_(num_workers) {
+  CHECK(num_workers > 0);
+  size_t num_bits = num_rows * num_workers;
+  bits_.resize((num_bits + kWordBits - 1) / kWordBits, 0);
+}
+
+void UpToDateTracker::ClearRange(size_t begin, size_t end) {
+  size_t first = begin / kWordBits, last = (end - 1) / kWordBits;
+  uint64_t first_mask = ~0ULL << (begin % kWordBits);
+  uint64_t last_mask = ~0ULL >> (kWordBits - 1 - (end - 1) % kWordBits);
+  if (first == last) {
+    bits_[first] &= ~(first_mask & last_mask);
+    return;
+  }
+  bits_[first] &= ~first_mask;
+  std::fill(bits_.begin() + first + 1, bits_.begin() + last, 0);
+  bits_[last] &= ~last_mask;
+}
+
+void UpToDateTracker::Invalidate(size_t row, int except) {
+  size_t begin = row * num_workers_;
+  if (except < 0) {
+    ClearRange(begin, begin + num_workers_);
+    return;
+  }
+  size_t bit = begin + except;
+  uint64_t kept = bits_[bit / kWordBits] & (1ULL << (bit % kWordBits));
+  ClearRange(begin, begin + num_workers_);
+  bits_[bit / kWordBits] |= kept;
+}
+
+void UpToDateTracker::InvalidateAll(int except) {
+  if (except < 0) {
+    std::fill(bits_.begin(), bits_.end(), 0);
+    return;
+  }
+  for (size_t row = 0; row < num_rows_; ++row) Invalidate(row, except);
+}
+
+bool UpToDateTracker::Refresh(size_t row, int worker) {
+  size_t bit = row * num_workers_ + worker;
+  uint64_t mask = 1ULL << (bit % kWordBits);
+  uint64_t& word = bits_[bit / kWordBits];
+  bool out_of_date = (word & mask) == 0;
+  word |= mask;
+  return out_of_date;
+}
+
+}  // namespace multiverso
@@ -27,12 +27,23 @@ int Worker::RegisterTable(WorkerTable* worker_table) {
   return id;
 }
 
+void Worker::DeregisterTable(int table_id) {
+  CHECK(table_id >= 0 && table_id < static_cast<int>(cache_.size()));
+  cache_[table_id] = nullptr;
+}
+
+void Worker::FlushTables() {
+  for (auto table : cache_) {
+    if (table != nullptr) table->Flush();
+  }
+}
+
 void Worker::ProcessGet(MessagePtr& msg) {
   MONITOR_BEGIN(WORKER_PROCESS_GET)
   int table_id = msg->table_id();
   int msg_id = msg->msg_id();
   std::unordered_map<int, std::vector<Blob>> partitioned_key;
-  int num = cache_[table_id]->Partition(msg->data(),
+  int num = cache_[table_id]->Partition(msg_id, msg->data(),
                                         MsgType::Request_Get, 
                                         &partitioned_key);
   cache_[table_id]->Reset(msg_id, num);
@@ -57,7 +68,7 @@ void Worker::ProcessAdd(MessagePtr& msg) {
   std::unordered_map<int, std::vector<Blob>> partitioned_kv;
   CHECK_NOTNULL(msg.get());
   CHECK(!msg->data().empty());
-  int num = cache_[table_id]->Partition(msg->data(), 
+  int num = cache_[table_id]->Partition(msg_id, msg->data(),
                                         MsgType::Request_Add, 
                                         &partitioned_kv);
   cache_[table_id]->Reset(msg_id, num);
@@ -78,7 +89,7 @@ void Worker::ProcessAdd(MessagePtr& msg) {
 void Worker::ProcessReplyGet(MessagePtr& msg) {
   MONITOR_BEGIN(WORKER_PROCESS_REPLY_GET)
   int table_id = msg->table_id();
-  cache_[table_id]->ProcessReplyGet(msg->data());
+  cache_[table_id]->ProcessReplyGet(msg->msg_id(), msg->data());
   cache_[table_id]->Notify(msg->msg_id());
   MONITOR_END(WORKER_PROCESS_REPLY_GET)
 }
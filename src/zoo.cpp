@@ -12,6 +12,7 @@
 #include "multiverso/util/configure.h"
 #include "multiverso/util/log.h"
 #include "multiverso/util/mt_queue.h"
+#include "multiverso/util/waiter.h"
 #include "multiverso/worker.h"
 
 namespace multiverso {
@@ -50,6 +51,8 @@ void Zoo::Start(int* argc, char** argv) {
 }
 
 void Zoo::Stop(bool finalize_net) {
+  // Finish the pending aggregates
+  net::FinishAllreduces();
   // Stop the system
   if (!MV_CONFIG_ma) { StopPS(); }
   // Stop the network
@@ -162,6 +165,12 @@ void Zoo::FinishTrain() {
 
 
 void Zoo::Barrier() {
+  // the Adds kept back by the worker tables reach the servers first
+  auto worker = zoo_.find(actor::kWorker);
+  if (worker != zoo_.end()) {
+    dynamic_cast<Worker*>(worker->second)->FlushTables();
+  }
+
   MessagePtr msg(new Message());
   msg->set_src(rank());
   msg->set_dst(kController); 
@@ -175,6 +184,34 @@ void Zoo::Barrier() {
   Log::Debug("rank %d reached barrier\n", rank());
 }
 
+void Zoo::Checkpoint(const std::string& uri) {
+  SendToServer(MsgType::Server_Checkpoint, uri);
+}
+
+void Zoo::WaitCheckpoint() {
+  if (zoo_.find(actor::kServer) == zoo_.end()) return;
+  dynamic_cast<Server*>(zoo_[actor::kServer])->WaitCheckpoint();
+}
+
+void Zoo::Restore(const std::string& uri) {
+  SendToServer(MsgType::Server_Restore, uri);
+}
+
+void Zoo::SendToServer(MsgType type, const std::string& uri) {
+  if (zoo_.find(actor::kServer) == zoo_.end()) return;
+  CHECK(!uri.empty());
+  Waiter waiter;
+  Waiter* waiter_ptr = &waiter;
+  MessagePtr msg(new Message());
+  msg->set_src(rank());
+  msg->set_dst(rank());
+  msg->set_type(type);
+  msg->Push(Blob(uri.data(), uri.size()));
+  msg->Push(Blob(&waiter_ptr, sizeof(waiter_ptr)));
+  SendTo(actor::kServer, msg);
+  waiter.Wait();
+}
+
 int Zoo::RegisterTable(WorkerTable* worker_table) {
   return dynamic_cast<Worker*>(zoo_[actor::kWorker])
     ->RegisterTable(worker_table);
@@ -185,4 +222,10 @@ int Zoo::RegisterTable(ServerTable* server_table) {
     ->RegisterTable(server_table);
 }
 
+void Zoo::DeregisterTable(int worker_table_id) {
+  auto it = zoo_.find(actor::kWorker);
+  if (it == zoo_.end()) return;
+  dynamic_cast<Worker*>(it->second)->DeregisterTable(worker_table_id);
+}
+
 }  // namespace multiverso